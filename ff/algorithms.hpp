@@ -0,0 +1,528 @@
+/* -*- Mode: C++; tab-width: 4; c-basic-offset: 4; indent-tabs-mode: nil -*- */
+
+/*!
+ *  \file algorithms.hpp
+ *  \ingroup high_level_patterns
+ *
+ *  \brief Parallel versions of some std:: algorithms (sort, partition,
+ *  merge, set operations, ...) running on the ParallelFor Workers.
+ *
+ */
+
+/* ***************************************************************************
+ *
+ *  FastFlow is free software; you can redistribute it and/or modify it
+ *  under the terms of the GNU Lesser General Public License version 3 as
+ *  published by the Free Software Foundation.
+ *  Starting from version 3.0.1 FastFlow is dual licensed under the GNU LGPLv3
+ *  or MIT License (https://github.com/ParaGroup/WindFlow/blob/vers3.x/LICENSE.MIT)
+ *
+ *  This program is distributed in the hope that it will be useful, but WITHOUT
+ *  ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ *  FITNESS FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public
+ *  License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public License
+ *  along with this program; if not, write to the Free Software Foundation,
+ *  Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ *
+ ****************************************************************************
+ */
+
+/*
+ *  All the algorithms of the ParallelAlgorithms class are written as a
+ *  sequence of ParallelFor loops over the blocks of the input range (one
+ *  block per Worker) separated by short sequential steps (e.g. the prefix
+ *  sum of the counters of the blocks), so they use the Worker threads of
+ *  the ParallelFor, with their mapping on the cores, and no other thread.
+ *
+ *  The ranges are given with random access iterators. Ranges shorter than
+ *  FF_ALGORITHMS_BLOCK elements per Worker are handled by the sequential
+ *  std:: algorithm. The algorithms that need a temporary buffer (sort,
+ *  stable_sort, partition, unique) require a value type that is default
+ *  constructible and move assignable.
+ *
+ */
+
+#ifndef FF_ALGORITHMS_HPP
+#define FF_ALGORITHMS_HPP
+
+#include <vector>
+#include <iterator>
+#include <algorithm>
+#include <functional>
+#include <ff/parallel_for.hpp>
+
+namespace ff {
+
+/*!
+  * \class ParallelAlgorithms
+  *  \ingroup high_level_patterns
+  *
+  * \brief Parallel sort, stable_sort, partition, unique, merge, set
+  * operations, transform_reduce and histogram.
+  *
+  * - sort is a sample sort: the elements are distributed in buckets
+  *   delimited by splitters taken from a sample of the input, and the buckets
+  *   are sorted in parallel (dynamically scheduled);
+  * - stable_sort is a merge sort: the blocks are sorted in parallel and then
+  *   merged in pairs, each merge is split among the Workers along the merge
+  *   path (as merge);
+  * - partition is stable (as std::stable_partition) and unique keeps the
+  *   first element of each group of equal elements (as std::unique);
+  * - the set operations have the semantics of the std:: ones, also when the
+  *   ranges contain repeated elements.
+  *
+  * The object extends ParallelFor, so the same Workers can also be used to
+  * run parallel_for loops.
+  *
+  * Example:
+  * \code
+  *   ParallelAlgorithms pa(8);
+  *   pa.sort(V.begin(), V.end());
+  *   auto odd = pa.partition(V.begin(), V.end(), [](long x) { return x&1; });
+  *   long sum = pa.transform_reduce(V.begin(), V.end(), 0L, std::plus<long>(),
+  *                                  [](long x) { return x*x; });
+  * \endcode
+  */
+class ParallelAlgorithms: public ParallelFor {
+protected:
+    // counts the elements written by a std:: algorithm
+    struct counter_iterator {
+        typedef std::output_iterator_tag iterator_category;
+        typedef void                     value_type;
+        typedef std::ptrdiff_t           difference_type;
+        typedef void                     pointer;
+        typedef void                     reference;
+
+        long n = 0;
+        counter_iterator& operator*()     { return *this; }
+        counter_iterator& operator++()    { ++n; return *this; }
+        counter_iterator  operator++(int) { counter_iterator t(*this); ++n; return t; }
+        template<typename T>
+        counter_iterator& operator=(const T&) { return *this; }
+    };
+
+    // bounds of block b of nb blocks of (0,n(
+    static inline void block(const long n, const long b, const long nb, long &start, long &stop) {
+        const long q = n/nb, r = n%nb;
+        start = b*q + (std::min)(b, r);
+        stop  = start + q + (b<r ? 1 : 0);
+    }
+
+    // number of blocks of a range of n elements
+    inline long nblocks(const long n, const long nw) const {
+        const long nb = (nw<=0) ? (long)getNWorkers() : (std::min)(nw, (long)getNWorkers());
+        return (std::max)(1L, (std::min)(nb, n/FF_ALGORITHMS_BLOCK));
+    }
+
+    // f(b) for each block b, block b is executed by Worker b
+    template<typename Function>
+    inline void forblocks(const long nb, const Function& f) {
+        if (nb==1) { f(0); return; }
+        parallel_for_static(0, nb, 1, 0, f, nb);
+    }
+
+    /*
+     * Number of elements of a in the first d elements of the stable merge of
+     * a (n1 elements) and b (n2 elements), the elements of a come first
+     * among the equal ones.
+     */
+    template<typename It1, typename It2, typename Compare>
+    static inline long corank(const long d, It1 a, const long n1, It2 b, const long n2,
+                              const Compare& cmp) {
+        long lo = (std::max)(0L, d-n2), hi = (std::min)(d, n1);
+        while(lo<hi) {
+            const long mid = lo + (hi-lo)/2;
+            if (!cmp(b[d-mid-1], a[mid])) lo = mid+1;
+            else hi = mid;
+        }
+        return lo;
+    }
+
+    // merges the q-th of nq equal parts of the output of the merge of a and b
+    template<typename It1, typename It2, typename Out, typename Compare>
+    static inline void merge_part(It1 a, const long n1, It2 b, const long n2, Out out,
+                                  const long q, const long nq, const Compare& cmp) {
+        const long n  = n1+n2;
+        const long d0 = (n*q)/nq, d1 = (n*(q+1))/nq;
+        const long i0 = corank(d0, a, n1, b, n2, cmp);
+        const long i1 = corank(d1, a, n1, b, n2, cmp);
+        std::merge(a+i0, a+i1, b+(d0-i0), b+(d1-i1), out+d0, cmp);
+    }
+
+    /*
+     * Set operations: the two ranges are split in nb parts along the merge
+     * path, then the split points are moved at the first element not less
+     * than the element of the merge at the split, so that the equal elements
+     * of both ranges are in the same part. The size of the output of each
+     * part is computed in a first pass, the parts are written in a second pass.
+     */
+    template<typename It1, typename It2, typename Out, typename Compare, typename SetOp>
+    inline Out set_operation(It1 first1, It1 last1, It2 first2, It2 last2, Out out,
+                             const Compare& cmp, const SetOp& op, const long nw) {
+        const long n1 = last1-first1, n2 = last2-first2;
+        const long nb = nblocks(n1+n2, nw);
+        if (nb==1) return op(first1, last1, first2, last2, out);
+
+        std::vector<long> ia(nb+1), ib(nb+1), off(nb+1);
+        ia[0] = ib[0] = 0;
+        ia[nb] = n1;  ib[nb] = n2;
+        for(long q=1;q<nb;++q) {
+            const long d = ((n1+n2)*q)/nb;
+            const long i = corank(d, first1, n1, first2, n2, cmp), j = d-i;
+            // the d-th element of the merge
+            if (i<n1 && (j>=n2 || !cmp(first2[j], first1[i]))) {
+                ia[q] = std::lower_bound(first1, last1, first1[i], cmp) - first1;
+                ib[q] = std::lower_bound(first2, last2, first1[i], cmp) - first2;
+            } else {
+                ia[q] = std::lower_bound(first1, last1, first2[j], cmp) - first1;
+                ib[q] = std::lower_bound(first2, last2, first2[j], cmp) - first2;
+            }
+        }
+        forblocks(nb, [&](const long q) {
+                off[q+1] = op(first1+ia[q], first1+ia[q+1], first2+ib[q], first2+ib[q+1],
+                              counter_iterator()).n;
+            });
+        off[0] = 0;
+        for(long q=0;q<nb;++q) off[q+1] += off[q];
+        forblocks(nb, [&](const long q) {
+                op(first1+ia[q], first1+ia[q+1], first2+ib[q], first2+ib[q+1], out+off[q]);
+            });
+        return out+off[nb];
+    }
+
+public:
+    /**
+     * \brief Constructor
+     * \param maxnw Maximum number of worker threads
+     * \param spinwait \p true nonblocking, \p false blocking (see ParallelFor)
+     * \param spinbarrier \p true it uses a spinning barrier
+     */
+    explicit ParallelAlgorithms(const long maxnw=FF_AUTO, bool spinwait=false, bool spinbarrier=false):
+        ParallelFor(maxnw, spinwait, spinbarrier) {}
+
+    /**
+     * \brief <b>reduce(... reduce(reduce(init, transform(*first)), transform(*(first+1))) ...)</b>
+     *
+     * \p reduce has to be associative, it needs not be commutative.
+     */
+    template<typename Iter, typename T, typename Reduce, typename Transform>
+    inline T transform_reduce(Iter first, Iter last, T init, const Reduce& reduce,
+                              const Transform& transform, const long nw=FF_AUTO) {
+        const long n = last-first;
+        if (n<=0) return init;
+        const long nb = nblocks(n, nw);
+        std::vector<T> partial(nb, init);
+        forblocks(nb, [&](const long b) {
+                long start, stop;
+                block(n, b, nb, start, stop);
+                T s = transform(first[start]);
+                for(long i=start+1;i<stop;++i) s = reduce(s, transform(first[i]));
+                partial[b] = s;
+            });
+        for(long b=0;b<nb;++b) init = reduce(init, partial[b]);
+        return init;
+    }
+
+    /**
+     * \brief Histogram of the range
+     *
+     * \param nbins number of bins
+     * \param bin <b>long bin(const value_type&)</b> the bin of an element,
+     * elements with a bin out of (0,nbins( are not counted
+     * \return the number of elements in each bin
+     */
+    template<typename Iter, typename Bin>
+    inline std::vector<long> histogram(Iter first, Iter last, const long nbins, const Bin& bin,
+                                       const long nw=FF_AUTO) {
+        std::vector<long> H(nbins>0 ? nbins : 0, 0);
+        const long n = last-first;
+        if (n<=0 || nbins<=0) return H;
+        const long nb = nblocks(n, nw);
+        std::vector<long> Hb(nb*nbins, 0);
+        forblocks(nb, [&](const long b) {
+                long start, stop;
+                block(n, b, nb, start, stop);
+                long *h = Hb.data() + b*nbins;
+                for(long i=start;i<stop;++i) {
+                    const long k = bin(first[i]);
+                    if (k>=0 && k<nbins) ++h[k];
+                }
+            });
+        for(long b=0;b<nb;++b)
+            for(long k=0;k<nbins;++k) H[k] += Hb[b*nbins+k];
+        return H;
+    }
+
+    /**
+     * \brief Stable partition: the elements for which \p pred is true are
+     * moved before the others, the relative order is kept in both groups.
+     *
+     * \return the first element for which \p pred is false
+     */
+    template<typename Iter, typename Predicate>
+    inline Iter partition(Iter first, Iter last, const Predicate& pred, const long nw=FF_AUTO) {
+        typedef typename std::iterator_traits<Iter>::value_type value_type;
+        const long n = last-first;
+        const long nb = nblocks(n, nw);
+        if (nb==1) return std::stable_partition(first, last, pred);
+
+        std::vector<unsigned char> flag(n);
+        std::vector<long> cnt(nb+1, 0);
+        forblocks(nb, [&](const long b) {
+                long start, stop;
+                block(n, b, nb, start, stop);
+                long c = 0;
+                for(long i=start;i<stop;++i) c += (flag[i] = pred(first[i]) ? 1 : 0);
+                cnt[b+1] = c;
+            });
+        for(long b=0;b<nb;++b) cnt[b+1] += cnt[b];
+        const long ntrue = cnt[nb];
+
+        std::vector<value_type> tmp(n);
+        forblocks(nb, [&](const long b) {
+                long start, stop;
+                block(n, b, nb, start, stop);
+                long t = cnt[b], f = ntrue + start - cnt[b];
+                for(long i=start;i<stop;++i)
+                    tmp[flag[i] ? t++ : f++] = std::move(first[i]);
+            });
+        forblocks(nb, [&](const long b) {
+                long start, stop;
+                block(n, b, nb, start, stop);
+                std::move(tmp.begin()+start, tmp.begin()+stop, first+start);
+            });
+        return first+ntrue;
+    }
+
+    /**
+     * \brief Removes all but the first element of each group of consecutive
+     * equal elements.
+     *
+     * \return the new end of the range
+     */
+    template<typename Iter, typename BinaryPredicate =
+             std::equal_to<typename std::iterator_traits<Iter>::value_type> >
+    inline Iter unique(Iter first, Iter last, const BinaryPredicate& eq = BinaryPredicate(),
+                       const long nw=FF_AUTO) {
+        typedef typename std::iterator_traits<Iter>::value_type value_type;
+        const long n = last-first;
+        const long nb = nblocks(n, nw);
+        if (nb==1) return std::unique(first, last, eq);
+
+        // the first element of a block is compared with the last one of the
+        // previous block, so the flags are computed before moving the elements
+        std::vector<unsigned char> flag(n);
+        std::vector<long> cnt(nb+1, 0);
+        forblocks(nb, [&](const long b) {
+                long start, stop;
+                block(n, b, nb, start, stop);
+                long c = 0;
+                for(long i=start;i<stop;++i) c += (flag[i] = (i==0 || !eq(first[i-1], first[i])));
+                cnt[b+1] = c;
+            });
+        for(long b=0;b<nb;++b) cnt[b+1] += cnt[b];
+        const long m = cnt[nb];
+
+        std::vector<value_type> tmp(m);
+        forblocks(nb, [&](const long b) {
+                long start, stop;
+                block(n, b, nb, start, stop);
+                long k = cnt[b];
+                for(long i=start;i<stop;++i)
+                    if (flag[i]) tmp[k++] = std::move(first[i]);
+            });
+        forblocks(nb, [&](const long b) {
+                std::move(tmp.begin()+cnt[b], tmp.begin()+cnt[b+1], first+cnt[b]);
+            });
+        return first+m;
+    }
+
+    /**
+     * \brief Stable merge of two sorted ranges into \p out (as std::merge),
+     * the output is split in equal parts among the Workers.
+     *
+     * \return the end of the output
+     */
+    template<typename It1, typename It2, typename Out, typename Compare =
+             std::less<typename std::iterator_traits<It1>::value_type> >
+    inline Out merge(It1 first1, It1 last1, It2 first2, It2 last2, Out out,
+                     const Compare& cmp = Compare(), const long nw=FF_AUTO) {
+        const long n1 = last1-first1, n2 = last2-first2;
+        const long nb = nblocks(n1+n2, nw);
+        if (nb==1) return std::merge(first1, last1, first2, last2, out, cmp);
+        forblocks(nb, [&](const long q) {
+                merge_part(first1, n1, first2, n2, out, q, nb, cmp);
+            });
+        return out+(n1+n2);
+    }
+
+    /**
+     * \brief Sort (not stable)
+     */
+    template<typename Iter, typename Compare =
+             std::less<typename std::iterator_traits<Iter>::value_type> >
+    inline void sort(Iter first, Iter last, const Compare& cmp = Compare(), const long nw=FF_AUTO) {
+        typedef typename std::iterator_traits<Iter>::value_type value_type;
+        const long n = last-first;
+        const long nb = nblocks(n, nw);
+        if (nb==1) { std::sort(first, last, cmp); return; }
+
+        // more buckets than Workers to balance the load of the last step
+        const long nk = 4*nb, os = 32;
+        std::vector<value_type> S(nk*os);
+        const long stride = n/(nk*os);
+        unsigned long seed = 1;
+        for(long s=0;s<nk*os;++s) {
+            seed = seed*6364136223846793005UL + 1442695040888963407UL;
+            S[s] = first[s*stride + (long)((seed>>33) % (unsigned long)stride)];
+        }
+        std::sort(S.begin(), S.end(), cmp);
+        std::vector<value_type> splitter(nk-1);
+        for(long k=0;k<nk-1;++k) splitter[k] = S[(k+1)*os];
+
+        // bucket of each element and elements of each bucket in each block
+        std::vector<unsigned> bucket(n);
+        std::vector<long> cnt(nb*nk, 0);
+        forblocks(nb, [&](const long b) {
+                long start, stop;
+                block(n, b, nb, start, stop);
+                long *c = cnt.data() + b*nk;
+                for(long i=start;i<stop;++i) {
+                    const long k = std::upper_bound(splitter.begin(), splitter.end(), first[i], cmp)
+                        - splitter.begin();
+                    bucket[i] = (unsigned)k;
+                    ++c[k];
+                }
+            });
+        // position in tmp of the elements of bucket k of block b
+        std::vector<long> bstart(nk+1);
+        long pos = 0;
+        for(long k=0;k<nk;++k) {
+            bstart[k] = pos;
+            for(long b=0;b<nb;++b) {
+                const long c = cnt[b*nk+k];
+                cnt[b*nk+k] = pos;
+                pos += c;
+            }
+        }
+        bstart[nk] = n;
+
+        std::vector<value_type> tmp(n);
+        forblocks(nb, [&](const long b) {
+                long start, stop;
+                block(n, b, nb, start, stop);
+                long *c = cnt.data() + b*nk;
+                for(long i=start;i<stop;++i) tmp[c[bucket[i]]++] = std::move(first[i]);
+            });
+        // the buckets may have different size, they are scheduled dynamically
+        parallel_for(0, nk, 1, 1, [&](const long k) {
+                std::sort(tmp.begin()+bstart[k], tmp.begin()+bstart[k+1], cmp);
+                std::move(tmp.begin()+bstart[k], tmp.begin()+bstart[k+1], first+bstart[k]);
+            }, nb);
+    }
+
+    /**
+     * \brief Stable sort
+     */
+    template<typename Iter, typename Compare =
+             std::less<typename std::iterator_traits<Iter>::value_type> >
+    inline void stable_sort(Iter first, Iter last, const Compare& cmp = Compare(),
+                            const long nw=FF_AUTO) {
+        typedef typename std::iterator_traits<Iter>::value_type value_type;
+        const long n = last-first;
+        const long nb = nblocks(n, nw);
+        if (nb==1) { std::stable_sort(first, last, cmp); return; }
+
+        std::vector<long> run(nb+1);
+        for(long b=0;b<nb;++b) { long stop; block(n, b, nb, run[b], stop); }
+        run[nb] = n;
+        forblocks(nb, [&](const long b) {
+                std::stable_sort(first+run[b], first+run[b+1], cmp);
+            });
+
+        // the runs are merged in pairs, the data go back and forth between
+        // the input range and tmp
+        std::vector<value_type> tmp(n);
+        bool intmp = false;
+        while(run.size()>2) {
+            const long nr = (long)run.size()-1, npairs = nr/2;
+            const long nq = (std::max)(1L, nb/npairs);
+            // tasks: nq parts for each pair, plus the copy of the last run if nr is odd
+            const long ntasks = npairs*nq + (nr&1);
+            auto task = [&](const long t) {
+                auto doit = [&](auto src, auto dst) {
+                    if (t == npairs*nq) {
+                        std::move(src+run[nr-1], src+run[nr], dst+run[nr-1]);
+                        return;
+                    }
+                    const long p = t/nq, q = t%nq;
+                    const long l = run[2*p], m = run[2*p+1], r = run[2*p+2];
+                    merge_part(std::make_move_iterator(src+l), m-l,
+                               std::make_move_iterator(src+m), r-m, dst+l, q, nq, cmp);
+                };
+                if (intmp) doit(tmp.begin(), first);
+                else       doit(first, tmp.begin());
+            };
+            if (ntasks==1) task(0);
+            else parallel_for(0, ntasks, 1, 1, task, nb);
+            std::vector<long> next;
+            for(long r=0;r<nr;r+=2) next.push_back(run[r]);
+            next.push_back(n);
+            run.swap(next);
+            intmp = !intmp;
+        }
+        if (intmp)
+            forblocks(nb, [&](const long b) {
+                    long start, stop;
+                    block(n, b, nb, start, stop);
+                    std::move(tmp.begin()+start, tmp.begin()+stop, first+start);
+                });
+    }
+
+    /// \brief Union of two sorted ranges (as std::set_union)
+    template<typename It1, typename It2, typename Out, typename Compare =
+             std::less<typename std::iterator_traits<It1>::value_type> >
+    inline Out set_union(It1 first1, It1 last1, It2 first2, It2 last2, Out out,
+                         const Compare& cmp = Compare(), const long nw=FF_AUTO) {
+        return set_operation(first1, last1, first2, last2, out, cmp,
+                             [&](It1 a0, It1 a1, It2 b0, It2 b1, auto o) {
+                                 return std::set_union(a0, a1, b0, b1, o, cmp);
+                             }, nw);
+    }
+    /// \brief Intersection of two sorted ranges (as std::set_intersection)
+    template<typename It1, typename It2, typename Out, typename Compare =
+             std::less<typename std::iterator_traits<It1>::value_type> >
+    inline Out set_intersection(It1 first1, It1 last1, It2 first2, It2 last2, Out out,
+                                const Compare& cmp = Compare(), const long nw=FF_AUTO) {
+        return set_operation(first1, last1, first2, last2, out, cmp,
+                             [&](It1 a0, It1 a1, It2 b0, It2 b1, auto o) {
+                                 return std::set_intersection(a0, a1, b0, b1, o, cmp);
+                             }, nw);
+    }
+    /// \brief Difference of two sorted ranges (as std::set_difference)
+    template<typename It1, typename It2, typename Out, typename Compare =
+             std::less<typename std::iterator_traits<It1>::value_type> >
+    inline Out set_difference(It1 first1, It1 last1, It2 first2, It2 last2, Out out,
+                              const Compare& cmp = Compare(), const long nw=FF_AUTO) {
+        return set_operation(first1, last1, first2, last2, out, cmp,
+                             [&](It1 a0, It1 a1, It2 b0, It2 b1, auto o) {
+                                 return std::set_difference(a0, a1, b0, b1, o, cmp);
+                             }, nw);
+    }
+    /// \brief Symmetric difference of two sorted ranges (as std::set_symmetric_difference)
+    template<typename It1, typename It2, typename Out, typename Compare =
+             std::less<typename std::iterator_traits<It1>::value_type> >
+    inline Out set_symmetric_difference(It1 first1, It1 last1, It2 first2, It2 last2, Out out,
+                                        const Compare& cmp = Compare(), const long nw=FF_AUTO) {
+        return set_operation(first1, last1, first2, last2, out, cmp,
+                             [&](It1 a0, It1 a1, It2 b0, It2 b1, auto o) {
+                                 return std::set_symmetric_difference(a0, a1, b0, b1, o, cmp);
+                             }, nw);
+    }
+};
+
+} // namespace ff
+
+#endif /* FF_ALGORITHMS_HPP */
@@ -57,6 +57,14 @@ protected:
     }
 
     inline int prepare() {
+        // the slots of the by_value channels must be given back (see by_value)
+        for(size_t i=0;i<workers1.size();++i)
+            if (workers1[i]->value_output())
+                for(size_t j=0;j<workers2.size();++j)
+                    if (!workers2[j]->value_input()) {
+                        error("A2A, right-hand side node %ld receives by_value tasks but it is not a by_value node\n", j);
+                        return -1;
+                    }
         /* ----------------------- */
         if (wraparound) {   
             if (workers2[0]->isMultiOutput()) { // NOTE: we suppose that all others are the same
@@ -237,6 +245,12 @@ protected:
                     w[k]->set_scheduling_ondemand(ondemand_chunk);                
                 //workers1[i]->set_scheduling_ondemand(ondemand_chunk);
             }
+            if (keyrouter) {
+                svector<ff_node*> w;
+                workers1[i]->get_out_nodes(w);
+                for(size_t k=0;k<w.size(); ++k)
+                    w[k]->set_scheduling_bykey(*keyrouter);
+            }
             workers1[i]->set_id(int(i));
         }
         // checking R-Workers
@@ -360,6 +374,7 @@ public:
         out_buffer_entries   = p.out_buffer_entries;
         wraparound           = p.wraparound;
         ondemand_chunk       = p.ondemand_chunk;
+        if (p.keyrouter) keyrouter = new ff_keyrouter(*p.keyrouter);
         outputNodes          = p.outputNodes;
         internalSupportNodes = p.internalSupportNodes;
 
@@ -370,6 +385,7 @@ public:
     
     virtual ~ff_a2a() {
         if (barrier) delete barrier;
+        if (keyrouter) delete keyrouter;
         for(size_t i=0;i<workers1.size();++i)
             workers1[i] = nullptr;        
         for(size_t i=0;i<workers2.size();++i) 
@@ -512,6 +528,12 @@ public:
         blocking_in = blocking_out = blk;
     }
 
+    void set_backoff(const ff_backoff &policy) {
+        ff_node::set_backoff(policy);
+        for(size_t i=0;i<workers1.size(); ++i) workers1[i]->set_backoff(policy);
+        for(size_t i=0;i<workers2.size(); ++i) workers2[i]->set_backoff(policy);
+    }
+
     void no_mapping() {
         default_mapping = false;
     }
@@ -626,6 +648,31 @@ public:
     const svector<ff_node*>& getSecondSet() const { return workers2; }
 
     int ondemand_buffer() const { return ondemand_chunk; }
+
+    /**
+     * \brief Set the keyed scheduling between the two sets
+     *
+     * Each node of the first set sends its tasks to the node of the second
+     * set selected by the key of the task. All the nodes of the first set 
+     * use the same mapping, so all the tasks with the same key reach the 
+     * same node of the second set (see ff_farm::set_scheduling_bykey).
+     * It must be called before running the all-to-all.
+     */
+    void set_scheduling_bykey(ff_keyrouter::key_t key, bool consistent=false, bool rebalance=false) {
+        set_scheduling_bykey(ff_keyrouter(key, consistent, rebalance));
+    }
+    template<typename T, typename F>
+    void set_scheduling_bykey(F key, bool consistent=false, bool rebalance=false) {
+        set_scheduling_bykey(ff_keyof<T>(key), consistent, rebalance);
+    }
+    void set_scheduling_bykey(const ff_keyrouter &router) {
+        if (prepared) {
+            error("A2A, set_scheduling_bykey, all-to-all already prepared\n");
+            return;
+        }
+        if (keyrouter) delete keyrouter;
+        keyrouter = new ff_keyrouter(router);
+    }
     
     int numThreads() const { return cardinality(); }
 
@@ -660,6 +707,17 @@ public:
             w += getFirstSet();
     }
 
+    bool value_input() const {
+        for(size_t i=0;i<workers1.size();++i)
+            if (!workers1[i]->value_input()) return false;
+        return workers1.size()>0;
+    }
+    bool value_output() const {
+        for(size_t i=0;i<workers2.size();++i)
+            if (workers2[i]->value_output()) return true;
+        return false;
+    }
+
 
     /**
      * \brief Feedback channel (pattern modifier)
@@ -766,6 +824,13 @@ protected:
     bool isMultiOutput() const { return true;}
     bool isAll2All()     const { return true; }    
 
+    // the nodes of the first set share the histogram "L", the ones of the second set "R"
+    void latency_attach(ff_latency_tracer *t, const std::string &name) {
+        const std::string prefix = name.empty() ? name : name + ".";
+        for(size_t i=0;i<workers1.size();++i) workers1[i]->latency_attach(t, prefix + "L");
+        for(size_t i=0;i<workers2.size();++i) workers2[i]->latency_attach(t, prefix + "R");
+    }
+
     int create_input_buffer(int nentries, bool fixedsize=FF_FIXED_SIZE) {
         size_t nworkers1 = workers1.size();
         for(size_t i=0;i<nworkers1; ++i)
@@ -838,6 +903,7 @@ protected:
     bool wraparound=false;
     int in_buffer_entries, out_buffer_entries;
     int ondemand_chunk=0;
+    ff_keyrouter* keyrouter=nullptr;
     svector<ff_node*>  workers1;  // first set, nodes must be multi-output
     svector<ff_node*>  workers2;  // second set, nodes must be multi-input
     svector<ff_node*>  outputNodes;
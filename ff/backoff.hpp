@@ -0,0 +1,235 @@
+/* -*- Mode: C++; tab-width: 4; c-basic-offset: 4; indent-tabs-mode: nil -*- */
+
+/*!
+ * \file backoff.hpp
+ * \ingroup building_blocks
+ *
+ * \brief Backoff policies used by the nonblocking run-time when a channel
+ * is empty (or full)
+ *
+ */
+
+#ifndef FF_BACKOFF_HPP
+#define FF_BACKOFF_HPP
+
+/* ***************************************************************************
+ *
+ *  FastFlow is free software; you can redistribute it and/or modify it
+ *  under the terms of the GNU Lesser General Public License version 3 as
+ *  published by the Free Software Foundation.
+ *  Starting from version 3.0.1 FastFlow is dual licensed under the GNU LGPLv3
+ *  or MIT License (https://github.com/ParaGroup/WindFlow/blob/vers3.x/LICENSE.MIT)
+ *
+ *  This program is distributed in the hope that it will be useful, but WITHOUT
+ *  ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ *  FITNESS FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public
+ *  License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public License
+ *  along with this program; if not, write to the Free Software Foundation,
+ *  Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ *
+ ****************************************************************************
+ */
+
+#include <thread>
+#include <ff/config.hpp>
+#include <ff/utils.hpp>
+#include <ff/parking.hpp>
+
+namespace ff {
+
+/*!
+ * \class ff_backoff
+ * \ingroup building_blocks
+ *
+ * \brief Base class of the backoff policies
+ *
+ * A backoff policy decides what a thread does each time it finds its input
+ * channel(s) empty (or its output channel full) in the nonblocking run-time.
+ * It is set at run-time on nodes, farms and pipelines (see
+ * \p ff_node::set_backoff), each channel side gets its own copy of the policy
+ * (see \p clone).
+ *
+ * Consecutive calls of \p wait with no useful work in between form a waiting
+ * phase. The object records the number of waits, the number of waiting
+ * phases and the cycles actually spent waiting.
+ */
+class ff_backoff {
+public:
+    ff_backoff():waitticks(0),nwaits(0),nphases(0),last(0),phase_start(0) {}
+    virtual ~ff_backoff() {}
+
+    /// a new policy object of the same kind, with no statistics
+    virtual ff_backoff* clone() const = 0;
+    virtual const char* name() const = 0;
+    /// the parking object to be installed in the channels, if any
+    virtual ff_parking* parking() { return nullptr; }
+
+    /**
+     * \brief called each time the channel is found empty (or full)
+     *
+     * \param nticks default amount of time spent in each wait
+     */
+    inline void wait(unsigned long nticks) {
+        const ticks t0 = getticks();
+        if ((t0 - last) > (ticks)(FF_BACKOFF_GAP*nticks)) {
+            if (nphases) newphase(last - phase_start);
+            phase_start = t0;
+            ++nphases;
+        }
+        backoff(nticks, t0 - phase_start);
+        last = getticks();
+        waitticks += last - t0;
+        ++nwaits;
+    }
+
+    /// cycles spent waiting on the channel
+    inline ticks  get_waitticks() const { return waitticks; }
+    inline size_t get_nwaits()    const { return nwaits; }
+    inline size_t get_nphases()   const { return nphases; }
+
+protected:
+    /**
+     * \brief called when a new waiting phase starts
+     *
+     * \param prev duration of the previous waiting phase, i.e. how long
+     * the thread waited for the last task (or free slot) to arrive
+     */
+    virtual void newphase(ticks /*prev*/) {}
+    /**
+     * \brief the actual waiting
+     *
+     * \param nticks default amount of time spent in each wait
+     * \param waited time elapsed since the beginning of the waiting phase
+     */
+    virtual void backoff(unsigned long nticks, ticks waited) = 0;
+
+    ticks  waitticks;
+    size_t nwaits;
+    size_t nphases;
+    ticks  last;
+    ticks  phase_start;
+};
+
+/*!
+ * \class ff_backoff_spin
+ * \ingroup building_blocks
+ *
+ * \brief Busy waiting for a fixed amount of time (the default behaviour)
+ */
+class ff_backoff_spin: public ff_backoff {
+public:
+    ff_backoff* clone() const { return new ff_backoff_spin; }
+    const char* name() const { return "spin"; }
+protected:
+    void backoff(unsigned long nticks, ticks) {
+#if defined(SPIN_USE_PAUSE)
+        const long n = (long)nticks/2000;
+        for(int i=0;i<=n;++i) PAUSE();
+#else
+        ticks_wait(nticks);
+#endif /* SPIN_USE_PAUSE */
+    }
+};
+
+/*!
+ * \class ff_backoff_exp
+ * \ingroup building_blocks
+ *
+ * \brief Exponential backoff
+ *
+ * The waiting time starts from \p min ticks and doubles at each wait of
+ * the same waiting phase, up to \p max ticks.
+ */
+class ff_backoff_exp: public ff_backoff {
+public:
+    ff_backoff_exp(ticks min=BACKOFF_MIN, ticks max=BACKOFF_MAX):
+        min(min),max(max),delay(min) {}
+    ff_backoff* clone() const { return new ff_backoff_exp(min,max); }
+    const char* name() const { return "exponential"; }
+protected:
+    void newphase(ticks) { delay = min; }
+    void backoff(unsigned long, ticks) {
+        ticks_wait(delay);
+        if (delay < max) delay = (std::min)(2*delay, max);
+    }
+    const ticks min, max;
+    ticks delay;
+};
+
+/*!
+ * \class ff_backoff_adaptive
+ * \ingroup building_blocks
+ *
+ * \brief Backoff driven by the observed arrival rate
+ *
+ * The policy keeps a moving average of the length of the waiting phases.
+ * While the current phase is not longer than twice the average, a new task
+ * (or slot) is expected soon and the thread spins with a step proportional
+ * to the average. When the phase lasts longer, the thread yields its core.
+ */
+class ff_backoff_adaptive: public ff_backoff {
+public:
+    ff_backoff_adaptive():avg(0) {}
+    ff_backoff* clone() const { return new ff_backoff_adaptive; }
+    const char* name() const { return "adaptive"; }
+    /// moving average of the waiting phases (ticks)
+    ticks get_average() const { return avg; }
+protected:
+    void newphase(ticks prev) {
+        avg = avg ? (3*avg + prev)/4 : prev;
+    }
+    void backoff(unsigned long nticks, ticks waited) {
+        if (avg == 0) { ticks_wait(nticks); return; }   // nothing learned yet
+        if (waited <= 2*avg) {
+            ticks_wait((std::max)((ticks)BACKOFF_MIN, (std::min)(avg/8, (ticks)nticks)));
+            return;
+        }
+        std::this_thread::yield();
+    }
+    ticks avg;
+};
+
+/*!
+ * \class ff_backoff_yield
+ * \ingroup building_blocks
+ *
+ * \brief Yields the core at each wait
+ */
+class ff_backoff_yield: public ff_backoff {
+public:
+    ff_backoff* clone() const { return new ff_backoff_yield; }
+    const char* name() const { return "yield"; }
+protected:
+    void backoff(unsigned long, ticks) { std::this_thread::yield(); }
+};
+
+/*!
+ * \class ff_backoff_park
+ * \ingroup building_blocks
+ *
+ * \brief Adaptive spin-then-park (see ff_parking)
+ *
+ * The parking object is installed in the channels when the thread starts,
+ * so that the thread at the other end of the channel can wake it up.
+ * It is the default policy if SPINPARK_MODE is defined. The channels wake
+ * up the parked threads only if FF_BACKOFF_PARKING is defined (see
+ * config.hpp), the policy is not available without it.
+ */
+#if defined(FF_BACKOFF_PARKING)
+class ff_backoff_park: public ff_backoff {
+public:
+    ff_backoff* clone() const { return new ff_backoff_park; }
+    const char* name() const { return "park"; }
+    size_t get_nparks() const { return park.get_nparks(); }
+    ff_parking* parking() { return &park; }
+protected:
+    void backoff(unsigned long nticks, ticks) { park.wait(nticks); }
+    ff_parking park;
+};
+#endif /* FF_BACKOFF_PARKING */
+
+} // namespace ff
+
+#endif /* FF_BACKOFF_HPP */
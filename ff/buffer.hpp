@@ -13,6 +13,11 @@
  * 
  *  A single NULL value is used to indicate buffer full and 
  *  buffer empty conditions.
+ *
+ *  Optionally (see \p set_lookahead) both the producer and the consumer 
+ *  probe a slot N entries ahead and then run free on the N slots
+ *  preceding it (B-Queue batched lookahead), so that the NULL check is 
+ *  not executed on every push/pop.
  * 
  *  More details about the SWSR_Ptr_Buffer implementation 
  *  can be found in:
@@ -87,6 +92,19 @@ static const int longxCacheLine = (CACHE_LINE_SIZE/sizeof(long));
   * A single NULL value is used to indicate buffer full and buffer empty
   * conditions.
   *
+  * With lookahead N>1 (see \p set_lookahead) the producer checks the 
+  * slot N-1 entries ahead of the write pointer: if it is NULL then all 
+  * the N slots up to it are free as well, since the consumer releases
+  * slots in FIFO order. The number of free slots found is cached locally
+  * and the following N pushes do not touch the slots' contents before 
+  * writing them. The consumer does the same looking for non-NULL slots. 
+  * If the probe fails, the distance is halved (back-tracking) down to 1, 
+  * which is the classic behaviour. Producer and consumer therefore stop 
+  * contending for the same cache line when the queue is near-empty or 
+  * near-full. 
+  * Ref: J. Wang et al., "B-Queue: Efficient and Practical Queuing for 
+  * Fast Core-to-Core Communication", IJPP 2013.
+  *
   * This class is defined in \ref buffer.hpp
   *
   */ 
@@ -101,22 +119,34 @@ class SWSR_Ptr_Buffer {
 private:
     // Padding is required to avoid false-sharing between 
     // core's private cache
+    // rfull (wfree) is the number of slots, starting from pread (pwrite),
+    // that the consumer (producer) already knows to be full (free).
+    // They are local to the consumer (producer), so they are kept in 
+    // the same cache line of the corresponding pointer.
 #if defined(NO_VOLATILE_POINTERS)
     unsigned long    pread;
-    long padding1[longxCacheLine-1];
+    unsigned long    rfull;
+    long padding1[longxCacheLine-2];
     unsigned long    pwrite;
-    long padding2[longxCacheLine-1];
+    unsigned long    wfree;
+    long padding2[longxCacheLine-2];
 #else
     ALIGN_TO_PRE(CACHE_LINE_SIZE)
     volatile unsigned long pread;
     ALIGN_TO_POST(CACHE_LINE_SIZE)
+    unsigned long          rfull;
 
     ALIGN_TO_PRE(CACHE_LINE_SIZE)
     volatile unsigned long pwrite;
     ALIGN_TO_POST(CACHE_LINE_SIZE)
+    unsigned long          wfree;
 #endif
     size_t     size;
     void    ** buf;
+    unsigned long lookahead;   // probing distance (1 means no lookahead)
+    long     numanode;         // NUMA node of the slots (see set_placement)
+    bool     hugepages;
+    size_t   bufbytes;         // != 0 if buf has been allocated by getPlacedMemory
     
 #if defined(SWSR_MULTIPUSH)
     /* massimot: experimental code (see multipush)
@@ -141,7 +171,8 @@ public:
      *  \param n the size of the buffer
      */
     SWSR_Ptr_Buffer(unsigned long n, const bool=true):
-        pread(0),pwrite(0),size(n),buf(0) {
+        pread(0),rfull(0),pwrite(0),wfree(0),size(n),buf(0),lookahead(1),
+        numanode(FF_NUMA_NONE),hugepages(false),bufbytes(0) {
         pushPMF=&SWSR_Ptr_Buffer::push;
         popPMF =&SWSR_Ptr_Buffer::pop;
         // Avoid unused private field warning on padding1, padding2
@@ -154,7 +185,8 @@ public:
      */
     ~SWSR_Ptr_Buffer() {
         // freeAlignedMemory is a function defined in 'sysdep.h'
-        freeAlignedMemory(buf);
+        if (bufbytes) freePlacedMemory(buf, bufbytes, hugepages);
+        else freeAlignedMemory(buf);
     }
     
     /** 
@@ -170,8 +202,13 @@ public:
 #if defined(SWSR_MULTIPUSH)
         if (size<MULTIPUSH_BUFFER_SIZE) return false;
 #endif
-        // getAlignedMemory is a function defined in 'sysdep.h'
-        buf=(void**)getAlignedMemory(longxCacheLine*sizeof(long),size*sizeof(void*));
+        if (numanode!=FF_NUMA_NONE || hugepages) {
+            // getPlacedMemory is a function defined in 'sysdep.h'
+            buf=(void**)getPlacedMemory(size*sizeof(void*), numanode, hugepages);
+            if (buf) bufbytes = size*sizeof(void*);
+        } else 
+            // getAlignedMemory is a function defined in 'sysdep.h'
+            buf=(void**)getAlignedMemory(longxCacheLine*sizeof(long),size*sizeof(void*));
         if (!buf) return false;
 
         reset(startatlineend);
@@ -179,6 +216,35 @@ public:
         return true;
     }
 
+    /**
+     * It sets the lookahead distance used by the producer and by the
+     * consumer to probe the buffer (see the class description). 
+     * The value is bounded by the buffer size, 1 (the default) disables 
+     * the lookahead. It should be called before using the buffer.
+     */
+    inline void set_lookahead(unsigned long n) {
+        lookahead = (n==0) ? 1 : n;
+    }
+    inline unsigned long get_lookahead() const { return lookahead; }
+
+    /**
+     * It sets where the slots of the buffer are allocated: on the NUMA 
+     * node \p node (FF_NUMA_NONE means first-touch) and, if \p huge is 
+     * true, on (transparent) huge pages. 
+     * If called before init, the placement is used for the allocation.
+     * If called after init, the slots already allocated by getPlacedMemory 
+     * are migrated to the new node (the hugepages flag cannot change).
+     */
+    inline void set_placement(long node, bool huge=false) {
+        if (!buf) { numanode = node; hugepages = huge; return; }
+        if (bufbytes && node>=0 && node != numanode) {
+            if (bindMemory(buf, placedMemorySize(bufbytes, hugepages), node)==0)
+                numanode = node;
+        }
+    }
+    inline long get_numanode() const { return numanode; }
+    inline bool get_hugepages() const { return hugepages; }
+
     /** 
      * It returns true if the buffer is empty.
      */
@@ -222,6 +288,7 @@ public:
     size_t changesize(size_t newsz) {
         size_t tmp=size;
         size=newsz;
+        rfull=wfree=0;
         return tmp;
     }
 
@@ -241,7 +308,7 @@ public:
     inline bool push(void * const data) {     /* modify only pwrite pointer */
         assert(data != NULL);
 
-        if (available()) {
+        if (wfree || (wfree=probe_w())) {
             /**
              * Write Memory Barrier: ensure all previous memory write 
              * are visible to the other processors before any later
@@ -254,6 +321,7 @@ public:
             //std::atomic_thread_fence(std::memory_order_release);
             buf[pwrite] = data;
             pwrite = pwrite + ((pwrite+1 >=  size) ? (1-size): 1); // circular buffer
+            --wfree;
             return true;
         }
         return false;
@@ -261,7 +329,12 @@ public:
 
     /**
      * The multipush method, which pushes a batch of elements (array) in the
-     * queue. NOTE: len should be a multiple of longxCacheLine/sizeof(void*)
+     * queue. The slots are filled backward so that the consumer sees the
+     * whole batch at once when the first slot is written (forward if the 
+     * lookahead is enabled).
+     * Either all the \p len elements are pushed or none of them is.
+     * NOTE: for performance reasons len should be a multiple of 
+     * longxCacheLine/sizeof(void*)
      *
      */
     inline bool multipush(void * const data[], int len) {
@@ -271,8 +344,16 @@ public:
         unsigned long i;
 
         if (buf[last]==NULL) {
-            
-            if (last < pwrite) {
+            WMB();
+            if (lookahead>1) { 
+                // the consumer may probe slots beyond pread, so they have to be 
+                // filled in FIFO order
+                l = pwrite;
+                for(int i=0;i<=len;++i) {
+                    buf[l] = data[i];
+                    l = l + ((l+1 >= size) ? (1-size): 1);
+                }
+            } else if (last < pwrite) {
                 for(i=len;i>r;--i,--l) 
                     buf[l] = data[i];
                 for(i=(size-1);i>=pwrite;--i,--r)
@@ -283,7 +364,8 @@ public:
                     buf[pwrite+i] = data[i];
             
             WMB();
-            pwrite = pwrite + ((last+1 >= size) ? 0 : (last+1));
+            pwrite = ((last+1 >= size) ? 0 : (last+1));
+            wfree  = 0;
 #if defined(SWSR_MULTIPUSH)
             mcnt = 0; // reset mpush counter
 #endif
@@ -333,6 +415,7 @@ public:
     inline bool  inc() {
         buf[pread]=NULL;
         pread = pread + ((pread+1 >= size) ? (1-size): 1); // circular buffer     
+        if (rfull) --rfull;
         return true;
     }           
 
@@ -343,12 +426,45 @@ public:
      *  data popped from the buffer.
      */
     inline bool  pop(void ** data) {  /* modify only pread pointer */
-        if (empty()) return false;        
+        if (!rfull && !(rfull=probe_r())) return false;
         *data = buf[pread];
         //std::atomic_thread_fence(std::memory_order_acquire);
         return inc();
     } 
         
+    /**
+     *  Bulk pop method: it gets up to \p max values from the head of the
+     *  FIFO buffer. The slots are read first and then released in FIFO
+     *  order, and the read pointer is updated only once for the whole
+     *  batch, so that N elements cost a single update of the consumer index.
+     *
+     *  \param data array (of at least \p max entries) where to store the
+     *  data popped from the buffer.
+     *  \param max maximum number of elements to pop
+     *
+     *  \return the number of elements popped (0 if the buffer is empty)
+     */
+    inline size_t pop_n(void ** data, size_t max) { /* modify only pread pointer */
+        size_t n=0;
+        unsigned long r=pread;
+        while(n<max) {
+#if defined(NO_VOLATILE_POINTERS)
+            void * d = (void*)(*(volatile unsigned long *)(&buf[r]));
+#else
+            void * d = buf[r];
+#endif
+            if (d==NULL) break;
+            data[n++] = d;
+            r = r + ((r+1 >= size) ? (1-size): 1);
+        }
+        if (n==0) return 0;
+        for(unsigned long i=pread;i!=r;i=i+((i+1 >= size) ? (1-size): 1))
+            buf[i]=NULL;
+        pread = r;
+        rfull = (rfull>n) ? rfull-n : 0;
+        return n;
+    }
+
     /** 
      *  It returns the "head" of the buffer, i.e. the element pointed by the read
      *  pointer (it is a FIFO queue, so \p push on the tail and \p pop from the
@@ -375,6 +491,7 @@ public:
             pread=0;
             pwrite=0; 
         }
+        rfull=wfree=0;
 #if defined(SWSR_MULTIPUSH)        
         mcnt   = 0;
 #endif  
@@ -407,6 +524,44 @@ public:
     }
     
     inline bool isFixedSize() const { return true; }
+
+protected:
+    /*
+     * Producer side: it returns the number of consecutive free slots starting
+     * from pwrite (at most lookahead), 0 if the buffer is full.
+     */
+    inline unsigned long probe_w() {
+        unsigned long n = (lookahead < size) ? lookahead : size;
+        do {
+            unsigned long i = pwrite + n - 1;
+            if (i >= size) i -= size;
+#if defined(NO_VOLATILE_POINTERS)
+            if ((*(volatile unsigned long *)(&buf[i]))==0) return n;
+#else
+            if (buf[i]==NULL) return n;
+#endif
+            n >>= 1;
+        } while(n);
+        return 0;
+    }
+    /*
+     * Consumer side: it returns the number of consecutive full slots starting
+     * from pread (at most lookahead), 0 if the buffer is empty.
+     */
+    inline unsigned long probe_r() {
+        unsigned long n = (lookahead < size) ? lookahead : size;
+        do {
+            unsigned long i = pread + n - 1;
+            if (i >= size) i -= size;
+#if defined(NO_VOLATILE_POINTERS)
+            if ((*(volatile unsigned long *)(&buf[i]))!=0) return n;
+#else
+            if (buf[i]!=NULL) return n;
+#endif
+            n >>= 1;
+        } while(n);
+        return 0;
+    }
 };
 
 /*!
@@ -415,6 +415,9 @@ protected:
     void registerCallback(bool (*cb)(void *,int,unsigned long,unsigned long,void *), void * arg) {
         comp_nodes[1]->registerCallback(cb,arg);
     }
+    void registerBatchCallback(bool (*cb)(void **,size_t,int,unsigned long,unsigned long,void *)) {
+        comp_nodes[1]->registerBatchCallback(cb);
+    }
     
     void connectCallback() {
         if (comp_nodes[0]->isComp())
@@ -444,6 +447,11 @@ protected:
     }
     int prepare() {
         if (prepared) return 0;
+        // the slots of the by_value channel must be given back (see by_value)
+        if (comp_nodes[0]->value_output() && !comp_nodes[1]->value_input()) {
+            error("COMBINE, the second node receives by_value tasks but it is not a by_value node\n");
+            return -1;
+        }
         connectCallback();
 
         // checking if the first node is a multi-input node
@@ -487,6 +495,12 @@ protected:
     void set_neos(ssize_t n) {
         getFirst()->set_neos(n);
     }
+
+    // the nodes of the composition run in the thread of the composition
+    void set_latnode(ff_latnode *l) {
+        ff_node::set_latnode(l);
+        for(size_t j=0;j<comp_nodes.size(); ++j) comp_nodes[j]->set_latnode(l);
+    }
     
     inline int cardinality(BARRIER_T * const barrier)  { 
         ff_node::set_barrier(barrier);
@@ -597,6 +611,17 @@ protected:
         if (n) n->blocking_mode(blocking_in);
     }
 
+    void set_backoff(const ff_backoff &policy) {
+        ff_minode::set_backoff(policy);
+        comp_nodes[0]->set_backoff(policy);
+        comp_nodes[1]->set_backoff(policy);
+    }
+    // the output channel is the one of the last node
+    void set_channels_parking() {
+        ff_minode::set_channels_parking();
+        comp_nodes[1]->set_channels_parking();
+    }
+
     void set_scheduling_ondemand(const int inbufferentries=1) {
         if (!isMultiOutput()) return;
         ff_node* n= getLast();
@@ -609,6 +634,12 @@ protected:
         assert(n->isMultiOutput());
         return n->ondemand_buffer();
     }
+    void set_scheduling_bykey(const ff_keyrouter &router) {
+        if (!isMultiOutput()) return;
+        ff_node* n= getLast();
+        assert(n->isMultiOutput());
+        n->set_scheduling_bykey(router);
+    }
    
     void eosnotify(ssize_t id=-1) {
         comp_nodes[0]->eosnotify(id);
@@ -654,6 +685,9 @@ protected:
         comp_nodes[0]->get_in_nodes_feedback(w);
     }
 
+    bool value_input() const  { return comp_nodes[0]->value_input(); }
+    bool value_output() const { return comp_nodes[1]->value_output(); }
+
     int create_input_buffer(int nentries, bool fixedsize=FF_FIXED_SIZE) {
         if (isMultiInput()) {
             int r= ff_minode::create_input_buffer(nentries,fixedsize);
@@ -735,6 +769,7 @@ protected:
     // uses as output channel(s) the one(s) of the second node.
     // these functions should not be called if the node is multi-output
     inline bool  get(void **ptr)                 { return comp_nodes[1]->get(ptr);}
+    inline size_t get_n(void **ptr, size_t max)  { return comp_nodes[1]->get_n(ptr,max);}
     inline pthread_cond_t    &get_cons_c()  {
         ff_node *n = getFirst();
         if (n->isMultiInput()) return ff_minode::get_cons_c();
@@ -750,6 +785,11 @@ protected:
                             unsigned long ticks=(ff_node::TICKS2WAIT)) { 
         return comp_nodes[1]->ff_send_out(task,id,retry,ticks);
     }
+    inline bool ff_send_out_batch(void ** tasks, size_t n, int id=-1,
+                                  unsigned long retry=((unsigned long)-1),
+                                  unsigned long ticks=(ff_node::TICKS2WAIT)) { 
+        return comp_nodes[1]->ff_send_out_batch(tasks,n,id,retry,ticks);
+    }
 
     inline bool ff_send_out_to(void * task,int id, unsigned long retry=((unsigned long)-1),
                                unsigned long ticks=(ff_node::TICKS2WAIT)) { 
@@ -1201,7 +1241,7 @@ static inline const ff_pipeline combine_ofarm_farm(ff_farm& farm1, ff_farm& farm
     newfarm1.ordered_resize_memory(memsize);
     _lb->init(newfarm1.ordered_get_memory(), memsize);
     newfarm1.setlb(_lb, true);
-    OrderedCollectorWrapper* cw = new OrderedCollectorWrapper(DEF_OFARM_ONDEMAND_MEMORY);
+    OrderedCollectorWrapper* cw = new OrderedCollectorWrapper(memsize, _lb->get_released());
     assert(cw);
     
     // emitter1 
@@ -126,6 +126,158 @@
 #define DEFAULT_BUFFER_CAPACITY              2048
 #endif
 
+/*
+ * Default number of slots of the pool used by a node producing by_value<T>
+ * tasks (see by_value in node.hpp). It bounds the number of tasks in flight
+ * produced by the node.
+ */
+#if !defined(FF_VALUE_POOL_SIZE)
+#define FF_VALUE_POOL_SIZE                   DEFAULT_BUFFER_CAPACITY
+#endif
+
+/*
+ * Default capacity of the per-worker deques used by the farm's work-stealing
+ * scheduling (see ff_farm::set_scheduling_stealing).
+ */
+#if !defined(FF_WS_DEQUE_SIZE)
+#define FF_WS_DEQUE_SIZE                     1024
+#endif
+
+/*
+ * Keyed scheduling (see ff_keyrouter in keyrouter.hpp).
+ * FF_KEY_VNODES: number of points of each worker on the consistent hashing ring.
+ * FF_KEY_WINDOW: number of tasks after which the load of the workers is checked.
+ * FF_KEY_SKEW:   a worker is overloaded if it receives more than FF_KEY_SKEW 
+ *                times the average number of tasks.
+ * FF_KEY_HOT:    maximum number of hot keys.
+ */
+#if !defined(FF_KEY_VNODES)
+#define FF_KEY_VNODES                        64
+#endif
+#if !defined(FF_KEY_WINDOW)
+#define FF_KEY_WINDOW                        4096
+#endif
+#if !defined(FF_KEY_SKEW)
+#define FF_KEY_SKEW                          1.5
+#endif
+#if !defined(FF_KEY_HOT)
+#define FF_KEY_HOT                           16
+#endif
+
+/*
+ * Elastic farm (see ff_elastic in elastic.hpp).
+ * FF_ELASTIC_PERIOD: sampling period of the controller in milliseconds.
+ * FF_ELASTIC_UTIL:   default target utilization of the active workers.
+ * FF_ELASTIC_CHECK:  number of scheduled tasks between two reads of the clock
+ *                    until the controller has calibrated the cycle counter.
+ */
+#if !defined(FF_ELASTIC_PERIOD)
+#define FF_ELASTIC_PERIOD                    100
+#endif
+#if !defined(FF_ELASTIC_UTIL)
+#define FF_ELASTIC_UTIL                      0.75
+#endif
+#if !defined(FF_ELASTIC_CHECK)
+#define FF_ELASTIC_CHECK                     64
+#endif
+
+/*
+ * Latency tracing (see ff_latency_tracer in latency.hpp).
+ * FF_LATENCY_SAMPLE: default sampling rate, one task out of FF_LATENCY_SAMPLE
+ *                    generated by each source is traced.
+ * FF_LATENCY_TABLE:  number of slots of the table of the sampled tasks in
+ *                    flight (it must be a power of 2).
+ * FF_LATENCY_STALE:  milliseconds after which an entry of the table can be
+ *                    overwritten.
+ */
+#if !defined(FF_LATENCY_SAMPLE)
+#define FF_LATENCY_SAMPLE                    64
+#endif
+#if !defined(FF_LATENCY_TABLE)
+#define FF_LATENCY_TABLE                     4096
+#endif
+#if !defined(FF_LATENCY_STALE)
+#define FF_LATENCY_STALE                     1000
+#endif
+
+/*
+ * Run-time timeline (see ff_timeline in timeline.hpp).
+ * FF_TIMELINE_EVENTS: number of events kept for each thread.
+ * FF_TIMELINE_GAP:    nanoseconds within which two waits of the same kind
+ *                     are merged in a single event.
+ */
+#if !defined(FF_TIMELINE_EVENTS)
+#define FF_TIMELINE_EVENTS                   32768
+#endif
+#if !defined(FF_TIMELINE_GAP)
+#define FF_TIMELINE_GAP                      2000
+#endif
+
+/*
+ * Thread pool (see ff_threadpool in threadpool.hpp): if FF_THREADPOOL is
+ * not 0 (or it is defined with no value) the nodes run on the threads of
+ * the process-wide pool unless it is disabled at run time. By default the
+ * pool is disabled.
+ */
+#if !defined(FF_THREADPOOL)
+#define FF_THREADPOOL                        0
+#endif
+
+/*
+ * M:N execution (see ff_executor in executor.hpp).
+ * FF_FIBER_STACK: size in bytes of the stack of each node run as a fiber.
+ */
+#if !defined(FF_FIBER_STACK)
+#define FF_FIBER_STACK                       (256*1024)
+#endif
+
+/*
+ * ParallelFor adaptive scheduling (see PARFOR_SCHED_ADAPTIVE in
+ * parallel_for_internals.hpp).
+ * FF_PARFOR_CHUNK_TICKS: target duration in ticks of the chunks of
+ *                        iterations taken by the workers.
+ */
+#if !defined(FF_PARFOR_CHUNK_TICKS)
+#define FF_PARFOR_CHUNK_TICKS                50000
+#endif
+
+/*
+ * Tiles of the 2D/3D ParallelFor loops (see forall_tiles in
+ * parallel_for_internals.hpp) when their shape is not given.
+ * FF_PARFOR_TILE_BYTES: bytes of data touched by one iteration, the tiles
+ *                       are sized to fill half of the L2 cache.
+ */
+#if !defined(FF_PARFOR_TILE_BYTES)
+#define FF_PARFOR_TILE_BYTES                 16
+#endif
+
+/*
+ * ParallelForScan (see parallel_for.hpp).
+ * FF_PARFOR_SCAN_BLOCK: minimum number of values scanned by each Worker.
+ */
+#if !defined(FF_PARFOR_SCAN_BLOCK)
+#define FF_PARFOR_SCAN_BLOCK                 4096
+#endif
+
+/*
+ * ParallelFor hot loops (see parallel_for_hot in parallel_for.hpp).
+ * FF_HOTLOOP_SPIN_TICKS: ticks spent spinning by an idle worker waiting for
+ *                        the next loop (and by the thread waiting for the end
+ *                        of a loop) before parking on a futex.
+ */
+#if !defined(FF_HOTLOOP_SPIN_TICKS)
+#define FF_HOTLOOP_SPIN_TICKS                200000
+#endif
+
+/*
+ * ParallelAlgorithms (see algorithms.hpp).
+ * FF_ALGORITHMS_BLOCK: minimum number of elements handled by each Worker,
+ * shorter ranges are handled sequentially with the std:: algorithms.
+ */
+#if !defined(FF_ALGORITHMS_BLOCK)
+#define FF_ALGORITHMS_BLOCK                  8192
+#endif
+
 
 /* To save energy and improve hyperthreading performance
  * define the following macro
@@ -171,6 +323,26 @@
 #define FF_RUNTIME_MODE false   // by default the run-time is in nonblocking mode
 #endif
 
+/* If SPINPARK_MODE is defined, in the nonblocking run-time a thread that finds
+ * its channels empty (or full) spins for an adaptively learned interval and
+ * then parks on a futex until the thread at the other end of the channel wakes
+ * it up, i.e. the default backoff policy is ff_backoff_park (see backoff.hpp).
+ *
+ * The wake-up of the parked peer costs a check in each push/pop of the
+ * channels, it is compiled in only if FF_BACKOFF_PARKING is defined (it is
+ * implied by SPINPARK_MODE). Without it ff_backoff_park is not defined.
+ */
+#if defined(SPINPARK_MODE) && !defined(FF_BACKOFF_PARKING)
+#define FF_BACKOFF_PARKING
+#endif
+
+/* The ready notification of the input channels of a gatherer (see
+ * ff_gatherer::set_ready_notification) costs a check in each push of the
+ * channels, it is compiled in only if FF_READYSET is defined. Without it
+ * the gatherer polls all its input channels.
+ */
+// #define FF_READYSET
+
 /* Used in blocking mode to limit the amount of time 
  * before checking again the input/output queue.
  * NOTE: it cannot be greater than 1e+9 (i.e. 1sec)
@@ -215,6 +387,21 @@
 #define BACKOFF_MAX 1024
 #endif
 
+// NOTE: used by the spin-then-park backoff policy (see parking.hpp).
+// FF_SPINPARK_MIN/MAX are lower and upper bound of the adaptive number of
+// spinning steps (TICKS2WAIT each) before a thread parks on its futex.
+#if !defined(FF_SPINPARK_MIN)
+#define FF_SPINPARK_MIN 16
+#endif
+#if !defined(FF_SPINPARK_MAX)
+#define FF_SPINPARK_MAX 4096
+#endif
+// A thread that has not been waiting for more than FF_BACKOFF_GAP steps
+// starts a new waiting phase (see backoff.hpp).
+#if !defined(FF_BACKOFF_GAP)
+#define FF_BACKOFF_GAP 4
+#endif
+
 #if !defined(CACHE_LINE_SIZE)
 #define CACHE_LINE_SIZE 64
 #endif
@@ -0,0 +1,168 @@
+/* -*- Mode: C++; tab-width: 4; c-basic-offset: 4; indent-tabs-mode: nil -*- */
+
+/*!
+ * \file coroutine.hpp
+ * \ingroup building_blocks
+ *
+ * \brief Stream nodes whose body is a C++20 coroutine
+ *
+ */
+
+#ifndef FF_COROUTINE_HPP
+#define FF_COROUTINE_HPP
+
+/* ***************************************************************************
+ *
+ *  FastFlow is free software; you can redistribute it and/or modify it
+ *  under the terms of the GNU Lesser General Public License version 3 as
+ *  published by the Free Software Foundation.
+ *  Starting from version 3.0.1 FastFlow is dual licensed under the GNU LGPLv3
+ *  or MIT License (https://github.com/ParaGroup/WindFlow/blob/vers3.x/LICENSE.MIT)
+ *
+ *  This program is distributed in the hope that it will be useful, but WITHOUT
+ *  ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ *  FITNESS FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public
+ *  License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public License
+ *  along with this program; if not, write to the Free Software Foundation,
+ *  Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ *
+ ****************************************************************************
+ */
+
+#if (__cplusplus < 202002L) || !__has_include(<coroutine>)
+#error "ff/coroutine.hpp requires C++20 coroutines (compile with -std=c++20)"
+#endif
+
+#include <coroutine>
+#include <exception>
+#include <ff/node.hpp>
+
+namespace ff {
+
+/*!
+ * \class ff_node_co
+ * \ingroup building_blocks
+ *
+ * \brief Typed node (as ff_node_t) whose behaviour is written as a coroutine
+ *
+ * Instead of the \p svc method the user implements \p body, a coroutine that
+ * gets the input tasks with <tt>co_await in()</tt> and sends out the results
+ * with <tt>co_yield</tt>, keeping its state in local variables between one
+ * input and the next one. \p in() returns NULL when the input stream ends
+ * (EOS), or immediately if the node has no input channel (first stage of a
+ * pipeline). When the body returns the node sends out the EOS.
+ *
+ * The coroutine is suspended when it waits for an input that has not
+ * arrived yet: the \p svc method returns GO_ON and the node waits on its
+ * input channel as any other node. A \p co_yield on a full output channel
+ * waits as \p ff_send_out does. If the nodes run as fibers on the
+ * ff_executor (ff/executor.hpp) both kinds of waits give the executor to
+ * the other nodes, so that many coroutine nodes can run on few threads.
+ *
+ * Example (each input string is split into words):
+ * \code
+ *   struct Split: ff_node_co<std::string> {
+ *       coroutine body() {
+ *           while(std::string *s = co_await in()) {
+ *               std::istringstream is(*s);
+ *               std::string w;
+ *               while(is >> w) co_yield new std::string(w);
+ *               delete s;
+ *           }
+ *       }
+ *   };
+ * \endcode
+ *
+ * A subclass redefining \p svc_init, \p eosnotify or \p svc_end has to
+ * call the methods of ff_node_co.
+ */
+template<typename IN_t, typename OUT_t = IN_t>
+struct ff_node_co: ff_node_t<IN_t, OUT_t> {
+    typedef typename ff_node_t<IN_t, OUT_t>::in_task_t  in_task_t;
+    typedef typename ff_node_t<IN_t, OUT_t>::out_task_t out_task_t;
+
+    /// return type of the coroutine \p body
+    struct coroutine {
+        struct promise_type {
+            ff_node_co *node = nullptr;
+
+            coroutine get_return_object() {
+                return coroutine{std::coroutine_handle<promise_type>::from_promise(*this)};
+            }
+            // the body starts when the first task arrives
+            std::suspend_always initial_suspend() noexcept { return {}; }
+            std::suspend_always final_suspend() noexcept { return {}; }
+            std::suspend_never yield_value(out_task_t *task) {
+                node->ff_send_out(task);
+                return {};
+            }
+            void return_void() {}
+            void unhandled_exception() { std::terminate(); }
+        };
+        std::coroutine_handle<promise_type> h;
+    };
+
+    struct in_awaiter {
+        ff_node_co *node;
+        bool await_ready() const noexcept { return node->pending || node->eos; }
+        void await_suspend(std::coroutine_handle<>) const noexcept {}
+        in_task_t* await_resume() const noexcept {
+            in_task_t *t = node->task;
+            node->task    = nullptr;
+            node->pending = false;
+            return t;
+        }
+    };
+
+    ff_node_co():h(nullptr),task(nullptr),pending(false),eos(false) {}
+    virtual ~ff_node_co() { if (h) h.destroy(); }
+
+    /// the behaviour of the node
+    virtual coroutine body() = 0;
+
+    /// to be used in \p body as <tt>co_await in()</tt>
+    in_awaiter in() { return in_awaiter{this}; }
+
+    int svc_init() {
+        // the node may be run again, the body starts from the beginning
+        if (h) { h.destroy(); h = nullptr; }
+        eos = false;
+        return 0;
+    }
+
+    out_task_t* svc(in_task_t *t) {
+        if (!h) {
+            h = body().h;
+            h.promise().node = this;
+        }
+        task    = t;
+        pending = true;
+        // a node without input channels is called once with a NULL task
+        if (!t) eos = true;
+        h.resume();
+        if (h.done()) return this->EOS;
+        return this->GO_ON;
+    }
+
+    void eosnotify(ssize_t =-1) {
+        eos = true;
+        // the body may flush its state before returning
+        if (h && !h.done()) h.resume();
+    }
+
+    void svc_end() {
+        if (h) { h.destroy(); h = nullptr; }
+    }
+
+protected:
+    std::coroutine_handle<typename coroutine::promise_type> h;
+    in_task_t *task;
+    bool       pending;   // task has not been taken by the body yet
+    bool       eos;       // the input stream is ended
+};
+
+} // namespace ff
+
+#endif /* FF_COROUTINE_HPP */
@@ -0,0 +1,249 @@
+/* -*- Mode: C++; tab-width: 4; c-basic-offset: 4; indent-tabs-mode: nil -*- */
+
+/*!
+ * \file elastic.hpp
+ * \ingroup building_blocks
+ *
+ * \brief Controller of the number of active workers of an elastic farm
+ * (see ff_farm::set_elastic)
+ *
+ */
+
+#ifndef FF_ELASTIC_HPP
+#define FF_ELASTIC_HPP
+
+/* ***************************************************************************
+ *
+ *  FastFlow is free software; you can redistribute it and/or modify it
+ *  under the terms of the GNU Lesser General Public License version 3 as
+ *  published by the Free Software Foundation.
+ *  Starting from version 3.0.1 FastFlow is dual licensed under the GNU LGPLv3
+ *  or MIT License (https://github.com/ParaGroup/WindFlow/blob/vers3.x/LICENSE.MIT)
+ *
+ *  This program is distributed in the hope that it will be useful, but WITHOUT
+ *  ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ *  FITNESS FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public
+ *  License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public License
+ *  along with this program; if not, write to the Free Software Foundation,
+ *  Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ *
+ ****************************************************************************
+ */
+
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <vector>
+#include <algorithm>
+#include <ff/config.hpp>
+#include <ff/cycle.h>
+
+namespace ff {
+
+/*!
+ * \class ff_busystat
+ * \ingroup building_blocks
+ *
+ * \brief Time spent by a worker in its svc method and number of tasks
+ *
+ * It also counts how many times the worker has been started (svc_init)
+ * and stopped (svc_end), so that the controller knows whether a freeze or a
+ * thaw has taken effect. Written only by the worker's thread, read by the
+ * elastic controller.
+ */
+struct ff_busystat {
+    ff_busystat():busy(0),tasks(0),starts(0),stops(0) { (void)padding; }
+
+    inline void add(ticks t) {
+        busy.store(busy.load(std::memory_order_relaxed)+t, std::memory_order_relaxed);
+        tasks.store(tasks.load(std::memory_order_relaxed)+1, std::memory_order_relaxed);
+    }
+    inline void started() { starts.store(starts.load(std::memory_order_relaxed)+1, std::memory_order_release); }
+    inline void stopped() { stops.store(stops.load(std::memory_order_relaxed)+1, std::memory_order_release); }
+
+    std::atomic<uint64_t> busy;
+    std::atomic<uint64_t> tasks;
+    std::atomic<uint64_t> starts;
+    std::atomic<uint64_t> stops;
+    long padding[longxCacheLine-4];
+};
+
+/*!
+ * \class ff_elastic
+ * \ingroup building_blocks
+ *
+ * \brief Decides how many workers of a farm are active
+ *
+ * Every \p period milliseconds the controller (called by the Emitter)
+ * measures the utilization of the active workers, i.e. the fraction of
+ * the period they spent in their svc method, and the average number of
+ * tasks waiting in their input channels. The number of active workers
+ * becomes the one that would bring the utilization to the target value,
+ * within [\p minw, \p maxw]. At most half of the active workers are
+ * removed at a time.
+ *
+ * With a latency SLO, the latency of a task is estimated as the time needed
+ * to serve the tasks queued before it plus its own service time. If it
+ * exceeds the SLO the number of workers grows (at least by one), and it
+ * does not shrink while it is above half of the SLO.
+ */
+class ff_elastic {
+public:
+    /**
+     * \param minw minimum number of active workers
+     * \param maxw maximum number of active workers (0 means all the workers)
+     * \param utilization target utilization of the active workers in (0,1]
+     * \param period sampling period in milliseconds
+     */
+    ff_elastic(size_t minw=1, size_t maxw=0,
+               double utilization=FF_ELASTIC_UTIL, double period=FF_ELASTIC_PERIOD):
+        minw(minw?minw:1),maxw(maxw),target(utilization),period(period) {
+        if (target<=0.0 || target>1.0) target = FF_ELASTIC_UTIL;
+        if (period<=0.0) this->period = FF_ELASTIC_PERIOD;
+    }
+
+    // the copy has the same parameters but no statistics
+    ff_elastic(const ff_elastic &e):
+        ff_elastic(e.minw, e.maxw, e.target, e.period) { slo = e.slo; }
+
+    /// target latency in milliseconds (0 disables it)
+    ff_elastic& set_latency_slo(double ms) { slo = (ms>0.0) ? ms : 0.0; return *this; }
+
+    inline size_t get_min() const { return minw; }
+    inline size_t get_max() const { return maxw; }
+    /// number of workers currently active
+    inline size_t get_nactive() const { return nactive; }
+    /// how many times the number of active workers has been increased/decreased
+    inline size_t get_ngrow()   const { return ngrow; }
+    inline size_t get_nshrink() const { return nshrink; }
+    /// utilization of the active workers measured in the last period
+    inline double get_utilization() const { return lastutil; }
+
+    /// statistics for \p n workers, called before the workers are started
+    void init(size_t n) {
+        std::vector<ff_busystat> s(n);
+        stats.swap(s);
+        last.assign(n, std::make_pair((uint64_t)0,(uint64_t)0));
+        nstarts.assign(n, 0);
+    }
+
+    /*
+     * A worker that has just been thawed may not have left the frozen state
+     * yet, if it is frozen again before then it keeps sleeping (and the
+     * FF_GO_OUT sent to it stays in its channel). So, each time a worker is
+     * thawed the controller counts one more start, a worker can be removed
+     * only after it has started (\p awake) and added again only after it has
+     * stopped (\p asleep).
+     */
+    inline void thawed(size_t i) { ++nstarts[i]; }
+    inline bool awake(size_t i) const {
+        return stats[i].starts.load(std::memory_order_acquire) >= nstarts[i];
+    }
+    inline bool asleep(size_t i) const {
+        return stats[i].stops.load(std::memory_order_acquire) >= nstarts[i];
+    }
+
+    /**
+     * \brief The first \p n workers are running, it returns the number of
+     * workers that have to be active at the beginning
+     */
+    size_t start(size_t n) {
+        nworkers = (std::min)(n, stats.size());
+        for(size_t i=0;i<nworkers;++i)
+            last[i] = std::make_pair(stats[i].busy.load(std::memory_order_relaxed),
+                                     stats[i].tasks.load(std::memory_order_relaxed));
+        t0 = getticks(); ms0 = msnow();
+        tpms = 0; ncalls = 0;
+        nactive = clamp(nworkers);
+        return nactive;
+    }
+    inline ff_busystat* stat(size_t i) { return &stats[i]; }
+
+    /// true if a period has elapsed since the last decision
+    inline bool due() {
+        if (tpms>0) return getticks() >= deadline;
+        // the ticks per millisecond are not known yet
+        if (++ncalls < FF_ELASTIC_CHECK) return false;
+        ncalls=0;
+        return (msnow() - ms0) >= period;
+    }
+
+    /**
+     * \brief It returns the number of workers that should be active
+     *
+     * \param backlog average number of tasks in the input channels of the
+     * active workers
+     */
+    size_t decide(double backlog) {
+        const ticks  t  = getticks();
+        const double ms = msnow();
+        const double dt = (double)(t - t0);
+        const double dms= ms - ms0;
+        if (dms <= 0.0 || dt <= 0.0 || nactive == 0) return nactive;
+        tpms = dt / dms;
+        t0 = t; ms0 = ms;
+        deadline = t + (ticks)(period*tpms);
+
+        uint64_t busy=0, tasks=0;
+        for(size_t i=0;i<nworkers;++i) {
+            const uint64_t b = stats[i].busy.load(std::memory_order_relaxed);
+            const uint64_t k = stats[i].tasks.load(std::memory_order_relaxed);
+            if (i<nactive) { busy += b - last[i].first; tasks += k - last[i].second; }
+            last[i] = std::make_pair(b,k);
+        }
+        const size_t n = nactive;
+        double u = (double)busy / ((double)n * dt);
+        if (u>1.0) u = 1.0;
+        lastutil = u;
+
+        size_t want = (size_t)std::ceil(n * u / target);
+        if (u>=target && backlog>=1.0) want = (std::max)(want, n+1);
+        if (slo>0.0 && tasks>0) {
+            const double svcms = ((double)busy/tasks) / tpms;
+            const double lat   = (backlog+1.0) * svcms;
+            if (lat > slo) want = (std::max)(want, n+1);
+            else if (lat > slo/2) want = (std::max)(want, n);
+        }
+        if (want < n) want = (std::max)(want, n - n/2);
+        return clamp(want);
+    }
+
+    /// the number of active workers is now \p n (\p count false: not a decision of the controller)
+    inline void resized(size_t n, bool count=true) {
+        if (count && n>nactive) ++ngrow;
+        if (count && n<nactive) ++nshrink;
+        nactive = n;
+    }
+
+protected:
+    inline size_t clamp(size_t w) const {
+        const size_t hi = (maxw && maxw<nworkers) ? maxw : nworkers;
+        const size_t lo = (std::min)(minw, hi);
+        return (std::max)(lo, (std::min)(w, hi));
+    }
+    static inline double msnow() {
+        return std::chrono::duration<double, std::milli>(
+               std::chrono::steady_clock::now().time_since_epoch()).count();
+    }
+
+    size_t  minw, maxw;
+    double  target, period;
+    double  slo      = 0.0;
+    size_t  nworkers = 0;
+    size_t  nactive  = 0;
+    size_t  ngrow    = 0, nshrink = 0;
+    double  lastutil = 0.0;
+
+    std::vector<ff_busystat> stats;
+    std::vector<std::pair<uint64_t,uint64_t> > last;
+    std::vector<uint64_t> nstarts;
+    ticks   t0 = 0, deadline = 0;
+    double  ms0 = 0.0, tpms = 0.0;
+    size_t  ncalls = 0;
+};
+
+} // namespace ff
+
+#endif /* FF_ELASTIC_HPP */
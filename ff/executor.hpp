@@ -0,0 +1,408 @@
+/* -*- Mode: C++; tab-width: 4; c-basic-offset: 4; indent-tabs-mode: nil -*- */
+
+/*!
+ * \file executor.hpp
+ * \ingroup building_blocks
+ *
+ * \brief M:N execution of the FastFlow nodes: the nodes run as fibers
+ * multiplexed onto a fixed set of executor threads
+ *
+ */
+
+#ifndef FF_EXECUTOR_HPP
+#define FF_EXECUTOR_HPP
+
+/* ***************************************************************************
+ *
+ *  FastFlow is free software; you can redistribute it and/or modify it
+ *  under the terms of the GNU Lesser General Public License version 3 as
+ *  published by the Free Software Foundation.
+ *  Starting from version 3.0.1 FastFlow is dual licensed under the GNU LGPLv3
+ *  or MIT License (https://github.com/ParaGroup/WindFlow/blob/vers3.x/LICENSE.MIT)
+ *
+ *  This program is distributed in the hope that it will be useful, but WITHOUT
+ *  ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ *  FITNESS FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public
+ *  License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public License
+ *  along with this program; if not, write to the Free Software Foundation,
+ *  Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ *
+ ****************************************************************************
+ */
+
+#include <atomic>
+#include <deque>
+#include <vector>
+#include <pthread.h>
+#include <ff/config.hpp>
+#include <ff/utils.hpp>
+#include <ff/mapper.hpp>
+#include <ff/mapping_utils.hpp>
+
+#if defined(__linux__)
+#include <ucontext.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#define FF_HAVE_FIBERS 1
+#endif
+
+namespace ff {
+
+/*!
+ * \class ff_fiber
+ * \ingroup building_blocks
+ *
+ * \brief A routine running on its own stack on one of the executor threads
+ * (see ff_executor)
+ */
+class ff_fiber {
+    friend class ff_executor;
+public:
+    /// true if the routine has returned
+    bool finished() const { return done.load(std::memory_order_acquire); }
+
+protected:
+    enum action_t { NONE, YIELD, PARK, EXIT };
+
+    ff_fiber(void*(*routine)(void*), void *arg):routine(routine),arg(arg) {
+        pthread_mutex_init(&mutex, NULL);
+        pthread_cond_init(&cond, NULL);
+    }
+    ~ff_fiber() {
+#if defined(FF_HAVE_FIBERS)
+        if (stack) munmap(stack, ssize);
+#endif
+        pthread_mutex_destroy(&mutex);
+        pthread_cond_destroy(&cond);
+    }
+
+#if defined(FF_HAVE_FIBERS)
+    ucontext_t       ctx;
+    ucontext_t      *sched   = nullptr;  // context of the executor running the fiber
+#endif
+    char            *stack   = nullptr;
+    size_t           ssize   = 0;
+    void*          (*routine)(void*);
+    void            *arg;
+    action_t         action  = NONE;     // what the executor has to do when the fiber stops
+    pthread_mutex_t *release = nullptr;  // mutex released when the fiber is parked
+    bool             parked  = false;    // protected by *release
+    std::atomic<bool> done{false};
+    pthread_mutex_t  mutex;              // used by the threads joining the fiber
+    pthread_cond_t   cond;
+};
+
+/*!
+ * \class ff_executor
+ * \ingroup building_blocks
+ *
+ * \brief Runs the nodes as fibers on a fixed number of executor threads
+ *
+ * When the executor is started, the threads of the nodes (ff_thread) are
+ * not OS threads but fibers with their own stack (FF_FIBER_STACK bytes)
+ * multiplexed onto the executor threads, so that the number of nodes of
+ * a graph is not limited by the number of cores. The svc, svc_init,
+ * svc_end and EOS protocol of the nodes does not change.
+ *
+ * Fibers are scheduled cooperatively from a FIFO ready queue: a node
+ * yields its executor where it would wait, i.e. when its input channels
+ * are empty or its output channels are full (losetime_in/losetime_out,
+ * and the waits of the blocking mode). A frozen node does not use any
+ * executor until it is thawed. A node that stays in its svc method without
+ * sending out or receiving tasks keeps its executor busy.
+ *
+ * The executor has to be started before running the graph and stopped
+ * after all the nodes have been waited. FF_INITIAL_BARRIER is not
+ * supported with less executor threads than nodes. Fibers are available
+ * only on Linux, elsewhere \p start fails.
+ *
+ * Example:
+ * \code
+ *   ff_executor::instance()->start(4);   // 4 executor threads
+ *   pipe.run_and_wait_end();             // any number of nodes
+ *   ff_executor::instance()->stop();
+ * \endcode
+ */
+class ff_executor {
+public:
+    static inline ff_executor* instance() {
+        static ff_executor ex;
+        return &ex;
+    }
+
+    /**
+     * \brief Starts \p n executor threads (0 means one for each core), the
+     * nodes started from now on run as fibers
+     *
+     * \return 0 if successful, -1 otherwise
+     */
+    int start(size_t n=0) {
+#if !defined(FF_HAVE_FIBERS)
+        (void)n;
+        error("ff_executor, fibers are not supported on this platform\n");
+        return -1;
+#else
+        pthread_mutex_lock(&mutex);
+        if (threads.size()) {
+            pthread_mutex_unlock(&mutex);
+            error("ff_executor, already started\n");
+            return -1;
+        }
+        if (n==0) n = ff_numCores();
+        quit = false;
+        for(size_t i=0;i<n;++i) {
+            pthread_t th;
+            int r;
+            if ((r=pthread_create(&th, NULL, executor_routine, this)) != 0) {
+                errno=r;
+                perror("ff_executor: pthread creation failed");
+                break;
+            }
+            threads.push_back(th);
+        }
+        const bool ok = threads.size()==n;
+        pthread_mutex_unlock(&mutex);
+        if (!ok) { stop(); return -1; }
+        on.store(true, std::memory_order_release);
+        return 0;
+#endif
+    }
+
+    /**
+     * \brief Terminates the executor threads, the nodes started from now on
+     * have their own OS thread
+     *
+     * All the nodes run on the executor have to be waited before.
+     */
+    void stop() {
+        on.store(false, std::memory_order_release);
+        pthread_mutex_lock(&mutex);
+        quit = true;
+        pthread_cond_broadcast(&cond);
+        std::vector<pthread_t> ths;
+        ths.swap(threads);
+        pthread_mutex_unlock(&mutex);
+        for(auto &th: ths) pthread_join(th, NULL);
+    }
+
+    inline bool enabled() const { return on.load(std::memory_order_acquire); }
+    /// number of executor threads
+    size_t get_nthreads() {
+        pthread_mutex_lock(&mutex);
+        const size_t n = threads.size();
+        pthread_mutex_unlock(&mutex);
+        return n;
+    }
+    /// number of fibers not yet finished
+    size_t get_nfibers() const { return nlive.load(std::memory_order_acquire); }
+    /// number of times the fibers have given up their executor
+    size_t get_nyields() const { return nyields.load(std::memory_order_relaxed); }
+
+    /**
+     * \brief Runs \p routine(\p arg) as a new fiber
+     *
+     * \return the fiber that has to be given to \p join, NULL if the stack
+     * cannot be allocated
+     */
+    ff_fiber* run(void*(*routine)(void*), void *arg) {
+#if !defined(FF_HAVE_FIBERS)
+        (void)routine; (void)arg;
+        return nullptr;
+#else
+        ff_fiber *f = new ff_fiber(routine, arg);
+        // the lowest page of the stack is a guard page
+        const size_t page = (size_t)sysconf(_SC_PAGESIZE);
+        f->ssize = ((FF_FIBER_STACK + page - 1)/page + 1)*page;
+        void *s = mmap(NULL, f->ssize, PROT_READ|PROT_WRITE, MAP_PRIVATE|MAP_ANONYMOUS, -1, 0);
+        if (s == MAP_FAILED) {
+            error("ff_executor, cannot allocate the stack of the fiber\n");
+            delete f;
+            return nullptr;
+        }
+        f->stack = (char*)s;
+        mprotect(f->stack, page, PROT_NONE);
+        getcontext(&f->ctx);
+        f->ctx.uc_stack.ss_sp   = f->stack + page;
+        f->ctx.uc_stack.ss_size = f->ssize - page;
+        f->ctx.uc_link = nullptr;
+        makecontext(&f->ctx, (void(*)())fiber_routine, 0);
+        nlive.fetch_add(1);
+        push(f);
+        return f;
+#endif
+    }
+
+    /// waits for the end of the fiber \p f and releases it
+    void join(ff_fiber *f) {
+        if (current()) {
+            while(!f->finished()) yield();
+        } else {
+            pthread_mutex_lock(&f->mutex);
+            while(!f->finished()) pthread_cond_wait(&f->cond, &f->mutex);
+            pthread_mutex_unlock(&f->mutex);
+        }
+        delete f;
+    }
+
+    /// the fiber running on the calling thread, NULL if it is not an executor
+    static ff_fiber* current() { return tls_current(); }
+
+    /**
+     * \brief The calling fiber goes at the end of the ready queue
+     *
+     * \return false if the caller is not a fiber (nothing is done)
+     */
+    static inline bool yield() {
+#if defined(FF_HAVE_FIBERS)
+        ff_fiber *f = current();
+        if (!f) return false;
+        f->action = ff_fiber::YIELD;
+        swapcontext(&f->ctx, f->sched);
+        return true;
+#else
+        return false;
+#endif
+    }
+
+    /**
+     * \brief The calling fiber, that holds the mutex \p m, releases it and
+     * sleeps until \p unpark is called (with \p m held)
+     *
+     * When the fiber is resumed \p m is locked again.
+     */
+    static void park(pthread_mutex_t *m) {
+#if defined(FF_HAVE_FIBERS)
+        ff_fiber *f = current();
+        f->action  = ff_fiber::PARK;
+        f->release = m;
+        swapcontext(&f->ctx, f->sched);
+        pthread_mutex_lock(m);
+#else
+        (void)m;
+#endif
+    }
+    /// resumes \p f if it is parked, the caller holds the mutex given to \p park
+    void unpark(ff_fiber *f) {
+        if (!f->parked) return;
+        f->parked = false;
+        push(f);
+    }
+
+    ~ff_executor() {
+        if (nlive.load()==0) stop();
+        pthread_mutex_destroy(&mutex);
+        pthread_cond_destroy(&cond);
+    }
+
+protected:
+    ff_executor():on(false),quit(false),nlive(0),nyields(0) {
+        pthread_mutex_init(&mutex, NULL);
+        pthread_cond_init(&cond, NULL);
+    }
+
+    // the accessor is not inlined so that the fibers moving from one
+    // executor to another do not use the thread-local of the old one
+    static ff_fiber*& tls_current() __attribute__((noinline)) {
+        static thread_local ff_fiber *f = nullptr;
+        return f;
+    }
+
+    void push(ff_fiber *f) {
+        pthread_mutex_lock(&mutex);
+        ready.push_back(f);
+        pthread_cond_signal(&cond);
+        pthread_mutex_unlock(&mutex);
+    }
+    // NULL when the executor has to terminate
+    ff_fiber* next() {
+        pthread_mutex_lock(&mutex);
+        while(ready.empty() && !(quit && nlive.load()==0)) pthread_cond_wait(&cond, &mutex);
+        ff_fiber *f = nullptr;
+        if (!ready.empty()) { f = ready.front(); ready.pop_front(); }
+        pthread_mutex_unlock(&mutex);
+        return f;
+    }
+
+#if defined(FF_HAVE_FIBERS)
+    static void fiber_routine() {
+        ff_fiber *f = current();
+        f->routine(f->arg);
+        f->action = ff_fiber::EXIT;
+        swapcontext(&f->ctx, f->sched);
+    }
+
+    static void* executor_routine(void *arg) {
+        ff_executor &E = *(ff_executor*)arg;
+#if !defined(NO_DEFAULT_MAPPING)
+        ff_mapThreadToCpu(threadMapper::instance()->getCoreId());
+#endif
+        ucontext_t sched;
+        while(ff_fiber *f = E.next()) {
+            f->sched  = &sched;
+            f->action = ff_fiber::NONE;
+            tls_current() = f;
+            swapcontext(&sched, &f->ctx);
+            tls_current() = nullptr;
+            switch(f->action) {
+            case ff_fiber::YIELD:
+                E.nyields.fetch_add(1, std::memory_order_relaxed);
+                E.push(f);
+                break;
+            case ff_fiber::PARK:
+                f->parked = true;
+                pthread_mutex_unlock(f->release);
+                break;
+            case ff_fiber::EXIT: {
+                pthread_mutex_lock(&E.mutex);
+                if (E.nlive.fetch_sub(1)==1 && E.quit) pthread_cond_broadcast(&E.cond);
+                pthread_mutex_unlock(&E.mutex);
+                pthread_mutex_lock(&f->mutex);
+                f->done.store(true, std::memory_order_release);
+                pthread_cond_broadcast(&f->cond);
+                pthread_mutex_unlock(&f->mutex);
+            } break;
+            default: break;
+            }
+        }
+        return NULL;
+    }
+#endif
+
+    std::atomic<bool>      on;
+    bool                   quit;
+    std::atomic<size_t>    nlive;
+    std::atomic<size_t>    nyields;
+    pthread_mutex_t        mutex;
+    pthread_cond_t         cond;
+    std::deque<ff_fiber*>  ready;
+    std::vector<pthread_t> threads;
+};
+
+/*
+ * Waits on the condition variable c (m locked by the caller). A fiber
+ * does not wait, it releases m and gives up its executor.
+ */
+static inline int ff_cond_wait(pthread_cond_t *c, pthread_mutex_t *m) {
+    if (ff_executor::current()) {
+        pthread_mutex_unlock(m);
+        ff_executor::yield();
+        pthread_mutex_lock(m);
+        return 0;
+    }
+    return pthread_cond_wait(c, m);
+}
+static inline int ff_cond_timedwait(pthread_cond_t *c, pthread_mutex_t *m, const struct timespec *tv) {
+    if (ff_executor::current()) {
+        pthread_mutex_unlock(m);
+        ff_executor::yield();
+        pthread_mutex_lock(m);
+        return 0;
+    }
+    return pthread_cond_timedwait(c, m, tv);
+}
+
+} // namespace ff
+
+#endif /* FF_EXECUTOR_HPP */
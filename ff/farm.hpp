@@ -115,6 +115,12 @@ protected:
             if (s) victim = (victim+1) % getnworkers();
             return s;
         }
+        // the strict round-robin policy is preserved task by task
+        inline bool schedule_task_batch(void ** tasks, size_t n, unsigned long retry,unsigned long ticks) {
+            for(size_t i=0;i<n;++i)
+                if (!schedule_task(tasks[i], retry, ticks)) return false;
+            return true;
+        }
         inline void broadcast_task(void * task) {
             const svector<ff_node*> &W = getWorkers();
             if (blocking_out) {
@@ -124,7 +130,7 @@ protected:
                         pthread_mutex_lock(prod_m);
                         struct timespec tv;
                         timedwait_timeout(tv);
-                        pthread_cond_timedwait(prod_c, prod_m,&tv);
+                        ff_cond_timedwait(prod_c, prod_m,&tv);
                         pthread_mutex_unlock(prod_m); 
                     }
                     put_done(i);
@@ -134,7 +140,7 @@ protected:
                         pthread_mutex_lock(prod_m);
                         struct timespec tv;
                         timedwait_timeout(tv);
-                        pthread_cond_timedwait(prod_c, prod_m,&tv);
+                        ff_cond_timedwait(prod_c, prod_m,&tv);
                         pthread_mutex_unlock(prod_m); 
                     }
                     put_done(i);
@@ -221,6 +227,18 @@ protected:
         for(size_t i=0;i<workers.size();++i) {
             workers[i]->set_id(int(i));
         }
+        // the slots of the by_value channels must be given back (see by_value)
+        const bool user_collector = collector && !collector_removed && (collector != (ff_node*)gt);
+        for(size_t i=0;i<workers.size();++i) {
+            if (emitter && emitter->value_output() && !workers[i]->value_input()) {
+                error("FARM, worker %ld receives by_value tasks but it is not a by_value node\n", i);
+                return -1;
+            }
+            if (user_collector && workers[i]->value_output() && !collector->value_input()) {
+                error("FARM, the collector receives by_value tasks but it is not a by_value node\n");
+                return -1;
+            }
+        }
 
         // NOTE: if the farm is in a master-worker configuration, all workers must be either
         //       sequential or parallel  building block
@@ -252,7 +270,7 @@ protected:
                 assert(_lb); assert(_gt);
                 ordering_Memory.resize(nworkers * (2*ff_farm::ondemand_buffer()+3)+ordering_memsize);
                 _lb->init(ordering_Memory.begin(), ordering_Memory.size());
-                _gt->init(ordering_memsize);
+                _gt->init(ordering_Memory.size(), _lb->get_released());
                 setlb(_lb, true);
                 setgt(_gt, true);
                 
@@ -270,6 +288,14 @@ protected:
             }        
         }
 
+        if (input_numanode!=FF_NUMA_NONE || input_hugepages) {
+            for(size_t i=0;i<nworkers;++i) {
+                workers[i]->set_input_placement(input_numanode, input_hugepages);
+                if (hasCollector()) 
+                    workers[i]->set_output_placement(input_numanode, input_hugepages);
+            }
+        }
+
         // accelerator
         if (has_input_channel) { 
             if (create_input_buffer(in_buffer_entries, fixedsizeIN)<0) {
@@ -656,7 +682,80 @@ protected:
             }
         }
         
+
+        if (input_batch_size>1) {
+            for(size_t i=0;i<nworkers;++i) {
+                ff_node *w = workers[i];
+                if (w->isMultiInput() || w->isPipe() || w->isFarm() || w->isAll2All()) continue;
+                w->set_input_batch(input_batch_size);
+            }
+            // the ordered farm collectors receive one task at a time from each worker
+            if (!ordered && hasCollector()) gt->set_input_batch(input_batch_size);
+        }
+        if (collector_ready && hasCollector()) {
+            if (ordered && !ondemand) {
+                error("FARM, ready notification cannot be used in ordered farms without on-demand scheduling\n");
+                return -1;
+            }
+            gt->set_ready_notification(true);
+        }
+        if (stealing_dequesize) {
+            if (lb->get_keyrouter()) {
+                error("FARM, work-stealing and keyed scheduling cannot be used together\n");
+                return -1;
+            }
+            if (ordered) {
+                error("FARM, work-stealing scheduling cannot be used in ordered farms\n");
+                return -1;
+            }
+            svector<ff_node*> W;
+            for(size_t i=0;i<nworkers;++i) {
+                ff_node *w = workers[i];
+                if (w->isMultiInput() || w->isPipe() || w->isFarm() || w->isAll2All() || w->isComp()) continue;
+                W.push_back(w);
+            }
+            if (W.size()) {
+                stealing_group = new ff_wsgroup(W.size(), stealing_dequesize);
+                for(size_t i=0;i<W.size();++i) {
+                    W[i]->wsgroup = stealing_group;
+                    W[i]->wsid    = i;
+                    W[i]->wsseed  = i+1;
+                }
+            }
+        }
+        if (lb->get_elastic()) {
+            if (stealing_dequesize || lb->get_keyrouter()) {
+                error("FARM, elastic farm with work-stealing or keyed scheduling\n");
+                return -1;
+            }
+            if (ordered) {
+                error("FARM, elastic farm cannot be ordered\n");
+                return -1;
+            }
+            if (lb->masterworker()) {
+                error("FARM, elastic farm cannot have feedback channels\n");
+                return -1;
+            }
+            for(size_t i=0;i<nworkers;++i) {
+                ff_node *w = workers[i];
+                if (w->isMultiInput() || w->isMultiOutput() || w->isPipe() ||
+                    w->isFarm() || w->isAll2All() || w->isComp()) {
+                    error("FARM, the workers of an elastic farm must be sequential nodes\n");
+                    return -1;
+                }
+            }
+            lb->init_elastic();
+        }
+        if (input_lookahead>1) {
+            for(size_t i=0;i<nworkers;++i) {
+                FFBUFFER *b = workers[i]->get_in_buffer();
+                if (b) b->set_lookahead(input_lookahead);
+                if (hasCollector() && (b=workers[i]->get_out_buffer())) 
+                    b->set_lookahead(input_lookahead);
+            }
+        }
         
+        if (lattracer) latency_attach(lattracer, "");
         prepared=true;
         return 0;
     }
@@ -817,6 +916,12 @@ public:
         collector_removed = f.collector_removed;
         ordered           = f.ordered;
         ordering_memsize  = f.ordering_memsize;
+        input_batch_size  = f.input_batch_size;
+        input_lookahead   = f.input_lookahead;
+        collector_ready   = f.collector_ready;
+        stealing_dequesize= f.stealing_dequesize;
+        input_numanode    = f.input_numanode;
+        input_hugepages   = f.input_hugepages;
         ondemand = f.ondemand; in_buffer_entries = f.in_buffer_entries;
         out_buffer_entries = f.out_buffer_entries;
         worker_cleanup = f.worker_cleanup; 
@@ -860,6 +965,12 @@ public:
         ordered           = f.ordered;
         ordering_memsize  = f.ordering_memsize;
         ordering_Memory   = std::move(f.ordering_Memory);
+        input_batch_size  = f.input_batch_size;
+        input_lookahead   = f.input_lookahead;
+        collector_ready   = f.collector_ready;
+        stealing_dequesize= f.stealing_dequesize;
+        input_numanode    = f.input_numanode;
+        input_hugepages   = f.input_hugepages;
         ondemand = f.ondemand; in_buffer_entries = f.in_buffer_entries;
         out_buffer_entries = f.out_buffer_entries;
         worker_cleanup = f.worker_cleanup; 
@@ -890,6 +1001,7 @@ public:
      * gatherer, all the workers
      */
     virtual ~ff_farm() { 
+        if (lattracer) delete lattracer;
         if (emitter_cleanup) {
             if (lb && myownlb && lb->get_filter()) delete lb->get_filter();
             else if (emitter) delete emitter;
@@ -900,6 +1012,7 @@ public:
         }
         if (lb && myownlb) { delete lb; lb=NULL;}
         if (gt && myowngt) { delete gt; gt=NULL;}
+        if (stealing_group) { delete stealing_group; stealing_group=nullptr; }
         if (worker_cleanup) {
             for(size_t i=0;i<workers.size(); ++i) 
                 if (workers[i]) delete workers[i];
@@ -1088,14 +1201,147 @@ public:
         if (inbufferentries<=0) ondemand=1;
         else ondemand=inbufferentries;
     }
+
+    /**
+     * \brief Set the work-stealing scheduling
+     *
+     * Each worker moves the tasks it receives from the Emitter into its own
+     * work-stealing deque and computes them starting from the last one 
+     * received. A worker that has nothing to do steals the oldest task from 
+     * the deque of a worker chosen at random. So, the tasks queued behind a
+     * long task are computed by the idle workers. Workers can also push new
+     * tasks in their deque with \p ff_node::ff_send_out_local.
+     * The scheduling of the Emitter is on-demand (see \p set_scheduling_ondemand)
+     * so that tasks do not pile up in the channel of a busy worker.
+     * A worker terminates when it has received the EOS, its deque is empty 
+     * and there is nothing to steal. The output order of the tasks is not 
+     * preserved, so it cannot be used in ordered farms.
+     * Workers which are multi-input nodes, pipelines, farms, all-to-all or 
+     * combine building blocks do not take part in the work-stealing.
+     *
+     * \param inbufferentries number of slots of the workers' input channels
+     * \param dequesize capacity of the workers' deques
+     */
+    void set_scheduling_stealing(const int inbufferentries=4, 
+                                 const size_t dequesize=FF_WS_DEQUE_SIZE) {
+        if (prepared) {
+            error("FARM, set_scheduling_stealing, farm already prepared\n");
+            return;
+        }
+        set_scheduling_ondemand(inbufferentries);
+        stealing_dequesize = (dequesize==0) ? FF_WS_DEQUE_SIZE : dequesize;
+    }
+
+    /**
+     * \brief Set the keyed scheduling
+     *
+     * The Emitter sends each task to the worker selected by the key of the
+     * task, so that all the tasks with the same key are computed by the 
+     * same worker and the state associated with a key can be kept by the 
+     * worker without locking (see ff_keyrouter). 
+     * With \p consistent the keys are mapped with consistent hashing: if the
+     * farm is thawed with fewer workers, only the keys of the stopped 
+     * workers move to other workers. 
+     * With \p rebalance the most frequent keys are sent to one out of two
+     * workers when the load is skewed; the application has to merge the 
+     * (partial) state of those keys.
+     *
+     * \param key function returning the key of a task (void*)
+     */
+    void set_scheduling_bykey(ff_keyrouter::key_t key, bool consistent=false, bool rebalance=false) {
+        set_scheduling_bykey(ff_keyrouter(key, consistent, rebalance));
+    }
+    /**
+     * \brief Set the keyed scheduling for tasks of type \p T
+     *
+     * \p key takes a \p T* and returns a key of any type for which
+     * std::hash is defined, e.g.
+     *   farm.set_scheduling_bykey<Tweet>([](Tweet* t) { return t->word; });
+     */
+    template<typename T, typename F>
+    void set_scheduling_bykey(F key, bool consistent=false, bool rebalance=false) {
+        set_scheduling_bykey(ff_keyof<T>(key), consistent, rebalance);
+    }
+    void set_scheduling_bykey(const ff_keyrouter &router) {
+        if (prepared) {
+            error("FARM, set_scheduling_bykey, farm already prepared\n");
+            return;
+        }
+        lb->set_scheduling_bykey(router);
+    }
+    /// the key router of the Emitter, NULL if the scheduling is not keyed
+    const ff_keyrouter* get_keyrouter() const { return lb->get_keyrouter(); }
+
+    /// number of tasks stolen by the workers (work-stealing scheduling)
+    size_t get_nsteals() const {
+        return stealing_group ? stealing_group->get_nsteals() : 0;
+    }
+
+    /**
+     * \brief Makes the farm elastic
+     *
+     * The Emitter periodically measures the utilization of the active
+     * workers (the fraction of time spent in their svc method) and the tasks
+     * queued in their channels, and changes the number of active workers
+     * within [\p minw, \p maxw] to keep the utilization close to 
+     * \p utilization (see ff_elastic, also for the latency SLO).
+     * The stream is not drained: a removed worker computes the tasks already
+     * in its channel and then it is frozen (its svc_end is called), an added
+     * worker is thawed (its svc_init is called again).
+     * All the workers are active again when the EOS is sent.
+     * The controller runs when the Emitter schedules a task, with on-demand
+     * scheduling (see \p set_scheduling_ondemand) the Emitter does not run
+     * too far ahead of the workers.
+     * The workers must be sequential nodes, the farm cannot be ordered and
+     * cannot use work-stealing, keyed scheduling or feedback channels.
+     *
+     * \param minw minimum number of active workers
+     * \param maxw maximum number of active workers (0 means all the workers)
+     * \param utilization target utilization in (0,1]
+     */
+    void set_elastic(size_t minw=1, size_t maxw=0, double utilization=FF_ELASTIC_UTIL) {
+        set_elastic(ff_elastic(minw, maxw, utilization));
+    }
+    void set_elastic(const ff_elastic &e) {
+        if (prepared) {
+            error("FARM, set_elastic, farm already prepared\n");
+            return;
+        }
+        lb->set_elastic(e);
+    }
+    /// the controller of an elastic farm, NULL if the farm is not elastic
+    const ff_elastic* get_elastic() const { return lb->get_elastic(); }
+
+    /**
+     * \brief Enables the latency tracing
+     *
+     * One task out of \p sample received (or generated) by the Emitter is
+     * traced through the Emitter, the workers and the Collector (see
+     * ff_latency_tracer). It must be called before running the farm.
+     */
+    void set_latency_tracing(size_t sample=FF_LATENCY_SAMPLE) {
+        if (prepared) {
+            error("FARM, set_latency_tracing, farm already prepared\n");
+            return;
+        }
+        if (lattracer) delete lattracer;
+        lattracer = new ff_latency_tracer(sample);
+    }
+    /// latency histograms of the Emitter, the workers, the Collector and 
+    /// end-to-end, nullptr if not enabled
+    const ff_latency_tracer* get_latency_tracer() const { return lattracer; }
     /**
      * \brief Force ordering. 
      *  
      * The data elements will be produced in output respecting the
      * input ordering.
      *
-     * The \param MemoryElements sets the maximum size of the buffer in the 
+     * The \param MemoryElements sets the maximum size of the buffer in the
      * collector when the scheduling of elements is on-demand.
+     * The tasks in flight (i.e. sent by the Emitter and not yet delivered
+     * by the collector) are at most MemoryElements plus the tasks the
+     * workers' channels can hold; when this window is full, the Emitter
+     * waits for the collector.
      */
     void set_ordered(const size_t MemoryElements=DEF_OFARM_ONDEMAND_MEMORY) {
         if (prepared) {
@@ -1113,6 +1359,76 @@ public:
     
     int ondemand_buffer() const { return ondemand; }
     ssize_t ordering_memory_size() const { return ordering_memsize; }
+
+    /**
+     * \brief Sets the input batch size of the workers and of the collector
+     *
+     * Each worker (and the collector, if the farm is not ordered) pops up to 
+     * \p n tasks at a time from its input channel(s). Composite workers 
+     * (pipelines, farms, multi-input nodes) are not affected.
+     * It must be called before running the farm.
+     */
+    void set_input_batch(size_t n) {
+        if (prepared) {
+            error("FARM, set_input_batch, farm already prepared\n");
+            return;
+        }
+        input_batch_size = n;
+    }
+    size_t input_batch() const { return input_batch_size; }
+
+    /**
+     * \brief The collector looks only at the non-empty workers' channels
+     *
+     * The workers mark their output channel as ready after each push, so
+     * that the collector does not poll all the channels to find a task 
+     * (see ff_gatherer::set_ready_notification). It pays off with many 
+     * workers. It must be called before running the farm.
+     * It requires FF_READYSET (see config.hpp).
+     */
+    void set_ready_notification(bool on=true) {
+        if (prepared) {
+            error("FARM, set_ready_notification, farm already prepared\n");
+            return;
+        }
+        collector_ready = on;
+    }
+
+    /**
+     * \brief Sets the lookahead distance of the workers' channels
+     *
+     * The input channels of the workers and the channels between the 
+     * workers and the collector use batched lookahead with distance 
+     * \p n (see \p SWSR_Ptr_Buffer::set_lookahead). 
+     * It must be called before running the farm.
+     */
+    void set_input_lookahead(size_t n) {
+        if (prepared) {
+            error("FARM, set_input_lookahead, farm already prepared\n");
+            return;
+        }
+        input_lookahead = n;
+    }
+
+    /**
+     * \brief Sets where the memory of the farm's channels is allocated
+     *
+     * It applies to the input channel of the farm, to the input channels of
+     * the workers and to the channels between the workers and the collector
+     * (see \p ff_node::set_input_placement). With FF_NUMA_CONSUMER (default)
+     * each channel is bound to the NUMA node of the thread reading it, i.e.
+     * the emitter, the worker and the collector, respectively.
+     * It must be called before running the farm.
+     */
+    void set_input_placement(long node=FF_NUMA_CONSUMER, bool hugepages=false) {
+        if (prepared) {
+            error("FARM, set_input_placement, farm already prepared\n");
+            return;
+        }
+        ff_node::set_input_placement(node, hugepages);
+        input_numanode  = node;
+        input_hugepages = hugepages;
+    }
     
     /**
      *  \brief Adds workers to the form
@@ -1321,6 +1637,23 @@ public:
         lb->blocking_mode(blk);
         if (gt) gt->blocking_mode(blk);            
     }
+
+    /**
+     * \brief Sets the backoff policy of all the threads of the farm
+     *
+     * Emitter, collector and workers get their own copy of \p policy 
+     * (see \p ff_node::set_backoff), the farm's one is used by the 
+     * main thread in accelerator mode (offload and load_result).
+     * It must be called after the workers have been added and before
+     * running the farm.
+     */
+    virtual void set_backoff(const ff_backoff &policy) {
+        ff_node::set_backoff(policy);
+        lb->set_backoff(policy);
+        if (gt) gt->set_backoff(policy);
+        for(size_t i=0;i<workers.size();++i) 
+            workers[i]->set_backoff(policy);
+    }
     
     inline int cardinality() const { 
         int card=0;
@@ -1557,10 +1890,11 @@ public:
                 struct timespec tv;
                 timedwait_timeout(tv);                
                 pthread_mutex_lock(prod_m);
-                pthread_cond_timedwait(prod_c, prod_m, &tv);
+                ff_cond_timedwait(prod_c, prod_m, &tv);
                 pthread_mutex_unlock(prod_m);
                 goto _retry;
             }
+            inbuffer->set_producer_parking(backoff_out ? backoff_out->parking() : nullptr);
             for(unsigned long i=0;i<retry;++i) {
                 if (inbuffer->push(task)) return true;
                 losetime_out(ticks);
@@ -1606,10 +1940,12 @@ public:
             struct timespec tv;
             timedwait_timeout(tv);
             pthread_mutex_lock(cons_m);
-            pthread_cond_timedwait(cons_c, cons_m,&tv);
+            ff_cond_timedwait(cons_c, cons_m,&tv);
             pthread_mutex_unlock(cons_m);
             goto _retry;
         }
+        if (gt->get_out_buffer()) 
+            gt->get_out_buffer()->set_consumer_parking(backoff_in ? backoff_in->parking() : nullptr);
         for(unsigned long i=0;i<retry;++i) {
             if (gt->pop_nb(task)) {
                 if ((*task != (void *)FF_EOS)) return true;
@@ -1752,6 +2088,21 @@ public:
         w.push_back(this);
     }
 
+    // the default Emitter and Collector just forward the by_value slots
+    inline bool value_input() const {
+        if (emitter) return emitter->value_input();
+        for(size_t i=0;i<workers.size();++i)
+            if (!workers[i]->value_input()) return false;
+        return true;
+    }
+    inline bool value_output() const {
+        if (collector && !collector_removed && (collector != (ff_node*)gt))
+            return collector->value_output();
+        for(size_t i=0;i<workers.size();++i)
+            if (workers[i]->value_output()) return true;
+        return false;
+    }
+
     /*  WARNING: if these methods are called after prepare (i.e. after having called
      *  run_and_wait_end/run_then_freeze/run/....) they have no effect.     
      *
@@ -1912,6 +2263,21 @@ protected:
      */
     void svc_end()        {}
 
+    // all the workers share the histogram of the stage "workers"
+    void latency_attach(ff_latency_tracer *t, const std::string &name) {
+        const std::string prefix = name.empty() ? name : name + ".";
+        ff_latnode *l = t->node(prefix + "emitter");
+        lb->set_latnode(l);
+        if (emitter) emitter->set_latnode(l);
+        for(size_t i=0;i<workers.size();++i)
+            workers[i]->latency_attach(t, prefix + "workers");
+        if (hasCollector()) {
+            l = t->node(prefix + "collector");
+            gt->set_latnode(l);
+            if (collector && collector != (ff_node*)gt) collector->set_latnode(l);
+        }
+    }
+
     ssize_t get_my_id() const { return -1; };
 
 
@@ -1960,6 +2326,8 @@ protected:
             return -1;
         }
         if (emitter) {
+            if (in_numanode!=FF_NUMA_NONE || in_hugepages) 
+                emitter->set_input_placement(in_numanode, in_hugepages);
             if (emitter->create_input_buffer(nentries,fixedsize)<0) return -1;
             if (emitter->isMultiInput()) {
                 if (emitter->isComp()) 
@@ -2124,6 +2492,14 @@ protected:
     int out_buffer_entries;
     size_t max_nworkers;
     size_t ordering_memsize;
+    size_t input_batch_size = 0;
+    size_t input_lookahead  = 1;
+    bool   collector_ready  = false;        // see set_ready_notification
+    long   input_numanode   = FF_NUMA_NONE;
+    size_t stealing_dequesize = 0;         // if >0, work-stealing scheduling
+    ff_wsgroup* stealing_group = nullptr;
+    bool   input_hugepages  = false;
+    ff_latency_tracer *lattracer = nullptr;  // see set_latency_tracing
     
     ff_node          *  emitter;
     ff_node          *  collector;
@@ -41,6 +41,7 @@
 #include <ff/svector.hpp>
 #include <ff/utils.hpp>
 #include <ff/node.hpp>
+#include <ff/readyset.hpp>
 
 namespace ff {
 
@@ -160,6 +161,9 @@ protected:
      */
     virtual inline void losetime_out(unsigned long ticks=TICKS2WAIT) { 
         FFTRACE(lostpushticks+=ticks;++pushwait);
+        ff_timeline_span span(ff_timeline::WAIT_OUT);
+        if (ff_executor::yield()) return;
+        if (backoff_out) { backoff_out->wait(ticks); return; }
 #if defined(SPIN_USE_PAUSE)
         const long n = (long)ticks/2000;
         for(int i=0;i<=n;++i) PAUSE();
@@ -176,6 +180,9 @@ protected:
      */
     virtual inline void losetime_in(unsigned long ticks=TICKS2WAIT) { 
         FFTRACE(lostpopticks+=ticks;++popwait);
+        ff_timeline_span span(ff_timeline::WAIT_IN);
+        if (ff_executor::yield()) return;
+        if (backoff_in) { backoff_in->wait(ticks); return; }
 #if defined(SPIN_USE_PAUSE)
         const long n = (long)ticks/2000;
         for(int i=0;i<=n;++i) PAUSE();
@@ -196,33 +203,80 @@ protected:
      */
     virtual ssize_t gather_task(void ** task) {
         unsigned int cnt;
+        if (batch_idx < batch_cnt) {    // serving the current batch
+            *task = batch[batch_idx++];
+            return batch_src;
+        }
+        if (readyactive) return gather_task_ready(task);
         do {
             cnt=0;
             do {
                 nextr = selectworker();
                 //assert(offline[nextr]==false);
-                if (workers[nextr]->get(task)) {
-                    return nextr;
-                }
-                else if (++cnt == nattempts()) break;
+                if (get_from(nextr, task)) return nextr;
+                if (++cnt == nattempts()) break;
             } while(1);
-            if (blocking_in) {
-                struct timespec tv;
-                timedwait_timeout(tv);
-                pthread_mutex_lock(cons_m);
-                pthread_cond_timedwait(cons_c, cons_m, &tv);
-                pthread_mutex_unlock(cons_m);
-            } else losetime_in();
+            wait_input();
         } while(1);
         return -1;
     }
 
+    /**
+     * \brief It gathers the tasks looking only at the ready channels
+     *
+     * Used instead of the round-robin polling of \p gather_task when the
+     * ready notification is enabled (see \p set_ready_notification). The 
+     * ready channels are visited in round-robin order, \p selectworker and
+     * \p nattempts are not used.
+     */
+    inline ssize_t gather_task_ready(void ** task) {
+        do {
+            ssize_t i;
+            while((i = readyset->next(nextr, running)) >= 0) {
+                nextr = i;
+                if (offline[i]) { readyset->clear(i); continue; }
+                if (get_from(i, task)) return i;
+                readyset->clear(i);
+                // a push may have found the bit still set
+                if (get_from(i, task)) { readyset->set(i); return i; }
+            }
+            wait_input();
+        } while(1);
+        return -1;
+    }
+
+    // pops one task (or one batch of tasks) from the channel of worker i
+    inline bool get_from(ssize_t i, void ** task) {
+        if (batch_size>1) {
+            size_t r = workers[i]->get_n(batch, batch_size);
+            if (r) {
+                *task = batch[0];
+                batch_idx=1, batch_cnt=r, batch_src=i;
+                return true;
+            }
+            return false;
+        } 
+        return workers[i]->get(task);
+    }
+
+    // no task found, waits before trying again
+    inline void wait_input() {
+        if (blocking_in) {
+            struct timespec tv;
+            timedwait_timeout(tv);
+            pthread_mutex_lock(cons_m);
+            ff_cond_timedwait(cons_c, cons_m, &tv);
+            pthread_mutex_unlock(cons_m);
+        } else losetime_in();
+    }
+
     /**
      * \brief Pushes the task in the tasks queue.
      *
      * It pushes the tasks in a queue. 
      */
     inline bool push(void * task, unsigned long retry=((unsigned long)-1), unsigned long ticks=(TICKS2WAIT)) {
+        if (ff_latnode *lat = get_latnode()) if (task < FF_TAG_MIN) lat->out(task);
         if (blocking_out) {
             if (!filter) {
                 bool empty=buffer->empty();
@@ -231,7 +285,7 @@ protected:
                     struct timespec tv;
                     timedwait_timeout(tv);
                     pthread_mutex_lock(prod_m);
-                    pthread_cond_timedwait(prod_c,prod_m, &tv);
+                    ff_cond_timedwait(prod_c,prod_m, &tv);
                     pthread_mutex_unlock(prod_m);  
                 }
                 if (empty) pthread_cond_signal(p_cons_c);
@@ -242,7 +296,7 @@ protected:
                     struct timespec tv;
                     timedwait_timeout(tv);
                     pthread_mutex_lock(prod_m);
-                    pthread_cond_timedwait(prod_c,prod_m,&tv);
+                    ff_cond_timedwait(prod_c,prod_m,&tv);
                     pthread_mutex_unlock(prod_m);      
                 }
                 if (empty) pthread_cond_signal(p_cons_c);
@@ -322,7 +376,7 @@ public:
         max_nworkers(max_num_workers), running(-1), nextr(-1),
         neos(0),neosnofreeze(0),channelid(-1),feedbackid(0),
         filter(NULL), workers(max_nworkers), offline(max_nworkers), buffer(NULL),
-        skip1pop(false),frominput(false) {
+        skip1pop(false),frominput(false),ag_workers(16),ag_retry(16) {
         time_setzero(tstart);time_setzero(tstop);
         time_setzero(wtstart);time_setzero(wtstop);
         wttime=0;
@@ -331,6 +385,10 @@ public:
         offline.resize(max_nworkers);
 
         blocking_in = blocking_out = FF_RUNTIME_MODE;
+#if defined(SPINPARK_MODE)
+        backoff_in  = new ff_backoff_park;
+        backoff_out = new ff_backoff_park;
+#endif
 
         FFTRACE(taskcnt=0;lostpushticks=0;pushwait=0;lostpopticks=0;popwait=0;ticksmin=(ticks)-1;ticksmax=0;tickstot=0);
     }
@@ -347,6 +405,9 @@ public:
         buffer         = gtin.buffer;
         blocking_in    = gtin.blocking_in;
         blocking_out   = gtin.blocking_out;
+        std::swap(backoff_in,  gtin.backoff_in);
+        std::swap(backoff_out, gtin.backoff_out);
+        std::swap(readyset,    gtin.readyset);
         skip1pop       = gtin.skip1pop;
         frominput      = gtin.frominput;
         filter         = gtin.filter;
@@ -362,6 +423,9 @@ public:
     }
     
     virtual ~ff_gatherer() {
+        if (backoff_in)  delete backoff_in;
+        if (backoff_out) delete backoff_out;
+        if (readyset)    delete readyset;
         if (cons_m) {
             pthread_mutex_destroy(cons_m);
             free(cons_m);
@@ -382,7 +446,57 @@ public:
             free(prod_c);
             prod_c = nullptr;
         }
+        if (batch) free(batch);
+    }
+
+    /**
+     * \brief Sets the input batch size
+     *
+     * The default \p gather_task pops up to \p n tasks at a time from the 
+     * selected worker and then serves them one by one (in FIFO order).
+     * With \p n<=1 batching is disabled (default). It must not be used 
+     * together with \p all_gather.
+     */
+    void set_input_batch(size_t n) {
+        if (batch) { free(batch); batch=nullptr; }
+        batch_size=batch_idx=batch_cnt=0;
+        if (n<=1) return;
+        batch = (void**)malloc(n*sizeof(void*));
+        assert(batch);
+        batch_size = n;
+    }
+
+    /**
+     * \brief Enables the ready notification of the input channels
+     *
+     * The producers of the input channels set a bit in a bitmap shared
+     * with the gatherer after each push, so that \p gather_task looks only
+     * at the channels that may be non-empty instead of polling all of them
+     * (see ff_readyset). It pays off with many input channels most of
+     * which are empty at any time. It must be called before running.
+     * It requires FF_READYSET (see config.hpp).
+     */
+    void set_ready_notification(bool on=true) {
+        if (!on) {
+            if (readyset) { delete readyset; readyset=nullptr; }
+            return;
+        }
+#if defined(FF_READYSET)
+        if (!readyset) readyset = new ff_readyset;
+#else
+        error("GT, set_ready_notification, FF_READYSET not defined, the input channels are polled\n");
+#endif
     }
+    bool ready_notification() const { return readyset != nullptr; }
+
+    // tracing state of the Collector (see ff_latency_tracer), by default the
+    // one of the filter (e.g. the multi-input node using this gatherer)
+    void set_latnode(ff_latnode *l) { latnode = l; }
+    inline ff_latnode* get_latnode() const {
+        return latnode ? latnode : (filter ? filter->latnode : nullptr);
+    }
+
+    std::string timeline_name() const { return "collector " + std::to_string(tid); }
 
     /**
      * \brief Sets the filer
@@ -545,6 +659,26 @@ public:
 #endif        
         gettimeofday(&tstart,NULL);
         for(ssize_t i=0;i<running;++i)  offline[i]=false;
+        ag_workers.reserve(workers.size());
+        ag_retry.reserve(workers.size());
+        ff_parking *pin  = backoff_in  ? backoff_in->parking()  : nullptr;
+        ff_parking *pout = backoff_out ? backoff_out->parking() : nullptr;
+        // the gatherer is the consumer of the workers' output channels
+        // and the producer of its output channel
+        if (readyset) readyset->init(workers.size());
+        readyactive = (readyset != nullptr);
+        for(size_t i=0;i<workers.size();++i) {
+            FFBUFFER* b = workers[i]->get_out_buffer();
+            if (b) {
+                b->set_consumer_parking(pin);
+                b->set_consumer_readyset(readyset, i);
+            } else readyactive = false;  // nobody would notify this channel
+            ff_placeOnMyNode(b);
+        }
+        {
+            FFBUFFER* b = filter ? filter->get_out_buffer() : buffer;
+            if (b) b->set_producer_parking(pout);
+        }
         if (filter) {
             if (filter->isComp() && !filter->isMultiInput())
                 filter->set_neos(running);
@@ -582,6 +716,9 @@ public:
         // input channel.
         bool notify_each_eos = filter ? (filter->neos==1): false;
 
+        ff_latnode *lat = get_latnode();
+        if (lat) lat->start(false, !outpresent && !filter_outpresent);
+
         // TODO: skipallpop missing!
 
         gettimeofday(&wtstart,NULL);
@@ -615,13 +752,17 @@ public:
                 ret = task;
             } else {
                 FFTRACE(++taskcnt);
+                if (lat) { lat->in(task); if (!filter) lat->done(); }
                 if (filter)  {                    
                     FFTRACE(ticks t0 = getticks());
 
 #if defined(FF_TASK_CALLBACK)
                     if (filter) callbackIn(this);
 #endif
+                    const int64_t tl = ff_timeline::begin();
                     task = filter->svc(task);
+                    ff_timeline::end(ff_timeline::SVC, tl);
+                    if (lat) lat->done();
 
 #if defined(TRACE_FASTFLOW)
                     ticks diff=(getticks()-t0);
@@ -653,6 +794,7 @@ public:
 
         // GO_OUT, EOS_NOFREEZE and EOSW are not propagated !
         if (ret == FF_EOS) {
+            ff_timeline::instant(ff_timeline::EOS);
             // we notify the filter only when we have received all EOSs
             if (!notify_each_eos && filter) filter->eosnotify();
 
@@ -720,6 +862,22 @@ public:
         blocking_in = blocking_out = blk;
     }
 
+    // see ff_node::set_backoff
+    void set_backoff(const ff_backoff &policy) {
+        set_backoff_in(policy);
+        set_backoff_out(policy);
+    }
+    void set_backoff_in(const ff_backoff &policy) {
+        if (backoff_in) delete backoff_in;
+        backoff_in = policy.clone();
+    }
+    void set_backoff_out(const ff_backoff &policy) {
+        if (backoff_out) delete backoff_out;
+        backoff_out = policy.clone();
+    }
+    const ff_backoff* get_backoff_in()  const { return backoff_in; }
+    const ff_backoff* get_backoff_out() const { return backoff_out; }
+
     void no_mapping() {
         default_mapping = false;
     }
@@ -745,13 +903,14 @@ public:
         if (ag_callback)  return ag_callback(task,V,ag_callback_arg);
 
         V[channelid]=task;
-        size_t nw=getnworkers();
-        svector<ff_node*> _workers(nw);
+        svector<ff_node*> &_workers = ag_workers;  // preallocated in svc_init
+        _workers.resize(0);
         for(ssize_t i=0;i<running;++i) {
             if (!offline[i]) _workers.push_back(workers[i]);
             else _workers.push_back(nullptr);
         }
-        svector<size_t> retry(nw);
+        svector<size_t> &retry = ag_retry;
+        retry.resize(0);
 
         for(ssize_t i=0;i<running;++i) {
             if(i != channelid) {
@@ -770,7 +929,7 @@ public:
                     struct timespec tv;
                     timedwait_timeout(tv);
                     pthread_mutex_lock(cons_m);
-                    pthread_cond_timedwait(cons_c, cons_m, &tv);
+                    ff_cond_timedwait(cons_c, cons_m, &tv);
                     pthread_mutex_unlock(cons_m);
                 } else losetime_in();
             }
@@ -790,7 +949,7 @@ public:
                     FFTRACE(taskcnt--);
                 }
         }
-        FFTRACE(taskcnt+=nw-1);
+        FFTRACE(taskcnt+=getnworkers()-1);
         return eos?-1:0;
     }
 
@@ -861,6 +1020,12 @@ public:
             << "  svc ticks     : " << tickstot  << " (min= " << (filter?ticksmin:0) << " max= " << ticksmax << ")\n"
             << "  n. push lost  : " << pushwait  << " (ticks=" << lostpushticks << ")" << "\n"
             << "  n. pop lost   : " << popwait   << " (ticks=" << lostpopticks  << ")" << "\n";
+        if (backoff_in)
+            out << "  backoff in    : " << backoff_in->name() << " waits= " << backoff_in->get_nwaits()
+                << " (ticks=" << backoff_in->get_waitticks() << ")\n";
+        if (backoff_out)
+            out << "  backoff out   : " << backoff_out->name() << " waits= " << backoff_out->get_nwaits()
+                << " (ticks=" << backoff_out->get_waitticks() << ")\n";
     }
 
     virtual double getworktime() const { return wttime; }
@@ -895,6 +1060,17 @@ private:
     int  (*ag_callback)(void *,void **, void*);
     void  * ag_callback_arg;
 
+    void           ** batch      = nullptr;  // see set_input_batch
+    size_t            batch_size = 0;
+    size_t            batch_idx  = 0;
+    size_t            batch_cnt  = 0;
+    ssize_t           batch_src  = -1;
+    ff_readyset     * readyset   = nullptr;  // see set_ready_notification
+    bool              readyactive = false;
+    ff_latnode      * latnode    = nullptr;  // see set_latnode
+    svector<ff_node*> ag_workers;            // preallocated state of all_gather
+    svector<size_t>   ag_retry;
+
     
     struct timeval tstart;
     struct timeval tstop;
@@ -918,6 +1094,8 @@ protected:
 
     bool               blocking_in;
     bool               blocking_out;
+    ff_backoff        *backoff_in  = nullptr;
+    ff_backoff        *backoff_out = nullptr;
 
 #if defined(TRACE_FASTFLOW)
     unsigned long taskcnt;
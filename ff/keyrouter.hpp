@@ -0,0 +1,220 @@
+/* -*- Mode: C++; tab-width: 4; c-basic-offset: 4; indent-tabs-mode: nil -*- */
+
+/*!
+ * \file keyrouter.hpp
+ * \ingroup building_blocks
+ *
+ * \brief Key-based routing of tasks used by the keyed scheduling of the
+ * farm and of the all-to-all (see ff_farm::set_scheduling_bykey)
+ *
+ */
+
+#ifndef FF_KEYROUTER_HPP
+#define FF_KEYROUTER_HPP
+
+/* ***************************************************************************
+ *
+ *  FastFlow is free software; you can redistribute it and/or modify it
+ *  under the terms of the GNU Lesser General Public License version 3 as
+ *  published by the Free Software Foundation.
+ *  Starting from version 3.0.1 FastFlow is dual licensed under the GNU LGPLv3
+ *  or MIT License (https://github.com/ParaGroup/WindFlow/blob/vers3.x/LICENSE.MIT)
+ *
+ *  This program is distributed in the hope that it will be useful, but WITHOUT
+ *  ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ *  FITNESS FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public
+ *  License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public License
+ *  along with this program; if not, write to the Free Software Foundation,
+ *  Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ *
+ ****************************************************************************
+ */
+
+#include <cstdint>
+#include <vector>
+#include <utility>
+#include <algorithm>
+#include <functional>
+#include <type_traits>
+#include <ff/config.hpp>
+
+namespace ff {
+
+/*!
+ * \class ff_keyrouter
+ * \ingroup building_blocks
+ *
+ * \brief Maps the key of a task to a destination worker
+ *
+ * The key of a task is computed by a user function. All the tasks with the
+ * same key are sent to the same worker (its home worker), so that the state
+ * associated with the key can be kept by the worker without locking.
+ *
+ * By default the home worker is the hash of the key modulo the number of
+ * running workers. With consistent hashing, the workers are placed on a
+ * ring (FF_KEY_VNODES virtual points each) and the home worker is the first
+ * running worker found on the ring after the hash of the key. If the number
+ * of running workers changes (e.g. a farm thawed with fewer workers) only
+ * the keys of the removed (or added) workers move.
+ *
+ * With rebalancing, the router counts the tasks sent to each worker and
+ * keeps the most frequent keys (Misra-Gries summary). When, in a window of
+ * FF_KEY_WINDOW tasks, the most loaded worker receives more than FF_KEY_SKEW
+ * times the average, the frequent keys become hot: their tasks are sent
+ * either to the home worker or to a second fixed worker, whichever has been
+ * less loaded. So the state of a hot key is split between at most two
+ * workers, the application has to merge it (partial key grouping).
+ *
+ * Ref: D. Karger et al., "Consistent hashing and random trees", STOC 1997.
+ *      M.A.U. Nasir et al., "The power of both choices: Practical load
+ *      balancing for distributed stream processing engines", ICDE 2015.
+ */
+class ff_keyrouter {
+public:
+    typedef std::function<size_t(void*)> key_t;
+
+    ff_keyrouter(key_t key, bool consistent=false, bool rebalance=false):
+        key(key),consistent(consistent),rebalance(rebalance),
+        wcount(0),nhot(0),nmg(0),nrebalanced(0) {}
+
+    // the copy has the same routing function but no statistics
+    ff_keyrouter(const ff_keyrouter &r):
+        ff_keyrouter(r.key, r.consistent, r.rebalance) {}
+
+    /**
+     * \brief Returns the worker in [0, n) the task has to be sent to
+     */
+    inline size_t route(void *task, size_t n) {
+        const uint64_t h = mix((uint64_t)key(task));
+        if (n<=1) return 0;
+        size_t w = home(h, n);
+        if (!rebalance) return w;
+        if (load.size()<n) load.resize(n, 0);
+        track(h);
+        if (nhot && ishot(h)) {
+            const size_t a = alt(h, n, w);
+            if (load[a] < load[w]) { w = a; ++nrebalanced; }
+        }
+        ++load[w];
+        if (++wcount >= FF_KEY_WINDOW) newwindow(n);
+        return w;
+    }
+
+    /// the home worker of a key (the one used if the key is not hot)
+    inline size_t home_of(size_t k, size_t n) {
+        return (n<=1) ? 0 : home(mix((uint64_t)k), n);
+    }
+
+    /// number of keys currently considered hot
+    inline size_t get_nhot() const { return nhot; }
+    /// number of tasks of hot keys not sent to their home worker
+    inline size_t get_nrebalanced() const { return nrebalanced; }
+
+protected:
+    // 64-bit finalizer (splitmix64), user hashes are often the identity
+    static inline uint64_t mix(uint64_t x) {
+        x ^= x >> 30; x *= 0xbf58476d1ce4e5b9ULL;
+        x ^= x >> 27; x *= 0x94d049bb133111ebULL;
+        x ^= x >> 31;
+        return x;
+    }
+
+    inline size_t home(uint64_t h, size_t n) {
+        if (!consistent) return (size_t)(h % n);
+        if (ringsize < n) buildring(n);
+        size_t i = std::lower_bound(ring.begin(), ring.end(),
+                                    std::make_pair(h, (size_t)0)) - ring.begin();
+        for(;;++i) {
+            if (i==ring.size()) i=0;
+            if (ring[i].second < n) return ring[i].second;
+        }
+    }
+
+    // the second choice of a hot key
+    inline size_t alt(uint64_t h, size_t n, size_t w) {
+        if (!consistent) {
+            const size_t a = (size_t)(mix(h ^ 0x9e3779b97f4a7c15ULL) % n);
+            return (a==w) ? (w+1)%n : a;
+        }
+        // the next running worker on the ring
+        size_t i = std::lower_bound(ring.begin(), ring.end(),
+                                    std::make_pair(h, (size_t)0)) - ring.begin();
+        for(size_t k=0;k<ring.size();++k,++i) {
+            if (i==ring.size()) i=0;
+            if (ring[i].second < n && ring[i].second != w) return ring[i].second;
+        }
+        return w;
+    }
+
+    // the points of a worker do not depend on the number of workers
+    void buildring(size_t n) {
+        ring.clear();
+        for(size_t w=0;w<n;++w)
+            for(size_t v=0;v<FF_KEY_VNODES;++v)
+                ring.push_back(std::make_pair(mix(((uint64_t)w << 32) | v), w));
+        std::sort(ring.begin(), ring.end());
+        ringsize = n;
+    }
+
+    // Misra-Gries summary of the most frequent keys
+    inline void track(uint64_t h) {
+        for(size_t i=0;i<nmg;++i)
+            if (mg[i].first == h) { ++mg[i].second; return; }
+        if (nmg < FF_KEY_HOT) { mg[nmg++] = std::make_pair(h, (size_t)1); return; }
+        size_t j=0;
+        for(size_t i=0;i<nmg;++i)
+            if (--mg[i].second > 0) mg[j++] = mg[i];
+        nmg = j;
+    }
+
+    inline bool ishot(uint64_t h) const {
+        for(size_t i=0;i<nhot;++i) if (hot[i]==h) return true;
+        return false;
+    }
+
+    void newwindow(size_t n) {
+        const size_t avg = wcount / n;
+        size_t max = 0;
+        for(size_t i=0;i<n;++i) max = (std::max)(max, load[i]);
+        nhot = 0;
+        if (max > FF_KEY_SKEW * avg) {
+            // a key is hot if it alone takes at least half of the fair share
+            for(size_t i=0;i<nmg;++i)
+                if (2*mg[i].second >= avg) hot[nhot++] = mg[i].first;
+        }
+        for(size_t i=0;i<load.size();++i) load[i]=0;
+        for(size_t i=0;i<nmg;++i) mg[i].second /= 2;
+        wcount = 0;
+    }
+
+    key_t   key;
+    bool    consistent, rebalance;
+    std::vector<std::pair<uint64_t, size_t> > ring;
+    size_t  ringsize = 0;
+    std::vector<size_t> load;   // tasks sent to each worker in the window
+    size_t  wcount;
+    uint64_t hot[FF_KEY_HOT];
+    size_t  nhot;
+    std::pair<uint64_t, size_t> mg[FF_KEY_HOT];
+    size_t  nmg;
+    size_t  nrebalanced;
+};
+
+/**
+ * \brief Builds a key function for ff_keyrouter from a function
+ * computing the key of a task of type \p T. The key can be of any type
+ * for which std::hash is defined.
+ */
+template<typename T, typename F>
+static inline ff_keyrouter::key_t ff_keyof(F f) {
+    return [f](void *t) -> size_t {
+        typedef typename std::decay<decltype(f((T*)t))>::type K;
+        return std::hash<K>()(f((T*)t));
+    };
+}
+
+} // namespace ff
+
+#endif /* FF_KEYROUTER_HPP */
@@ -0,0 +1,331 @@
+/* -*- Mode: C++; tab-width: 4; c-basic-offset: 4; indent-tabs-mode: nil -*- */
+
+/*!
+ * \file latency.hpp
+ * \ingroup building_blocks
+ *
+ * \brief Sampled per-task latency tracing
+ * (see ff_pipeline::set_latency_tracing and ff_farm::set_latency_tracing)
+ *
+ */
+
+#ifndef FF_LATENCY_HPP
+#define FF_LATENCY_HPP
+
+/* ***************************************************************************
+ *
+ *  FastFlow is free software; you can redistribute it and/or modify it
+ *  under the terms of the GNU Lesser General Public License version 3 as
+ *  published by the Free Software Foundation.
+ *  Starting from version 3.0.1 FastFlow is dual licensed under the GNU LGPLv3
+ *  or MIT License (https://github.com/ParaGroup/WindFlow/blob/vers3.x/LICENSE.MIT)
+ *
+ *  This program is distributed in the hope that it will be useful, but WITHOUT
+ *  ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ *  FITNESS FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public
+ *  License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public License
+ *  along with this program; if not, write to the Free Software Foundation,
+ *  Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ *
+ ****************************************************************************
+ */
+
+#include <atomic>
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+#include <ostream>
+#include <ff/config.hpp>
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+namespace ff {
+
+// index of the most significant bit set, x must not be 0
+static inline unsigned ff_msb64(uint64_t x) {
+#if defined(_MSC_VER)
+    unsigned long r;
+    _BitScanReverse64(&r, x);
+    return (unsigned)r;
+#else
+    return 63u - (unsigned)__builtin_clzll(x);
+#endif
+}
+
+/*!
+ * \class ff_histogram
+ * \ingroup building_blocks
+ *
+ * \brief HDR-style histogram of latencies in nanoseconds
+ *
+ * Values below 2*SUB are counted exactly, above that each power of two is
+ * split in SUB linear buckets, so the relative error of a percentile is
+ * below 1/SUB. It can be updated by several threads and read while it is
+ * being updated.
+ */
+class ff_histogram {
+public:
+    enum { SUBBITS=5, SUB=(1<<SUBBITS), NBUCKETS=(65-SUBBITS)*SUB };
+
+    ff_histogram() { reset(); }
+
+    inline void record(uint64_t ns) {
+        counts[index(ns)].fetch_add(1, std::memory_order_relaxed);
+        total.fetch_add(1, std::memory_order_relaxed);
+        sum.fetch_add(ns, std::memory_order_relaxed);
+        uint64_t m = vmin.load(std::memory_order_relaxed);
+        while(ns < m && !vmin.compare_exchange_weak(m, ns, std::memory_order_relaxed));
+        m = vmax.load(std::memory_order_relaxed);
+        while(ns > m && !vmax.compare_exchange_weak(m, ns, std::memory_order_relaxed));
+    }
+
+    inline uint64_t get_count() const { return total.load(std::memory_order_relaxed); }
+    inline uint64_t get_min()   const { return get_count() ? vmin.load(std::memory_order_relaxed) : 0; }
+    inline uint64_t get_max()   const { return vmax.load(std::memory_order_relaxed); }
+    inline double   get_mean()  const {
+        const uint64_t n = get_count();
+        return n ? (double)sum.load(std::memory_order_relaxed)/n : 0.0;
+    }
+
+    /// the value below which the fraction \p p (in [0,1]) of the samples fall
+    uint64_t percentile(double p) const {
+        uint64_t n = 0;
+        for(size_t i=0;i<NBUCKETS;++i) n += counts[i].load(std::memory_order_relaxed);
+        if (n==0) return 0;
+        if (p<0.0) p=0.0;
+        if (p>1.0) p=1.0;
+        uint64_t rank = (uint64_t)(p*n + 0.5);
+        if (rank==0) rank=1;
+        uint64_t c = 0;
+        for(size_t i=0;i<NBUCKETS;++i) {
+            c += counts[i].load(std::memory_order_relaxed);
+            if (c>=rank) return (std::min)(highest(i), get_max());
+        }
+        return get_max();
+    }
+
+    void reset() {
+        for(size_t i=0;i<NBUCKETS;++i) counts[i].store(0, std::memory_order_relaxed);
+        total.store(0, std::memory_order_relaxed);
+        sum.store(0, std::memory_order_relaxed);
+        vmin.store(UINT64_MAX, std::memory_order_relaxed);
+        vmax.store(0, std::memory_order_relaxed);
+    }
+
+protected:
+    static inline size_t index(uint64_t v) {
+        if (v < 2*SUB) return (size_t)v;
+        const unsigned e = ff_msb64(v) - SUBBITS;
+        return (size_t)e*SUB + (size_t)(v>>e);
+    }
+    // largest value counted in bucket i
+    static inline uint64_t highest(size_t i) {
+        if (i < 2*SUB) return i;
+        const unsigned e = (unsigned)(i/SUB) - 1;
+        const uint64_t m = i%SUB + SUB;
+        return ((m+1)<<e) - 1;
+    }
+
+    std::atomic<uint64_t> counts[NBUCKETS];
+    std::atomic<uint64_t> total, sum, vmin, vmax;
+};
+
+class ff_latency_tracer;
+
+/*!
+ * \class ff_latnode
+ * \ingroup building_blocks
+ *
+ * \brief Tracing state of one thread of the graph (a sequential node, an
+ * Emitter or a Collector), used only by that thread
+ *
+ * \p origin is the time the sampled task being computed was generated by
+ * the source (0 if the task is not sampled) and \p hop the time it was
+ * sent to this node.
+ */
+struct ff_latnode {
+    ff_latnode(ff_latency_tracer *t, ff_histogram *h):tracer(t),hist(h) {}
+
+    inline void start(bool src, bool snk) { source=src; sink=snk; origin=0; cnt=0; }
+    inline void in(void *task);
+    inline void out(void *task);
+    inline void done();
+
+    ff_latency_tracer *tracer;
+    ff_histogram      *hist;
+    bool     source = false, sink = false;
+    int64_t  origin = 0, hop = 0;
+    size_t   cnt    = 0;
+};
+
+/*!
+ * \class ff_latency_tracer
+ * \ingroup building_blocks
+ *
+ * \brief Latency of a sampled subset of the tasks of a pipeline or of a farm
+ *
+ * One task out of \p sample sent by each source of the stream (a node
+ * without input channel) is timestamped. The task pointer is recorded in
+ * a small table together with the time it was generated and the time it
+ * was sent, so the tasks are not modified. When a node receives a sampled
+ * task it removes it from the table, the tasks it sends out while computing
+ * it inherit the generation time. Each node records in the histogram of its
+ * stage the time from when the task was sent to it until the node has
+ * computed it (waiting time in the channel plus service time), a node
+ * without output channel also records the end-to-end latency.
+ *
+ * A sample is lost if the table is full or if the task is sent in a batch,
+ * broadcast or dropped by a stage. Tasks whose pointer is reused while it
+ * is still in the table may be mixed up, entries older than
+ * FF_LATENCY_STALE milliseconds are overwritten.
+ */
+class ff_latency_tracer {
+    friend struct ff_latnode;
+public:
+    ff_latency_tracer(size_t sample=FF_LATENCY_SAMPLE):
+        sample(sample?sample:1),table(new slot[FF_LATENCY_TABLE]),ndropped(0) {}
+
+    /// the tracing state of a thread of the stage \p name
+    ff_latnode* node(const std::string& name) {
+        size_t i=0;
+        for(;i<names.size();++i) if (names[i]==name) break;
+        if (i==names.size()) {
+            names.push_back(name);
+            hists.emplace_back(new ff_histogram);
+        }
+        nodes.emplace_back(new ff_latnode(this, hists[i].get()));
+        return nodes.back().get();
+    }
+
+    inline size_t get_sample() const { return sample; }
+    /// number of stages, in the order in which they have been attached
+    inline size_t nstages() const { return names.size(); }
+    inline const std::string& stage_name(size_t i) const { return names[i]; }
+    inline const ff_histogram& stage(size_t i) const { return *hists[i]; }
+    const ff_histogram* stage(const std::string& name) const {
+        for(size_t i=0;i<names.size();++i) if (names[i]==name) return hists[i].get();
+        return nullptr;
+    }
+    /// latency from the source to a node without output channel
+    inline const ff_histogram& end2end() const { return e2e; }
+    /// samples lost because the table was full
+    inline size_t dropped() const { return ndropped.load(std::memory_order_relaxed); }
+
+    void reset() {
+        for(size_t i=0;i<hists.size();++i) hists[i]->reset();
+        e2e.reset();
+    }
+
+    /// prints count, mean, p50, p99, p99.9 and max (in microseconds) of each histogram
+    void print(std::ostream& out) const {
+        auto line = [&out](const std::string& name, const ff_histogram& h) {
+            out << "  " << name << ": n=" << h.get_count() << " mean=" << h.get_mean()/1000.0
+                << " p50=" << h.percentile(0.5)/1000.0 << " p99=" << h.percentile(0.99)/1000.0
+                << " p99.9=" << h.percentile(0.999)/1000.0 << " max=" << h.get_max()/1000.0 << " (us)\n";
+        };
+        out << "Latency (1 task out of " << sample << "):\n";
+        for(size_t i=0;i<names.size();++i) line(names[i], *hists[i]);
+        line("end-to-end", e2e);
+        if (dropped()) out << "  dropped samples: " << dropped() << "\n";
+    }
+
+    static inline int64_t now() {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(
+               std::chrono::steady_clock::now().time_since_epoch()).count();
+    }
+
+protected:
+    enum { PROBE=8 };
+    static const uintptr_t EMPTY=0, BUSY=1;
+    struct slot {
+        slot():key(EMPTY),origin(0),hop(0) {}
+        std::atomic<uintptr_t> key;
+        std::atomic<int64_t>   origin, hop;
+    };
+
+    static inline size_t hash(uintptr_t k) {
+        return (size_t)((k * 0x9E3779B97F4A7C15ULL) >> 32) & (FF_LATENCY_TABLE-1);
+    }
+
+    /*
+     * A slot is claimed by moving its key to BUSY, either from EMPTY or from
+     * the sampled task (take), or from a stale entry (insert).
+     */
+    void insert(void *task, int64_t origin, int64_t t) {
+        const uintptr_t k = (uintptr_t)task;
+        if (k==EMPTY || k==BUSY) return;
+        const size_t h = hash(k);
+        const int64_t stale = t - (int64_t)FF_LATENCY_STALE*1000000;
+        for(size_t p=0;p<PROBE;++p) {
+            slot &s = table[(h+p) & (FF_LATENCY_TABLE-1)];
+            uintptr_t e = s.key.load(std::memory_order_relaxed);
+            if (e==BUSY) continue;
+            if (e!=EMPTY && s.hop.load(std::memory_order_relaxed) > stale) continue;
+            if (!s.key.compare_exchange_strong(e, BUSY, std::memory_order_acquire)) continue;
+            s.origin.store(origin, std::memory_order_relaxed);
+            s.hop.store(t, std::memory_order_relaxed);
+            s.key.store(k, std::memory_order_release);
+            return;
+        }
+        ndropped.fetch_add(1, std::memory_order_relaxed);
+    }
+    bool take(void *task, int64_t& origin, int64_t& t) {
+        const uintptr_t k = (uintptr_t)task;
+        if (k==EMPTY || k==BUSY) return false;
+        const size_t h = hash(k);
+        for(size_t p=0;p<PROBE;++p) {
+            slot &s = table[(h+p) & (FF_LATENCY_TABLE-1)];
+            uintptr_t e = k;
+            if (s.key.load(std::memory_order_relaxed) != k) continue;
+            if (!s.key.compare_exchange_strong(e, BUSY, std::memory_order_acquire)) continue;
+            origin = s.origin.load(std::memory_order_relaxed);
+            t      = s.hop.load(std::memory_order_relaxed);
+            s.key.store(EMPTY, std::memory_order_release);
+            return true;
+        }
+        return false;
+    }
+
+    const size_t                               sample;
+    std::unique_ptr<slot[]>                    table;
+    std::atomic<size_t>                        ndropped;
+    ff_histogram                               e2e;
+    std::vector<std::string>                   names;
+    std::vector<std::unique_ptr<ff_histogram> > hists;
+    std::vector<std::unique_ptr<ff_latnode> >   nodes;
+};
+
+// called when the node receives a task from its input channels
+inline void ff_latnode::in(void *task) {
+    origin = 0;
+    tracer->take(task, origin, hop);
+}
+// called before the task is sent out
+inline void ff_latnode::out(void *task) {
+    if (origin) {
+        tracer->insert(task, origin, ff_latency_tracer::now());
+        return;
+    }
+    if (source && ++cnt >= tracer->sample) {
+        cnt = 0;
+        const int64_t t = ff_latency_tracer::now();
+        tracer->insert(task, t, t);
+    }
+}
+// called when the node has computed the task (the outputs may follow)
+inline void ff_latnode::done() {
+    if (!origin) return;
+    const int64_t t = ff_latency_tracer::now();
+    hist->record((uint64_t)(t - hop));
+    if (sink) tracer->e2e.record((uint64_t)(t - origin));
+}
+
+} // namespace ff
+
+#endif /* FF_LATENCY_HPP */
@@ -136,7 +136,9 @@ protected:
         //register int cnt=0;
 
         if (!task) task = FF_EOS;
-        broadcast_task(task);
+        // the workers of a keyed farm may have already got the EOS sent out by the filter
+        if (!eos_broadcast) broadcast_task(task);
+        eos_broadcast = false;
         if (feedbackid > 0) {
             for(size_t i=feedbackid; i<workers.size();++i)
                 this->ff_send_out_to(task, i);
@@ -201,6 +203,9 @@ protected:
      */
     virtual inline void losetime_out(unsigned long ticks=TICKS2WAIT) {
         FFTRACE(lostpushticks+=ticks; ++pushwait);
+        ff_timeline_span span(ff_timeline::WAIT_OUT);
+        if (ff_executor::yield()) return;
+        if (backoff_out) { backoff_out->wait(ticks); return; }
 #if defined(SPIN_USE_PAUSE)
         const long n = (long)ticks/2000;
         for(int i=0;i<=n;++i) PAUSE();
@@ -216,6 +221,9 @@ protected:
      */
     virtual inline void losetime_in(unsigned long ticks=TICKS2WAIT) {
         FFTRACE(lostpopticks+=ticks; ++popwait);
+        ff_timeline_span span(ff_timeline::WAIT_IN);
+        if (ff_executor::yield()) return;
+        if (backoff_in) { backoff_in->wait(ticks); return; }
 #if defined(SPIN_USE_PAUSE)
         const long n = (long)ticks/2000;
         for(int i=0;i<=n;++i) PAUSE();
@@ -240,6 +248,17 @@ protected:
     virtual inline bool schedule_task(void * task, 
                                       unsigned long retry=((unsigned long)-1), 
                                       unsigned long ticks=TICKS2WAIT) {
+        if (ff_latnode *lat = get_latnode()) if (task < FF_TAG_MIN) lat->out(task);
+        if (keyrouter) return schedule_task_bykey(task, retry, ticks);
+        return schedule_task_next(task, retry, ticks);
+    }
+
+    /*
+     * The task is sent to the worker selected by \p selectworker, it is the
+     * default policy of \p schedule_task.
+     */
+    inline bool schedule_task_next(void * task, unsigned long retry, unsigned long ticks) {
+        if (elastic) elastic_step();
         unsigned long cnt;
         if (blocking_out) {
             unsigned long r = 0;
@@ -266,7 +285,7 @@ protected:
                 struct timespec tv;
                 timedwait_timeout(tv);                
                 pthread_mutex_lock(prod_m);
-                pthread_cond_timedwait(prod_c, prod_m, &tv);
+                ff_cond_timedwait(prod_c, prod_m, &tv);
                 pthread_mutex_unlock(prod_m);
             } while(1);
             return true;
@@ -292,6 +311,97 @@ protected:
         return false;
     }
 
+    // largest batch that can be pushed at once into the input channel of
+    // every worker
+    inline size_t maxbatch() const {
+        size_t m = (size_t)-1;
+        for(size_t i=0;i<workers.size();++i) {
+            FFBUFFER *b = workers[i]->get_in_buffer();
+            if (b && b->maxbatch() < m) m = b->maxbatch();
+        }
+        return m;
+    }
+
+    /**
+     * \brief Schedules a batch of tasks
+     *
+     * Same as \p schedule_task but the whole batch of tasks is sent to 
+     * one single worker with one single push operation.
+     * This is a virtual function and can be redefined (e.g. to preserve 
+     * the per-task scheduling policy).
+     * A batch that can never fit into the bounded input channel of a worker
+     * is scheduled in slices, the retries apply to the first slice only.
+     *
+     * \return \p true, if successful, or \p false if not successful.
+     */
+    virtual inline bool schedule_task_batch(void ** tasks, size_t n,
+                                            unsigned long retry=((unsigned long)-1), 
+                                            unsigned long ticks=TICKS2WAIT) {
+        if (keyrouter) { // each task goes to the worker of its key
+            for(size_t i=0;i<n;++i) 
+                if (!schedule_task_bykey(tasks[i], retry, ticks)) return false;
+            return true;
+        }
+        const size_t maxb = maxbatch();
+        if (n > maxb) {
+            if (!schedule_task_batch(tasks, maxb, retry, ticks)) return false;
+            for(size_t i=maxb;i<n;i+=maxb)
+                schedule_task_batch(tasks+i, (n-i < maxb) ? n-i : maxb);
+            return true;
+        }
+        if (elastic) elastic_step();
+        unsigned long cnt;
+        if (blocking_out) {
+            unsigned long r = 0;
+            do {
+                cnt=0;
+                do {
+                    nextw = selectworker();
+                    assert(nextw>=0);                    
+#if defined(LB_CALLBACK)
+                    for(size_t i=0;i<n;++i) tasks[i] = callback(nextw, tasks[i]);
+#endif
+                    bool empty=workers[nextw]->get_in_buffer()->empty();
+                    if(workers[nextw]->put_n(tasks, n)) {
+                        FFTRACE(taskcnt+=n);
+                        if (empty) put_done(nextw);
+                        return true;
+                    } 
+                    ++cnt;
+                    if (cnt == nattempts()) break; 
+                } while(1);
+
+                if (++r >= retry) return false;
+                
+                struct timespec tv;
+                timedwait_timeout(tv);                
+                pthread_mutex_lock(prod_m);
+                ff_cond_timedwait(prod_c, prod_m, &tv);
+                pthread_mutex_unlock(prod_m);
+            } while(1);
+            return true;
+        } // blocking 
+        do {
+            cnt=0;
+            do {
+                nextw = selectworker();
+                if (nextw<0) return false;
+#if defined(LB_CALLBACK)
+                for(size_t i=0;i<n;++i) tasks[i] = callback(nextw, tasks[i]);
+#endif
+                if(workers[nextw]->put_n(tasks, n)) {
+                    FFTRACE(taskcnt+=n);
+                    return true;
+                }
+                ++cnt;
+                if (cnt>=retry) { nextw=-1; return false; }
+                if (cnt == nattempts()) break; 
+            } while(1);
+            losetime_out(ticks);
+        } while(1);
+        return false;
+    }
+
     /**
      * \brief Collects tasks
      *
@@ -354,13 +464,58 @@ protected:
                 struct timespec tv;
                 timedwait_timeout(tv);
                 pthread_mutex_lock(cons_m);
-                pthread_cond_timedwait(cons_c, cons_m, &tv);
+                ff_cond_timedwait(cons_c, cons_m, &tv);
                 pthread_mutex_unlock(cons_m);
             } else losetime_in();
         } while(1);
         return ite;
     }
 
+    /**
+     * \brief Changes the number of active workers of an elastic farm
+     *
+     * Called by the Emitter before scheduling a task, once in a sampling
+     * period it asks the controller how many workers should be active. The
+     * workers are removed starting from the last one: the worker is frozen
+     * and receives FF_GO_OUT after the tasks already in its channel, so no
+     * task is lost. A worker is removed only once the thaw that added it has
+     * taken effect and it is added again only once it has stopped (see
+     * ff_elastic::thawed), otherwise it is retried at the next period.
+     */
+    inline void elastic_step() {
+        if (!elastic->due() || running<=0) return;
+        double backlog=0.0;
+        for(ssize_t i=0;i<running;++i)
+            backlog += workers[i]->get_in_buffer()->length();
+        backlog /= running;
+        const ssize_t n = (ssize_t)elastic->decide(backlog);
+        elastic_resize(n);
+    }
+    inline void elastic_resize(ssize_t n) {
+        while(running > n && elastic->awake(running-1)) {
+            --running;
+            workers[running]->freeze();
+            ff_loadbalancer::ff_send_out_to(FF_GO_OUT, (int)running);
+        }
+        while(running < n && elastic->asleep(running)) {
+            elastic->thawed(running);
+            workers[running]->thaw(isfrozen());
+            ++running;
+        }
+        if (nextw >= running) nextw = -1;
+        elastic->resized(running);
+    }
+    // before the EOS, all the workers removed by the controller are added again
+    inline void elastic_restore() {
+        for(ssize_t i=running;i<elastic_nw;++i) {
+            workers[i]->wait_freezing();
+            elastic->thawed(i);
+            workers[i]->thaw(isfrozen());
+        }
+        running = elastic_nw;
+        elastic->resized(running, false);
+    }
+
     /**
      * \brief Pop a task from buffer
      *
@@ -378,7 +533,7 @@ protected:
                     struct timespec tv;
                     timedwait_timeout(tv);
                     pthread_mutex_lock(cons_m);
-                    pthread_cond_timedwait(cons_c, cons_m, &tv);
+                    ff_cond_timedwait(cons_c, cons_m, &tv);
                     pthread_mutex_unlock(cons_m);
                 } // while
             } else  {                
@@ -387,7 +542,7 @@ protected:
                         struct timespec tv;
                         timedwait_timeout(tv);
                         pthread_mutex_lock(cons_m);
-                        pthread_cond_timedwait(cons_c, cons_m, &tv);
+                        ff_cond_timedwait(cons_c, cons_m, &tv);
                         pthread_mutex_unlock(cons_m);
                     } //while 
                 } else {
@@ -410,6 +565,53 @@ protected:
         return true;
     }
     
+    /*
+     * Keyed scheduling (see set_scheduling_bykey): the task is sent to the 
+     * worker selected by the key router, waiting if its channel is full.
+     * Control tags have no key: the EOS is broadcast to all the workers 
+     * (only once, see push_eos), the other tags are scheduled as in the 
+     * non-keyed farm.
+     */
+    inline bool schedule_task_bykey(void * task, unsigned long retry, unsigned long ticks) {
+        if (task >= FF_TAG_MIN) {
+            if ((task == FF_EOS) || (task == FF_EOSW) || (task == FF_EOS_NOFREEZE)) {
+                if (!eos_broadcast) broadcast_task(task);
+                eos_broadcast = true;
+                return true;
+            }
+            return schedule_task_next(task, retry, ticks);
+        }
+        nextw = keyrouter->route(task, running);
+#if defined(LB_CALLBACK)
+        task = callback(nextw, task);
+#endif
+        if (blocking_out) {
+            unsigned long r=0;
+            do {
+                bool empty=workers[nextw]->get_in_buffer()->empty();
+                if (workers[nextw]->put(task)) {
+                    FFTRACE(++taskcnt);
+                    if (empty) put_done(nextw);
+                    return true;
+                }
+                if (++r >= retry) return false;
+                struct timespec tv;
+                timedwait_timeout(tv);
+                pthread_mutex_lock(prod_m);
+                ff_cond_timedwait(prod_c, prod_m, &tv);
+                pthread_mutex_unlock(prod_m);
+            } while(1);
+        }
+        for(unsigned long i=0;i<retry;++i) {
+            if (workers[nextw]->put(task)) {
+                FFTRACE(++taskcnt);
+                return true;
+            }
+            losetime_out(ticks);
+        }
+        return false;
+    }
+
     /**
      *
      * \brief Task scheduler
@@ -432,6 +634,22 @@ protected:
         return r;
     }
 
+    /**
+     * \brief Batch task scheduler
+     *
+     * Static version of \p schedule_task_batch, used by \p ff_send_out_batch.
+     */
+    static inline bool ff_send_out_batch_emitter(void ** tasks, size_t n, int id,
+                                                 unsigned long retry,
+                                                 unsigned long ticks, void *obj) {
+        (void)id;
+        bool r= ((ff_loadbalancer *)obj)->schedule_task_batch(tasks, n, retry, ticks);
+#if defined(FF_TASK_CALLBACK)
+        if (r) ((ff_loadbalancer *)obj)->callbackOut(obj);
+#endif
+        return r;
+    }
+
     /**
      *
      * \brief It gathers all tasks from input channels.
@@ -487,12 +705,17 @@ public:
         channelid(-2),input_channelid(-1),
         filter(NULL),workers(max_num_workers),
         buffer(NULL),skip1pop(false),master_worker(false),parallel_workers(false),
-        multi_input(MAX_NUM_THREADS), inputNodesFeedback(MAX_NUM_THREADS), multi_input_start((size_t)-1) {
+        multi_input(MAX_NUM_THREADS), inputNodesFeedback(MAX_NUM_THREADS), multi_input_start((size_t)-1),
+        bcast_retry(16), bcast_wake(16), ag_workers(16), ag_retry(16) {
         time_setzero(tstart);time_setzero(tstop);
         time_setzero(wtstart);time_setzero(wtstop);
         wttime=0;
 
         blocking_in = blocking_out = FF_RUNTIME_MODE;
+#if defined(SPINPARK_MODE)
+        backoff_in  = new ff_backoff_park;
+        backoff_out = new ff_backoff_park;
+#endif
 
         FFTRACE(taskcnt=0;lostpushticks=0;pushwait=0;lostpopticks=0;popwait=0;ticksmin=(ticks)-1;ticksmax=0;tickstot=0);
     }
@@ -509,6 +732,10 @@ public:
         buffer         = lbin.buffer;
         blocking_in    = lbin.blocking_in;
         blocking_out   = lbin.blocking_out;
+        std::swap(backoff_in,  lbin.backoff_in);
+        std::swap(backoff_out, lbin.backoff_out);
+        std::swap(keyrouter,   lbin.keyrouter);
+        std::swap(elastic,     lbin.elastic);
         skip1pop       = lbin.skip1pop;
         filter         = lbin.filter;
         workers        = lbin.workers;
@@ -528,6 +755,10 @@ public:
      *  It deallocates dynamic memory spaces previoulsy allocated for workers.
      */
     virtual ~ff_loadbalancer() {
+        if (backoff_in)  delete backoff_in;
+        if (backoff_out) delete backoff_out;
+        if (keyrouter)   delete keyrouter;
+        if (elastic)     delete elastic;
         if (cons_m) {
             pthread_mutex_destroy(cons_m);
             free(cons_m);
@@ -680,6 +911,61 @@ public:
         blocking_in = blocking_out = blk;
     }
 
+    // see ff_node::set_backoff
+    void set_backoff(const ff_backoff &policy) {
+        set_backoff_in(policy);
+        set_backoff_out(policy);
+    }
+    void set_backoff_in(const ff_backoff &policy) {
+        if (backoff_in) delete backoff_in;
+        backoff_in = policy.clone();
+    }
+    void set_backoff_out(const ff_backoff &policy) {
+        if (backoff_out) delete backoff_out;
+        backoff_out = policy.clone();
+    }
+    const ff_backoff* get_backoff_in()  const { return backoff_in; }
+    const ff_backoff* get_backoff_out() const { return backoff_out; }
+
+    /**
+     * \brief Sets the keyed scheduling
+     *
+     * Each task is sent to the worker selected by (a copy of) \p router
+     * on the basis of the key of the task (see ff_keyrouter). The policy
+     * is applied by \p schedule_task, \p selectworker is not used.
+     */
+    void set_scheduling_bykey(const ff_keyrouter &router) {
+        if (keyrouter) delete keyrouter;
+        keyrouter = new ff_keyrouter(router);
+    }
+    const ff_keyrouter* get_keyrouter() const { return keyrouter; }
+
+    /**
+     * \brief Sets the controller of the number of active workers
+     *
+     * A copy of \p e is used, see ff_farm::set_elastic.
+     */
+    void set_elastic(const ff_elastic &e) {
+        if (elastic) delete elastic;
+        elastic = new ff_elastic(e);
+    }
+    // it allocates the statistics of the workers, called before they are started
+    void init_elastic() {
+        elastic->init(workers.size());
+        for(size_t i=0;i<workers.size();++i)
+            workers[i]->busystat = elastic->stat(i);
+    }
+    const ff_elastic* get_elastic() const { return elastic; }
+
+    // tracing state of the Emitter (see ff_latency_tracer), by default the
+    // one of the filter (e.g. the multi-output node using this load-balancer)
+    void set_latnode(ff_latnode *l) { latnode = l; }
+    inline ff_latnode* get_latnode() const {
+        return latnode ? latnode : (filter ? filter->latnode : nullptr);
+    }
+
+    std::string timeline_name() const { return "emitter " + std::to_string(tid); }
+
     void no_mapping() {
         default_mapping = false;
     }
@@ -735,6 +1021,7 @@ public:
     virtual inline bool ff_send_out_to(void *task, int id,  
                                unsigned long retry=((unsigned long)-1),
                                unsigned long ticks=(TICKS2WAIT)) {        
+        if (ff_latnode *lat = get_latnode()) if (task < FF_TAG_MIN) lat->out(task);
         if (blocking_out) {
             unsigned long r=0;
         _retry:
@@ -747,7 +1034,7 @@ public:
                 struct timespec tv;
                 timedwait_timeout(tv);
                 pthread_mutex_lock(prod_m);
-                pthread_cond_timedwait(prod_c, prod_m, &tv);
+                ff_cond_timedwait(prod_c, prod_m, &tv);
                 pthread_mutex_unlock(prod_m);     
                 goto _retry;
             }
@@ -775,27 +1062,35 @@ public:
      * It sends the same task to all workers.   
      */
     virtual inline void broadcast_task(void * task) {
-       std::vector<size_t> retry;
+       if (elastic && running<elastic_nw &&
+           (task==FF_EOS || task==FF_EOSW || task==FF_EOS_NOFREEZE))
+           elastic_restore();
+       // the task is pushed in all the channels first, then the workers
+       // waiting on an empty channel are notified. The vectors are
+       // preallocated in svc_init.
+       bcast_retry.resize(0);
        if (blocking_out) {
+           bcast_wake.resize(0);
            for(ssize_t i=0;i<running;++i) {
                bool empty=workers[i]->get_in_buffer()->empty();
                if(!workers[i]->put(task))
-                   retry.push_back(i);
-               else if (empty) put_done(i);
+                   bcast_retry.push_back(i);
+               else if (empty) bcast_wake.push_back(i);
            }
-           while(retry.size()) {
-               bool empty=workers[retry.back()]->get_in_buffer()->empty();
-               if(workers[retry.back()]->put(task)) {
-                   if (empty) put_done(retry.back());
-                   retry.pop_back();
+           for(size_t i=0;i<bcast_wake.size();++i) put_done((int)bcast_wake[i]);
+           while(bcast_retry.size()) {
+               bool empty=workers[bcast_retry.back()]->get_in_buffer()->empty();
+               if(workers[bcast_retry.back()]->put(task)) {
+                   if (empty) put_done((int)bcast_retry.back());
+                   bcast_retry.pop_back();
                } else {
                    struct timespec tv;
                    timedwait_timeout(tv);
                    pthread_mutex_lock(prod_m);
-                   pthread_cond_timedwait(prod_c, prod_m, &tv);
-                   pthread_mutex_unlock(prod_m); 
+                   ff_cond_timedwait(prod_c, prod_m, &tv);
+                   pthread_mutex_unlock(prod_m);
                }
-           }           
+           }
 #if defined(FF_TASK_CALLBACK)
            callbackOut(this);
 #endif
@@ -803,13 +1098,13 @@ public:
        }
        for(ssize_t i=0;i<running;++i) {
            if(!workers[i]->put(task))
-               retry.push_back(i);
+               bcast_retry.push_back(i);
        }
-       while(retry.size()) {
-           if(workers[retry.back()]->put(task))
-               retry.pop_back();
+       while(bcast_retry.size()) {
+           if(workers[bcast_retry.back()]->put(task))
+               bcast_retry.pop_back();
            else losetime_out();
-       }       
+       }
 #if defined(FF_TASK_CALLBACK)
        callbackOut(this);
 #endif
@@ -819,7 +1114,8 @@ public:
         V[input_channelid]=task;
         if (multi_input.size()==0) return -1;
         size_t _nw=0;
-        svector<ff_node*> _workers(MAX_NUM_THREADS);
+        svector<ff_node*> &_workers = ag_workers;  // preallocated in svc_init
+        _workers.resize(0);
         for(size_t i=0;i<multi_input.size(); ++i) {
             if (!offline[i]) {
                 ++_nw;
@@ -827,7 +1123,8 @@ public:
             }
             else _workers.push_back(nullptr);
         }
-        svector<size_t> retry(_nw);
+        svector<size_t> &retry = ag_retry;
+        retry.resize(0);
         for(size_t i=0;i<_workers.size();++i) {
             if(i!=(size_t)input_channelid) {
                 if (_workers[i]) {
@@ -845,7 +1142,7 @@ public:
                     struct timespec tv;
                     timedwait_timeout(tv);
                     pthread_mutex_lock(cons_m);
-                    pthread_cond_timedwait(cons_c, cons_m, &tv);
+                    ff_cond_timedwait(cons_c, cons_m, &tv);
                     pthread_mutex_unlock(cons_m);
                 } else losetime_in();
             }
@@ -906,6 +1203,9 @@ public:
             set_in_buffer(filter->get_in_buffer());
         }
 
+        ff_latnode *lat = get_latnode();
+        if (lat) lat->start(!inpresent && (multi_input.size()==0), false);
+
         gettimeofday(&wtstart,NULL);
         if (!master_worker && (multi_input.size()==0) && (inputNodesFeedback.size()==0)) {
 
@@ -927,6 +1227,7 @@ public:
                     if (task == FF_EOSW) continue;                     
                     if (task == FF_EOS) {
                         if (--neos>0) continue;
+                        ff_timeline::instant(ff_timeline::EOS);
                         if (filter) filter->eosnotify();
                         push_eos(); 
                         break;
@@ -939,6 +1240,7 @@ public:
                         ret = task;
                         break;
                     } 
+                    if (lat) { lat->in(task); if (!filter) lat->done(); }
                 }
 
                 if (filter) {
@@ -947,7 +1249,10 @@ public:
 #if defined(FF_TASK_CALLBACK)
                     callbackIn(this);
 #endif
+                    const int64_t tl = ff_timeline::begin();
                     task = filter->svc(task);
+                    ff_timeline::end(ff_timeline::SVC, tl);
+                    if (lat) lat->done();
 
                     
 #if defined(TRACE_FASTFLOW)
@@ -1048,6 +1353,7 @@ public:
                         }
                     }
                     if (!--nw) {
+                        ff_timeline::instant(ff_timeline::EOS);
                         // this conditions means that if there is a loop
                         // we don't want to send an additional
                         // EOS since all EOSs have already been received
@@ -1059,13 +1365,17 @@ public:
                     }
                     //}
                 } else {
+                    if (lat) { lat->in(task); if (!filter) lat->done(); }
                     if (filter) {
                         FFTRACE(ticks t0 = getticks());
 
 #if defined(FF_TASK_CALLBACK)
                         callbackIn(this);
 #endif   
+                        const int64_t tl = ff_timeline::begin();
                         task = filter->svc(task);
+                        ff_timeline::end(ff_timeline::SVC, tl);
+                        if (lat) lat->done();
 
 #if defined(TRACE_FASTFLOW)
                         ticks diff=(getticks()-t0);
@@ -1125,10 +1435,37 @@ public:
         }
 #endif        
         gettimeofday(&tstart,NULL);
+        eos_broadcast = false;
+        ff_parking *pin  = backoff_in  ? backoff_in->parking()  : nullptr;
+        ff_parking *pout = backoff_out ? backoff_out->parking() : nullptr;
+        // the load-balancer is the producer of the workers' input channels
+        // and the consumer of its input channel(s)
+        for(size_t i=0;i<workers.size();++i) {
+            FFBUFFER* b = workers[i]->get_in_buffer();
+            if (b) b->set_producer_parking(pout);
+        }
+        for(size_t i=0;i<multi_input.size();++i) {
+            FFBUFFER* b = multi_input[i]->get_out_buffer();
+            if (b) b->set_consumer_parking(pin);
+        }
+        {
+            FFBUFFER* b = filter ? filter->get_in_buffer() : buffer;
+            if (b) b->set_consumer_parking(pin);
+            ff_placeOnMyNode(b);
+        }
+        bcast_retry.reserve(workers.size());
+        bcast_wake.reserve(workers.size());
+        ag_workers.reserve(multi_input.size());
+        ag_retry.reserve(multi_input.size());
         if (filter) {
             if (filter->svc_init() <0) return -1;
         }
-
+        if (elastic) {
+            elastic_nw = running;
+            // the workers have been started (or thawed) by the farm
+            for(ssize_t i=0;i<running;++i) elastic->thawed(i);
+            elastic_resize((ssize_t)elastic->start(running));
+        }
         return 0;
     }
 
@@ -1158,6 +1495,7 @@ public:
             // callback must not be set.
             if (!filter->isMultiOutput()) {
                 filter->registerCallback(ff_send_out_emitter, this);
+                filter->registerBatchCallback(ff_send_out_batch_emitter);
             }
             // setting the thread for the filter
             filter->setThread(this);
@@ -1455,6 +1793,12 @@ public:
             << "  svc ticks     : " << tickstot  << " (min= " << (filter?ticksmin:0) << " max= " << ticksmax << ")\n"
             << "  n. push lost  : " << pushwait  << " (ticks=" << lostpushticks << ")" << "\n"
             << "  n. pop lost   : " << popwait   << " (ticks=" << lostpopticks  << ")" << "\n";
+        if (backoff_in)
+            out << "  backoff in    : " << backoff_in->name() << " waits= " << backoff_in->get_nwaits()
+                << " (ticks=" << backoff_in->get_waitticks() << ")\n";
+        if (backoff_out)
+            out << "  backoff out   : " << backoff_out->name() << " waits= " << backoff_out->get_nwaits()
+                << " (ticks=" << backoff_out->get_waitticks() << ")\n";
     }
 
     virtual double getworktime() const { return wttime; }
@@ -1485,6 +1829,11 @@ private:
     svector<ff_node*>  inputNodesFeedback;  /// nodes coming node feedback channels
     size_t             multi_input_start;   /// position in the availworkers array
     ssize_t            managerpos=-1;       /// position in the availworkers array of the manager
+    // preallocated state of broadcast_task and all_gather
+    svector<size_t>    bcast_retry;
+    svector<size_t>    bcast_wake;
+    svector<ff_node*>  ag_workers;
+    svector<size_t>    ag_retry;
 
     struct timeval tstart;
     struct timeval tstop;
@@ -1504,6 +1853,13 @@ private:
 
     bool               blocking_in;
     bool               blocking_out;
+    ff_backoff        *backoff_in  = nullptr;
+    ff_backoff        *backoff_out = nullptr;
+    ff_keyrouter      *keyrouter   = nullptr;
+    bool               eos_broadcast = false;  /// keyed EOS already sent to the workers
+    ff_elastic        *elastic     = nullptr;
+    ssize_t            elastic_nw  = 0;     /// workers started, see elastic_restore
+    ff_latnode        *latnode     = nullptr;  /// see set_latnode
 
 #ifdef DFF_ENABLED
     bool               _skipallpop = false;    
@@ -135,6 +135,12 @@ public:
                                     const Function& f, const long nw=FF_AUTO) {
         pfr.parallel_for_static(first,last,step,grain,f,nw);
     }
+    template <typename Function>
+    inline void parallel_for_hot(long first, long last, long step, long grain, 
+                                 const Function& f, const long nw=FF_AUTO) {
+        pfr.parallel_for_hot(first,last,step,grain,f,nw);
+    }
+    inline int stopHotLoops() { return pfr.stopHotLoops(); }
     template <typename Function, typename FReduction>
     inline void parallel_reduce(reduceT& var, const reduceT& identity, 
                                 long first, long last, 
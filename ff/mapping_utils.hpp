@@ -56,6 +56,8 @@
  #include <asm/unistd.h>
  #include <stdio.h>
  #include <unistd.h>
+ #include <dirent.h>
+ #include <string.h>
 
 static inline int ff_gettid() { return syscall(__NR_gettid);}
 
@@ -453,6 +455,50 @@ return -1;
 // NOTE: this function will be discarded, please use ff_getMyCore() instead
 static inline ssize_t ff_getMyCpu() { return ff_getMyCore(); }
 
+/**
+ *  \brief Returns the NUMA node of the given core
+ *
+ *  It works on Linux OS only (it reads the sysfs topology).
+ *
+ *  \return the ID of the NUMA node of the core \p cpu, -1 if it is not found.
+ */
+static inline ssize_t ff_numaNodeOfCpu(ssize_t cpu) {
+#if defined(__linux__)
+    if (cpu<0) return -1;
+    char path[64];
+    snprintf(path, sizeof(path), "/sys/devices/system/cpu/cpu%ld", (long)cpu);
+    DIR *d = opendir(path);
+    if (!d) return -1;
+    ssize_t node=-1;
+    struct dirent *e;
+    while((e=readdir(d)) != NULL) {
+        long n;
+        if (strncmp(e->d_name, "node", 4)==0 && sscanf(e->d_name+4, "%ld", &n)==1) {
+            node = n;
+            break;
+        }
+    }
+    closedir(d);
+    return node;
+#else
+    (void)cpu;
+    return -1;
+#endif
+}
+
+/**
+ *  \brief Returns the NUMA node where the calling thread is running
+ *
+ *  \return the ID of the NUMA node, -1 if it is not found.
+ */
+static inline ssize_t ff_getMyNumaNode() {
+#if defined(__linux__)
+    return ff_numaNodeOfCpu(sched_getcpu());
+#else
+    return -1;
+#endif
+}
+
 /** 
  *  \brief Maps the calling thread to the given CPU.
  *
@@ -544,6 +590,20 @@ static inline size_t cache_line_size() {
     return line_size;
 }
 
+/**
+ *  \brief Gets the size (in bytes) of the data cache of level \p level (1, 2 or 3)
+ *
+ *  \return the size of the cache, 0 on failure
+ */
+static inline size_t cache_size(const int level) {
+    const char *names[] = { "hw.l1dcachesize", "hw.l2cachesize", "hw.l3cachesize" };
+    if (level<1 || level>3) return 0;
+    u_int64_t size = 0;
+    size_t sizeof_size = sizeof(size);
+    if (sysctlbyname(names[level-1], &size, &sizeof_size, NULL, 0) !=0) return 0;
+    return size;
+}
+
 #elif defined(_WIN32)
 //#include <stdlib.h>
 //#include <windows.h>
@@ -576,6 +636,32 @@ static inline size_t cache_line_size() {
     return line_size;
 }
 
+/**
+ *  \brief Gets the size (in bytes) of the data cache of level \p level (1, 2 or 3)
+ *
+ *  \return the size of the cache, 0 on failure
+ */
+static inline size_t cache_size(const int level) {
+    size_t size = 0;
+    DWORD buffer_size = 0;
+    SYSTEM_LOGICAL_PROCESSOR_INFORMATION * buffer = 0;
+
+    GetLogicalProcessorInformation(0, &buffer_size);
+    buffer = (SYSTEM_LOGICAL_PROCESSOR_INFORMATION *)malloc(buffer_size);
+    GetLogicalProcessorInformation(&buffer[0], &buffer_size);
+
+    for (DWORD i = 0; i != buffer_size / sizeof(SYSTEM_LOGICAL_PROCESSOR_INFORMATION); ++i) {
+        if (buffer[i].Relationship == RelationCache && buffer[i].Cache.Level == level &&
+            buffer[i].Cache.Type != CacheInstruction) {
+            size = buffer[i].Cache.Size;
+            break;
+        }
+    }
+
+    free(buffer);
+    return size;
+}
+
 #elif defined(__linux__)
 //#include <stdio.h>
 
@@ -605,6 +691,41 @@ static inline size_t cache_line_size() {
     return i;
 }
 
+/**
+ *  \brief Gets the size (in bytes) of the data cache of level \p level (1, 2 or 3)
+ *
+ *  \return the size of the cache, 0 on failure
+ */
+static inline size_t cache_size(const int level) {
+    char path[128], type[32];
+    for(int idx=0; ; ++idx) {
+        int l = 0;
+        snprintf(path, sizeof(path), "/sys/devices/system/cpu/cpu0/cache/index%d/level", idx);
+        FILE *p = fopen(path, "r");
+        if (!p) return 0;
+        const int n = fscanf(p, "%d", &l);
+        fclose(p);
+        if (n != 1 || l != level) continue;
+
+        snprintf(path, sizeof(path), "/sys/devices/system/cpu/cpu0/cache/index%d/type", idx);
+        if (!(p = fopen(path, "r"))) continue;
+        const int t = fscanf(p, "%31s", type);
+        fclose(p);
+        if (t != 1 || strcmp(type, "Instruction") == 0) continue;
+
+        snprintf(path, sizeof(path), "/sys/devices/system/cpu/cpu0/cache/index%d/size", idx);
+        if (!(p = fopen(path, "r"))) continue;
+        size_t size = 0;
+        char unit = 0;
+        const int s = fscanf(p, "%zu%c", &size, &unit);
+        fclose(p);
+        if (s < 1) continue;
+        if (unit == 'K') size *= 1024;
+        else if (unit == 'M') size *= 1024*1024;
+        return size;
+    }
+}
+
 #else
 #error Unrecognized platform
 #endif
@@ -96,6 +96,10 @@ protected:
         assert(inputNodes.size() == 1);
         return inputNodes[0]->put(ptr);
     }
+    inline bool  put_n(void * const ptr[], size_t n) { 
+        assert(inputNodes.size() == 1);
+        return inputNodes[0]->put_n(ptr, n);
+    }
     inline FFBUFFER *get_in_buffer() const {
         if (inputNodes.size() == 0) return nullptr;
         assert(inputNodes.size() == 1);
@@ -126,6 +130,10 @@ protected:
         blocking_in = blocking_out = blk;
         gt->blocking_mode(blk);
     }
+    void set_backoff(const ff_backoff &policy) {
+        ff_node::set_backoff(policy);
+        gt->set_backoff(policy);
+    }
     template<typename T>
     int all_gather(T* in, T** V) { return gt->all_gather(in,(void**)V); }
 
@@ -225,6 +233,7 @@ public:
         }
         if (n.gt->get_filter())
             gt->set_filter(n.gt->get_filter());
+        if (n.gt->ready_notification()) gt->set_ready_notification();
         myowngt=true;
 
         inputNodes=n.inputNodes;
@@ -262,6 +271,14 @@ public:
         myowngt = cleanup;
     }
 
+    /**
+     * \brief The input channels notify the node when they become non-empty
+     *
+     * See ff_gatherer::set_ready_notification. It must be called before 
+     * running the node.
+     */
+    void set_ready_notification(bool on=true) { gt->set_ready_notification(on); }
+
     
     inline void set_barrier(BARRIER_T * const barrier) {
         gt->set_barrier(barrier);
@@ -509,6 +526,10 @@ protected:
         blocking_in = blocking_out = blk;
         lb->blocking_mode(blk);
     }
+    void set_backoff(const ff_backoff &policy) {
+        ff_node::set_backoff(policy);
+        lb->set_backoff(policy);
+    }
     
     // consumer
     virtual inline bool init_input_blocking(pthread_mutex_t   *&m,
@@ -590,6 +611,10 @@ public:
         else ondemand=inbufferentries;
     }
     int ondemand_buffer() const { return ondemand; } 
+    // see ff_farm::set_scheduling_bykey
+    void set_scheduling_bykey(const ff_keyrouter &router) {
+        lb->set_scheduling_bykey(router);
+    }
 
     
     int set_filter(ff_node *filter) {
@@ -709,6 +734,13 @@ public:
         return lb->schedule_task(task,retry,ticks);
     }
 
+    inline bool ff_send_out_batch(void ** tasks, size_t n, int id=-1,
+                                  unsigned long retry=((unsigned long)-1),
+                                  unsigned long ticks=(ff_node::TICKS2WAIT)) {
+        if (callback) return ff_node::ff_send_out_batch(tasks,n,id,retry,ticks);
+        return lb->schedule_task_batch(tasks,n,retry,ticks);
+    }
+
     // TODO: broadcast_task should have callback as in ff_send_out
     //
     inline void broadcast_task(void *task) {
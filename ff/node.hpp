@@ -42,11 +42,22 @@
 #include <ff/utils.hpp>
 #include <ff/buffer.hpp>
 #include <ff/ubuffer.hpp>
+#include <ff/backoff.hpp>
+#include <ff/wsdeque.hpp>
+#include <ff/keyrouter.hpp>
+#include <ff/elastic.hpp>
+#include <ff/latency.hpp>
+#include <ff/timeline.hpp>
+#include <ff/threadpool.hpp>
+#include <ff/executor.hpp>
 #include <ff/mapper.hpp>
 #include <ff/config.hpp>
 #include <ff/svector.hpp>
 #include <ff/barrier.hpp>
 #include <atomic>
+#include <new>
+#include <type_traits>
+#include <thread>
 
 #ifdef DFF_ENABLED
 
@@ -153,6 +164,15 @@ static inline int init_thread_affinity(pthread_attr_t*attr, int cpuId) {
     }
     return id;    
 }
+
+/*
+ * \brief Core of a thread taken from the thread pool (see ff_threadpool)
+ *
+ * The same choice of \p init_thread_affinity, the thread is pinned by the pool.
+ */
+static inline int pooled_thread_affinity(int cpuId) {
+    return (cpuId<0) ? threadMapper::instance()->getCoreId() : cpuId;
+}
 #elif !defined(HAVE_PTHREAD_SETAFFINITY_NP) && !defined(NO_DEFAULT_MAPPING)
 
 /*
@@ -168,6 +188,10 @@ static inline int init_thread_affinity(pthread_attr_t*,int) {
     threadMapper::instance();
     return -1;
 }
+static inline int pooled_thread_affinity(int) {
+    threadMapper::instance();
+    return -1;
+}
 #else
 /*
  * \brief Initializes thread affinity
@@ -181,6 +205,7 @@ static inline int init_thread_affinity(pthread_attr_t*,int) {
     // Do nothing
     return -1;
 }
+static inline int pooled_thread_affinity(int) { return -1; }
 #endif /* HAVE_PTHREAD_SETAFFINITY_NP */
 
 
@@ -190,6 +215,7 @@ static inline int init_thread_affinity(pthread_attr_t*,int) {
  *
  */
 static void * proxy_thread_routine(void * arg);
+static void * proxy_pooled_routine(void * arg);
 
 /*!
  *  \class ff_thread
@@ -205,6 +231,7 @@ static void * proxy_thread_routine(void * arg);
 class ff_thread {
 
     friend void * proxy_thread_routine(void *arg);
+    friend void * proxy_pooled_routine(void *arg);
 
 protected:
     ff_thread(BARRIER_T * barrier=NULL, bool default_mapping=true):
@@ -236,6 +263,7 @@ protected:
     
     void thread_routine() {
         threadid = ff_getThreadID();
+        ff_timeline::set_thread_name(timeline_name());
 #if defined(FF_INITIAL_BARRIER)
         if (barrier) {
             barrier->doBarrier(tid);
@@ -267,11 +295,15 @@ protected:
             pthread_mutex_lock(&mutex);
             if (ret != FF_EOS_NOFREEZE && !stp) {
                 if ((freezing == 0) && (ret == FF_EOS)) stp = true;
+                const int64_t t0 = (freezing==1) ? ff_timeline::begin() : 0;
                 while(freezing==1) { // NOTE: freezing can change to 2
                     frozen=true; 
                     pthread_cond_signal(&cond_frozen);
-                    pthread_cond_wait(&cond,&mutex);
+                    // a fiber leaves its executor until it is thawed
+                    if (ff_executor::current()) ff_executor::park(&mutex);
+                    else pthread_cond_wait(&cond,&mutex);
                 }
+                ff_timeline::end(ff_timeline::FROZEN, t0);
             }
             
             //thawed=true;
@@ -316,6 +348,9 @@ protected:
     virtual void callbackIn(void  * =NULL) { }
     virtual void callbackOut(void * =NULL) { }
 #endif
+
+    // name of the thread's track in the timeline (see ff_timeline)
+    virtual std::string timeline_name() const { return "thread " + std::to_string(tid); }
     
 public:
  
@@ -334,6 +369,9 @@ public:
     virtual int spawn(int cpuId=-1) {
         if (spawned) return -1;
 
+        if (ff_executor::instance()->enabled()) return spawn_fiber();
+        if (ff_threadpool::instance()->enabled()) return spawn_pooled(cpuId);
+
         if ((attr = (pthread_attr_t*)malloc(sizeof(pthread_attr_t))) == NULL) {
             error("spawn: pthread can not be created, malloc failed\n");
             return -1;
@@ -363,7 +401,37 @@ public:
         spawned = true;
         return CPUId;
     }
-     
+
+    // spawn using one of the threads of the pool (see ff_threadpool)
+    int spawn_pooled(int cpuId) {
+        const int cpu = default_mapping ? pooled_thread_affinity(cpuId) : -1;
+        if (barrier)
+            tid= internal_threadCounter.fetch_add(1);
+        else
+            tid= internal_threadCounter_noBarrier.fetch_add(1);
+        if ((pooled = ff_threadpool::instance()->run(proxy_pooled_routine, this, cpu)) == nullptr) {
+            barrier?--internal_threadCounter:--internal_threadCounter_noBarrier;
+            return -2;
+        }
+        th_handle = pooled->get_handle();
+        spawned = true;
+        return -1;
+    }
+
+    // spawn as a fiber of the executor (see ff_executor)
+    int spawn_fiber() {
+        if (barrier)
+            tid= internal_threadCounter.fetch_add(1);
+        else
+            tid= internal_threadCounter_noBarrier.fetch_add(1);
+        if ((fiber = ff_executor::instance()->run(proxy_pooled_routine, this)) == nullptr) {
+            barrier?--internal_threadCounter:--internal_threadCounter_noBarrier;
+            return -2;
+        }
+        spawned = true;
+        return -1;
+    }
+
     virtual int wait() {
         int r=0;
         stp=true;
@@ -372,7 +440,14 @@ public:
             thaw();
         }
         if (spawned) {
-            pthread_join(th_handle, NULL);
+            if (fiber) {
+                ff_executor::instance()->join(fiber);
+                fiber = nullptr;
+            } else if (pooled) {
+                ff_threadpool::instance()->join(pooled);
+                pooled = nullptr;
+            } else 
+                pthread_join(th_handle, NULL);
             barrier ? --internal_threadCounter: --internal_threadCounter_noBarrier;
         }
         if (attr) {
@@ -389,7 +464,7 @@ public:
 
     virtual int wait_freezing() {
         pthread_mutex_lock(&mutex);
-        while(!frozen) pthread_cond_wait(&cond_frozen,&mutex);
+        while(!frozen) ff_cond_wait(&cond_frozen,&mutex);
         pthread_mutex_unlock(&mutex);
         return (init_error?-1:0);
     }
@@ -415,6 +490,7 @@ public:
         //assert(thawed==false);
         frozen=false; 
         pthread_cond_signal(&cond);
+        if (fiber) ff_executor::instance()->unpark(fiber);
         pthread_mutex_unlock(&mutex);
 
         //pthread_mutex_lock(&mutex);
@@ -426,6 +502,10 @@ public:
     virtual bool done()     const { return isdone || (frozen && !stp);}
 
     pthread_t get_handle() const { return th_handle;}
+    /// true if the thread has been taken from the thread pool
+    bool is_pooled() const { return pooled != nullptr; }
+    /// true if the thread is a fiber of the executor
+    bool is_fiber() const { return fiber != nullptr; }
 
     inline size_t getTid() const { return tid; }
     inline size_t getOSThreadId() const { return threadid; }
@@ -443,6 +523,8 @@ private:
     bool            init_error;
     pthread_t       th_handle;
     pthread_attr_t *attr;
+    ff_pooledthread*pooled = nullptr;
+    ff_fiber       *fiber  = nullptr;
     pthread_mutex_t mutex; 
     pthread_cond_t  cond;
     pthread_cond_t  cond_frozen;
@@ -456,9 +538,29 @@ static void * proxy_thread_routine(void * arg) {
     return NULL;
 }
 
+// the thread is given back to the pool when the routine returns
+static void * proxy_pooled_routine(void * arg) {
+    ff_thread & obj = *(ff_thread *)arg;
+    obj.thread_routine();
+    return NULL;
+}
+
+/*
+ * If the channel \p b has to be placed on the NUMA node of its consumer
+ * (FF_NUMA_CONSUMER, see ff_node::set_input_placement), it binds the channel
+ * to the NUMA node where the calling thread is running. It is called by the
+ * consumer thread when it starts.
+ */
+static inline void ff_placeOnMyNode(FFBUFFER *b) {
+    if (!b || b->get_numanode() != FF_NUMA_CONSUMER) return;
+    const ssize_t node = ff_getMyNumaNode();
+    if (node>=0) b->set_placement(node);
+}
+
 // forward declaration    
 class ff_loadbalancer;
 class ff_gatherer;
+class ff_pipeline_profiler;
 
 /*!
  *  \class ff_node
@@ -511,6 +613,7 @@ private:
     friend class ff_comb;
     friend struct internal_mo_transformer;
     friend struct internal_mi_transformer;
+    friend class ff_pipeline_profiler;
 
 #ifdef DFF_ENABLED
     friend class dGroups;
@@ -537,7 +640,23 @@ private:
 
     ff_thread       * thread;       /// A \p thWorker object, which extends the \p ff_thread class 
     bool (*callback)(void *, int, unsigned long,unsigned long, void *);
+    bool (*batch_callback)(void **, size_t, int, unsigned long,unsigned long, void *) = nullptr;
     void            * callback_arg;
+    void           ** inbatch = nullptr;   ///< local input batch (see set_input_batch)
+    size_t            inbatch_size = 0;
+    size_t            inbatch_idx  = 0;
+    size_t            inbatch_cnt  = 0;
+    size_t            in_lookahead = 1;    ///< see set_input_lookahead
+    long              in_numanode  = FF_NUMA_NONE;  ///< see set_input_placement
+    bool              in_hugepages = false;
+    long              out_numanode = FF_NUMA_NONE;  ///< see set_output_placement
+    bool              out_hugepages= false;
+    ff_wsgroup      * wsgroup  = nullptr;  ///< see ff_farm::set_scheduling_stealing
+    size_t            wsid     = 0;        ///< index of the node's deque in wsgroup
+    void            * wseos    = nullptr;  ///< EOS received while stealing
+    unsigned long     wsseed   = 0;
+    ff_busystat     * busystat = nullptr;  ///< see ff_farm::set_elastic
+    ff_latnode      * latnode  = nullptr;  ///< see ff_pipeline::set_latency_tracing
     BARRIER_T       * barrier;      /// A \p Barrier object
     struct timeval tstart;
     struct timeval tstop;
@@ -553,13 +672,26 @@ protected:
     // sets how many EOSs the node has to receive before terminating,
     // it also sets when eosnotify has to be called, by default at each input EOS    
     virtual void set_neos(ssize_t n) { neos = n; }
+
+    // latency tracing (see ff_latency_tracer), a composition shares the
+    // tracing state with the nodes it is made of
+    virtual void set_latnode(ff_latnode *l) { latnode = l; }
+    virtual void latency_attach(ff_latency_tracer *t, const std::string &name) {
+        set_latnode(t->node(name));
+    }
     
     virtual inline bool push(void * ptr) { return out->push(ptr); }
     virtual inline bool pop(void ** ptr) { 
         if (!in_active) return false; // it does not want to receive data
         return in->pop(ptr);
     }
+    virtual inline bool push_n(void * const ptr[], size_t n) { return out->multipush(ptr, (int)n); }
+    virtual inline size_t pop_n(void ** ptr, size_t max) {
+        if (!in_active) return 0;   // it does not want to receive data
+        return in->pop_n(ptr, max);
+    }
     virtual inline bool Push(void *ptr, unsigned long retry=((unsigned long)-1), unsigned long ticks=(TICKS2WAIT)) {
+        if (latnode && ptr < FF_TAG_MIN) latnode->out(ptr);
         if (blocking_out) {
         retry:
             bool empty=out->empty();
@@ -569,8 +701,9 @@ protected:
             } else { // FULL
                 struct timespec tv;
                 timedwait_timeout(tv);
+                ff_timeline_span span(ff_timeline::WAIT_OUT);
                 pthread_mutex_lock(prod_m);
-                pthread_cond_timedwait(prod_c,prod_m,&tv);
+                ff_cond_timedwait(prod_c,prod_m,&tv);
                 pthread_mutex_unlock(prod_m);
                 goto retry;
             }
@@ -591,8 +724,9 @@ protected:
             if (!r) { // EMPTY                
                 struct timespec tv;
                 timedwait_timeout(tv);
+                ff_timeline_span span(ff_timeline::WAIT_IN);
                 pthread_mutex_lock(cons_m);
-                pthread_cond_timedwait(cons_c, cons_m,&tv);
+                ff_cond_timedwait(cons_c, cons_m,&tv);
                 pthread_mutex_unlock(cons_m);
                 goto retry;
             }
@@ -606,6 +740,125 @@ protected:
         return true;
     }
 
+    /* 
+     * Batched version of Push: the n elements are published in the output 
+     * channel at once (all or nothing).
+     * A batch that can never fit into the bounded output channel is pushed
+     * in slices, the retries apply to the first slice only.
+     */
+    virtual inline bool Push_n(void * const ptr[], size_t n, unsigned long retry=((unsigned long)-1), unsigned long ticks=(TICKS2WAIT)) {
+        const size_t maxb = out->maxbatch();
+        if (n > maxb) {
+            if (!Push_n(ptr, maxb, retry, ticks)) return false;
+            for(size_t i=maxb;i<n;i+=maxb)
+                Push_n(ptr+i, (n-i < maxb) ? n-i : maxb);
+            return true;
+        }
+        if (blocking_out) {
+        retry:
+            bool empty=out->empty();
+            bool r = push_n(ptr, n);
+            if (r) { // OK
+                if (empty) pthread_cond_signal(p_cons_c);
+            } else { // FULL
+                struct timespec tv;
+                timedwait_timeout(tv);
+                pthread_mutex_lock(prod_m);
+                ff_cond_timedwait(prod_c,prod_m,&tv);
+                pthread_mutex_unlock(prod_m);
+                goto retry;
+            }
+            return true;
+        }
+        for(unsigned long i=0;i<retry;++i) {
+            if (push_n(ptr, n)) return true;
+            losetime_out(ticks);
+        }     
+        return false;
+    }
+
+    /* 
+     * Batched version of Pop: it returns the number of elements (at most max)
+     * popped from the input channel, 0 if the input is not active.
+     */
+    virtual inline size_t Pop_n(void **ptr, size_t max, unsigned long retry=((unsigned long)-1), unsigned long ticks=(TICKS2WAIT)) {
+        if (blocking_in) {
+            if (!in_active) return 0;
+        retry:
+            size_t r = in->pop_n(ptr, max);
+            if (!r) { // EMPTY                
+                struct timespec tv;
+                timedwait_timeout(tv);
+                pthread_mutex_lock(cons_m);
+                ff_cond_timedwait(cons_c, cons_m,&tv);
+                pthread_mutex_unlock(cons_m);
+                goto retry;
+            }
+            return r;
+        }
+        for(unsigned long i=0;i<retry;++i) {
+            if (!in_active) return 0;
+            size_t r = pop_n(ptr, max);
+            if (r) return r;
+            losetime_in(ticks);
+        } 
+        return 0;
+    }
+
+    /*
+     * Used by the node's thread when input batching is enabled (see set_input_batch).
+     * Tasks are taken from the input channel in batches and then served one by one 
+     * from the local batch.
+     */
+    inline bool Pop_batch(void **ptr) {
+        if (!in_active) { *ptr=NULL; return false; }
+        if (inbatch_idx == inbatch_cnt) {
+            inbatch_idx = 0;
+            inbatch_cnt = Pop_n(inbatch, inbatch_size);
+            if (inbatch_cnt == 0) { *ptr=NULL; return false; }
+        }
+        *ptr = inbatch[inbatch_idx++];
+        return true;
+    }
+
+
+    /*
+     * Used by the node's thread when the work-stealing scheduling is enabled
+     * (see ff_farm::set_scheduling_stealing). The tasks arrived in the input
+     * channel are moved into the node's deque, then the node takes the last
+     * task from its deque or, if it is empty, steals a task from the deque of
+     * another node of the group. The EOS is delivered when the node's deque
+     * is empty and no task can be stolen, the other tags (e.g. GO_OUT) are
+     * delivered as soon as they arrive.
+     */
+    inline bool Pop_steal(void **ptr) {
+        if (!in_active) { *ptr=NULL; return false; }
+        ff_wsdeque *dq = wsgroup->get(wsid);
+        do {
+            if (!wseos) {
+                void *task;
+                while(!dq->full() && pop(&task)) {
+                    if ((task == FF_EOS) || (task == FF_EOSW) ||
+                        (task == FF_EOS_NOFREEZE)) { wseos = task; break; }
+                    if (task >= FF_TAG_MIN) { *ptr = task; return true; }
+                    dq->push(task);
+                }
+            }
+            if (dq->pop(ptr)) return true;
+            if (wsgroup->steal(wsid, ptr, wsseed, wseos!=nullptr)) return true;
+            if (wseos) { *ptr = wseos; wseos = nullptr; return true; }
+            if (blocking_in) {
+                // a task may become available in other deques
+                struct timespec tv;
+                timedwait_timeout(tv);
+                pthread_mutex_lock(cons_m);
+                if (in->empty()) ff_cond_timedwait(cons_c, cons_m,&tv);
+                pthread_mutex_unlock(cons_m);
+            } else losetime_in(TICKS2WAIT);
+        } while(in_active);
+        *ptr=NULL;
+        return false;
+    }
 
     // consumer
     virtual inline bool init_input_blocking(pthread_mutex_t   *&m,
@@ -706,7 +959,10 @@ protected:
         in = new FFBUFFER(nentries,fixedsize);
         if (!in) return -1;
         myinbuffer=true;
+        if (in_numanode!=FF_NUMA_NONE || in_hugepages) 
+            in->set_placement(in_numanode, in_hugepages);
         if (!in->init()) return -1;
+        if (in_lookahead>1) in->set_lookahead(in_lookahead);
         return 0;
     }
 
@@ -733,6 +989,8 @@ protected:
         out = new FFBUFFER(nentries,fixedsize); 
         if (!out) return -1;
         myoutbuffer=true;
+        if (out_numanode!=FF_NUMA_NONE || out_hugepages) 
+            out->set_placement(out_numanode, out_hugepages);
         if (!out->init()) return -1;
         return 0;
     }
@@ -787,6 +1045,40 @@ protected:
 
     virtual void set_scheduling_ondemand(const int /*inbufferentries*/=1) {} 
     virtual int ondemand_buffer() const { return 0;} 
+    virtual void set_scheduling_bykey(const ff_keyrouter &) {}
+
+    /**
+     * \brief Sets the input batch size
+     *
+     * The node's thread pops up to \p n tasks at a time from the input 
+     * channel, so that a single update of the consumer index covers 
+     * the whole batch. The svc method is still called once per task.
+     * With \p n<=1 batching is disabled (default).
+     * It must be called before running the node.
+     */
+    virtual void set_input_batch(size_t n) {
+        if (inbatch) { free(inbatch); inbatch=nullptr; }
+        inbatch_size=inbatch_idx=inbatch_cnt=0;
+        if (n<=1) return;
+        inbatch = (void**)malloc(n*sizeof(void*));
+        assert(inbatch);
+        inbatch_size=n;
+    }
+    virtual size_t input_batch() const { return inbatch_size; }
+
+    /**
+     * \brief Sets the lookahead distance of the input channel
+     *
+     * The producer and the consumer of the input channel probe the channel
+     * \p n slots ahead and then run free on the preceding slots 
+     * (see \p SWSR_Ptr_Buffer::set_lookahead). With \p n<=1 the classic
+     * per-slot check is used (default).
+     * It must be called before running the node.
+     */
+    virtual void set_input_lookahead(size_t n) {
+        in_lookahead = n;
+        if (in) in->set_lookahead(n);
+    }
 
     
     /**
@@ -936,6 +1228,9 @@ public:
         if (in && myinbuffer) delete in;
         if (out && myoutbuffer) delete out;
         if (thread && my_own_thread) delete reinterpret_cast<thWorker*>(thread);
+        if (inbatch) free(inbatch);
+        if (backoff_in)  delete backoff_in;
+        if (backoff_out) delete backoff_out;
         if (cons_c && cons_m) {
             pthread_cond_destroy(cons_c);
             free(cons_c);
@@ -958,6 +1253,60 @@ public:
         }
     };
 
+    /**
+     * \brief Sets the backoff policy of the node
+     *
+     * The policy (see backoff.hpp) is used by the node's thread when the
+     * input channel is empty or the output channel is full. Each side gets
+     * its own copy of \p policy, which also records the cycles spent waiting
+     * on that channel (see \p get_backoff_in and \p get_backoff_out).
+     * Without a policy the node spins for TICKS2WAIT ticks (default), 
+     * if SPINPARK_MODE is defined the default policy is ff_backoff_park.
+     * It must be called before running the node.
+     */
+    virtual void set_backoff(const ff_backoff &policy) {
+        set_backoff_in(policy);
+        set_backoff_out(policy);
+    }
+    virtual void set_backoff_in(const ff_backoff &policy) {
+        if (backoff_in) delete backoff_in;
+        backoff_in = policy.clone();
+    }
+    virtual void set_backoff_out(const ff_backoff &policy) {
+        if (backoff_out) delete backoff_out;
+        backoff_out = policy.clone();
+    }
+    const ff_backoff* get_backoff_in()  const { return backoff_in; }
+    const ff_backoff* get_backoff_out() const { return backoff_out; }
+
+    /**
+     * \brief Sets where the memory of the input channel is allocated
+     *
+     * \p node is the NUMA node of the channel's slots, FF_NUMA_CONSUMER 
+     * (default) means the node where the node's thread runs, it is resolved
+     * when the thread starts (so it follows the thread mapping, see 
+     * \p setAffinity) and the pages already allocated are migrated there.
+     * FF_NUMA_NONE leaves the allocation to the OS (first-touch).
+     * If \p hugepages is true the slots are allocated on (transparent) huge
+     * pages. On non-Linux systems the call has no effect.
+     * It must be called before running the node.
+     */
+    virtual void set_input_placement(long node=FF_NUMA_CONSUMER, bool hugepages=false) {
+        in_numanode  = node;
+        in_hugepages = hugepages;
+    }
+    /**
+     * \brief Sets where the memory of the output channel is allocated
+     *
+     * As \p set_input_placement, FF_NUMA_CONSUMER is resolved by the thread 
+     * reading the channel. It has no effect if the output channel is the 
+     * input channel of another node.
+     */
+    virtual void set_output_placement(long node=FF_NUMA_CONSUMER, bool hugepages=false) {
+        out_numanode  = node;
+        out_hugepages = hugepages;
+    }
+
     /**
      * \brief The service callback (should be filled by user with parallel activity business code)
      *
@@ -1068,6 +1417,12 @@ public:
     virtual inline void get_in_nodes(svector<ff_node*>&w) { w.push_back(this); }
     virtual inline void get_in_nodes_feedback(svector<ff_node*>&) {}
 
+    // by_value channels (see by_value): true if the node sends out slots of
+    // a value pool, and true if all the nodes receiving its input tasks give
+    // the slots back to the pool
+    virtual inline bool value_output() const { return false; }
+    virtual inline bool value_input()  const { return false; }
+
     
     /**
      * \brief Force ff_node-to-core pinning
@@ -1120,9 +1475,31 @@ public:
      *
      */
     virtual inline bool  get(void **ptr) { return out->pop(ptr);}
+
+    /**
+     * \brief Nonblocking batched put into the input channel
+     *
+     * All the \p n elements are pushed at once or none of them is.
+     * It always fails if \p n is greater than \p maxbatch of the channel.
+     */
+    virtual inline bool  put_n(void * const ptr[], size_t n) {
+        if (in->pushPMF != &FFBUFFER::push) // multi-producer channel
+            return in->mp_multipush(ptr, (int)n);
+        return in->multipush(ptr, (int)n);
+    }
+
+    /**
+     * \brief Nonblocking batched pop from the output channel
+     *
+     * \return the number of elements popped (at most \p max)
+     */
+    virtual inline size_t get_n(void **ptr, size_t max) { return out->pop_n(ptr, max);}
    
     virtual inline void losetime_out(unsigned long ticks=ff_node::TICKS2WAIT) {
         FFTRACE(lostpushticks+=ticks; ++pushwait);
+        ff_timeline_span span(ff_timeline::WAIT_OUT);
+        if (ff_executor::yield()) return;
+        if (backoff_out) { backoff_out->wait(ticks); return; }
 #if defined(SPIN_USE_PAUSE)
         const long n = (long)ticks/2000;
         for(int i=0;i<=n;++i) PAUSE();
@@ -1133,6 +1510,9 @@ public:
 
     virtual inline void losetime_in(unsigned long ticks=ff_node::TICKS2WAIT) {
         FFTRACE(lostpopticks+=ticks; ++popwait);
+        ff_timeline_span span(ff_timeline::WAIT_IN);
+        if (ff_executor::yield()) return;
+        if (backoff_in) { backoff_in->wait(ticks); return; }
 #if defined(SPIN_USE_PAUSE)
         const long n = (long)ticks/2000;
         for(int i=0;i<=n;++i) PAUSE();
@@ -1141,6 +1521,16 @@ public:
 #endif /* SPIN_USE_PAUSE */
     }
 
+    /*
+     * Called by the node's thread when it starts: if the backoff policy parks
+     * the thread, the thread at the other end of the input (output) channel
+     * wakes up the node through the channel.
+     */
+    virtual inline void set_channels_parking() {
+        if (in)  in->set_consumer_parking(backoff_in ? backoff_in->parking() : nullptr);
+        if (out) out->set_producer_parking(backoff_out ? backoff_out->parking() : nullptr);
+    }
+
     /**
      * \brief Gets input channel
      *
@@ -1175,6 +1565,12 @@ public:
             << "  svc ticks     : " << tickstot  << " (min= " << ticksmin << " max= " << ticksmax << ")\n"
             << "  n. push lost  : " << pushwait  << " (ticks=" << lostpushticks << ")" << "\n"
             << "  n. pop lost   : " << popwait   << " (ticks=" << lostpopticks  << ")" << "\n";
+        if (backoff_in)
+            out << "  backoff in    : " << backoff_in->name() << " waits= " << backoff_in->get_nwaits()
+                << " (ticks=" << backoff_in->get_waitticks() << ")\n";
+        if (backoff_out)
+            out << "  backoff out   : " << backoff_out->name() << " waits= " << backoff_out->get_nwaits()
+                << " (ticks=" << backoff_out->get_waitticks() << ")\n";
     }
 
     virtual double getworktime() const { return wttime; }
@@ -1206,6 +1602,57 @@ public:
         return r;
     }
 
+    /**
+     * \brief Pushes a task in the node's work-stealing deque
+     *
+     * It can be called by a worker of a farm with the work-stealing 
+     * scheduling (see \p ff_farm::set_scheduling_stealing). The task will
+     * be computed by the \p svc method of this node or of another worker
+     * that steals it. 
+     *
+     * \return false if the node is not using the work-stealing scheduling or
+     * if its deque is full, in that case the caller should compute the task.
+     */
+    bool ff_send_out_local(void * task) {
+        if (!wsgroup) return false;
+        return wsgroup->get(wsid)->push(task);
+    }
+
+    /**
+     * \brief Sends out a batch of tasks
+     *
+     * It works as \p ff_send_out but the \p n tasks are published in the 
+     * output channel with a single update of the producer index.
+     * If the node is the Emitter of a farm, the whole batch is scheduled
+     * to one single worker.
+     * With bounded channels a batch larger than the channel capacity is
+     * sent in slices.
+     *
+     * \param tasks array of pointers to tasks
+     * \param n number of tasks in the array
+     */
+    virtual bool ff_send_out_batch(void ** tasks, size_t n, int id=-1,
+                                   unsigned long retry=((unsigned long)-1),
+                                   unsigned long ticks=(TICKS2WAIT)) {
+        if (n==0) return true;
+        if (callback) {
+            if (batch_callback) return batch_callback(tasks,n,id,retry,ticks,callback_arg);
+            for(size_t i=0;i<n;++i)
+                if (!callback(tasks[i],id,retry,ticks,callback_arg)) return false;
+            return true;
+        }
+        if (!out) { // the node may redefine ff_send_out (e.g., multi-output)
+            for(size_t i=0;i<n;++i)
+                if (!ff_send_out(tasks[i],id,retry,ticks)) return false;
+            return true;
+        }
+        bool r =Push_n(tasks,n,retry,ticks);
+#if defined(FF_TASK_CALLBACK)
+        if (r) callbackOut();
+#endif
+        return r;
+    }
+
     // Warning resetting queues while the node is running may produce unexpected results.
     virtual void reset() {
         if (in)  in->reset();
@@ -1328,6 +1775,10 @@ protected:
         p_cons_c = NULL;
 
         blocking_in = blocking_out = FF_RUNTIME_MODE;
+#if defined(SPINPARK_MODE)
+        backoff_in  = new ff_backoff_park;
+        backoff_out = new ff_backoff_park;
+#endif
     };
 
     
@@ -1346,6 +1797,13 @@ protected:
         cons_m = n.cons_m;  cons_c = n.cons_c;
         prod_m = n.prod_m;  prod_c = n.prod_c;
         barrier = n.barrier;
+        inbatch = n.inbatch; inbatch_size = n.inbatch_size;
+        inbatch_idx = n.inbatch_idx; inbatch_cnt = n.inbatch_cnt;
+        in_lookahead = n.in_lookahead;
+        wsgroup = n.wsgroup; wsid = n.wsid; wsseed = n.wsseed;
+        in_numanode  = n.in_numanode;  in_hugepages  = n.in_hugepages;
+        out_numanode = n.out_numanode; out_hugepages = n.out_hugepages;
+        backoff_in = n.backoff_in; backoff_out = n.backoff_out;
 
         // TODO trace <------
         
@@ -1365,6 +1823,8 @@ protected:
         n.barrier = nullptr;
         n.cons_m = nullptr; n.cons_c = nullptr;
         n.prod_m = nullptr; n.prod_c = nullptr;
+        n.inbatch = nullptr; n.inbatch_size = 0;
+        n.backoff_in = nullptr; n.backoff_out = nullptr;
     }
 
     virtual inline void input_active(const bool onoff) {
@@ -1375,6 +1835,12 @@ protected:
     virtual void registerCallback(bool (*cb)(void *,int,unsigned long,unsigned long,void *), void * arg) {
         callback=cb;
         callback_arg=arg;
+        batch_callback=NULL;
+    }
+    // optional, it is used by ff_send_out_batch together with the callback
+    // registered with registerCallback (it uses the same argument)
+    virtual void registerBatchCallback(bool (*cb)(void **,size_t,int,unsigned long,unsigned long,void *)) {
+        batch_callback=cb;
     }
     virtual void registerAllGatherCallback(int (* /*cb*/)(void *,void **, void*), void * /*arg*/) {}
 
@@ -1410,6 +1876,8 @@ private:
             /* 
              * NOTE: filter->pop and not buffer->pop because of the filter can be a dnode
              */
+            if (filter->wsgroup) return filter->Pop_steal(task);
+            if (filter->inbatch_size>1) return filter->Pop_batch(task);
             return filter->Pop(task);
         }
 
@@ -1417,6 +1885,8 @@ private:
 
         inline bool get(void **ptr) { return filter->get(ptr);}
 
+        std::string timeline_name() const { return "node " + std::to_string(tid); }
+
         inline void* svc(void * ) {
             void * task = NULL;
             void * ret  = FF_EOS;
@@ -1432,6 +1902,8 @@ private:
             if ( filter && ( !outpresent && filter->isMultiOutput() ) ) {
                 filter_outpresent=true;
             }
+            ff_latnode *lat = filter->latnode;
+            if (lat) lat->start(!inpresent, !outpresent && !filter_outpresent);
             gettimeofday(&filter->wtstart,NULL);
             do {
 #ifdef DFF_ENABLED
@@ -1446,6 +1918,7 @@ private:
                         ret = task;
                         
                         if (--neos > 0) continue;  
+                        ff_timeline::instant(ff_timeline::EOS);
                         filter->eosnotify();
 
                         // only EOS and EOSW are propagated
@@ -1456,6 +1929,7 @@ private:
                         break;
                     }
                     if (task == FF_GO_OUT) break;
+                    if (lat) lat->in(task);
                 }
                 FFTRACE(++filter->taskcnt);
                 FFTRACE(ticks t0 = getticks());
@@ -1464,7 +1938,15 @@ private:
                 if (filter) callbackIn();
 #endif                    
 
-                ret = filter->svc(task);
+                const int64_t tl = ff_timeline::begin();
+                if (filter->busystat) {
+                    const ticks t1 = getticks();
+                    ret = filter->svc(task);
+                    filter->busystat->add(getticks()-t1);
+                } else
+                    ret = filter->svc(task);
+                ff_timeline::end(ff_timeline::SVC, tl);
+                if (lat) lat->done();
 
 #if defined(TRACE_FASTFLOW)
                 ticks diff=(getticks()-t0);
@@ -1505,11 +1987,15 @@ private:
             }
 #endif
             gettimeofday(&filter->tstart,NULL);
+            filter->set_channels_parking();
+            ff_placeOnMyNode(filter->get_in_buffer());
+            if (filter->busystat) filter->busystat->started();
             return filter->svc_init();
         }
         
         void svc_end() {
             filter->svc_end();
+            if (filter->busystat) filter->busystat->stopped();
             gettimeofday(&filter->tstop,NULL);            
         }
         
@@ -1572,6 +2058,10 @@ protected:
     bool               FF_MEM_ALIGN(blocking_in,32); 
     bool               FF_MEM_ALIGN(blocking_out,32);
 
+    // used when the input channel is empty or the output channel is full
+    ff_backoff         *backoff_in  = nullptr;
+    ff_backoff         *backoff_out = nullptr;
+
     bool                  prepared = false;
     bool                  initial_barrier = true;
     bool                  default_mapping = true;
@@ -1580,6 +2070,127 @@ protected:
 
 /* *************************** Typed node ************************* */
 
+/*!
+ *  \class by_value
+ *  \ingroup building_blocks
+ *
+ *  \brief Marks a typed channel whose payload is passed by value.
+ *
+ *  It can be used as input and/or output type of \p ff_node_t 
+ *  (e.g. \p ff_node_t<by_value<int>, by_value<point_t> >) for small 
+ *  trivially copyable types. The value returned by the \p svc method 
+ *  (or passed to \p ff_send_out) is copied into a slot of a pool owned 
+ *  by the producer node, and the slot is given back to the producer when
+ *  the \p svc method of the consumer node returns. Therefore no 
+ *  allocation/deallocation per task is needed, and the value pointed by 
+ *  the input pointer of the \p svc method is valid only during the call.
+ *  The consumer of a by_value channel must be an \p ff_node_t having
+ *  \p by_value<T> as input type (the farm Emitter and Collector can be 
+ *  omitted, they just forward pointers), otherwise the slots are never
+ *  given back: preparing the pipeline, farm, all-to-all or combine that 
+ *  contains the channel fails. The same task cannot be broadcast 
+ *  to several consumers.
+ *  If the pool is exhausted the producer waits for a free slot.
+ *
+ *  This class is defined in \ref node.hpp
+ */
+template<typename T>
+struct by_value {
+    static_assert(std::is_trivially_copyable<T>::value, "by_value<T>: T must be trivially copyable");
+    static_assert(sizeof(T) <= CACHE_LINE_SIZE, "by_value<T>: T must fit in a cache line");
+    typedef T type;
+};
+
+/*
+ * Pool of slots used by a node producing by_value<T> tasks. Each slot 
+ * contains the value followed by a flag telling whether the slot is in use. 
+ * Slots are reused round-robin by the (single) producer and released by 
+ * the consumer that knows the type T but not the pool.
+ */
+template<typename T>
+class ff_value_pool {
+    static const size_t flag_offset = ((sizeof(T)+alignof(std::atomic<bool>)-1)/alignof(std::atomic<bool>))*alignof(std::atomic<bool>);
+    static const size_t align       = (alignof(T) > alignof(std::atomic<bool>)) ? alignof(T) : alignof(std::atomic<bool>);
+    static const size_t slot_size   = ((flag_offset+sizeof(std::atomic<bool>)+align-1)/align)*align;
+
+    static inline std::atomic<bool>* flag(void* p) {
+        return reinterpret_cast<std::atomic<bool>*>(reinterpret_cast<char*>(p)+flag_offset);
+    }
+public:
+    ff_value_pool(size_t nslots=FF_VALUE_POOL_SIZE):nslots(nslots) {}
+    ~ff_value_pool() { if (slots) freeAlignedMemory(slots); }
+
+    void resize(size_t n) {
+        assert(slots == nullptr); // it cannot be resized while being used
+        nslots = (n==0)?1:n;
+    }
+    size_t size() const { return nslots; }
+
+    /*
+     * It copies *task into a free slot and sets out to the slot address.
+     * Tags (EOS, GO_ON, ...) and NULL are returned as they are.
+     * It returns false if there are no free slots (the call should be retried).
+     */
+    inline bool put(T* task, void*& out) {
+        if (task == nullptr || (void*)task >= FF_TAG_MIN) { out = task; return true; }
+        if (!slots && !init()) {
+            error("FF_VALUE_POOL, unable to allocate the pool\n");
+            abort();
+        }
+        for(size_t i=0;i<nslots;++i) {
+            char* p = slots + next*slot_size;
+            if (++next == nslots) next=0;
+            if (!flag(p)->load(std::memory_order_acquire)) {
+                flag(p)->store(true, std::memory_order_relaxed);
+                memcpy(p, task, sizeof(T));
+                out = p;
+                return true;
+            }
+        }
+        return false;
+    }
+    // called by the consumer when the value is not used anymore
+    static inline void release(void* task) {
+        if (task == nullptr || task >= FF_TAG_MIN) return;
+        flag(task)->store(false, std::memory_order_release);
+    }
+protected:
+    bool init() {
+        slots = (char*)getAlignedMemory(CACHE_LINE_SIZE, nslots*slot_size);
+        if (!slots) return false;
+        for(size_t i=0;i<nslots;++i) 
+            new (slots+i*slot_size+flag_offset) std::atomic<bool>(false);
+        return true;
+    }
+private:
+    size_t nslots;
+    size_t next  = 0;
+    char * slots = nullptr;
+};
+
+/*
+ * It tells the task type seen by the svc method and how tasks are moved
+ * through the channel (by pointer or by value).
+ */
+template<typename T>
+struct ff_task_traits {
+    typedef T type;
+    static const bool by_value = false;
+    // nothing to do, the pointer is sent as it is
+    struct pool_t {
+        inline bool put(T* task, void*& out) { out = task; return true; }
+        static inline void release(void*) {}
+        void resize(size_t) {}
+        size_t size() const { return 0; }
+    };
+};
+template<typename T>
+struct ff_task_traits<by_value<T> > {
+    typedef T type;
+    static const bool by_value = true;
+    typedef ff_value_pool<T> pool_t;
+};
+
 //#ifndef WIN32 //VS12
 /*!
  *  \class ff_node_base_t
@@ -1596,16 +2207,19 @@ template<typename IN_t, typename OUT_t = IN_t>
 struct ff_node_t: ff_node {
     typedef IN_t  in_type;
     typedef OUT_t out_type;
+    // types seen by the svc method (they differ from in_type/out_type for by_value channels)
+    typedef typename ff_task_traits<IN_t>::type  in_task_t;
+    typedef typename ff_task_traits<OUT_t>::type out_task_t;
 
     using ff_node::registerCallback;
     using ff_node::ff_send_out;
     
     ff_node_t():
-        GO_ON((OUT_t*)FF_GO_ON),
-        EOS((OUT_t*)FF_EOS),
-        EOSW((OUT_t*)FF_EOSW),
-        GO_OUT((OUT_t*)FF_GO_OUT),
-        EOS_NOFREEZE((OUT_t*) FF_EOS_NOFREEZE) {
+        GO_ON((out_task_t*)FF_GO_ON),
+        EOS((out_task_t*)FF_EOS),
+        EOSW((out_task_t*)FF_EOSW),
+        GO_OUT((out_task_t*)FF_GO_OUT),
+        EOS_NOFREEZE((out_task_t*) FF_EOS_NOFREEZE) {
 #ifdef DFF_ENABLED
 
         /* WARNING: 
@@ -1681,10 +2295,56 @@ struct ff_node_t: ff_node {
 #endif
 
 	}
-    OUT_t * const GO_ON,  *const EOS, *const EOSW, *const GO_OUT, *const EOS_NOFREEZE;
+    out_task_t * const GO_ON,  *const EOS, *const EOSW, *const GO_OUT, *const EOS_NOFREEZE;
     virtual ~ff_node_t()  {}
-    virtual OUT_t* svc(IN_t*)=0;
-    inline  void *svc(void *task) { return svc(reinterpret_cast<IN_t*>(task)); };
+    virtual out_task_t* svc(in_task_t*)=0;
+    inline  void *svc(void *task) { 
+        out_task_t* t = svc(reinterpret_cast<in_task_t*>(task));
+        void* r;
+        // for by_value output channels the result is copied into the pool
+        while(!outpool.put(t, r)) pool_wait();
+        // for by_value input channels the slot is given back to the producer
+        ff_task_traits<IN_t>::pool_t::release(task);
+        return r;
+    };
+
+    /**
+     * \brief Sends out a by_value task
+     *
+     * The value pointed by \p task is copied, so it can be modified as 
+     * soon as the call returns. Defined only for by_value output channels.
+     */
+    template<typename T=OUT_t, typename std::enable_if<ff_task_traits<T>::by_value, int>::type = 0>
+    inline bool ff_send_out(out_task_t* task, int id=-1,
+                            unsigned long retry=((unsigned long)-1),
+                            unsigned long ticks=(ff_node::TICKS2WAIT)) {
+        void* r;
+        while(!outpool.put(task, r)) pool_wait();
+        return ff_node::ff_send_out(r, id, retry, ticks);
+    }
+
+    /*
+     * The by_value pool is full until the consumers give its slots back, 
+     * which may take long: the core is yielded to them after each wait.
+     */
+    inline void pool_wait() {
+        losetime_out();
+        std::this_thread::yield();
+    }
+
+    /**
+     * \brief Sets the number of slots of the pool used for by_value 
+     * output channels (default FF_VALUE_POOL_SIZE). 
+     * It must be called before running the node.
+     */
+    void set_value_pool_size(size_t n) { outpool.resize(n); }
+
+    bool value_output() const { return ff_task_traits<OUT_t>::by_value; }
+    bool value_input()  const { return ff_task_traits<IN_t>::by_value; }
+
+protected:
+    typename ff_task_traits<OUT_t>::pool_t outpool;
+
 private:
     // deleting some functions that do not have to be used in the svc
     using ff_node::push;
@@ -1707,10 +2367,10 @@ private:
  *  This class is defined in \ref node.hpp
  */
 template<typename TIN, typename TOUT=TIN, 
-         typename FUNC=std::function<TOUT*(TIN*,ff_node*const)> >
+         typename FUNC=std::function<typename ff_task_traits<TOUT>::type*(typename ff_task_traits<TIN>::type*,ff_node*const)> >
 struct ff_node_F: public ff_node_t<TIN,TOUT> {
    ff_node_F(FUNC f):F(f) {}
-   TOUT* svc(TIN* task) { return F(task, this); }
+   typename ff_node_t<TIN,TOUT>::out_task_t* svc(typename ff_node_t<TIN,TOUT>::in_task_t* task) { return F(task, this); }
    FUNC F;
 };
 
@@ -41,6 +41,10 @@
 #include <cstdio>
 #include <cstdlib>
 #include <cstdarg>
+#include <cmath>
+#include <chrono>
+#include <vector>
+#include <functional>
 #include <ff/node.hpp>
 #include <ff/pipeline.hpp>
 #include <ff/farm.hpp>
@@ -795,5 +799,236 @@ static inline int optimize_static(ff_pipeline& pipe, const OptLevel& opt=OptLeve
 }
 
 
+/* ----------------------------------------------------------------------- */
+/*                     profile-guided fusion and fission                   */
+/* ----------------------------------------------------------------------- */
+
+/// measured behaviour of a pipeline stage (see ff_pipeline_profiler)
+struct ff_stage_profile {
+    bool   opaque   = true;  ///< not measured: parallel building block or generator
+    size_t tasks    = 0;     ///< tasks computed by the stage
+    double svc_us   = 0.0;   ///< average service time (microseconds)
+    double wait_us  = 0.0;   ///< average time spent waiting for a task (microseconds)
+};
+
+/// stages [first,last] fused in one node, replicated \p nworkers times
+struct ff_stage_group {
+    size_t first, last;
+    size_t nworkers;
+    double svc_us;       ///< service time of the fused node
+};
+
+/// options of ff_pipeline_profiler::plan
+struct OptProfile {
+    ssize_t max_threads{ff_numCores()};
+    std::vector<bool> replicable;  ///< stages that can be replicated (stateless), none by default
+    int     verbose_level{0};
+};
+
+/**
+ * \class ff_pipeline_profiler
+ * \ingroup building_blocks
+ *
+ * \brief Measures the stages of a pipeline and proposes which adjacent
+ * stages to fuse and which stages to replicate
+ *
+ * The profiler is attached to a pipeline before it runs (or while it is 
+ * frozen). Each sequential stage accumulates the cycles spent in its svc
+ * method, the pipeline is then run on a warm-up input. \p profile returns
+ * the service time of each stage and the time it waited for its input. 
+ * \p plan looks for the grouping of the stages with the smallest period
+ * (the service time of the slowest group) within \p max_threads threads:
+ * adjacent stages whose service times add up to less than the period are 
+ * fused in one node (ff_comb), a group whose service time exceeds the 
+ * period is replicated in a farm if all its stages are replicable.
+ * The plan is applied by building a new pipeline with \p build_pipeline,
+ * a running pipeline cannot be restructured.
+ * Parallel building blocks (farms, all-to-all, nested pipelines) and the
+ * first stage of a pipeline without input channel (which generates the
+ * stream in a single svc call) are not measured and are left as they are.
+ */
+class ff_pipeline_profiler {
+public:
+    ff_pipeline_profiler() {}
+    ~ff_pipeline_profiler() { detach(); }
+
+    int attach(ff_pipeline& pipe) {
+        detach();
+        const svector<ff_node*>& S = pipe.getStages();
+        nodes.assign(S.begin(), S.end());
+        std::vector<ff_busystat> s(nodes.size());
+        stats.swap(s);
+        wt0.assign(nodes.size(), 0.0);
+        for(size_t i=0;i<nodes.size();++i) {
+            ff_node *n = nodes[i];
+            if (n->isFarm() || n->isPipe() || n->isAll2All() || n->busystat) continue;
+            n->busystat = &stats[i];
+            wt0[i] = n->wttime;
+        }
+        t0 = getticks();
+        us0 = usnow();
+        return 0;
+    }
+    void detach() {
+        for(size_t i=0;i<nodes.size();++i)
+            if (nodes[i]->busystat == &stats[i]) nodes[i]->busystat = nullptr;
+        nodes.clear();
+    }
+
+    /// it has to be called when the pipeline is not running (e.g. after wait_freezing)
+    std::vector<ff_stage_profile> profile() const {
+        std::vector<ff_stage_profile> P(nodes.size());
+        const double us = usnow() - us0;
+        const double tpus = (us>0.0) ? (double)(getticks()-t0)/us : 1.0;
+        for(size_t i=0;i<nodes.size();++i) {
+            ff_node *n = nodes[i];
+            if (n->busystat != &stats[i]) continue;
+            if (i==0 && n->get_in_buffer()==nullptr) continue;   // generator
+            const size_t k = stats[i].tasks.load(std::memory_order_relaxed);
+            if (k==0) continue;
+            const double busy = (double)stats[i].busy.load(std::memory_order_relaxed)/tpus;
+            const double wt   = (n->wttime - wt0[i])*1000.0;
+            P[i].opaque  = false;
+            P[i].tasks   = k;
+            P[i].svc_us  = busy / k;
+            P[i].wait_us = (wt>busy) ? (wt-busy)/k : 0.0;
+        }
+        return P;
+    }
+
+    std::vector<ff_stage_group> plan(const OptProfile& opt=OptProfile()) const {
+        const std::vector<ff_stage_profile> P = profile();
+        const size_t n = P.size();
+        const ssize_t maxth = (opt.max_threads>0) ? opt.max_threads : 1;
+        std::vector<double> candidates;
+        double total = 0.0;
+        for(size_t i=0;i<n;++i) {
+            if (P[i].opaque) continue;
+            total += P[i].svc_us;
+            for(ssize_t k=1;k<=maxth;++k) candidates.push_back(P[i].svc_us/k);
+        }
+        candidates.push_back(total);
+
+        std::vector<ff_stage_group> best, G;
+        double bestperiod=0.0; ssize_t bestthreads=0;
+        for(size_t c=0;c<candidates.size();++c) {
+            ssize_t th=0;
+            const double period = group(P, opt, candidates[c], G, th);
+            if (th > maxth && !best.empty()) continue;
+            if (best.empty() || (bestthreads > maxth && th < bestthreads) ||
+                period < bestperiod || (period == bestperiod && th < bestthreads)) {
+                best.swap(G); bestperiod=period; bestthreads=th;
+            }
+        }
+        if (opt.verbose_level>0) {
+            for(size_t i=0;i<n;++i) {
+                if (P[i].opaque) 
+                    opt_report(opt.verbose_level, OPT_NORMAL, "OPT (profile): stage %ld not measured\n", (long)i);
+                else
+                    opt_report(opt.verbose_level, OPT_NORMAL, "OPT (profile): stage %ld svc=%.2f us wait=%.2f us tasks=%ld\n", 
+                               (long)i, P[i].svc_us, P[i].wait_us, (long)P[i].tasks);
+            }
+            for(size_t g=0;g<best.size();++g) {
+                if (best[g].first != best[g].last)
+                    opt_report(opt.verbose_level, OPT_NORMAL, "OPT (profile): FUSE: stages [%ld-%ld]\n", (long)best[g].first, (long)best[g].last);
+                if (best[g].nworkers>1)
+                    opt_report(opt.verbose_level, OPT_NORMAL, "OPT (profile): REPLICATE: stages [%ld-%ld] in a farm with %ld workers\n",
+                               (long)best[g].first, (long)best[g].last, (long)best[g].nworkers);
+            }
+            opt_report(opt.verbose_level, OPT_NORMAL, "OPT (profile): period %.2f us, %ld threads\n", bestperiod, (long)bestthreads);
+        }
+        return best;
+    }
+
+protected:
+    /*
+     * Greedy grouping for a target period T: a stage is added to the current
+     * group while the service time of the group stays within T, a group
+     * slower than T is replicated (if possible) to bring it within T.
+     * It returns the period of the grouping and the threads it needs.
+     */
+    static double group(const std::vector<ff_stage_profile>& P, const OptProfile& opt,
+                        double T, std::vector<ff_stage_group>& G, ssize_t& threads) {
+        auto replicable = [&](size_t i) {
+            return !P[i].opaque && i<opt.replicable.size() && opt.replicable[i];
+        };
+        G.clear(); threads=0;
+        double period=0.0;
+        for(size_t i=0;i<P.size();) {
+            ff_stage_group g{i,i,1,P[i].svc_us};
+            if (P[i].opaque) { G.push_back(g); ++threads; ++i; continue; }
+            bool rep = replicable(i);
+            size_t j=i+1;
+            for(; j<P.size() && !P[j].opaque && g.svc_us+P[j].svc_us <= T; ++j) {
+                g.svc_us += P[j].svc_us;
+                g.last = j;
+                rep = rep && replicable(j);
+            }
+            if (rep && T>0.0 && g.svc_us > T) g.nworkers = (size_t)std::ceil(g.svc_us/T);
+            threads += g.nworkers + ((g.nworkers>1) ? 2 : 0);  // emitter and collector
+            period = (std::max)(period, g.svc_us/g.nworkers);
+            G.push_back(g);
+            i=j;
+        }
+        return period;
+    }
+    static inline double usnow() {
+        return std::chrono::duration<double, std::micro>(
+               std::chrono::steady_clock::now().time_since_epoch()).count();
+    }
+
+    std::vector<ff_node*>     nodes;
+    std::vector<ff_busystat>  stats;
+    std::vector<double>       wt0;
+    ticks  t0  = 0;
+    double us0 = 0.0;
+};
+
+/**
+ * \brief Builds the pipeline described by \p plan 
+ *
+ * \p make_stage(i) returns a new instance of the stage i of the profiled
+ * pipeline, it is called once for each replica. The nodes are deleted 
+ * with the pipeline. The farms are ordered if \p ordered is true.
+ */
+static inline ff_pipeline* build_pipeline(const std::vector<ff_stage_group>& plan,
+                                          const std::function<ff_node*(size_t)>& make_stage,
+                                          bool ordered=false) {
+    auto make_group = [&](const ff_stage_group& g) -> ff_node* {
+        ff_node *node = make_stage(g.first);
+        for(size_t k=g.first+1; node && k<=g.last; ++k) {
+            ff_node *next = make_stage(k);
+            if (!next) { delete node; return nullptr; }
+            node = new ff_comb(node, next, true, true);
+        }
+        return node;
+    };
+    ff_pipeline *pipe = new ff_pipeline;
+    for(size_t i=0;i<plan.size();++i) {
+        if (plan[i].nworkers<=1) {
+            ff_node *node = make_group(plan[i]);
+            if (!node) { delete pipe; return nullptr; }
+            pipe->add_stage(node, true);
+            continue;
+        }
+        std::vector<ff_node*> W;
+        for(size_t j=0;j<plan[i].nworkers;++j) {
+            ff_node *node = make_group(plan[i]);
+            if (!node) {
+                for(auto w: W) delete w;
+                delete pipe;
+                return nullptr;
+            }
+            W.push_back(node);
+        }
+        ff_farm *farm = new ff_farm(W);
+        farm->cleanup_workers();
+        if (ordered) farm->set_ordered();
+        pipe->add_stage(farm, true);
+    }
+    return pipe;
+}
+
+
 } // namespace ff
 #endif /* FF_OPTIMIZE_HPP */
@@ -36,7 +36,7 @@
 #define FF_ORDERING_POLICY_HPP
 
 #include <vector>
-#include <queue>
+#include <atomic>
 
 #include <ff/lb.hpp>
 #include <ff/gt.hpp>
@@ -50,12 +50,23 @@ namespace ff {
 // second.second is used to store the sender
 using ordering_pair_t = std::pair<size_t, std::pair<void*,ssize_t> >;
 
+// The sequence number of a task is also the index (modulo the window size)
+// of its ordering_pair_t slot and of its position in the reorder buffer of
+// the collector. The collector publishes in 'released' the sequence number
+// of the next task it will deliver, so that the emitter never has more than
+// a window of tasks in flight (the slot of a task is reused only after the
+// task has been delivered). When the window is full, the emitter waits.
 struct ordered_lb:ff_loadbalancer {
-    ordered_lb(int max_num_workers):ff_loadbalancer(max_num_workers) {}
+    ordered_lb(int max_num_workers):ff_loadbalancer(max_num_workers),released(0) {}
     void init(ordering_pair_t* v, const size_t size) {
         _M=v; _M_size=size; cnt=0; idx=0;
+        released.store(0, std::memory_order_relaxed);
     }
+    /// the counter of the delivered tasks, updated by the collector
+    std::atomic<size_t>* get_released() { return &released; }
+
     inline bool schedule_task(void * task, unsigned long retry, unsigned long ticks) {
+        wait_window(ticks);
         _M[idx].first  = cnt;
         _M[idx].second.first = task;
         auto r = ff_loadbalancer::schedule_task(&_M[idx], retry, ticks);
@@ -63,11 +74,18 @@ struct ordered_lb:ff_loadbalancer {
         ++cnt; ++idx %= _M_size;
         return r;
     }
+    // each task needs its own ordering_pair_t slot
+    inline bool schedule_task_batch(void ** tasks, size_t n, unsigned long retry, unsigned long ticks) {
+        for(size_t i=0;i<n;++i)
+            if (!schedule_task(tasks[i], retry, ticks)) return false;
+        return true;
+    }
     inline void broadcast_task(void * task) {
         if (task > FF_TAG_MIN) {
             ff_loadbalancer::broadcast_task(task);
             return;
         }
+        wait_window(TICKS2WAIT);
         _M[idx].first  = cnt;
         _M[idx].second.first = task;
         ff_loadbalancer::broadcast_task(&_M[idx]);
@@ -75,46 +93,86 @@ struct ordered_lb:ff_loadbalancer {
     }
     inline bool ff_send_out_to(void *task, int id, unsigned long retry, unsigned long ticks) {
         assert(task<FF_TAG_MIN);
+        wait_window(ticks);
         _M[idx].first  = cnt;
         _M[idx].second.first = task;
         auto r = ff_loadbalancer::ff_send_out_to(&_M[idx], id, retry, ticks);
         if (r) {++cnt; ++idx %= _M_size;}
         return r;
-    }        
+    }
+    
+    // back-pressure: waits until the collector has room for one more task
+    inline void wait_window(unsigned long ticks) {
+        while((cnt - released.load(std::memory_order_acquire)) >= _M_size) {
+            if (blocking_out) {
+                struct timespec tv;
+                timedwait_timeout(tv);
+                pthread_mutex_lock(prod_m);
+                pthread_cond_timedwait(prod_c, prod_m, &tv);
+                pthread_mutex_unlock(prod_m);
+            } else losetime_out(ticks);
+        }
+    }
+
     size_t idx,cnt,_M_size=0;
     ordering_pair_t* _M=nullptr;    
+    long padding[longxCacheLine];
+    std::atomic<size_t> released;
+};
+
+// Reorder buffer of the ordered collectors: a ring indexed by the sequence
+// number modulo the window size, both insert and release are O(1).
+struct ordering_window {
+    void init(const size_t size, std::atomic<size_t>* r) {
+        W.assign(size, nullptr); released=r;
+    }
+    // true if the element is within the window and has been stored
+    inline bool insert(ordering_pair_t* in, const size_t cnt) {
+        if ((in->first - cnt) >= W.size()) return false;
+        W[in->first % W.size()] = in;
+        return true;
+    }
+    // the element with sequence number cnt, if already arrived
+    inline ordering_pair_t* next(const size_t cnt) {
+        ordering_pair_t* &p = W[cnt % W.size()];
+        ordering_pair_t* r = p;
+        p = nullptr;
+        return r;
+    }
+    // the element cnt-1 has been delivered, its slot can be reused
+    inline void release(const size_t cnt) {
+        if (released) released->store(cnt, std::memory_order_release);
+    }
+    std::vector<ordering_pair_t*> W;
+    std::atomic<size_t>* released=nullptr;
 };
 
 struct ordered_gt: ff_gatherer {
-    struct PairCmp {
-        bool operator()(const ordering_pair_t* lhs, const ordering_pair_t* rhs) const { 
-            return lhs->first > rhs->first;
-        }
-    };
     ordered_gt(int max_num_workers): ff_gatherer(max_num_workers) {}
-    void init(const size_t size) { MemSize=size; cnt =0; }
+    void init(const size_t size, std::atomic<size_t>* released=nullptr) {
+        cnt =0;
+        R.init(size, released);
+    }
     inline ssize_t gather_task(void ** task) {
-        if (!Q.empty()) {
-	    auto next = Q.top();
-	    if (cnt == next->first) {
-            ++cnt;
+        ordering_pair_t* next = R.next(cnt);
+        if (next) {
             *task = next->second.first;
-            Q.pop();
+            R.release(++cnt);
             return next->second.second;
-	    }
         }
         ssize_t nextr=  ff_gatherer::gather_task(task);
         if (*task < FF_TAG_MIN) {
             ordering_pair_t *in =  reinterpret_cast<ordering_pair_t*>(*task);
             if (cnt == in->first) { // it's the next to send out
-                cnt++;
                 *task = in->second.first;
+                R.release(++cnt);
                 return nextr;
             }
             in->second.second = nextr;
-            Q.push(in);
-            if (Q.size()>MemSize) {
-                error("FATAL ERROR: OFARM, ondemand, not enough memory, increase MemoryElements\n");
+            if (!R.insert(in, cnt)) {
+                error("OFARM, task out of the ordering window, delivered unordered\n");
+                *task = in->second.first;
+                return nextr;
             }
             *task = FF_GO_ON;
         }
@@ -134,8 +192,7 @@ struct ordered_gt: ff_gatherer {
     }
     
     size_t cnt;
-    std::priority_queue<ordering_pair_t*,std::vector<ordering_pair_t*>, PairCmp> Q;
-    size_t MemSize;       
+    ordering_window R;
 };
 // Worker wrapper to be used when ordering_pair_t is added to the data elements
 class OrderedWorkerWrapper: public ff_node_t<ordering_pair_t> {
@@ -168,7 +225,7 @@ public:
         idx(0),cnt(0),Memory(m), MemSize(size) {}
 
     int svc_init() {
-        idx=0;
+        idx=cnt % MemSize;
         return 0;
     } 
     inline ordering_pair_t* svc(IN_t* in) {
@@ -187,41 +244,31 @@ public:
 // A node that removes the ordering_pair_t around the data element
 class OrderedCollectorWrapper: public ff_node_t<ordering_pair_t, void> {
 public:
-    struct PairCmp {
-        bool operator()(const ordering_pair_t* lhs, const ordering_pair_t* rhs) const { 
-            return lhs->first > rhs->first;
-        }
-    };
-    OrderedCollectorWrapper(const size_t size):cnt(0),MemSize(size) {}
-    int svc_init() {
-        cnt=0;
-        return 0;
-    } 
+    // size must be the window of the ordered_lb, whose counter is 'released'
+    OrderedCollectorWrapper(const size_t size, std::atomic<size_t>* released=nullptr):cnt(0) {
+        R.init(size, released);
+    }
+    // the sequence numbers are not restarted by the ordered_lb
     inline void* svc(ordering_pair_t* in) {
         if (cnt == in->first) { // it's the next to send out
             ff_send_out(in->second.first);
-            cnt++;
-            while(!Q.empty()) {
-                auto next = Q.top();
-                if (cnt == next->first) {
-                    ff_send_out(next->second.first);
-                    ++cnt;
-                    Q.pop();
-                } else break;
+            R.release(++cnt);
+            ordering_pair_t* next;
+            while((next = R.next(cnt))) {
+                ff_send_out(next->second.first);
+                R.release(++cnt);
             }
             return GO_ON;
         }
-        Q.push(in);
-        if (Q.size()>MemSize) {
-            error("FATAL ERROR: OFARM, ondemand, not enough memory, increase MemoryElements\n");
+        if (!R.insert(in, cnt)) {
+            error("OFARM, task out of the ordering window, delivered unordered\n");
+            ff_send_out(in->second.first);
         }
         return GO_ON;
     }
     size_t cnt;
-    std::priority_queue<ordering_pair_t*,std::vector<ordering_pair_t*>, PairCmp> Q;
-    size_t MemSize;       
+    ordering_window R;
 };
-
     
 // --------------------------------------------------------------
 
@@ -49,6 +49,27 @@
  *                   than chunk iterations. Then chunks are assigned to the Workers statically 
  *                   and in a round-robin fashion.
  *
+ *  The dynamic scheduling may also be guided or adaptive (see parfor_schedule_t), by giving 
+ *  a policy to the parallel_for/parallel_reduce methods:
+ *      - PARFOR_SCHED_GUIDED    the chunks decrease in size, a Worker takes half of the 
+ *                               iterations left and no less than grain iterations;
+ *      - PARFOR_SCHED_ADAPTIVE  the size of the chunks is tuned on the measured cost of the 
+ *                               iterations so that the scheduling overhead is kept low 
+ *                               (a chunk lasts about FF_PARFOR_CHUNK_TICKS), and it is never 
+ *                               greater than the guided one so that the load is balanced.
+ *  With these policies the grain does not have to be chosen by hand (1 is fine).
+ *
+ *  Without the scheduler thread, a Worker that has completed its own iterations steals 
+ *  iterations from the other Workers. By default all the Workers steal from the one with 
+ *  the most iterations left; with setStealing(PARFOR_STEAL_RANDOM) each Worker takes half 
+ *  of the iterations of a randomly chosen Worker, with PARFOR_STEAL_HIERARCHICAL the 
+ *  Workers on the same NUMA node are chosen first (see parfor_steal_t). These policies 
+ *  reduce the contention among the Workers when they are many.
+ *
+ *  For many short loops in sequence the parallel_for_hot method keeps the Workers 
+ *  waiting for the next loop on a shared counter, so that starting a loop costs much 
+ *  less than with the other methods (no messages to the Workers).
+ *
  *  If you want to use the static scheduling policy (either default or with a given grain),
  *  please use the **parallel_for_static** method.
  *
@@ -173,6 +194,21 @@ public:
         ff_forall_farm<forallreduce_W<int> >::disableScheduler(onoff);
     }
 
+    /**
+     * \brief Stealing policy of the Workers (dynamic scheduling)
+     *
+     * Selects how a Worker that has completed its iterations looks for 
+     * other iterations in the ranges of the other Workers, for all the next
+     * parallel_for. With \p PARFOR_STEAL_RANDOM or \p PARFOR_STEAL_HIERARCHICAL
+     * each Worker chooses its own victim (on the same NUMA node first with the 
+     * hierarchical policy) and takes half of its iterations, the active
+     * scheduler is not used. See parfor_steal_t.
+     * \param policy stealing policy, \p PARFOR_STEAL_DEFAULT restores the default one
+     */
+    inline void setStealing(parfor_steal_t policy) {
+        ff_forall_farm<forallreduce_W<int> >::setStealing(policy);
+    }
+
     // It puts all spinning threads to sleep. It does not disable the spinWait flag
     // so at the next call, threads start spinning again.
     inline int threadPause() {
@@ -249,6 +285,32 @@ public:
         } FF_PARFOR_STOP(this);
     }    
 
+    /**
+     * @brief Parallel for region (step, grain, policy) - guided or adaptive
+     *
+     * @detail Dynamic scheduling onto nw worker threads with the scheduling policy
+     * <b>sched</b> (PARFOR_SCHED_GUIDED or PARFOR_SCHED_ADAPTIVE). The chunks of
+     * iterations are sized by the run-time and they are no smaller than <b>grain</b>.
+     * Iteration space is walked with stride <b>step</b>. 
+     * 
+     * @param first first value of the iteration variable
+     * @param last last value of the iteration variable
+     * @param step step increment for the iteration variable
+     * @param grain (> 0) minimum computation grain 
+     * @param sched scheduling policy
+     * @param f <b>f(const long idx)</b>  Lambda function, 
+     * body of the parallel loop. <b>idx</b>: iteration
+     * param nw number of worker threads
+     */
+    template <typename Function>
+    inline void parallel_for(long first, long last, long step, long grain, 
+                             parfor_schedule_t sched,
+                             const Function& f, const long nw=FF_AUTO) {
+        FF_PARFOR_T_START_SCHED(this, int, parforidx,first,last,step,PARFOR_DYNAMIC(grain),sched,nw) {
+            f(parforidx);            
+        } FF_PARFOR_T_STOP(this,int);
+    }    
+
     /**
      * @brief Parallel for region with threadID (step, grain, thid) - dynamic
      *
@@ -337,6 +399,85 @@ public:
             } FF_PARFOR_T_STOP(this,int);
         }
     }
+
+    /**
+     * @brief Parallel for region over a 2D iteration space - tiled, dynamic
+     *
+     * The two nested loops are collapsed and the iteration space 
+     * (first0,last0( x (first1,last1( is divided in tiles of 
+     * <b>tile0 x tile1</b> iterations that are scheduled dynamically onto
+     * nw worker threads. Within a tile the iterations are walked in row-major
+     * order (<b>j</b> is the innermost index). If the shape of the tiles is not
+     * given (tile0 or tile1 <= 0) it is derived from the size of the L2 cache
+     * (see forall_tiles).
+     *
+     * @param f <b>f(const long i, const long j)</b> body of the parallel loop
+     * @param nw number of worker threads (default n. of platform HW contexts)
+     */
+    template <typename Function>
+    inline void parallel_for_2d(long first0, long last0, long first1, long last1,
+                                const Function& f, long tile0=0, long tile1=0,
+                                const long nw=FF_AUTO) {
+        const long first[2] = {first0, first1}, last[2] = {last0, last1}, tile[2] = {tile0, tile1};
+        const forall_tiles tiles(first, last, tile, 2, (nw<=0) ? getNWorkers() : (size_t)nw);
+        if (tiles.ntiles() == 0) return;
+        FF_PARFOR_START_IDX(this, parforidx,0,tiles.ntiles(),1,PARFOR_DYNAMIC(1),nw) {
+            for(long t=ff_start_idx;t<ff_stop_idx;++t) tiles.for2d(t, f);
+        } FF_PARFOR_STOP(this);
+    }
+    /**
+     * @brief Parallel for region over a 3D iteration space - tiled, dynamic
+     *
+     * As parallel_for_2d with three nested loops collapsed in tiles of 
+     * <b>tile0 x tile1 x tile2</b> iterations (<b>k</b> is the innermost index).
+     *
+     * @param f <b>f(const long i, const long j, const long k)</b> body of the parallel loop
+     * @param nw number of worker threads (default n. of platform HW contexts)
+     */
+    template <typename Function>
+    inline void parallel_for_3d(long first0, long last0, long first1, long last1,
+                                long first2, long last2, 
+                                const Function& f, long tile0=0, long tile1=0, long tile2=0,
+                                const long nw=FF_AUTO) {
+        const long first[3] = {first0, first1, first2}, last[3] = {last0, last1, last2};
+        const long tile[3]  = {tile0, tile1, tile2};
+        const forall_tiles tiles(first, last, tile, 3, (nw<=0) ? getNWorkers() : (size_t)nw);
+        if (tiles.ntiles() == 0) return;
+        FF_PARFOR_START_IDX(this, parforidx,0,tiles.ntiles(),1,PARFOR_DYNAMIC(1),nw) {
+            for(long t=ff_start_idx;t<ff_stop_idx;++t) tiles.for3d(t, f);
+        } FF_PARFOR_STOP(this);
+    }
+
+    /**
+     * @brief Parallel for region (step, grain) - hot loop
+     *
+     * For many short loops in sequence (e.g. the iterations of a solver). At
+     * the first call the worker threads enter the hot loop mode: between one 
+     * loop and the next one they wait on a shared counter (spinning and then 
+     * parking on a futex) instead of on their input channels, so a loop is 
+     * started with one store and its end is detected with a barrier, without 
+     * any message and freeze/thaw cycle.
+     * The hot loop mode ends with stopHotLoops or when any other method of 
+     * the object is called (parallel_for, threadPause, ...).
+     *
+     * @param first first value of the iteration variable
+     * @param last last value of the iteration variable
+     * @param step step increment for the iteration variable
+     * @param grain (> 0) dynamic scheduling with chunks of grain iterations,
+     * (== 0) static scheduling in contiguous blocks
+     * @param f <b>f(const long idx)</b>  Lambda function, body of the parallel loop.
+     * @param nw number of worker threads (default the ones of the constructor)
+     */
+    template <typename Function>
+    inline void parallel_for_hot(long first, long last, long step, long grain, 
+                                 const Function& f, const long nw=FF_AUTO) {
+        if (ff_forall_farm<forallreduce_W<int> >::hotloop(first,last,step,grain,f,nw)<0)
+            error("ParallelFor: running the hot loop\n");
+    }
+    // The worker threads leave the hot loop mode (see parallel_for_hot)
+    inline int stopHotLoops() {
+        return ff_forall_farm<forallreduce_W<int> >::hotStop();
+    }
 };
 
  /*!
@@ -399,6 +540,24 @@ public:
         ff_forall_farm<forallreduce_W<T> >::disableScheduler(onoff);
     }
 
+    // Selects the stealing policy of the Workers for the next loops (see parfor_steal_t
+    // and ParallelFor::setStealing)
+    inline void setStealing(parfor_steal_t policy) {
+        ff_forall_farm<forallreduce_W<T> >::setStealing(policy);
+    }
+
+    // Parallel for in the hot loop mode (see ParallelFor::parallel_for_hot)
+    template <typename Function>
+    inline void parallel_for_hot(long first, long last, long step, long grain, 
+                                 const Function& f, const long nw=FF_AUTO) {
+        if (ff_forall_farm<forallreduce_W<T> >::hotloop(first,last,step,grain,f,nw)<0)
+            error("ParallelForReduce: running the hot loop\n");
+    }
+    // The worker threads leave the hot loop mode
+    inline int stopHotLoops() {
+        return ff_forall_farm<forallreduce_W<T> >::hotStop();
+    }
+
     // It puts all spinning threads to sleep. It does not disable the spinWait flag
     // so at the next call, threads start spinning again.
     inline int threadPause() {
@@ -469,6 +628,30 @@ public:
             f(parforidx);            
         } FF_PARFOR_STOP(this);
     }    
+    /**
+     * @brief Parallel for region (step, grain, policy) - guided or adaptive
+     *
+     * Dynamic scheduling onto nw worker threads with the scheduling policy
+     * \p sched (PARFOR_SCHED_GUIDED or PARFOR_SCHED_ADAPTIVE). The chunks of
+     * iterations are sized by the run-time and they are no smaller than \p grain.
+     *
+     * @param first first value of the iteration variable
+     * @param last last value of the iteration variable
+     * @param step step increment for the iteration variable
+     * @param grain (> 0) minimum computation grain
+     * @param sched scheduling policy
+     * @param f <b>f(const long idx)</b>  Lambda function,
+     * body of the parallel loop. <b>idx</b>: iteration
+     * param nw number of worker threads
+     */
+    template <typename Function>
+    inline void parallel_for(long first, long last, long step, long grain, 
+                             parfor_schedule_t sched,
+                             const Function& f, const long nw=FF_AUTO) {
+        FF_PARFOR_T_START_SCHED(this, T, parforidx,first,last,step,PARFOR_DYNAMIC(grain),sched,nw) {
+            f(parforidx);            
+        } FF_PARFOR_T_STOP(this,T);
+    }    
     /**
      * @brief Parallel for region with threadID (step, grain, thid) - dynamic
      *
@@ -550,6 +733,52 @@ public:
         }
     }
 
+    /**
+     * @brief Parallel for region over a 2D iteration space - tiled, dynamic
+     *
+     * The two nested loops are collapsed and the iteration space 
+     * (first0,last0( x (first1,last1( is divided in tiles of 
+     * \p tile0 x \p tile1 iterations that are scheduled dynamically onto
+     * nw worker threads. If the shape of the tiles is not given (tile0 or 
+     * tile1 <= 0) it is derived from the size of the L2 cache.
+     *
+     * @param f <b>f(const long i, const long j)</b> body of the parallel loop
+     * @param nw number of worker threads (default n. of platform HW contexts)
+     */
+    template <typename Function>
+    inline void parallel_for_2d(long first0, long last0, long first1, long last1,
+                                const Function& f, long tile0=0, long tile1=0,
+                                const long nw=FF_AUTO) {
+        const long first[2] = {first0, first1}, last[2] = {last0, last1}, tile[2] = {tile0, tile1};
+        const forall_tiles tiles(first, last, tile, 2, (nw<=0) ? this->getNWorkers() : (size_t)nw);
+        if (tiles.ntiles() == 0) return;
+        FF_PARFOR_T_START_IDX(this, T, parforidx,0,tiles.ntiles(),1,PARFOR_DYNAMIC(1),nw) {
+            for(long t=ff_start_idx;t<ff_stop_idx;++t) tiles.for2d(t, f);
+        } FF_PARFOR_T_STOP(this,T);
+    }
+    /**
+     * @brief Parallel for region over a 3D iteration space - tiled, dynamic
+     *
+     * As parallel_for_2d with three nested loops collapsed in tiles of 
+     * \p tile0 x \p tile1 x \p tile2 iterations.
+     *
+     * @param f <b>f(const long i, const long j, const long k)</b> body of the parallel loop
+     * @param nw number of worker threads (default n. of platform HW contexts)
+     */
+    template <typename Function>
+    inline void parallel_for_3d(long first0, long last0, long first1, long last1,
+                                long first2, long last2, 
+                                const Function& f, long tile0=0, long tile1=0, long tile2=0,
+                                const long nw=FF_AUTO) {
+        const long first[3] = {first0, first1, first2}, last[3] = {last0, last1, last2};
+        const long tile[3]  = {tile0, tile1, tile2};
+        const forall_tiles tiles(first, last, tile, 3, (nw<=0) ? this->getNWorkers() : (size_t)nw);
+        if (tiles.ntiles() == 0) return;
+        FF_PARFOR_T_START_IDX(this, T, parforidx,0,tiles.ntiles(),1,PARFOR_DYNAMIC(1),nw) {
+            for(long t=ff_start_idx;t<ff_stop_idx;++t) tiles.for3d(t, f);
+        } FF_PARFOR_T_STOP(this,T);
+    }
+
     /* ------------------ parallel_reduce ------------------- */
     /**
      * \brief Parallel reduce (basic)
@@ -639,6 +868,24 @@ public:
             body(parforidx, var);            
         } FF_PARFORREDUCE_F_STOP(this, var, finalreduce);
     }
+    /**
+     * \brief Parallel reduce (step, grain, policy)
+     *
+     * As the parallel reduce (step, grain) with the guided or adaptive dynamic
+     * scheduling policy \p sched (PARFOR_SCHED_GUIDED or PARFOR_SCHED_ADAPTIVE).
+     * The chunks of iterations are sized by the run-time and they are no smaller
+     * than \p grain.
+     */
+    template <typename Function, typename FReduction>
+    inline void parallel_reduce(T& var, const T& identity, 
+                                long first, long last, long step, long grain, 
+                                parfor_schedule_t sched,
+                                const Function& body, const FReduction& finalreduce,
+                                const long nw=FF_AUTO) {
+        FF_PARFORREDUCE_START_SCHED(this, var, identity, parforidx,first,last,step,PARFOR_DYNAMIC(grain),sched,nw) {
+            body(parforidx, var);            
+        } FF_PARFORREDUCE_F_STOP(this, var, finalreduce);
+    }
 
     template <typename Function, typename FReduction>
     inline void parallel_reduce_thid(T& var, const T& identity,
@@ -692,10 +939,219 @@ public:
             } FF_PARFORREDUCE_F_STOP(this, var, finalreduce);
         }
     }
+
+    /**
+     * \brief Parallel reduce over a 2D iteration space - tiled, dynamic
+     *
+     * The iteration space (first0,last0( x (first1,last1( is divided in tiles
+     * as in parallel_for_2d. \p body(i,j,var) accumulates in the partial result 
+     * of the worker, the partial results are then reduced with \p finalreduce.
+     *
+     * \param var inital value of reduction variable (accumulator)
+     * \param indentity indetity value for the reduction function
+     * \param body <b>body(const long i, const long j, T& var)</b>
+     * \param finalreduce reduce operation (executed sequentially)
+     * \param nw number of worker threads
+     */
+    template <typename Function, typename FReduction>
+    inline void parallel_reduce_2d(T& var, const T& identity,
+                                   long first0, long last0, long first1, long last1,
+                                   const Function& body, const FReduction& finalreduce,
+                                   long tile0=0, long tile1=0, const long nw=FF_AUTO) {
+        const long first[2] = {first0, first1}, last[2] = {last0, last1}, tile[2] = {tile0, tile1};
+        const forall_tiles tiles(first, last, tile, 2, (nw<=0) ? this->getNWorkers() : (size_t)nw);
+        if (tiles.ntiles() == 0) return;
+        FF_PARFORREDUCE_START_IDX(this, var, identity, idx,0,tiles.ntiles(),1,PARFOR_DYNAMIC(1),nw) {
+            for(long t=ff_start_idx;t<ff_stop_idx;++t) 
+                tiles.for2d(t, [&](const long i, const long j) { body(i, j, var); });
+        } FF_PARFORREDUCE_F_STOP(this, var, finalreduce);
+    }
+    /**
+     * \brief Parallel reduce over a 3D iteration space - tiled, dynamic
+     *
+     * As parallel_reduce_2d with three nested loops, 
+     * \p body is <b>body(const long i, const long j, const long k, T& var)</b>.
+     */
+    template <typename Function, typename FReduction>
+    inline void parallel_reduce_3d(T& var, const T& identity,
+                                   long first0, long last0, long first1, long last1,
+                                   long first2, long last2,
+                                   const Function& body, const FReduction& finalreduce,
+                                   long tile0=0, long tile1=0, long tile2=0, 
+                                   const long nw=FF_AUTO) {
+        const long first[3] = {first0, first1, first2}, last[3] = {last0, last1, last2};
+        const long tile[3]  = {tile0, tile1, tile2};
+        const forall_tiles tiles(first, last, tile, 3, (nw<=0) ? this->getNWorkers() : (size_t)nw);
+        if (tiles.ntiles() == 0) return;
+        FF_PARFORREDUCE_START_IDX(this, var, identity, idx,0,tiles.ntiles(),1,PARFOR_DYNAMIC(1),nw) {
+            for(long t=ff_start_idx;t<ff_stop_idx;++t) 
+                tiles.for3d(t, [&](const long i, const long j, const long k) { body(i, j, k, var); });
+        } FF_PARFORREDUCE_F_STOP(this, var, finalreduce);
+    }
     
 };
 
 
+/*!
+  * \class ParallelForScan
+  *  \ingroup high_level_patterns
+  *
+  * \brief Parallel prefix scan. Run automatically.
+  *
+  * Computes the inclusive or exclusive prefix scan of a range of values
+  * with an associative operation \p op (not necessarily commutative), 
+  * using the same Worker threads and barrier of ParallelForReduce.
+  *
+  * The range is divided in one block per Worker and it is scanned in two
+  * parallel passes: in the first one each Worker reduces its block, then the
+  * reductions of the blocks are scanned sequentially, in the second pass each
+  * Worker scans its block starting from the reduction of the blocks before it.
+  * The input is read twice and the output is written once, block i is handled
+  * by the same Worker in both passes.
+  *
+  * Example (stream compaction):
+  * \code
+  *   ParallelForScan<long> pfs;
+  *   long n = pfs.parallel_scan(0, N, 0L, 
+  *                    [&](const long i) { return long(pred(A[i])); },
+  *                    [](const long a, const long b) { return a+b; },
+  *                    [&](const long i, const long pos) { if (pred(A[i])) B[pos] = A[i]; });
+  * \endcode
+  *
+  * \tparam T type of the values scanned
+  */
+template<typename T>
+class ParallelForScan: public ff_forall_farm<forallreduce_W<T> > {
+protected:
+    // bounds of block b of nb blocks of (first,last(
+    static inline void block(const long first, const long last, const long b, const long nb,
+                             long &start, long &stop) {
+        const long n = last-first, q = n/nb, r = n%nb;
+        start = first + b*q + (std::min)(b, r);
+        stop  = start + q + (b<r ? 1 : 0);
+    }
+public:
+    /**
+     * @brief Constructor
+     * @param maxnw Maximum number of worker threads
+     * @param spinwait \p true for noblocking support (the Worker threads do 
+     * not suspend between the two passes and between successive scans),
+     * \p false blocking support
+     * @param spinbarrier \p true it uses a spinning barrier
+     */
+    explicit ParallelForScan(const long maxnw=FF_AUTO, bool spinwait=false, bool spinbarrier=false):
+        ff_forall_farm<forallreduce_W<T> >(maxnw,spinwait,false,spinbarrier) {}
+
+    ~ParallelForScan() {
+        ff_forall_farm<forallreduce_W<T> >::stop();
+        ff_forall_farm<forallreduce_W<T> >::wait();
+    }
+
+    // It puts all spinning threads to sleep. It does not disable the spinWait flag
+    // so at the next call, threads start spinning again.
+    inline int threadPause() {
+        return ff_forall_farm<forallreduce_W<T> >::stopSpinning();
+    }
+
+    /**
+     * \brief Parallel scan (general form)
+     *
+     * For each index i in (first,last( it calls <b>out(i, s)</b> where s is
+     * <b>in(first) op ... op in(i)</b> if \p inclusive is true, 
+     * <b>identity op in(first) op ... op in(i-1)</b> otherwise.
+     * \p in(i) is called twice for each index, and it is called before
+     * \p out(i, s), so the input and the output may be the same array.
+     *
+     * \param identity identity value of \p op
+     * \param in <b>T in(const long i)</b> the i-th value of the range
+     * \param op <b>T op(const T&, const T&)</b> associative operation
+     * \param out <b>void out(const long i, const T& s)</b> 
+     * \param inclusive inclusive or exclusive scan
+     * \param nw number of worker threads
+     * \return the reduction of the whole range
+     */
+    template <typename Fin, typename Op, typename Fout>
+    inline T parallel_scan(long first, long last, const T& identity,
+                           const Fin& in, const Op& op, const Fout& out,
+                           const bool inclusive=false, const long nw=FF_AUTO) {
+        const long n = last-first;
+        if (n<=0) return identity;
+        long nb = (nw<=0) ? (long)this->getNWorkers() : (std::min)(nw, (long)this->getNWorkers());
+        // no less than FF_PARFOR_SCAN_BLOCK values per block
+        nb = (std::max)(1L, (std::min)(nb, n/FF_PARFOR_SCAN_BLOCK));
+        partial.assign(nb, identity);
+
+        { // first pass: reduction of each block
+            FF_PARFOR_T_START(this, T, b, 0, nb, 1, PARFOR_STATIC(0), nb) {
+                long start, stop;
+                block(first, last, b, nb, start, stop);
+                T s = identity;
+                for(long i=start;i<stop;++i) s = op(s, in(i));
+                partial[b] = s;
+            } FF_PARFOR_T_STOP(this, T);
+        }
+
+        // exclusive scan of the reductions of the blocks
+        T total = identity;
+        for(long b=0;b<nb;++b) {
+            const T s = partial[b];
+            partial[b] = total;
+            total = op(total, s);
+        }
+
+        { // second pass: scan of each block
+            FF_PARFOR_T_START(this, T, b, 0, nb, 1, PARFOR_STATIC(0), nb) {
+                long start, stop;
+                block(first, last, b, nb, start, stop);
+                T s = partial[b];
+                if (inclusive) {
+                    for(long i=start;i<stop;++i) {
+                        s = op(s, in(i));
+                        out(i, s);
+                    }
+                } else {
+                    for(long i=start;i<stop;++i) {
+                        const T v = in(i);
+                        out(i, s);
+                        s = op(s, v);
+                    }
+                }
+            } FF_PARFOR_T_STOP(this, T);
+        }
+        return total;
+    }
+
+    /**
+     * \brief Inclusive scan of the array \p in of \p n values into \p out
+     * (\p out may be equal to \p in)
+     *
+     * \return the reduction of the whole array
+     */
+    template <typename Op>
+    inline T inclusive_scan(const T *in, T *out, long n, const T& identity, const Op& op,
+                            const long nw=FF_AUTO) {
+        return parallel_scan(0, n, identity,
+                             [in](const long i) -> const T& { return in[i]; }, op,
+                             [out](const long i, const T& s) { out[i] = s; }, true, nw);
+    }
+    /**
+     * \brief Exclusive scan of the array \p in of \p n values into \p out
+     * (\p out may be equal to \p in), out[0] is \p identity
+     *
+     * \return the reduction of the whole array
+     */
+    template <typename Op>
+    inline T exclusive_scan(const T *in, T *out, long n, const T& identity, const Op& op,
+                            const long nw=FF_AUTO) {
+        return parallel_scan(0, n, identity,
+                             [in](const long i) -> const T& { return in[i]; }, op,
+                             [out](const long i, const T& s) { out[i] = s; }, false, nw);
+    }
+
+protected:
+    std::vector<T> partial;   // reductions of the blocks
+};
+
 //#ifndef WIN32 //VS12
 
 //! ParallelForPipeReduce class
@@ -61,11 +61,13 @@
 #include <deque>
 #include <vector>
 #include <cmath>
+#include <climits>
 #include <functional>
 #include <ff/lb.hpp>
 #include <ff/node.hpp>
 #include <ff/farm.hpp>
 #include <ff/spin-lock.hpp>
+#include <ff/parking.hpp>
 
 enum {FF_AUTO=-1};
 
@@ -292,6 +294,16 @@ namespace ff {
         for(long idx=ff_start_##idx;idx<ff_stop_##idx;idx+=step) 
 
 
+// as FF_PARFOR_T_START with a given scheduling policy (see parfor_schedule_t)
+#define FF_PARFOR_T_START_SCHED(name, type, idx, begin, end, step, chunk, sched, nw)     \
+    name->setloop(begin,end,step,chunk,nw,sched);                                        \
+    auto F_##name = [&] (const long ff_start_##idx, const long ff_stop_##idx,            \
+                         const int _ff_thread_id, const type&) {                         \
+        FF_IGNORE_UNUSED(_ff_thread_id);                                                 \
+        PRAGMA_IVDEP;                                                                    \
+        for(long idx=ff_start_##idx;idx<ff_stop_##idx;idx+=step) 
+
+
 // just another variat that may be used together with FF_PARFORREDUCE_INIT
 #define FF_PARFOR_T_START_STATIC(name, type, idx, begin, end, step, chunk, nw)           \
     assert(chunk<=0);                                                                    \
@@ -343,6 +355,15 @@ namespace ff {
         PRAGMA_IVDEP                                                                     \
         for(long idx=ff_start_##idx;idx<ff_stop_##idx;idx+=step) 
 
+#define FF_PARFORREDUCE_START_SCHED(name, var,identity, idx,begin,end,step, chunk, sched, nw) \
+    name->setloop(begin,end,step,chunk,nw,sched);                                        \
+    auto idtt_##name =identity;                                                          \
+    auto F_##name =[&](const long ff_start_##idx, const long ff_stop_##idx,              \
+                       const int _ff_thread_id, decltype(var) &var) {                    \
+        FF_IGNORE_UNUSED(_ff_thread_id);                                                 \
+        PRAGMA_IVDEP                                                                     \
+        for(long idx=ff_start_##idx;idx<ff_stop_##idx;idx+=step) 
+
 #define FF_PARFORREDUCE_START_IDX(name, var,identity, idx,begin,end,step, chunk, nw)     \
     name->setloop(begin,end,step,chunk,nw);                                              \
     auto idtt_##name =identity;                                                          \
@@ -408,6 +429,32 @@ namespace ff {
 #define PARFOR_STATIC(X)   (X>0?-X:X)
 #define PARFOR_DYNAMIC(X)  (X<0?-X:X)
 
+// Scheduling policy of the chunks of iterations, given to setloop together
+// with the chunk value:
+//  - PARFOR_SCHED_DEFAULT  the policy is selected by the chunk value (see setloop)
+//  - PARFOR_SCHED_GUIDED   dynamic scheduling with decreasing chunks: a worker takes
+//                          half of the iterations left in a range, and no less than
+//                          chunk iterations
+//  - PARFOR_SCHED_ADAPTIVE dynamic scheduling with chunks sized on the measured cost of
+//                          the iterations, so that each chunk lasts about
+//                          FF_PARFOR_CHUNK_TICKS, and no more than the guided chunk
+// With the guided and adaptive policies chunk>0 is the minimum grain (1 if chunk<=0)
+// and the chunks are taken by the workers, the scheduler thread is not started.
+enum parfor_schedule_t { PARFOR_SCHED_DEFAULT=0, PARFOR_SCHED_GUIDED, PARFOR_SCHED_ADAPTIVE };
+
+// Stealing policy of the workers that have no more iterations in their own range
+// (dynamic scheduling without the scheduler thread), selected with setStealing:
+//  - PARFOR_STEAL_DEFAULT      the victim is the worker with the most chunks left, found
+//                              with a scan of all the workers and shared by all the
+//                              thieves; one chunk at a time is taken from it, or half of
+//                              its chunks if PARFOR_MULTIPLE_TASKS_STEALING is defined
+//  - PARFOR_STEAL_RANDOM       each thief looks for a victim starting from a random worker
+//                              and takes half of its chunks
+//  - PARFOR_STEAL_HIERARCHICAL as PARFOR_STEAL_RANDOM, but the workers running on the same
+//                              NUMA node of the thief are tried first
+// With the random and hierarchical policies the scheduler thread is not started.
+enum parfor_steal_t { PARFOR_STEAL_DEFAULT=0, PARFOR_STEAL_RANDOM, PARFOR_STEAL_HIERARCHICAL };
+
     /* ------------------------------------------------------------------- */
 
 
@@ -426,6 +473,10 @@ struct forall_task_t {
     }
     void set(long s, long e)  { start=s,end=e; }
 
+    // start of a range being rewritten by its owner, it is not less than any end
+    // so that the range looks empty to the other workers
+    static constexpr long busy = LONG_MAX;
+
     std::atomic_long start;
     long             end;
 };
@@ -444,6 +495,108 @@ struct dataPair {
     dataPair& operator=(const dataPair &d) { ntask=d.ntask.load(std::memory_order_relaxed), task=d.task; return *this; }
 };
 
+// The iteration space of a collapsed 2D/3D loop divided in tiles, i.e. rectangular
+// blocks of iterations. The tiles are numbered in row-major order and they are 
+// scheduled as the iterations of a 1D loop (0,ntiles().
+// If the shape of the tiles is not given (tile[d]<=0) it is derived from the size of
+// the L2 cache and FF_PARFOR_TILE_BYTES, the tiles are then split along the outer
+// dimensions until there are at least 4 tiles per worker.
+struct forall_tiles {
+    forall_tiles(const long *_first, const long *_last, const long *_tile, 
+                 const int ndim, const size_t nw) {
+        long ext[3];
+        bool automatic = false;
+        for(int d=0;d<3;++d) {
+            first[d] = (d<ndim) ? _first[d] : 0;
+            last[d]  = (d<ndim) ? _last[d]  : 1;
+            ext[d]   = (std::max)(last[d]-first[d], 0L);
+            tile[d]  = (d<ndim) ? _tile[d]  : 1;
+            if (tile[d]<=0) automatic = true;
+        }
+        if (automatic) {
+            static const size_t l2 = cache_size(2);
+            const long elems = (long)((l2 ? l2 : 256*1024)/2/FF_PARFOR_TILE_BYTES);
+            // the innermost dimension is the one walked contiguously
+            if (ndim == 2) {
+                const long t = std::lrint(std::sqrt((double)elems));
+                tile[1] = (std::min)(ext[1], t);
+                tile[0] = elems / (std::max)(tile[1], 1L);
+            } else {
+                const long t = std::lrint(std::cbrt((double)elems));
+                tile[2] = (std::min)(ext[2], t);
+                tile[1] = (std::min)(ext[1], std::lrint(std::sqrt(double(elems / (std::max)(tile[2], 1L)))));
+                tile[0] = elems / ((std::max)(tile[1], 1L)*(std::max)(tile[2], 1L));
+            }
+        }
+        for(int d=0;d<3;++d) {
+            tile[d] = (std::max)((std::min)(tile[d], ext[d]), 1L);
+            n[d]    = (ext[d] + tile[d] - 1) / tile[d];
+        }
+        if (automatic) {
+            // enough tiles to balance the load
+            for(int d=0; d<ndim && ntiles() && ntiles() < 4*(long)nw; ) {
+                if (tile[d] == 1) { ++d; continue; }
+                tile[d] = (tile[d]+1) / 2;
+                n[d]    = (ext[d] + tile[d] - 1) / tile[d];
+            }
+        }
+    }
+    inline long ntiles() const { return n[0]*n[1]*n[2]; }
+
+    // bounds (lo,hi( of the tile t
+    inline void bounds(long t, long *lo, long *hi) const {
+        for(int d=2;d>=0;--d) {
+            const long k = t % n[d];
+            t /= n[d];
+            lo[d] = first[d] + k*tile[d];
+            hi[d] = (std::min)(lo[d]+tile[d], last[d]);
+        }
+    }
+    // calls f(i,j) for each iteration of the tile t
+    template<typename Function>
+    inline void for2d(const long t, const Function& f) const {
+        long lo[3], hi[3];
+        bounds(t, lo, hi);
+        for(long i=lo[0];i<hi[0];++i)
+            for(long j=lo[1];j<hi[1];++j) f(i,j);
+    }
+    // calls f(i,j,k) for each iteration of the tile t
+    template<typename Function>
+    inline void for3d(const long t, const Function& f) const {
+        long lo[3], hi[3];
+        bounds(t, lo, hi);
+        for(long i=lo[0];i<hi[0];++i)
+            for(long j=lo[1];j<hi[1];++j) 
+                for(long k=lo[2];k<hi[2];++k) f(i,j,k);
+    }
+
+    long first[3], last[3];
+    long tile[3];   // shape of the tiles
+    long n[3];      // n. of tiles in each dimension
+};
+
+// cost of the iterations measured by a worker (adaptive scheduling)
+struct chunkCost {
+    ALIGN_TO_PRE(CACHE_LINE_SIZE)
+    ticks  t0;      // when the last chunk has been taken
+    long   niter;   // n. of iterations of the last chunk
+    double cost;    // ticks per iteration, 0 if not measured yet
+    ALIGN_TO_POST(CACHE_LINE_SIZE)
+    chunkCost():t0(0),niter(0),cost(0.0) {}
+};
+
+// state of a worker when it steals (random and hierarchical stealing)
+struct stealState {
+    ALIGN_TO_PRE(CACHE_LINE_SIZE)
+    unsigned long    seed;  // xorshift state, written only by the worker
+    std::atomic_long node;  // NUMA node of the worker, -2 if not known yet
+    ALIGN_TO_POST(CACHE_LINE_SIZE)
+    stealState():seed(0) { node.store(-2); }
+    stealState(const stealState &s):seed(s.seed) {
+        node.store(s.node.load(std::memory_order_relaxed));
+    }
+};
+
 // compare functiong
 static inline bool data_cmp(const dataPair &a,const dataPair &b) {
     return a.ntask < b.ntask;
@@ -479,10 +632,15 @@ protected:
         
         data.resize(_nw); eossent.resize(_nw);
         taskv.resize(8*_nw); // 8 is the maximum n. of jumps, see the heuristic below
+        costs.assign(_nw, chunkCost());
+        if (thieves.size() < _nw) thieves.resize(_nw);
+        for(size_t i=0;i<_nw;++i)
+            if (!thieves[i].seed) thieves[i].seed = 0x9E3779B97F4A7C15UL*(i+1);
         skip1=false,jump=0,maxid=-1;
 
         ssize_t end, t=0, e;
-        for(size_t i=0;i<_nw && totalnumtasks>0;++i, totalnumtasks-=t) {
+        size_t i=0;
+        for(;i<_nw && totalnumtasks>0;++i, totalnumtasks-=t) {
             t       = ntxw + ( (r>1 && (i<r)) ? 1 : 0 );
             e       = start + (t*_chunk - 1)*_step + 1;
             end     = (e<stop) ? e : stop;
@@ -490,6 +648,12 @@ protected:
             data[i].task.set(start,end);
             start   = (end-1)+_step;
         }
+        // the workers always look at their own range, the ones of the previous
+        // loop have to be emptied
+        for(;i<_nw;++i) {
+            data[i].ntask=0;
+            data[i].task.set(stop,stop);
+        }
 
         if (totalnumtasks) {
             assert(totalnumtasks==1);
@@ -541,7 +705,11 @@ protected:
 
         for(size_t i=0;i<ntxw;++i) {
             data[i].ntask = 1;
-            data[i].task.set(start+long(i)*chunk,stop);                        
+            data[i].task.set(start+long(i)*chunk*_step,stop);                        
+        }
+        for(size_t i=ntxw;i<data.size();++i) {
+            data[i].ntask = 0;
+            data[i].task.set(stop,stop);
         }
         // printf("init_data_static\n");
         // for(size_t i=0;i<_nw;++i) {
@@ -556,7 +724,8 @@ protected:
 public:
     forall_Scheduler(ff_loadbalancer* lb, long start, long stop, long step, long chunk, size_t nw):
         lb(lb),_start(start),_stop(stop),_step(step),_chunk(chunk),totaltasks(0),_nw(nw),
-        jump(0),skip1(false),workersspinwait(false),static_scheduling(false) {
+        jump(0),skip1(false),workersspinwait(false),static_scheduling(false),
+        _sched(PARFOR_SCHED_DEFAULT),_steal(PARFOR_STEAL_DEFAULT) {
 #ifdef FF_PARFOR_PASSIVE_NOSTEALING
         _nextIteration = _start;
 #endif
@@ -567,7 +736,8 @@ public:
     }
     forall_Scheduler(ff_loadbalancer* lb, size_t nw):
         lb(lb),_start(0),_stop(0),_step(1),_chunk(1),totaltasks(0),_nw(nw),
-        jump(0),skip1(false),workersspinwait(false),static_scheduling(false) {
+        jump(0),skip1(false),workersspinwait(false),static_scheduling(false),
+        _sched(PARFOR_SCHED_DEFAULT),_steal(PARFOR_STEAL_DEFAULT) {
 #ifdef FF_PARFOR_PASSIVE_NOSTEALING
         _nextIteration = 0;
 #endif
@@ -578,9 +748,95 @@ public:
 
 #ifdef FF_PARFOR_PASSIVE_NOSTEALING
     inline bool canUseNoStealing(){
-        return !globalSchedRunning && !static_scheduling && _step == 1 && _chunk == 1;
+        return !globalSchedRunning && !static_scheduling && _step == 1 && _chunk == 1 &&
+            _sched == PARFOR_SCHED_DEFAULT && _steal == PARFOR_STEAL_DEFAULT;
     }
 #endif
+    // n. of chunks of _chunk iterations that the worker wid takes from the range
+    // (start,end( according to the scheduling policy
+    inline long nchunks(const long start, const long end, const int wid) const {
+        if (_sched == PARFOR_SCHED_DEFAULT) return 1;
+        const long n = (end-start + _chunk*_step - 1) / (_chunk*_step);
+        long k = n >> 1;
+        if (_sched == PARFOR_SCHED_ADAPTIVE) {
+            // the first chunk is used to measure the cost of the iterations
+            const double c = costs[wid].cost;
+            const long   a = (c>0.0) ? (long)(FF_PARFOR_CHUNK_TICKS / (c*_chunk)) : 1;
+            if (a < k) k = a;
+        }
+        return (k>1) ? k : 1;
+    }
+    // adaptive scheduling: the time elapsed since the worker wid took its last chunk 
+    // is the time spent computing it
+    inline void measure(const int wid) {
+        chunkCost &c = costs[wid];
+        if (c.niter>0) {
+            const double t = double(getticks()-c.t0) / c.niter;
+            c.cost  = (c.cost>0.0) ? 0.75*c.cost + 0.25*t : t;
+            c.niter = 0;
+        }
+    }
+    inline void taken(const long start, const long end, const int wid) {
+        chunkCost &c = costs[wid];
+        c.niter = (end-start + _step - 1) / _step;
+        c.t0    = getticks();
+    }
+
+    // victim of the thief wid (random and hierarchical stealing): the first worker with
+    // chunks left starting from a random one, -1 if there are none
+    inline long victim(const int wid) {
+        stealState &s = thieves[wid];
+        const long  n = (long)data.size();
+        s.seed ^= s.seed << 13, s.seed ^= s.seed >> 7, s.seed ^= s.seed << 17;
+        const long  r = (long)(s.seed % (unsigned long)n);
+        if (_steal == PARFOR_STEAL_HIERARCHICAL) {
+            const long node = s.node.load(std::memory_order_relaxed);
+            for(long i=0;i<n;++i) {
+                const long v = (r+i<n) ? r+i : r+i-n;
+                if (v != wid && data[v].ntask.load(std::memory_order_relaxed)>0 &&
+                    thieves[v].node.load(std::memory_order_relaxed) == node) return v;
+            }
+        }
+        for(long i=0;i<n;++i) {
+            const long v = (r+i<n) ? r+i : r+i-n;
+            if (v != wid && data[v].ntask.load(std::memory_order_relaxed)>0) return v;
+        }
+        return -1;
+    }
+    // The thief wid tries to move the first half of the chunks left to the worker v 
+    // in its own range, the split point respects the step. It returns 1 on success, 
+    // 0 if the range of v has been changed concurrently, -1 if v has no more than
+    // minq chunks left (or if its range is being rewritten).
+    inline int stealHalf(const int wid, const long v, const long minq) {
+        long oldstart, end;
+        if (!loadRange(v, oldstart, end)) return -1;
+        const long n  = ((end-oldstart + _step-1)/_step + _chunk-1) / _chunk;
+        const long q  = n >> 1;
+        if (q <= minq) return -1;
+        const long newstart = oldstart + q*_chunk*_step;
+        if (!data[v].task.start.compare_exchange_weak(oldstart, newstart,
+                                                      std::memory_order_acq_rel,
+                                                      std::memory_order_relaxed))
+            return 0;
+        data[v].ntask.fetch_sub(q, std::memory_order_release);
+        // The range of wid is empty, nobody else changes it. It is marked busy before
+        // the end is rewritten and the real start is published last: who reads the new
+        // end fails the CAS on the old start, who reads the new start sees the new end.
+        data[wid].task.start.store(forall_task_t::busy, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+        data[wid].task.end = newstart - _step + 1;
+        data[wid].ntask.store(q, std::memory_order_relaxed);
+        data[wid].task.start.store(oldstart, std::memory_order_release);
+        return 1;
+    }
+    // reads the range (start,end( of the worker id, false if it is empty or busy
+    inline bool loadRange(const long id, long &start, long &end) {
+        start = data[id].task.start.load(std::memory_order_acquire);
+        end   = data[id].task.end;
+        std::atomic_thread_fence(std::memory_order_acquire);
+        return start < end;
+    }
+
     inline bool sendTask(const bool skipmore=false) {
 #ifdef FF_PARFOR_PASSIVE_NOSTEALING
         if(canUseNoStealing()){
@@ -592,16 +848,17 @@ public:
         }
 #endif
         size_t remaining    = totaltasks;
-        const long endchunk = (_chunk-1)*_step + 1;
 
     more:
         for(size_t wid=0;wid<_nw;++wid) {
             if (data[wid].ntask >0) {
                 long start = data[wid].task.start;
-                long end   = (std::min)(start+endchunk, data[wid].task.end);
+                long k     = nchunks(start, data[wid].task.end, (int)wid);
+                long end   = (std::min)(start+(k*_chunk-1)*_step + 1, data[wid].task.end);
                 taskv[wid+jump].set(start, end);
                 lb->ff_send_out_to(&taskv[wid+jump], (int) wid);
-                --remaining, --data[wid].ntask;
+                if (_sched == PARFOR_SCHED_ADAPTIVE) taken(start, end, (int)wid);
+                --remaining, data[wid].ntask -= k;
                 (data[wid].task).start = (end-1)+_step;  
                 eossent[wid]=false;
             } else  skip1=true; //skip2=skip3=true;
@@ -647,31 +904,54 @@ public:
         }
 #endif
         const long endchunk = (_chunk-1)*_step + 1; // next end-point
+        const bool adaptive = (_sched == PARFOR_SCHED_ADAPTIVE);
         auto id  = wid;
+        if (adaptive) measure(wid);
+        if (_steal == PARFOR_STEAL_HIERARCHICAL && thieves[wid].node.load(std::memory_order_relaxed) == -2)
+            thieves[wid].node.store(ff_getMyNumaNode(), std::memory_order_relaxed);
     L1:
-        if (data[id].ntask.load(std::memory_order_acquire)>0) {
-            auto oldstart = data[id].task.start.load(std::memory_order_relaxed);
-            auto end      = (std::min)(oldstart+endchunk, data[id].task.end);
-            auto newstart = (end-1)+_step;
-            
-            if (!data[id].task.start.compare_exchange_weak(oldstart, newstart,
-                                                           std::memory_order_release,
-                                                           std::memory_order_relaxed)) {
-                workerlosetime_in(_nw <= lb->getnworkers());
-                goto L1; // restart the sequence from the beginning
-            }
-            
-            // after fetch_sub ntask may be less than 0
-            data[id].ntask.fetch_sub(1,std::memory_order_release);   
-            if (oldstart<end) { // it might be possible that oldstart == end
-                task->set(oldstart, end); 
+        // ntask is only a hint for the thieves, a worker always looks at its own range
+        if (id == wid || data[id].ntask.load(std::memory_order_acquire)>0) {
+            long oldstart, e;
+            if (loadRange(id, oldstart, e)) {
+                long k        = 1;
+                if (_sched != PARFOR_SCHED_DEFAULT) k = nchunks(oldstart, e, wid);
+                auto end      = (std::min)(oldstart+endchunk+(k-1)*_chunk*_step, e);
+                auto newstart = (end-1)+_step;
+
+                if (!data[id].task.start.compare_exchange_weak(oldstart, newstart,
+                                                               std::memory_order_acq_rel,
+                                                               std::memory_order_relaxed)) {
+                    workerlosetime_in(_nw <= lb->getnworkers());
+                    goto L1; // restart the sequence from the beginning
+                }
+                // after fetch_sub ntask may be less than 0
+                data[id].ntask.fetch_sub(k,std::memory_order_release);
+                task->set(oldstart, end);
+                if (adaptive) taken(oldstart, end, wid);
                 return true;
             }
+            // empty range, the hint is drained (a busy range is being refilled)
+            if (oldstart != forall_task_t::busy && data[id].ntask.load(std::memory_order_relaxed)>0)
+                data[id].ntask.fetch_sub(1,std::memory_order_release);
         }
 
         // no available task for the current thread
         if (static_scheduling) return false;      // <------------------------------------
 
+        if (_steal != PARFOR_STEAL_DEFAULT) {
+            // each thief has its own victim, so that the thieves do not contend 
+            // all on the same range
+            long v;
+        L3:
+            if ((v = victim(wid)) < 0) return false;
+            switch(stealHalf(wid, v, 1)) {
+            case  1: id = wid; goto L1;
+            case  0: workerlosetime_in(_nw <= lb->getnworkers()); goto L3;
+            default: id = (int)v; goto L1;  // too few chunks, just one is taken
+            }
+        }
+
 #if !defined(PARFOR_MULTIPLE_TASKS_STEALING)
         // the following scheduling policy for the tasks focuses mostly to load-balancing
         long _maxid = 0, ntask = 0;
@@ -702,25 +982,13 @@ public:
             if (ntask<=3) { id = _maxid; goto L1; }
             
             // try to steal half of the tasks remaining to _maxid
-
-            auto oldstart = data[_maxid].task.start.load(std::memory_order_relaxed);
-            auto q = ((data[_maxid].task.end-oldstart)/_chunk) >> 1;
-            if (q<=3) { id = _maxid; goto L1; }
-            auto newstart = oldstart + (q*_chunk-1)*_step +1;
-            if (!data[_maxid].task.start.compare_exchange_weak(oldstart, newstart,
-                                                               std::memory_order_release,
-                                                               std::memory_order_relaxed)) {
+            switch(stealHalf(wid, _maxid, 3)) {
+            case  1: id = wid; goto L1;
+            case  0: 
                 workerlosetime_in(_nw <= lb->getnworkers());
                 goto L2; // restart the sequence from the beginning
+            default: id = _maxid; goto L1;
             }
-            assert(newstart <= data[_maxid].task.end);
-            
-            data[_maxid].ntask.fetch_sub(q, std::memory_order_release);            
-            data[wid].task.start.store(oldstart, std::memory_order_relaxed);
-            data[wid].task.end = newstart;
-            data[wid].ntask.store(q, std::memory_order_release);
-            id = wid;
-            goto L1;
         }
 #endif
         return false; 
@@ -776,8 +1044,8 @@ public:
             data[id].ntask  = q;
             data[wid].ntask = q+r;
             data[wid].task.end   = data[id].task.end;
-            data[id].task.end    = data[id].task.start + (q*_chunk-1)*_step +1;
-            data[wid].task.start = data[id].task.end;
+            data[wid].task.start = data[id].task.start + q*_chunk*_step;
+            data[id].task.end    = data[wid].task.start - _step + 1;
             id = wid;
             goto L1;
         } else if (!flag) goto L2;
@@ -810,8 +1078,11 @@ public:
         return GO_ON;
     }
 
-    inline void setloop(long start, long stop, long step, long chunk, size_t nw) {
-        _start=start, _stop=stop, _step=step, _chunk=chunk, _nw=nw;
+    inline void setloop(long start, long stop, long step, long chunk, size_t nw,
+                        parfor_schedule_t sched=PARFOR_SCHED_DEFAULT) {
+        // with the guided and adaptive policies chunk is the minimum grain
+        if (sched != PARFOR_SCHED_DEFAULT && chunk<=0) chunk = 1;
+        _start=start, _stop=stop, _step=step, _chunk=chunk, _nw=nw, _sched=sched;
         
 #ifdef FF_PARFOR_PASSIVE_NOSTEALING
         _nextIteration = _start;
@@ -831,6 +1102,9 @@ public:
     inline size_t running() const { return _nw; }
     inline void workersSpinWait() { workersspinwait=true;}
     inline size_t getnumtasks() const { return totaltasks;}
+    inline parfor_schedule_t schedule() const { return _sched; }
+    inline void setStealing(parfor_steal_t policy) { _steal = policy; }
+    inline parfor_steal_t stealing() const { return _steal; }
 protected:
     // the following fields are used only by the scheduler thread
     ff_loadbalancer *lb;
@@ -842,7 +1116,11 @@ protected:
     bool             skip1;
     bool             workersspinwait;
     bool             static_scheduling;
+    parfor_schedule_t _sched;             // chunk scheduling policy
+    parfor_steal_t   _steal;              // stealing policy
     std::vector<forall_task_t> taskv;
+    std::vector<chunkCost>     costs;     // written only by the worker thread
+    std::vector<stealState>    thieves;
 };
 
 // parallel for/reduce  worker node
@@ -953,6 +1231,133 @@ public:
 
 
 
+/*
+ * Hot loops (see ff_forall_farm::hotloop).
+ *
+ * The workers do not leave the svc method between one loop and the next one:
+ * they wait for a new loop on the generation counter gen, spinning for
+ * FF_HOTLOOP_SPIN_TICKS and then parking on a futex. A loop is published by
+ * writing its bounds and incrementing gen, no message goes through the farm.
+ * The end of the loop is detected with a sense-reversing barrier: the last
+ * worker that completes its iterations flips sense, which is where the thread
+ * that has published the loop waits (again spinning and then parking).
+ * All the resident workers take part in the barrier, also the ones that have
+ * no iterations, so the descriptor of the loop can be overwritten as soon as
+ * the barrier is passed.
+ */
+class forall_hotloop {
+public:
+    typedef void (*call_t)(const void *f, const long start, const long stop, const long step);
+
+    forall_hotloop():base(0),nres(0),first(0),last(0),step(1),chunk(0),nw(0),
+                     exit(false),f(nullptr),call(nullptr) {
+        gen.store(0); sleepers.store(0); next.store(0);
+        count.store(0); sense.store(0); parked.store(0);
+    }
+
+    // to be called before starting the n resident workers
+    inline void reset(const long n) {
+        base = gen.load(std::memory_order_relaxed);
+        nres = n, exit = false;
+    }
+    inline long resident() const { return nres; }
+
+    // body of the resident worker wid
+    inline void worker(const long wid, const bool aggressive) {
+        uint32_t seen = base;
+        for(;;) {
+            ticks t0 = getticks();
+            while(gen.load(std::memory_order_acquire) == seen) {
+                // with more threads than cores spinning only delays the other threads
+                if (aggressive && (getticks()-t0) < (ticks)FF_HOTLOOP_SPIN_TICKS) {
+                    PAUSE();
+                    continue;
+                }
+                sleepers.fetch_add(1);
+                if (gen.load() == seen) ff_futex_wait(&gen, seen, FF_TIMEDWAIT_NS);
+                sleepers.fetch_sub(1);
+            }
+            seen = gen.load(std::memory_order_acquire);
+            if (exit) return;
+
+            if (wid < nw) {
+                if (chunk>0) {
+                    const long c = chunk*step;
+                    for(long s=next.fetch_add(c, std::memory_order_relaxed); s<last;
+                        s=next.fetch_add(c, std::memory_order_relaxed))
+                        call(f, s, (std::min)(s+c, last), step);
+                } else {
+                    const long n = (last-first+step-1)/step, q = n/nw, r = n%nw;
+                    const long s = first + (wid*q + (std::min)(wid, r))*step;
+                    call(f, s, (std::min)(s + (q + (wid<r ? 1 : 0))*step, last), step);
+                }
+            }
+            if (count.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+                sense.fetch_xor(1);
+                if (parked.load()) ff_futex_wake(&sense);
+            }
+        }
+    }
+
+    // runs the loop on the first _nw resident workers and waits for its end
+    template<typename Function>
+    inline void run(const long _first, const long _last, const long _step, const long _chunk,
+                    const Function &F, const long _nw, const bool aggressive) {
+        if (_first >= _last) return;
+        first = _first, last = _last, step = _step, chunk = _chunk, nw = _nw;
+        f = &F, call = &callfor<Function>;
+        next.store(first, std::memory_order_relaxed);
+        count.store(nres, std::memory_order_relaxed);
+        const uint32_t s = sense.load(std::memory_order_relaxed);
+        // publishing the loop
+        gen.fetch_add(1);
+        if (sleepers.load()) ff_futex_wake_all(&gen);
+
+        ticks t0 = getticks();
+        while(sense.load(std::memory_order_acquire) == s) {
+            if (aggressive && (getticks()-t0) < (ticks)FF_HOTLOOP_SPIN_TICKS) {
+                PAUSE();
+                continue;
+            }
+            parked.store(1);
+            if (sense.load() == s) ff_futex_wait(&sense, s, FF_TIMEDWAIT_NS);
+            parked.store(0);
+        }
+    }
+
+    // the resident workers leave the svc method
+    inline void stop() {
+        exit = true;
+        gen.fetch_add(1);
+        ff_futex_wake_all(&gen);
+    }
+
+protected:
+    template<typename Function>
+    static void callfor(const void *f, const long start, const long stop, const long step) {
+        const Function &F = *(const Function*)f;
+        for(long i=start;i<stop;i+=step) F(i);
+    }
+
+    uint32_t    base;                 // gen when the resident workers have been started
+    long        nres;                 // n. of resident workers
+    // the loop, written before gen is incremented
+    long        first, last, step, chunk, nw;
+    bool        exit;
+    const void *f;
+    call_t      call;
+    long padding1[longxCacheLine];
+    std::atomic<uint32_t> gen;        // generation of the last loop published
+    std::atomic<uint32_t> sleepers;   // n. of workers parked on gen
+    long padding2[longxCacheLine-1];
+    std::atomic_long      next;       // next iteration (dynamic scheduling)
+    long padding3[longxCacheLine-1];
+    std::atomic_long      count;      // n. of workers that have not passed the barrier
+    std::atomic<uint32_t> sense;      // flipped by the last worker of the barrier
+    std::atomic<uint32_t> parked;     // the thread waiting on the barrier is parked
+    long padding4[longxCacheLine-2];
+};
+
 template <typename Worker_t>
 class ff_forall_farm: public ff_farm {
 public:
@@ -1075,6 +1480,42 @@ public:
     // ff_numCores() > ff_realNumCores() (i.e. HT or SMT is enabled)
     inline void disableScheduler(bool onoff=true) { removeSched=onoff; }
 
+    // selects the stealing policy of the workers for the next loops (see parfor_steal_t)
+    inline void setStealing(parfor_steal_t policy) {
+        ((forall_Scheduler*)getEmitter())->setStealing(policy);
+    }
+
+    /*
+     * Hot loops: the first call starts all the workers on a resident loop
+     * (see forall_hotloop), then each call just publishes the loop
+     * (first,last( with the given step on the first nw workers and waits for
+     * its end. chunk>0 means dynamic scheduling with chunks of chunk iterations,
+     * chunk<=0 static scheduling in contiguous blocks.
+     * The workers leave the resident loop (hotStop) as soon as the farm is used
+     * in any other way (setloop, stopSpinning, stop, wait).
+     */
+    template <typename Function>
+    inline int hotloop(long first, long last, long step, long chunk, const Function& F, long nw) {
+        if (first>=last) return 0;
+        const long n = (long)getNWorkers();
+        if (nw<=0 || nw>n) nw = n;
+        nw = (std::min)(nw, (last-first+step-1)/step);
+        // as for the other loops, a single worker is the calling thread
+        if (nw<=1) {
+            for(long i=first;i<last;i+=step) F(i);
+            return 0;
+        }
+        if (!hotrunning && hotStart()<0) return -1;
+        hot.run(first, last, step, chunk, F, nw, hotaggressive);
+        return 0;
+    }
+    inline int hotStop() {
+        if (!hotrunning) return 0;
+        hotrunning = false;
+        hot.stop();
+        return wait_freezing();
+    }
+
     inline int run_then_freeze(ssize_t nw_=-1) {
         assert(skipwarmup == false);
         const ssize_t nwtostart = (nw_ == -1)?getNWorkers():nw_;
@@ -1123,6 +1564,7 @@ public:
     
     // it puts all threads to sleep but does not disable the spinWait flag
     inline int stopSpinning() {
+        hotStop();
         if (!spinwait) return -1;
         // getnworkers() returns the number of threads that are running
         // it may be different from getnw() (i.e. the n. of threads currently 
@@ -1156,7 +1598,13 @@ public:
         return getlb()->wait_freezingWorkers();
     }
     
+    inline void stop() {
+        hotStop();
+        ff_farm::stop();
+    }
+
     inline int wait() {
+        hotStop();
         if (spinwait){
             const svector<ff_node*> &nodes = getWorkers();
             for(size_t i=0;i<nodes.size();++i) 
@@ -1173,7 +1621,13 @@ public:
         const bool mode = (nw <= numCores);
     
         // NOTE: in case of static scheduling, the scheduler is never started !
-        schedRunning = (!removeSched && startScheduler(nw, ((forall_Scheduler*)getEmitter())->getnumtasks()));
+        //       The same for the guided and adaptive scheduling, where the size of 
+        //       the chunks is decided by the workers, and for the random and 
+        //       hierarchical stealing.
+        const forall_Scheduler *sched = (forall_Scheduler*)getEmitter();
+        schedRunning = (!removeSched && sched->schedule() == PARFOR_SCHED_DEFAULT &&
+                        sched->stealing() == PARFOR_STEAL_DEFAULT &&
+                        startScheduler(nw, sched->getnumtasks()));
 
 #ifdef FF_PARFOR_PASSIVE_NOSTEALING
         globalSchedRunning = schedRunning;
@@ -1204,15 +1658,19 @@ public:
      *                   the iteration space is divided in chunks each one of no more 
      *                   than chunk iterations. Then chunks are assigned to the threads 
      *                   in a round-robin fashion.
+     *       The policy parameter selects the guided or the adaptive dynamic scheduling
+     *       (see parfor_schedule_t), in that case chunk is the minimum grain.
      */
-    inline void setloop(long begin,long end,long step,long chunk,long nw) {
+    inline void setloop(long begin,long end,long step,long chunk,long nw,
+                        parfor_schedule_t policy=PARFOR_SCHED_DEFAULT) {
+        hotStop();
         if (nw>(ssize_t)getNWorkers()) {
             error("The number of threads specified is greater than the number set in the ParallelFor* constructor, it will be downsized\n");
             nw = getNWorkers();
         }
         assert(nw<=(ssize_t)getNWorkers());
         forall_Scheduler *sched = (forall_Scheduler*)getEmitter();
-        sched->setloop(begin,end,step,chunk,(nw<=0)?getNWorkers():(size_t)nw);
+        sched->setloop(begin,end,step,chunk,(nw<=0)?getNWorkers():(size_t)nw,policy);
     }
     // return the number of workers running or supposed to run
     inline size_t getnw() { return ((const forall_Scheduler*)getEmitter())->running(); }
@@ -1227,6 +1685,29 @@ public:
 
     void resetskipwarmup() { assert(skipwarmup); skipwarmup=false;}
 protected:
+    // starts all the workers on the resident loop of the hot loops
+    inline int hotStart() {
+        const long n = (long)getNWorkers();
+        setloop(0, n, 1, PARFOR_STATIC(0), n);  // one iteration per worker
+        hot.reset(n);
+        // the calling thread also spins waiting for the end of the loops
+        hotaggressive = ((size_t)n < numCores);
+        const bool aggressive = hotaggressive;
+        setF([this, aggressive](const long start, const long stop, const int, Tres_t&) {
+                // in spinwait mode the workers are woken up with an empty task
+                if (start<stop) hot.worker(start, aggressive);
+            });
+        if (run_then_freeze(n)<0) {
+            error("ff_forall_farm: starting the hot loops\n");
+            return -1;
+        }
+        hotrunning = true;
+        return 0;
+    }
+
+    forall_hotloop hot;
+    bool   hotrunning  = false;
+    bool   hotaggressive = true;
     bool   removeSched = false;
     bool   schedRunning= true;
     bool   skipwarmup  = false;
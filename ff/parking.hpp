@@ -0,0 +1,187 @@
+/* -*- Mode: C++; tab-width: 4; c-basic-offset: 4; indent-tabs-mode: nil -*- */
+
+/*!
+ * \file parking.hpp
+ * \ingroup building_blocks
+ *
+ * \brief Adaptive spin-then-park waiting (see ff_backoff_park)
+ *
+ */
+
+#ifndef FF_PARKING_HPP
+#define FF_PARKING_HPP
+
+/* ***************************************************************************
+ *
+ *  FastFlow is free software; you can redistribute it and/or modify it
+ *  under the terms of the GNU Lesser General Public License version 3 as
+ *  published by the Free Software Foundation.
+ *  Starting from version 3.0.1 FastFlow is dual licensed under the GNU LGPLv3
+ *  or MIT License (https://github.com/ParaGroup/WindFlow/blob/vers3.x/LICENSE.MIT)
+ *
+ *  This program is distributed in the hope that it will be useful, but WITHOUT
+ *  ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ *  FITNESS FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public
+ *  License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public License
+ *  along with this program; if not, write to the Free Software Foundation,
+ *  Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ *
+ ****************************************************************************
+ */
+
+#include <atomic>
+#include <cstdint>
+#include <climits>
+#include <ff/config.hpp>
+#include <ff/utils.hpp>
+#include <ff/buffer.hpp>
+#if defined(__linux__)
+#include <unistd.h>
+#include <sys/syscall.h>
+#include <linux/futex.h>
+#endif
+
+namespace ff {
+
+#if defined(__linux__)
+static inline void ff_futex_wait(std::atomic<uint32_t> *addr, uint32_t val, long ns) {
+    struct timespec ts = {0, ns};
+    syscall(SYS_futex, reinterpret_cast<uint32_t*>(addr), FUTEX_WAIT_PRIVATE, val, &ts, NULL, 0);
+}
+static inline void ff_futex_wake(std::atomic<uint32_t> *addr) {
+    syscall(SYS_futex, reinterpret_cast<uint32_t*>(addr), FUTEX_WAKE_PRIVATE, 1, NULL, NULL, 0);
+}
+static inline void ff_futex_wake_all(std::atomic<uint32_t> *addr) {
+    syscall(SYS_futex, reinterpret_cast<uint32_t*>(addr), FUTEX_WAKE_PRIVATE, INT_MAX, NULL, NULL, 0);
+}
+#else
+// no futex available, parking degenerates into a short sleep
+static inline void ff_futex_wait(std::atomic<uint32_t> *, uint32_t, long ns) {
+    ff_relax(ns/1000);
+}
+static inline void ff_futex_wake(std::atomic<uint32_t> *) {}
+static inline void ff_futex_wake_all(std::atomic<uint32_t> *) {}
+#endif
+
+/*!
+ * \class ff_parking
+ * \ingroup building_blocks
+ *
+ * \brief Spin-then-park waiting object of a single thread
+ *
+ * Each thread of the run-time owns one ff_parking object for its input
+ * channels and one for its output channels. The object is installed in the
+ * channels (see uSWSR_Ptr_Buffer::set_consumer_parking and
+ * set_producer_parking), so that the thread at the other end of the channel
+ * can wake it up.
+ *
+ * The owner calls \p wait each time it finds its channels empty (or full).
+ * The first calls just spin for \p ticks, as in the non-blocking run-time.
+ * When the spinning budget is exhausted, the thread announces that it is
+ * going to sleep, looks once more at its channels and then parks on a futex.
+ * The peer thread calls \p wake after each push (or pop); this costs a fence
+ * and a load of the \p sleeping flag unless the owner is actually parked.
+ * The fence after the push (or pop) in \p wake and the one after the
+ * announcement in \p wait order the two stores before the two loads, so
+ * either the owner sees the new state of the channel or the peer sees the
+ * \p sleeping flag: no wake-up is lost.
+ *
+ * The spinning budget is learned: it grows when the thread is woken up
+ * shortly after having parked (spinning a bit longer would have avoided
+ * the system calls), and shrinks when the park times out (the channel is
+ * really idle).
+ * Parking is anyway bounded by FF_TIMEDWAIT_NS.
+ */
+class ff_parking {
+public:
+    ff_parking():
+        budget(FF_SPINPARK_MIN),spinned(0),last(0),seq(0),announced(false),
+        nparks(0),sleeping(0),word(0) {}
+
+    /**
+     * \brief waits for the peer, spinning or parking the thread
+     *
+     * \param nticks time spent in each spinning step
+     */
+    inline void wait(unsigned long nticks) {
+        const ticks t0 = getticks();
+        // if the thread has been doing something else since the last
+        // call, this is a new waiting phase
+        if ((t0 - last) > (ticks)(FF_BACKOFF_GAP*nticks)) {
+            spinned = 0;
+            if (announced) {
+                announced = false;
+                sleeping.store(0, std::memory_order_relaxed);
+            }
+        }
+        if (spinned < budget) {
+            ++spinned;
+            ticks_wait(nticks);
+            last = getticks();
+            return;
+        }
+        if (!announced) {
+            announced = true;
+            seq = word.load(std::memory_order_acquire);
+            sleeping.store(1);
+            // StoreLoad: the flag is visible before the channels are read again
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+            // one more look at the channels before parking
+            last = getticks();
+            return;
+        }
+        announced = false;
+        // it returns immediately if the peer has already bumped the word
+        ff_futex_wait(&word, seq, FF_TIMEDWAIT_NS);
+        ++nparks;
+        sleeping.store(0, std::memory_order_relaxed);
+        const ticks t1 = getticks();
+        if (word.load(std::memory_order_acquire) != seq) {
+            // woken up by the peer
+            if ((t1 - t0) < (ticks)(budget*nticks) && budget < FF_SPINPARK_MAX)
+                budget <<= 1;
+            spinned = 0;
+        } else {
+            // timeout, the channel is idle: go back to sleep as soon as possible
+            if (budget > FF_SPINPARK_MIN) budget >>= 1;
+            spinned = budget;
+        }
+        last = t1;
+    }
+
+    /**
+     * \brief wakes up the owner if it is parked (or about to park)
+     */
+    inline void wake() {
+        // StoreLoad: the pushed (popped) item is visible before the flag is read
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (sleeping.load(std::memory_order_relaxed) &&
+            sleeping.exchange(0)) {
+            word.fetch_add(1, std::memory_order_release);
+            ff_futex_wake(&word);
+        }
+    }
+
+    inline size_t get_nparks() const { return nparks; }
+    inline size_t get_budget() const { return budget; }
+
+protected:
+    // written only by the owner thread
+    size_t                budget;   // spinning steps before parking
+    size_t                spinned;
+    ticks                 last;
+    uint32_t              seq;
+    bool                  announced;
+    size_t                nparks;
+    long padding1[longxCacheLine];
+    // shared with the peer thread
+    std::atomic<uint32_t> sleeping;
+    std::atomic<uint32_t> word;
+    long padding2[longxCacheLine-1];
+};
+
+} // namespace ff
+
+#endif /* FF_PARKING_HPP */
@@ -403,6 +403,13 @@ protected:
         
         const int nstages=static_cast<int>(nodes_list.size());
 
+        // the slots of the by_value channels must be given back (see by_value)
+        for(int i=1;i<nstages;++i)
+            if (nodes_list[i-1]->value_output() && !nodes_list[i]->value_input()) {
+                error("PIPE, stage %d receives by_value tasks but it is not a by_value node\n", i);
+                return -1;
+            }
+
         // possible cases:                                                                       [captured by]
         //
         // the current stage is a standard node (the previous stage can also be multi-output)    [curr_single_standard]
@@ -800,6 +807,7 @@ protected:
             set_output_blocking(m,c);
         }
 
+        if (lattracer) latency_attach(lattracer, "");
         prepared=true; 
         return ret;
     }
@@ -885,6 +893,7 @@ public:
      */
     virtual ~ff_pipeline() {        
         if (barrier) delete barrier;
+        if (lattracer) delete lattracer;
         if (node_cleanup) {
             while(nodes_list.size()>0) {
                 ff_node *n = nodes_list.back();
@@ -1158,6 +1167,13 @@ public:
         assert(nodes_list.size()>0);
         nodes_list[0]->get_in_nodes(w);
     }
+
+    inline bool value_input() const {
+        return nodes_list.size() && nodes_list[0]->value_input();
+    }
+    inline bool value_output() const {
+        return nodes_list.size() && nodes_list[nodes_list.size()-1]->value_output();
+    }
     
     void skipfirstpop(bool sk)   { 
         get_node(0)->skipfirstpop(sk);
@@ -1176,10 +1192,43 @@ public:
     void blocking_mode(bool blk=true) {
         blocking_in = blocking_out = blk;
     }
+    // the policy is set on all the stages already added (see ff_node::set_backoff)
+    void set_backoff(const ff_backoff &policy) {
+        ff_node::set_backoff(policy);
+        for(size_t i=0;i<nodes_list.size();++i) 
+            nodes_list[i]->set_backoff(policy);
+    }
+    // the placement is set on the channels between the stages already added
+    // (see ff_node::set_input_placement)
+    void set_input_placement(long node=FF_NUMA_CONSUMER, bool hugepages=false) {
+        ff_node::set_input_placement(node, hugepages);
+        for(size_t i=0;i<nodes_list.size();++i) {
+            nodes_list[i]->set_input_placement(node, hugepages);
+            if (i+1<nodes_list.size()) nodes_list[i]->set_output_placement(node, hugepages);
+        }
+    }
     void no_barrier() {
         initial_barrier = false;
     }
 
+    /**
+     * \brief Enables the latency tracing
+     *
+     * One task out of \p sample generated by the first stage is traced
+     * through the stages, also inside nested farms, pipelines and all-to-all
+     * (see ff_latency_tracer). It must be called before running the pipeline.
+     */
+    void set_latency_tracing(size_t sample=FF_LATENCY_SAMPLE) {
+        if (prepared) {
+            error("PIPE, set_latency_tracing, pipeline already prepared\n");
+            return;
+        }
+        if (lattracer) delete lattracer;
+        lattracer = new ff_latency_tracer(sample);
+    }
+    /// latency histograms of the stages and end-to-end, nullptr if not enabled
+    const ff_latency_tracer* get_latency_tracer() const { return lattracer; }
+
     void no_mapping() {
         default_mapping = false;
     }
@@ -1417,10 +1466,11 @@ public:
              struct timespec tv;
              timedwait_timeout(tv);             
              pthread_mutex_lock(prod_m);
-             pthread_cond_timedwait(prod_c, prod_m, &tv);
+             ff_cond_timedwait(prod_c, prod_m, &tv);
              pthread_mutex_unlock(prod_m);
              goto _retry;
          }
+         inbuffer->set_producer_parking(backoff_out ? backoff_out->parking() : nullptr);
          for(unsigned long i=0;i<retry;++i) {
             if (inbuffer->push(task)) return true;
             losetime_out(ticks);
@@ -1463,10 +1513,11 @@ public:
             struct timespec tv;
             timedwait_timeout(tv);
             pthread_mutex_lock(cons_m);
-            pthread_cond_timedwait(cons_c, cons_m, &tv);
+            ff_cond_timedwait(cons_c, cons_m, &tv);
             pthread_mutex_unlock(cons_m);
             goto _retry;
         }
+        outbuffer->set_consumer_parking(backoff_in ? backoff_in->parking() : nullptr);
         for(unsigned long i=0;i<retry;++i) {
             if (outbuffer->pop(task)) {
                 if ((*task != (void *)FF_EOS)) return true;
@@ -1574,6 +1625,9 @@ protected:
     inline bool  put(void * ptr) { 
         return nodes_list[0]->put(ptr);
     }
+    inline bool  put_n(void * const ptr[], size_t n) { 
+        return nodes_list[0]->put_n(ptr, n);
+    }
     inline FFBUFFER * get_in_buffer() const {
         return nodes_list[0]->get_in_buffer();
     }
@@ -1585,6 +1639,13 @@ protected:
     int   svc_init() { return -1; };    
     void  svc_end()  {}
 
+    // the stages are named by their position
+    void latency_attach(ff_latency_tracer *t, const std::string &name) {
+        const std::string prefix = name.empty() ? name : name + ".";
+        for(size_t i=0;i<nodes_list.size();++i)
+            nodes_list[i]->latency_attach(t, prefix + std::to_string(i));
+    }
+
     void  setAffinity(int) { 
         error("PIPE, setAffinity: cannot set affinity for the pipeline\n");
     }
@@ -1708,6 +1769,7 @@ private:
     svector<ff_node *> nodes_list;
     svector<ff_node*>  internalSupportNodes;
     svector<ff_node*>  dontcleanup;  // used by the flatten method
+    ff_latency_tracer *lattracer = nullptr;  // see set_latency_tracing
 
 #if defined(MAMMUT)
     mammut::Mammut           mammut;
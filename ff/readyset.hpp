@@ -0,0 +1,146 @@
+/* -*- Mode: C++; tab-width: 4; c-basic-offset: 4; indent-tabs-mode: nil -*- */
+
+/*!
+ * \file readyset.hpp
+ * \ingroup building_blocks
+ *
+ * \brief Bitmap of the non-empty input channels of a gatherer
+ * (see ff_gatherer::set_ready_notification)
+ *
+ */
+
+#ifndef FF_READYSET_HPP
+#define FF_READYSET_HPP
+
+/* ***************************************************************************
+ *
+ *  FastFlow is free software; you can redistribute it and/or modify it
+ *  under the terms of the GNU Lesser General Public License version 3 as
+ *  published by the Free Software Foundation.
+ *  Starting from version 3.0.1 FastFlow is dual licensed under the GNU LGPLv3
+ *  or MIT License (https://github.com/ParaGroup/WindFlow/blob/vers3.x/LICENSE.MIT)
+ *
+ *  This program is distributed in the hope that it will be useful, but WITHOUT
+ *  ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ *  FITNESS FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public
+ *  License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public License
+ *  along with this program; if not, write to the Free Software Foundation,
+ *  Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ *
+ ****************************************************************************
+ */
+
+#include <atomic>
+#include <cstdint>
+#include <sys/types.h>
+#include <ff/config.hpp>
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+namespace ff {
+
+// index of the least significant bit set, x must not be 0
+static inline unsigned ff_ctz64(uint64_t x) {
+#if defined(_MSC_VER)
+    unsigned long r;
+    _BitScanForward64(&r, x);
+    return (unsigned)r;
+#else
+    return (unsigned)__builtin_ctzll(x);
+#endif
+}
+
+/*!
+ * \class ff_readyset
+ * \ingroup building_blocks
+ *
+ * \brief One bit per input channel of a consumer, set when the channel may
+ * be non-empty
+ *
+ * The producers set the bit of their channel after each push (the bit is
+ * written only if it is not already set). The consumer looks only at the
+ * channels whose bit is set and clears the bit when it finds the channel
+ * empty, so the cost of looking for a task depends on the number of words
+ * of the bitmap (64 channels each) and not on the number of channels.
+ * Each word is on its own cache line.
+ *
+ * A producer setting the bit and the consumer clearing it must agree on
+ * the state of the channel: the producer issues a full fence between the
+ * push and the test of the bit, the consumer clears the bit by an atomic
+ * read-modify-write and then checks the channel once more (see \p clear).
+ */
+class ff_readyset {
+    struct word_t {
+        std::atomic<uint64_t> bits;
+        long padding[longxCacheLine-1];
+    };
+public:
+    ff_readyset():words(nullptr),nwords(0),n(0) {}
+    ~ff_readyset() { if (words) delete [] words; }
+
+    /// n channels, all of them marked as ready
+    void init(size_t nchannels) {
+        if (words) delete [] words;
+        n      = nchannels;
+        nwords = (n+63)/64;
+        words  = new word_t[nwords ? nwords : 1];
+        for(size_t i=0;i<nwords;++i) {
+            const size_t b = n - i*64;
+            words[i].bits.store((b>=64) ? ~0ULL : ((1ULL<<b)-1), std::memory_order_relaxed);
+        }
+    }
+    inline size_t size() const { return n; }
+
+    /// producer side: the channel i has been pushed
+    inline void set(size_t i) {
+        const uint64_t m = 1ULL << (i & 63);
+        std::atomic<uint64_t> &w = words[i >> 6].bits;
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (!(w.load(std::memory_order_relaxed) & m))
+            w.fetch_or(m, std::memory_order_seq_cst);
+    }
+
+    /**
+     * \brief consumer side: the channel i has been found empty
+     *
+     * After this call the consumer has to check the channel once more,
+     * a task pushed before the bit was cleared may not have been seen.
+     */
+    inline void clear(size_t i) {
+        words[i >> 6].bits.fetch_and(~(1ULL << (i & 63)), std::memory_order_seq_cst);
+    }
+
+    /**
+     * \brief consumer side: the first ready channel in [0,limit) after
+     * \p from (cyclically), -1 if there are no ready channels
+     */
+    inline ssize_t next(ssize_t from, size_t limit) const {
+        if (limit > n) limit = n;
+        if (limit == 0) return -1;
+        size_t start = (from<0) ? 0 : (size_t)(from+1) % limit;
+        const size_t lw = (limit+63)/64;
+        size_t wi = start >> 6;
+        // the first word from the starting bit on
+        uint64_t b = words[wi].bits.load(std::memory_order_acquire) & (~0ULL << (start & 63));
+        for(size_t k=0;k<=lw;++k) {
+            if (b) {
+                const size_t i = (wi << 6) + ff_ctz64(b);
+                if (i < limit) return (ssize_t)i;
+            }
+            if (++wi == lw) wi = 0;
+            b = words[wi].bits.load(std::memory_order_acquire);
+        }
+        return -1;
+    }
+
+protected:
+    word_t *words;
+    size_t  nwords, n;
+};
+
+} // namespace ff
+
+#endif /* FF_READYSET_HPP */
@@ -40,6 +40,12 @@
 #if defined(__APPLE__)
 #include <AvailabilityMacros.h>
 #endif
+#if defined(__linux__)
+#include <stdint.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#endif
 
 
 /***********************************************************\
@@ -247,4 +253,86 @@ static inline void freeAlignedMemory(void* ptr) {
 #endif  
 }
 
+/*------------------------
+  Memory placement (NUMA node and huge pages) 
+ ------------------------*/
+
+#define FF_NUMA_NONE       (-1)  /* no explicit placement (first-touch) */
+#define FF_NUMA_CONSUMER   (-2)  /* the NUMA node of the consumer thread */
+
+#if !defined(FF_HUGEPAGE_SIZE)
+#define FF_HUGEPAGE_SIZE   (2*1024*1024)
+#endif
+
+/* 
+ * It binds the pages in [ptr, ptr+size) to the NUMA node \p node (preferred
+ * policy), pages already allocated are moved. \p ptr has to be page aligned.
+ * Returns 0 on success, -1 otherwise.
+ */
+static inline int bindMemory(void *ptr, size_t size, long node) {
+#if defined(__linux__) && defined(SYS_mbind)
+  enum { MPOL_PREFERRED_=1, MPOL_MF_MOVE_=(1<<1), MASKSIZE=16 };
+  unsigned long mask[MASKSIZE] = {0};
+  const long bits = 8*sizeof(unsigned long);
+  if (node < 0 || node >= MASKSIZE*bits) return -1;
+  mask[node/bits] = 1UL << (node%bits);
+  return (syscall(SYS_mbind, ptr, size, MPOL_PREFERRED_, mask, 
+                  (unsigned long)(MASKSIZE*bits+1), MPOL_MF_MOVE_) == 0) ? 0 : -1;
+#else
+  (void)ptr; (void)size; (void)node;
+  return -1;
+#endif
+}
+
+static inline size_t placedMemorySize(size_t size, int hugepages) {
+#if defined(__linux__)
+  const size_t pg = hugepages ? FF_HUGEPAGE_SIZE : (size_t)sysconf(_SC_PAGESIZE);
+  return ((size + pg - 1) / pg) * pg;
+#else
+  (void)hugepages;
+  return size;
+#endif
+}
+
+/*
+ * It allocates \p size bytes of page aligned memory bound to the NUMA node 
+ * \p node (if node >= 0) and, if \p hugepages is not 0, aligned to and 
+ * backed by (transparent) huge pages. The memory has to be released by using
+ * freePlacedMemory with the same size and hugepages values.
+ */
+static inline void *getPlacedMemory(size_t size, long node, int hugepages) {
+#if defined(__linux__)
+  const size_t len = placedMemorySize(size, hugepages);
+  const size_t extra = hugepages ? FF_HUGEPAGE_SIZE : 0;
+  char *ptr = (char*)mmap(NULL, len+extra, PROT_READ|PROT_WRITE, 
+                          MAP_PRIVATE|MAP_ANONYMOUS, -1, 0);
+  if (ptr == (char*)MAP_FAILED) return NULL;
+  if (extra) { 
+    /* trims the mapping so that it starts on a huge page boundary */
+    char *aligned = (char*)(((uintptr_t)ptr + FF_HUGEPAGE_SIZE-1) & ~((uintptr_t)FF_HUGEPAGE_SIZE-1));
+    if (aligned > ptr) munmap(ptr, aligned-ptr);
+    if (aligned+len < ptr+len+extra) munmap(aligned+len, (ptr+len+extra)-(aligned+len));
+    ptr = aligned;
+#if defined(MADV_HUGEPAGE)
+    madvise(ptr, len, MADV_HUGEPAGE);
+#endif
+  }
+  if (node >= 0) bindMemory(ptr, len, node);
+  return ptr;
+#else
+  (void)node; (void)hugepages;
+  return getAlignedMemory(4096, size);
+#endif
+}
+
+static inline void freePlacedMemory(void *ptr, size_t size, int hugepages) {
+  if (!ptr) return;
+#if defined(__linux__)
+  munmap(ptr, placedMemorySize(size, hugepages));
+#else
+  (void)size; (void)hugepages;
+  freeAlignedMemory(ptr);
+#endif
+}
+
 #endif /* FF_SPIN_SYSDEP_H */
@@ -0,0 +1,277 @@
+/* -*- Mode: C++; tab-width: 4; c-basic-offset: 4; indent-tabs-mode: nil -*- */
+
+/*!
+ * \file threadpool.hpp
+ * \ingroup building_blocks
+ *
+ * \brief Process-wide pool of the OS threads running the FastFlow nodes
+ *
+ */
+
+#ifndef FF_THREADPOOL_HPP
+#define FF_THREADPOOL_HPP
+
+/* ***************************************************************************
+ *
+ *  FastFlow is free software; you can redistribute it and/or modify it
+ *  under the terms of the GNU Lesser General Public License version 3 as
+ *  published by the Free Software Foundation.
+ *  Starting from version 3.0.1 FastFlow is dual licensed under the GNU LGPLv3
+ *  or MIT License (https://github.com/ParaGroup/WindFlow/blob/vers3.x/LICENSE.MIT)
+ *
+ *  This program is distributed in the hope that it will be useful, but WITHOUT
+ *  ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ *  FITNESS FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public
+ *  License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public License
+ *  along with this program; if not, write to the Free Software Foundation,
+ *  Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ *
+ ****************************************************************************
+ */
+
+#include <atomic>
+#include <vector>
+#include <pthread.h>
+#include <ff/config.hpp>
+#include <ff/utils.hpp>
+#include <ff/mapping_utils.hpp>
+
+namespace ff {
+
+/*!
+ * \class ff_pooledthread
+ * \ingroup building_blocks
+ *
+ * \brief An OS thread of the pool, it runs one routine at a time
+ */
+class ff_pooledthread {
+    friend class ff_threadpool;
+public:
+    pthread_t get_handle() const { return th_handle; }
+    /// core the thread is pinned to, -1 if it is not pinned
+    int get_cpu() const { return cpu; }
+
+protected:
+    ff_pooledthread():routine(nullptr),arg(nullptr),cpu(-1),newcpu(-1),
+                      busy(false),finished(false),quit(false) {
+        pthread_mutex_init(&mutex, NULL);
+        pthread_cond_init(&cond, NULL);
+    }
+    ~ff_pooledthread() {
+        pthread_mutex_destroy(&mutex);
+        pthread_cond_destroy(&cond);
+    }
+
+    static void* thread_routine(void *arg) {
+        ff_pooledthread &t = *(ff_pooledthread*)arg;
+        pthread_mutex_lock(&t.mutex);
+        while(true) {
+            while(!t.routine && !t.quit) pthread_cond_wait(&t.cond, &t.mutex);
+            if (!t.routine) break;
+            void*(*routine)(void*) = t.routine;
+            void *rarg = t.arg;
+            const int c = t.newcpu;
+            pthread_mutex_unlock(&t.mutex);
+
+            if (c != t.cpu) { pin(c); t.cpu = c; }
+            routine(rarg);
+
+            pthread_mutex_lock(&t.mutex);
+            t.routine  = nullptr;
+            t.finished = true;
+            pthread_cond_broadcast(&t.cond);
+        }
+        pthread_mutex_unlock(&t.mutex);
+        return NULL;
+    }
+
+    // pins the calling thread to the core cpu, or to all the cores if cpu<0
+    static void pin(int cpu) {
+#if defined(__linux__) && defined(CPU_SET)
+        if (cpu>=0) { ff_mapThreadToCpu(cpu); return; }
+        cpu_set_t mask;
+        CPU_ZERO(&mask);
+        const ssize_t n = ff_numCores();
+        for(ssize_t i=0;i<n && i<CPU_SETSIZE;++i) CPU_SET(i, &mask);
+        sched_setaffinity(ff_gettid(), sizeof(mask), &mask);
+#else
+        if (cpu>=0) ff_mapThreadToCpu(cpu);
+#endif
+    }
+
+    pthread_t        th_handle;
+    pthread_mutex_t  mutex;
+    pthread_cond_t   cond;
+    void*          (*routine)(void*);
+    void            *arg;
+    int              cpu;       // written only by the thread
+    int              newcpu;
+    bool             busy;      // owned by a node, from acquire to join
+    bool             finished;
+    bool             quit;
+};
+
+/*!
+ * \class ff_threadpool
+ * \ingroup building_blocks
+ *
+ * \brief Process-wide pool of OS threads
+ *
+ * When the pool is enabled, the threads of the nodes (ff_thread) are not
+ * created by \p spawn and destroyed by \p wait: a node gets one of the idle
+ * threads of the pool when it is started and gives it back when it is
+ * waited. A new OS thread is created only if there are no idle threads.
+ * This removes the cost of creating the threads when many short-lived
+ * pipelines or farms are built and run.
+ *
+ * A node that has to run on a core gets, if possible, an idle thread that
+ * is already pinned to that core (so that the memory touched first by the
+ * thread stays close to it), otherwise the thread is pinned again before
+ * running the node. A node that has not to be pinned runs on a thread
+ * that can run on all the cores.
+ *
+ * The pool is disabled by default, it is enabled at compile time with
+ * FF_THREADPOOL (not 0) or at run time with \p enable. The idle threads
+ * exit when the pool is destroyed at the end of the program, or with
+ * \p shrink.
+ */
+class ff_threadpool {
+public:
+    static inline ff_threadpool* instance() {
+        static ff_threadpool pool;
+        return &pool;
+    }
+
+    /// the nodes started from now on use the pool (or not)
+    void enable(bool onoff=true) { on.store(onoff, std::memory_order_release); }
+    inline bool enabled() const { return on.load(std::memory_order_acquire); }
+
+    /// at most \p n idle threads are kept (0 means no limit)
+    void set_max_idle(size_t n) {
+        maxidle = n;
+        if (n) shrink(n);
+    }
+
+    /// number of OS threads of the pool and how many of them are idle
+    size_t size() {
+        pthread_mutex_lock(&mutex);
+        const size_t n = threads.size();
+        pthread_mutex_unlock(&mutex);
+        return n;
+    }
+    size_t idle() {
+        pthread_mutex_lock(&mutex);
+        size_t n = 0;
+        for(auto t: threads) n += !t->busy;
+        pthread_mutex_unlock(&mutex);
+        return n;
+    }
+    /// number of OS threads created by the pool
+    size_t created() const { return ncreated.load(std::memory_order_relaxed); }
+
+    /**
+     * \brief Runs \p routine(\p arg) on one of the idle threads, pinned to
+     * the core \p cpu (not pinned if cpu<0)
+     *
+     * \return the thread that has to be given to \p join, NULL if a new
+     * thread is needed and it cannot be created
+     */
+    ff_pooledthread* run(void*(*routine)(void*), void *arg, int cpu) {
+        pthread_mutex_lock(&mutex);
+        ff_pooledthread *t = nullptr;
+        for(auto p: threads)
+            if (!p->busy && (!t || p->cpu == cpu)) {
+                t = p;
+                if (p->cpu == cpu) break;
+            }
+        if (!t) {
+            t = new ff_pooledthread;
+            int r;
+            if ((r=pthread_create(&t->th_handle, NULL, ff_pooledthread::thread_routine, t)) != 0) {
+                pthread_mutex_unlock(&mutex);
+                errno=r;
+                perror("ff_threadpool: pthread creation failed");
+                delete t;
+                return nullptr;
+            }
+            ncreated.fetch_add(1, std::memory_order_relaxed);
+            threads.push_back(t);
+        }
+        t->busy = true;
+        pthread_mutex_unlock(&mutex);
+
+        pthread_mutex_lock(&t->mutex);
+        t->routine  = routine;
+        t->arg      = arg;
+        t->newcpu   = cpu;
+        t->finished = false;
+        pthread_cond_signal(&t->cond);
+        pthread_mutex_unlock(&t->mutex);
+        return t;
+    }
+
+    /// waits for the end of the routine running on \p t, then \p t is idle again
+    void join(ff_pooledthread *t) {
+        pthread_mutex_lock(&t->mutex);
+        while(!t->finished) pthread_cond_wait(&t->cond, &t->mutex);
+        pthread_mutex_unlock(&t->mutex);
+
+        pthread_mutex_lock(&mutex);
+        t->busy = false;
+        pthread_mutex_unlock(&mutex);
+        if (maxidle) shrink(maxidle);
+    }
+
+    /// terminates the idle threads in excess of \p n
+    void shrink(size_t n=0) {
+        std::vector<ff_pooledthread*> victims;
+        pthread_mutex_lock(&mutex);
+        size_t nidle = 0;
+        for(auto t: threads) nidle += !t->busy;
+        for(size_t i=threads.size(); i>0 && nidle>n; --i)
+            if (!threads[i-1]->busy) {
+                victims.push_back(threads[i-1]);
+                threads.erase(threads.begin()+(i-1));
+                --nidle;
+            }
+        pthread_mutex_unlock(&mutex);
+        for(auto t: victims) {
+            pthread_mutex_lock(&t->mutex);
+            t->quit = true;
+            pthread_cond_signal(&t->cond);
+            pthread_mutex_unlock(&t->mutex);
+            pthread_join(t->th_handle, NULL);
+            delete t;
+        }
+    }
+
+    ~ff_threadpool() {
+        shrink(0);
+        // the threads still running a node (never waited) are left alone
+        for(auto t: threads) pthread_detach(t->th_handle);
+        pthread_mutex_destroy(&mutex);
+    }
+
+protected:
+    ff_threadpool():maxidle(0),ncreated(0) {
+        // enabled by FF_THREADPOOL not 0, or defined with no value
+#if defined(FF_THREADPOOL) && ((FF_THREADPOOL+0) || (0-FF_THREADPOOL-1) == 1)
+        on.store(true);
+#else
+        on.store(false);
+#endif
+        pthread_mutex_init(&mutex, NULL);
+    }
+
+    std::atomic<bool>  on;
+    size_t             maxidle;
+    std::atomic<size_t> ncreated;
+    pthread_mutex_t    mutex;
+    std::vector<ff_pooledthread*> threads;
+};
+
+} // namespace ff
+
+#endif /* FF_THREADPOOL_HPP */
@@ -0,0 +1,258 @@
+/* -*- Mode: C++; tab-width: 4; c-basic-offset: 4; indent-tabs-mode: nil -*- */
+
+/*!
+ * \file timeline.hpp
+ * \ingroup building_blocks
+ *
+ * \brief Run-time switchable timeline of the FastFlow threads, exported as
+ * a Chrome trace-event (Perfetto) JSON file
+ *
+ */
+
+#ifndef FF_TIMELINE_HPP
+#define FF_TIMELINE_HPP
+
+/* ***************************************************************************
+ *
+ *  FastFlow is free software; you can redistribute it and/or modify it
+ *  under the terms of the GNU Lesser General Public License version 3 as
+ *  published by the Free Software Foundation.
+ *  Starting from version 3.0.1 FastFlow is dual licensed under the GNU LGPLv3
+ *  or MIT License (https://github.com/ParaGroup/WindFlow/blob/vers3.x/LICENSE.MIT)
+ *
+ *  This program is distributed in the hope that it will be useful, but WITHOUT
+ *  ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ *  FITNESS FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public
+ *  License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public License
+ *  along with this program; if not, write to the Free Software Foundation,
+ *  Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ *
+ ****************************************************************************
+ */
+
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+#include <ff/config.hpp>
+#include <ff/utils.hpp>
+
+namespace ff {
+
+/*!
+ * \class ff_timeline
+ * \ingroup building_blocks
+ *
+ * \brief Timeline of the events of the FastFlow threads
+ *
+ * When it is enabled (\p start), each thread records in its own ring
+ * buffer of FF_TIMELINE_EVENTS events the time spent in the svc method
+ * of its node, the time spent waiting for input (\p WAIT_IN) or for room
+ * in the output channel (\p WAIT_OUT), the time spent frozen and the
+ * reception of the EOS. Consecutive waits of the same kind are merged in
+ * one event. When the buffer is full the oldest events are overwritten.
+ * The ring buffer of a thread is allocated the first time it records an
+ * event, when the timeline is disabled recording costs one load and one
+ * branch. A thread that runs several nodes (e.g. a thread of the pool)
+ * records the events of each node in a ring of its own, so that each
+ * track is labelled with the node that has run.
+ *
+ * \p dump writes a JSON file in the Chrome trace-event format, with one
+ * track for each thread, that can be opened with chrome://tracing or
+ * https://ui.perfetto.dev. It should be called when the threads are not
+ * running or after \p stop.
+ *
+ * Example:
+ * \code
+ *   ff_timeline::start();
+ *   pipe.run_and_wait_end();
+ *   ff_timeline::stop();
+ *   ff_timeline::dump("pipe.json");
+ * \endcode
+ */
+class ff_timeline {
+public:
+    enum event_t { SVC=0, WAIT_IN, WAIT_OUT, FROZEN, EOS, NEVENTS };
+
+    /// starts recording, the timestamps are relative to the first start
+    static void start() {
+        registry &r = reg();
+        {
+            std::lock_guard<std::mutex> lk(r.m);
+            if (r.t0 == 0) r.t0 = now();
+        }
+        on.store(true, std::memory_order_release);
+    }
+    static void stop() { on.store(false, std::memory_order_release); }
+    static inline bool enabled() { return on.load(std::memory_order_relaxed); }
+
+    /// removes all the events recorded (the timeline has to be stopped)
+    static void clear() {
+        registry &r = reg();
+        std::lock_guard<std::mutex> lk(r.m);
+        r.rings.clear();
+        r.t0 = 0;
+        r.gen.fetch_add(1, std::memory_order_release);
+    }
+
+    /// name of the calling thread in the timeline, the next events go in its track
+    static void set_thread_name(const std::string &name) {
+        thread_state &s = local();
+        if (s.name == name) return;
+        s.name = name;
+        s.r    = nullptr;
+    }
+
+    /// 0 if the timeline is disabled, otherwise the current time
+    static inline int64_t begin() { return enabled() ? now() : 0; }
+    /// an event of kind \p e started at \p t0 (as returned by \p begin) ends now
+    static inline void end(event_t e, int64_t t0) {
+        if (t0) record(e, t0, now()-t0);
+    }
+    static inline void instant(event_t e) {
+        if (enabled()) record(e, now(), -1);
+    }
+
+    /// number of tracks, i.e. of (thread, name) pairs with at least one event
+    static size_t nthreads() {
+        registry &r = reg();
+        std::lock_guard<std::mutex> lk(r.m);
+        return r.rings.size();
+    }
+
+    /**
+     * \brief Writes the events in \p filename in the Chrome trace-event format
+     *
+     * \return 0 if successful, -1 if the file cannot be written
+     */
+    static int dump(const std::string &filename) {
+        FILE *f = fopen(filename.c_str(), "w");
+        if (!f) {
+            error("ff_timeline, cannot open file %s\n", filename.c_str());
+            return -1;
+        }
+        static const char *names[NEVENTS] = { "svc", "wait input", "wait output", "frozen", "EOS" };
+        registry &r = reg();
+        std::lock_guard<std::mutex> lk(r.m);
+        fprintf(f, "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[\n");
+        fprintf(f, "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":1,\"args\":{\"name\":\"FastFlow\"}}");
+        for(size_t i=0;i<r.rings.size();++i) {
+            const ring &R = *r.rings[i];
+            fprintf(f, ",\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%ld,\"args\":{\"name\":\"%s\"}}",
+                    (long)i, R.name.c_str());
+            const uint64_t head = R.head.load(std::memory_order_acquire);
+            const uint64_t n    = (head < R.events.size()) ? head : R.events.size();
+            for(uint64_t k=head-n; k<head; ++k) {
+                const event &ev = R.events[k % R.events.size()];
+                const double ts = (ev.ts - r.t0)/1000.0;
+                if (ev.dur < 0)
+                    fprintf(f, ",\n{\"name\":\"%s\",\"ph\":\"i\",\"s\":\"t\",\"pid\":1,\"tid\":%ld,\"ts\":%.3f}",
+                            names[ev.type], (long)i, ts);
+                else
+                    fprintf(f, ",\n{\"name\":\"%s\",\"ph\":\"X\",\"pid\":1,\"tid\":%ld,\"ts\":%.3f,\"dur\":%.3f}",
+                            names[ev.type], (long)i, ts, ev.dur/1000.0);
+            }
+        }
+        fprintf(f, "\n]}\n");
+        if (fclose(f) != 0) {
+            error("ff_timeline, error writing file %s\n", filename.c_str());
+            return -1;
+        }
+        return 0;
+    }
+
+    static inline int64_t now() {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(
+               std::chrono::steady_clock::now().time_since_epoch()).count();
+    }
+
+protected:
+    struct event {
+        int64_t  ts;
+        int64_t  dur;    // -1 for instant events
+        uint32_t type;
+    };
+    // written only by its thread
+    struct ring {
+        ring(const std::string &name):name(name),events(FF_TIMELINE_EVENTS),head(0) {}
+        std::string        name;
+        std::vector<event> events;
+        std::atomic<uint64_t> head;
+    };
+    struct registry {
+        std::mutex  m;
+        int64_t     t0 = 0;
+        std::atomic<uint64_t> gen{0};
+        std::vector<std::unique_ptr<ring> > rings;
+    };
+    struct thread_state {
+        ring       *r   = nullptr;
+        uint64_t    gen = 0;
+        std::string name{"thread"};
+        std::vector<ring*> rings;  // the rings of the thread, one for each name
+    };
+
+    static registry& reg() {
+        static registry r;
+        return r;
+    }
+    static thread_state& local() {
+        static thread_local thread_state s;
+        return s;
+    }
+
+    static void record(event_t e, int64_t ts, int64_t dur) {
+        thread_state &s = local();
+        registry &r = reg();
+        const uint64_t gen = r.gen.load(std::memory_order_acquire);
+        if (!s.r || s.gen != gen) {
+            std::lock_guard<std::mutex> lk(r.m);
+            const uint64_t g = r.gen.load(std::memory_order_relaxed);
+            if (s.gen != g) s.rings.clear(), s.gen = g;  // cleared
+            s.r = nullptr;
+            for(ring *x: s.rings) if (x->name == s.name) { s.r = x; break; }
+            if (!s.r) {
+                r.rings.emplace_back(new ring(s.name));
+                s.r = r.rings.back().get();
+                s.rings.push_back(s.r);
+            }
+        }
+        ring &R = *s.r;
+        const uint64_t head = R.head.load(std::memory_order_relaxed);
+        if ((e == WAIT_IN || e == WAIT_OUT) && head>0) {
+            event &last = R.events[(head-1) % R.events.size()];
+            if (last.type == (uint32_t)e && last.ts + last.dur + FF_TIMELINE_GAP >= ts) {
+                last.dur = ts + dur - last.ts;
+                return;
+            }
+        }
+        event &ev = R.events[head % R.events.size()];
+        ev.ts = ts; ev.dur = dur; ev.type = (uint32_t)e;
+        R.head.store(head+1, std::memory_order_release);
+    }
+
+    static inline std::atomic<bool> on{false};
+};
+
+/*!
+ * \class ff_timeline_span
+ * \ingroup building_blocks
+ *
+ * \brief Records an event of the timeline lasting as long as the object
+ */
+struct ff_timeline_span {
+    ff_timeline_span(ff_timeline::event_t e):e(e),t0(ff_timeline::begin()) {}
+    ~ff_timeline_span() { ff_timeline::end(e, t0); }
+    const ff_timeline::event_t e;
+    const int64_t t0;
+};
+
+} // namespace ff
+
+#endif /* FF_TIMELINE_HPP */
@@ -75,6 +75,8 @@
 #include <ff/dynqueue.hpp>
 #include <ff/buffer.hpp>
 #include <ff/spin-lock.hpp>
+#include <ff/parking.hpp>
+#include <ff/readyset.hpp>
 // #if defined(HAVE_ATOMIC_H)
 // #include <asm/atomic.h>
 // #else
@@ -85,10 +87,29 @@ namespace ff {
 /* Do not change the following define unless you know what you're doing */
 #define INTERNAL_BUFFER_T SWSR_Ptr_Buffer  /* bounded SPSC buffer */
 
+/* The thread at the other end of the queue, if it uses a parking object,
+ * is woken up after each successful push/pop (see parking.hpp) 
+ */
+#if defined(FF_BACKOFF_PARKING)
+#define SPINPARK_WAKE(w) do { if (w) (w)->wake(); } while(0)
+#else
+#define SPINPARK_WAKE(w) do { } while(0)
+#endif
+
+/* If the consumer gathers from many channels using a ready-set, the bit of
+ * the channel is set after each successful push (see readyset.hpp), only if
+ * FF_READYSET is defined (see config.hpp)
+ */
+#if defined(FF_READYSET)
+#define READYSET_NOTIFY(r,i) do { if (r) (r)->set(i); } while(0)
+#else
+#define READYSET_NOTIFY(r,i) do { } while(0)
+#endif
+
 class BufferPool {
 public:
     BufferPool(int cachesize, const bool fillcache=false, unsigned long size=-1)
-        :inuse(cachesize),bufcache(cachesize) {
+        :numanode(FF_NUMA_NONE),hugepages(false),inuse(cachesize),bufcache(cachesize) {
         bufcache.init(); // initialise the internal buffer and allocates memory
 
         if (fillcache) {
@@ -125,7 +146,7 @@ public:
         }
     }
     
-    inline INTERNAL_BUFFER_T * next_w(unsigned long size)  { 
+    inline INTERNAL_BUFFER_T * next_w(unsigned long size, unsigned long lookahead=1)  { 
         union { INTERNAL_BUFFER_T * buf; void * buf2;} p;
         if (!bufcache.pop(&p.buf2)) {
 #if defined(UBUFFER_STATS)
@@ -133,15 +154,21 @@ public:
 #endif
             p.buf = (INTERNAL_BUFFER_T*)malloc(sizeof(INTERNAL_BUFFER_T));
             new (p.buf) INTERNAL_BUFFER_T(size);
+            p.buf->set_placement(numanode.load(std::memory_order_relaxed), hugepages);
 #if defined(uSWSR_MULTIPUSH)        
             if (!p.buf->init(true)) return NULL;
 #else
             if (!p.buf->init()) return NULL;
 #endif
         }
+        else {
 #if defined(UBUFFER_STATS)
-        else  ++hit;
+            ++hit;
 #endif  
+            // the consumer may have moved since the buffer was allocated
+            p.buf->set_placement(numanode.load(std::memory_order_relaxed), hugepages);
+        }
+        p.buf->set_lookahead(lookahead);
         inuse.push(p.buf);
         return p.buf;
     }
@@ -201,8 +228,19 @@ public:
         }
     }
 
+    /*
+     * Placement of the buffers allocated from now on. The NUMA node may be 
+     * changed by the consumer while the producer is using the pool, the 
+     * hugepages flag must not change after the first allocation.
+     */
+    void set_placement(long node, bool huge) {
+        numanode.store(node, std::memory_order_relaxed);
+        hugepages = huge;
+    }
     
 private:
+    std::atomic<long>  numanode;
+    bool               hugepages;
 #if defined(UBUFFER_STATS)
     unsigned long      miss,hit;
     long padding1[longxCacheLine-2];    
@@ -241,17 +279,19 @@ private:
     inline bool multipush() {
         if (buf_w->multipush(multipush_buf,MULTIPUSH_BUFFER_SIZE)) {
             mcnt=0; 
+            READYSET_NOTIFY(cons_ready, cons_readyid);
             return true;
         }
 
         if (fixedsize) return false;
         // try to get a new buffer             
-        INTERNAL_BUFFER_T * t = pool.next_w(size);
+        INTERNAL_BUFFER_T * t = pool.next_w(size, lookahead);
         assert(t); // if (!t) return false; // EWOULDBLOCK
         buf_w = t;
         in_use_buffers++;
         buf_w->multipush(multipush_buf,MULTIPUSH_BUFFER_SIZE);
         mcnt=0;
+        READYSET_NOTIFY(cons_ready, cons_readyid);
 #if defined(UBUFFER_STATS)
         ++numBuffers
         //atomic_long_inc(&numBuffers);
@@ -268,7 +308,9 @@ public:
     uSWSR_Ptr_Buffer(unsigned long n,
                      const bool fixedsize=false,
                      const bool fillcache=false):
-        buf_r(0),buf_w(0),in_use_buffers(1),size(n),fixedsize(fixedsize),
+        buf_r(0),prod_wait(0),buf_w(0),cons_wait(0),cons_ready(0),cons_readyid(0),
+        in_use_buffers(1),size(n),lookahead(1),numanode(FF_NUMA_NONE),
+        hugepages(false),fixedsize(fixedsize),
         pool(CACHE_SIZE,fillcache,size) {
         init_unlocked(P_lock); init_unlocked(C_lock);
         pushPMF=&uSWSR_Ptr_Buffer::push;
@@ -302,11 +344,13 @@ public:
         buf_r = (INTERNAL_BUFFER_T*)::malloc(sizeof(INTERNAL_BUFFER_T));
         assert(buf_r);
         new ((void *)buf_r) INTERNAL_BUFFER_T(size);
+        buf_r->set_placement(numanode, hugepages);
 #if defined(uSWSR_MULTIPUSH)        
         if (!buf_r->init(true)) return false;
 #else
         if (!buf_r->init()) return false;
 #endif
+        buf_r->set_lookahead(lookahead);
         buf_w = buf_r;
 
         return true;
@@ -326,6 +370,38 @@ public:
         return buf_w->available();
     }
 
+    /**
+     * \brief Sets the lookahead distance of the internal buffers
+     *
+     * See \p SWSR_Ptr_Buffer::set_lookahead. It should be called before
+     * using the queue.
+     */
+    inline void set_lookahead(unsigned long n) {
+        lookahead = (n==0) ? 1 : n;
+        if (buf_r) buf_r->set_lookahead(lookahead);
+        if (buf_w) buf_w->set_lookahead(lookahead);
+    }
+    inline unsigned long get_lookahead() const { return lookahead; }
+
+    /**
+     * \brief Sets where the internal buffers are allocated
+     *
+     * See \p SWSR_Ptr_Buffer::set_placement. \p node is either a NUMA node,
+     * FF_NUMA_NONE or FF_NUMA_CONSUMER; in the latter case the memory is
+     * allocated by getPlacedMemory but it is not bound until the consumer 
+     * calls this method again with its own node (usually when it starts). 
+     * This is the only call that can be made by the consumer while the 
+     * producer is using the queue, the buffer being read is migrated, the 
+     * others are migrated by the producer when they are reused.
+     */
+    inline void set_placement(long node, bool huge=false) {
+        if (!buf_r) hugepages = huge;
+        numanode = node;
+        pool.set_placement(node, hugepages);
+        if (buf_r) buf_r->set_placement(node, hugepages);
+    }
+    inline long get_numanode() const { return numanode; }
+
 
     /**
      *  \brief Push
@@ -345,24 +421,73 @@ public:
         /* NULL values cannot be pushed in the queue */
         assert(data != NULL);
 
+        if (buf_w->push(data)) {
+            SPINPARK_WAKE(cons_wait);
+            READYSET_NOTIFY(cons_ready, cons_readyid);
+            return true;
+        }
+
         // If fixedsize has been set to \p true, this method may
         // return false. This means EWOULDBLOCK 
-        if (!available()) {
-
-            if (fixedsize) return false;
+        if (fixedsize) return false;
 
-            // try to get a new buffer             
-            INTERNAL_BUFFER_T * t = pool.next_w(size);
-            assert(t); //if (!t) return false; // EWOULDBLOCK
-            buf_w = t;
-            in_use_buffers++;
+        // try to get a new buffer             
+        INTERNAL_BUFFER_T * t = pool.next_w(size, lookahead);
+        assert(t); //if (!t) return false; // EWOULDBLOCK
+        buf_w = t;
+        in_use_buffers++;
 #if defined(UBUFFER_STATS)
-            ++numBuffers;
-            //atomic_long_inc(&numBuffers);
+        ++numBuffers;
+        //atomic_long_inc(&numBuffers);
 #endif
-        }
         //DBG(assert(buf_w->push(data)); return true;);
         buf_w->push(data);
+        SPINPARK_WAKE(cons_wait);
+        READYSET_NOTIFY(cons_ready, cons_readyid);
+        return true;
+    }
+
+    /**
+     *  \brief Multipush
+     *
+     *  It pushes a batch of \p len elements in the queue publishing all of
+     *  them at once. Either all the elements are pushed or none of them is.
+     *  If the current internal buffer has not enough room and the queue is
+     *  unbounded, the whole batch is written into a new buffer.
+     *  If fixedsize has been set to \p true, this method may return false. 
+     *  This means EWOULDBLOCK and the call should be retried.
+     *
+     *  \param data array of pointers to be pushed in the buffer
+     *  \param len number of elements in the array
+     *  \return \p true if the push succedes. 
+     */
+    inline bool multipush(void * const data[], int len) {
+        if (len<=0) return true;
+        if (len==1) return push(data[0]);
+        if ((unsigned long)len >= size) {
+            if (fixedsize) return false;
+            // the batch does not fit into a single internal buffer
+            for(int i=0;i<len;++i) push(data[i]);
+            return true;
+        }
+        if (buf_w->multipush(data,len)) {
+            SPINPARK_WAKE(cons_wait);
+            READYSET_NOTIFY(cons_ready, cons_readyid);
+            return true;
+        }
+        if (fixedsize) return false;
+
+        // try to get a new buffer             
+        INTERNAL_BUFFER_T * t = pool.next_w(size, lookahead);
+        assert(t); //if (!t) return false; // EWOULDBLOCK
+        buf_w = t;
+        in_use_buffers++;
+#if defined(UBUFFER_STATS)
+        ++numBuffers;
+#endif
+        buf_w->multipush(data,len);
+        SPINPARK_WAKE(cons_wait);
+        READYSET_NOTIFY(cons_ready, cons_readyid);
         return true;
     }
 
@@ -373,6 +498,19 @@ public:
         return r;
     }
 
+    /* multi-producer version of multipush (all or nothing) */
+    inline bool mp_multipush(void * const data[], int len) {
+        spin_lock(P_lock);
+        bool r=multipush(data,len);
+        spin_unlock(P_lock);
+        return r;
+    }
+
+    /* largest batch that multipush can ever accept */
+    inline size_t maxbatch() const {
+        return (fixedsize ? size-1 : (size_t)-1);
+    }
+
 #if defined(uSWSR_MULTIPUSH)
     /**
      *
@@ -411,28 +549,71 @@ public:
     inline bool  pop(void ** data) {
         assert(data != NULL);
 
-        if (buf_r->empty()) { // current buffer is empty
-            if (buf_r == buf_w) return false; 
-            if (buf_r->empty()) { // we have to check again
-                INTERNAL_BUFFER_T * tmp = pool.next_r();
-                if (tmp) {
-                    // there is another buffer, release the current one 
-                    pool.release(buf_r); 
-                    in_use_buffers--;
-                    buf_r = tmp;                    
+        if (buf_r->pop(data)) {
+            SPINPARK_WAKE(prod_wait);
+            return true;
+        }
+        // current buffer is empty
+        if (buf_r == buf_w) return false; 
+        if (buf_r->empty()) { // we have to check again
+            INTERNAL_BUFFER_T * tmp = pool.next_r();
+            if (tmp) {
+                // there is another buffer, release the current one 
+                pool.release(buf_r); 
+                in_use_buffers--;
+                buf_r = tmp;                    
 
 #if defined(UBUFFER_STATS)
-                    --numBuffers;
-                    //atomic_long_dec(&numBuffers);
+                --numBuffers;
+                //atomic_long_dec(&numBuffers);
 #endif
-                }
             }
         }
         //DBG(assert(buf_r->pop(data)); return true;);
-        return buf_r->pop(data);
+        if (buf_r->pop(data)) {
+            SPINPARK_WAKE(prod_wait);
+            return true;
+        }
+        return false;
     }    
 
 
+    /**
+     *  \brief Bulk pop
+     *
+     *  It pops up to \p max elements from the queue. The elements are taken 
+     *  only from the current internal buffer, so that a single update of the
+     *  consumer index covers the whole batch.
+     *
+     *  \param[out] data array of at least \p max entries
+     *  \return the number of elements popped (0 if the queue is empty)
+     */
+    inline size_t pop_n(void ** data, size_t max) {
+        assert(data != NULL);
+
+        size_t n = buf_r->pop_n(data, max);
+        if (n) {
+            SPINPARK_WAKE(prod_wait);
+            return n;
+        }
+        if (buf_r == buf_w) return 0;
+        if (buf_r->empty()) { // we have to check again
+            INTERNAL_BUFFER_T * tmp = pool.next_r();
+            if (tmp) {
+                // there is another buffer, release the current one 
+                pool.release(buf_r); 
+                in_use_buffers--;
+                buf_r = tmp;
+#if defined(UBUFFER_STATS)
+                --numBuffers;
+#endif
+            }
+        }
+        n = buf_r->pop_n(data, max);
+        if (n) { SPINPARK_WAKE(prod_wait); }
+        return n;
+    }
+
 #if defined(UBUFFER_STATS)
     inline unsigned long queue_status() {
         return (unsigned long) numBuffers;
@@ -506,6 +687,15 @@ public:
 
     inline bool isFixedSize() const { return fixedsize; }
 
+    /* parking object of the consumer thread, it is woken up by push */
+    inline void set_consumer_parking(ff_parking *p) { cons_wait = p; }
+    /* parking object of the producer thread, it is woken up by pop */
+    inline void set_producer_parking(ff_parking *p) { prod_wait = p; }
+    /* ready-set of the consumer thread, the bit id is set by push */
+    inline void set_consumer_readyset(ff_readyset *r, size_t id) {
+        cons_ready = r; cons_readyid = id;
+    }
+
     inline void reset() {
         if (buf_r) buf_r->reset();
         if (buf_w) buf_w->reset();
@@ -525,10 +715,14 @@ private:
     ALIGN_TO_PRE(CACHE_LINE_SIZE) 
     INTERNAL_BUFFER_T * buf_r;
     ALIGN_TO_POST(CACHE_LINE_SIZE)
+    ff_parking        * prod_wait; // the producer parks here when the queue is full
 
     ALIGN_TO_PRE(CACHE_LINE_SIZE)
     INTERNAL_BUFFER_T * buf_w;
     ALIGN_TO_POST(CACHE_LINE_SIZE)
+    ff_parking        * cons_wait; // the consumer parks here when the queue is empty
+    ff_readyset       * cons_ready;   // the consumer looks here for non-empty queues
+    size_t              cons_readyid;
 
     /* ----- two-lock used only in the mp_push and mc_pop methods ------- */
 	ALIGN_TO_PRE(CACHE_LINE_SIZE) 
@@ -555,6 +749,9 @@ private:
 
     unsigned long       in_use_buffers; // used to estimate queue length
     unsigned long	    size;
+    unsigned long       lookahead;
+    long                numanode;
+    bool                hugepages;
     bool			    fixedsize;
     BufferPool			pool;
 };
@@ -0,0 +1,209 @@
+/* -*- Mode: C++; tab-width: 4; c-basic-offset: 4; indent-tabs-mode: nil -*- */
+
+/*!
+ * \file wsdeque.hpp
+ * \ingroup building_blocks
+ *
+ * \brief Work-stealing deques used by the farm's work-stealing scheduling
+ * (see ff_farm::set_scheduling_stealing)
+ *
+ */
+
+#ifndef FF_WSDEQUE_HPP
+#define FF_WSDEQUE_HPP
+
+/* ***************************************************************************
+ *
+ *  FastFlow is free software; you can redistribute it and/or modify it
+ *  under the terms of the GNU Lesser General Public License version 3 as
+ *  published by the Free Software Foundation.
+ *  Starting from version 3.0.1 FastFlow is dual licensed under the GNU LGPLv3
+ *  or MIT License (https://github.com/ParaGroup/WindFlow/blob/vers3.x/LICENSE.MIT)
+ *
+ *  This program is distributed in the hope that it will be useful, but WITHOUT
+ *  ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ *  FITNESS FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public
+ *  License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public License
+ *  along with this program; if not, write to the Free Software Foundation,
+ *  Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ *
+ ****************************************************************************
+ */
+
+#include <atomic>
+#include <ff/config.hpp>
+#include <ff/buffer.hpp>
+#include <ff/svector.hpp>
+
+namespace ff {
+
+/*!
+ * \class ff_wsdeque
+ * \ingroup building_blocks
+ *
+ * \brief Bounded Chase-Lev work-stealing deque of pointers
+ *
+ * The owner thread pushes and pops tasks at the bottom end (LIFO), any
+ * other thread can steal tasks from the top end (FIFO). The owner's
+ * operations do not use atomic read-modify-write instructions but when
+ * the deque holds a single task, thieves synchronise by a CAS on \p top.
+ * The capacity is fixed (rounded up to a power of 2), \p push fails when
+ * the deque is full.
+ *
+ * Ref: D. Chase, Y. Lev, "Dynamic Circular Work-Stealing Deque", SPAA 2005.
+ *      N.M. Le et al., "Correct and Efficient Work-Stealing for Weak Memory
+ *      Models", PPoPP 2013.
+ */
+class ff_wsdeque {
+public:
+    ff_wsdeque(size_t n):top(0),bottom(0),mask(0),buf(nullptr),nsteals(0) {
+        size_t sz=2;
+        while(sz<n) sz <<= 1;
+        mask = sz-1;
+        buf  = new std::atomic<void*>[sz];
+        (void)padding1; (void)padding2;
+    }
+    ~ff_wsdeque() { delete [] buf; }
+
+    /// owner only: false if the deque is full
+    inline bool push(void *task) {
+        const long b = bottom.load(std::memory_order_relaxed);
+        const long t = top.load(std::memory_order_acquire);
+        if (b - t > (long)mask) return false;
+        buf[b & mask].store(task, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+        bottom.store(b+1, std::memory_order_relaxed);
+        return true;
+    }
+
+    /// owner only: it takes the last pushed task
+    inline bool pop(void **task) {
+        const long b = bottom.load(std::memory_order_relaxed) - 1;
+        bottom.store(b, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        long t = top.load(std::memory_order_relaxed);
+        if (t > b) {                 // empty
+            bottom.store(b+1, std::memory_order_relaxed);
+            return false;
+        }
+        void *x = buf[b & mask].load(std::memory_order_relaxed);
+        if (t == b) {               // last task, racing with the thieves
+            const bool won = top.compare_exchange_strong(t, t+1,
+                                                         std::memory_order_seq_cst,
+                                                         std::memory_order_relaxed);
+            bottom.store(b+1, std::memory_order_relaxed);
+            if (!won) return false;
+        }
+        *task = x;
+        return true;
+    }
+
+    /// any thread: it takes the oldest task, false if empty or if it lost a race
+    inline bool steal(void **task) {
+        long t = top.load(std::memory_order_acquire);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        const long b = bottom.load(std::memory_order_acquire);
+        if (t >= b) return false;
+        void *x = buf[t & mask].load(std::memory_order_relaxed);
+        if (!top.compare_exchange_strong(t, t+1,
+                                         std::memory_order_seq_cst,
+                                         std::memory_order_relaxed)) return false;
+        *task = x;
+        return true;
+    }
+
+    inline bool empty() const {
+        return bottom.load(std::memory_order_relaxed) <= top.load(std::memory_order_relaxed);
+    }
+    inline bool full() const {
+        return (bottom.load(std::memory_order_relaxed) -
+                top.load(std::memory_order_relaxed)) > (long)mask;
+    }
+    inline size_t capacity() const { return mask+1; }
+
+    /// number of tasks the owner has stolen from the other deques
+    inline size_t get_nsteals() const { return nsteals; }
+
+protected:
+    friend class ff_wsgroup;
+
+    std::atomic<long>   top;
+    long padding1[longxCacheLine-1];
+    std::atomic<long>   bottom;
+    size_t              mask;
+    std::atomic<void*> *buf;
+    size_t              nsteals;   // written only by the owner
+    long padding2[longxCacheLine-4];
+};
+
+/*!
+ * \class ff_wsgroup
+ * \ingroup building_blocks
+ *
+ * \brief The deques of a set of threads stealing work each other
+ *
+ * Thread \p i owns deque \p i. An idle thread steals from a victim chosen
+ * at random among the other threads.
+ */
+class ff_wsgroup {
+public:
+    ff_wsgroup(size_t nthreads, size_t dequesize) {
+        for(size_t i=0;i<nthreads;++i) deques.push_back(new ff_wsdeque(dequesize));
+    }
+    ~ff_wsgroup() {
+        for(size_t i=0;i<deques.size();++i) delete deques[i];
+    }
+
+    inline size_t size() const { return deques.size(); }
+    inline ff_wsdeque* get(size_t i) const { return deques[i]; }
+
+    /**
+     * \brief Steals one task on behalf of the thread \p thief
+     *
+     * \param seed random state of the thief
+     * \param all if true, all the other deques are visited and the call
+     * fails only if all of them have been found empty. Otherwise just one
+     * random victim is tried.
+     */
+    inline bool steal(size_t thief, void **task, unsigned long &seed, bool all=false) {
+        const size_t n = deques.size();
+        if (n<2) return false;
+        size_t v = next(seed) % (n-1);
+        if (v>=thief) ++v;
+        if (!all) {
+            if (!deques[v]->steal(task)) return false;
+            ++deques[thief]->nsteals;
+            return true;
+        }
+        for(size_t k=0;k<n;++k, v=(v+1)%n) {
+            if (v==thief) continue;
+            ff_wsdeque *d = deques[v];
+            while(!d->empty())
+                if (d->steal(task)) { ++deques[thief]->nsteals; return true; }
+        }
+        return false;
+    }
+
+    /// total number of tasks stolen
+    size_t get_nsteals() const {
+        size_t s=0;
+        for(size_t i=0;i<deques.size();++i) s += deques[i]->get_nsteals();
+        return s;
+    }
+
+protected:
+    // xorshift random generator
+    static inline unsigned long next(unsigned long &x) {
+        if (x==0) x = 2463534242UL;
+        x ^= x << 13; x ^= x >> 7; x ^= x << 17;
+        return x;
+    }
+
+    svector<ff_wsdeque*> deques;
+};
+
+} // namespace ff
+
+#endif /* FF_WSDEQUE_HPP */
@@ -0,0 +1,664 @@
+/* -*- Mode: C++; tab-width: 4; c-basic-offset: 4; indent-tabs-mode: nil -*- */
+/* ***************************************************************************
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License version 2 as
+ *  published by the Free Software Foundation.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ *
+ *  As a special exception, you may use this file as part of a free software
+ *  library without restriction.  Specifically, if other files instantiate
+ *  templates or use macros or inline functions from this file, or you compile
+ *  this file and link it with other files to produce an executable, this
+ *  file does not by itself cause the resulting executable to be covered by
+ *  the GNU General Public License.  This exception does not however
+ *  invalidate any other reasons why the executable file might be covered by
+ *  the GNU General Public License.
+ *
+ ****************************************************************************
+ */
+
+/*
+ * FastFlow micro-benchmark suite.
+ *
+ *   spsc       SWSR_Ptr_Buffer and uSWSR_Ptr_Buffer throughput, one-way
+ *              latency (ping-pong)
+ *   mpmc       MPMC_Ptr_Queue throughput with p producers and p consumers
+ *   farm       farm(Emitter, Worker x nw, Collector) throughput for
+ *              increasing number of workers
+ *   ofarm      the same farm with the ordering of the tasks
+ *   a2a        a2a(L x n, R x n) shuffle throughput
+ *   parfor     ParallelFor static and dynamic scheduling with different
+ *              grains, balanced and unbalanced iterations, random and
+ *              hierarchical stealing
+ *   algo       ParallelAlgorithms (sort, stable_sort, partition, merge,
+ *              set_union, transform_reduce, histogram) and the sequential
+ *              std:: versions
+ *   alloc      malloc/free pairs in one thread and across two threads
+ *              (allocated by the producer and freed by the consumer) for
+ *              malloc, ff_allocator and StaticAllocator
+ *
+ * Each measure is repeated and the median, min and max are reported.
+ * All the threads (also the ones of the FastFlow patterns) are pinned
+ * to the cores of the list given with -c, by default all the cores.
+ *
+ * The results can be written in CSV or JSON (-o, by file extension) and
+ * compared with a baseline saved in CSV (-b): each median that is worse
+ * than the baseline by more than the tolerance (-t, percent) is reported
+ * as a regression and the exit status is 1.
+ *
+ */
+
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <iomanip>
+#include <thread>
+#include <atomic>
+#include <chrono>
+#include <string>
+#include <vector>
+#include <map>
+#include <algorithm>
+#include <functional>
+#include <cstdlib>
+#include <cstring>
+#include <cmath>
+#include <ff/ff.hpp>
+#include <ff/parallel_for.hpp>
+#include <ff/algorithms.hpp>
+#include <ff/allocator.hpp>
+#include <ff/staticallocator.hpp>
+#include <ff/mpmc/MPMCqueues.hpp>
+#include <ff/version.h>
+
+using namespace ff;
+
+struct result {
+    std::string bench, param, unit;
+    bool   higher;          // true if higher is better
+    double median, min, max;
+};
+
+static std::vector<result> results;
+static std::vector<int>    cpus;
+static int    reps  = 5;
+static bool   quick = false;
+static long   work  = 200;       // ticks spent on each task by the workers
+
+static inline double seconds_since(std::chrono::steady_clock::time_point t0) {
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+}
+
+/*
+ * Runs f reps times, f returns the value of one measure.
+ */
+static void measure(const std::string &bench, const std::string &param,
+                    const std::string &unit, bool higher, const std::function<double()> &f) {
+    std::vector<double> v;
+    for(int i=0;i<reps;++i) v.push_back(f());
+    std::sort(v.begin(), v.end());
+    const double med = (v.size()%2) ? v[v.size()/2] : (v[v.size()/2-1]+v[v.size()/2])/2;
+    results.push_back({bench, param, unit, higher, med, v.front(), v.back()});
+    std::cout << std::left << std::setw(8) << bench << std::setw(30) << param
+              << std::right << std::setw(12) << std::fixed << std::setprecision(3) << med
+              << " " << unit << "  [" << v.front() << ", " << v.back() << "]\n";
+}
+
+// the i-th thread of a benchmark runs on cpus[i % cpus.size()]
+static inline void pin(size_t i) { ff_mapThreadToCpu(cpus[i % cpus.size()]); }
+
+// busy waiting that leaves the core if the other side is not running
+static inline void relax(long &spins) {
+    if (++spins < 1024) { PAUSE(); return; }
+    spins = 0;
+    std::this_thread::yield();
+}
+
+/* ----------------------------- spsc ----------------------------- */
+
+template<typename Q>
+static double spsc_throughput(Q &q, long n) {
+    std::atomic<int> ready{0};
+    long sum = 0;
+    std::thread C([&]() {
+        pin(1);
+        ready.fetch_add(1); while(ready.load()<2);
+        void *p; long spins=0;
+        for(long i=1;i<=n;++i) {
+            while(!q.pop(&p)) relax(spins);
+            sum += (long)p;
+        }
+    });
+    pin(0);
+    ready.fetch_add(1); while(ready.load()<2);
+    const auto t0 = std::chrono::steady_clock::now();
+    long spins=0;
+    for(long i=1;i<=n;++i)
+        while(!q.push((void*)i)) relax(spins);
+    C.join();
+    const double s = seconds_since(t0);
+    if (sum != n*(n+1)/2) error("spsc, wrong result\n");
+    return n/s/1e6;
+}
+
+template<typename Q>
+static double spsc_latency(Q &ping, Q &pong, long n) {
+    std::thread C([&]() {
+        pin(1);
+        void *p; long spins=0;
+        for(long i=0;i<n;++i) {
+            while(!ping.pop(&p)) relax(spins);
+            while(!pong.push(p)) relax(spins);
+        }
+    });
+    pin(0);
+    void *p; long spins=0;
+    const auto t0 = std::chrono::steady_clock::now();
+    for(long i=1;i<=n;++i) {
+        while(!ping.push((void*)i)) relax(spins);
+        while(!pong.pop(&p)) relax(spins);
+    }
+    const double s = seconds_since(t0);
+    C.join();
+    return s*1e9/(2.0*n);
+}
+
+static void bench_spsc() {
+    const long n = quick ? 20000 : 5000000;
+    const long size = 1024;
+    measure("spsc", "SWSR size=1024", "Mops/s", true, [&]() {
+        SWSR_Ptr_Buffer q(size); q.init();
+        return spsc_throughput(q, n);
+    });
+    measure("spsc", "uSWSR size=1024", "Mops/s", true, [&]() {
+        uSWSR_Ptr_Buffer q(size); q.init();
+        return spsc_throughput(q, n);
+    });
+    const long m = quick ? 2000 : 500000;
+    measure("spsc", "SWSR latency", "ns", false, [&]() {
+        SWSR_Ptr_Buffer ping(size), pong(size); ping.init(); pong.init();
+        return spsc_latency(ping, pong, m);
+    });
+    measure("spsc", "uSWSR latency", "ns", false, [&]() {
+        uSWSR_Ptr_Buffer ping(size), pong(size); ping.init(); pong.init();
+        return spsc_latency(ping, pong, m);
+    });
+}
+
+/* ----------------------------- mpmc ----------------------------- */
+
+static double mpmc_throughput(int np, long n) {
+    MPMC_Ptr_Queue q;
+    q.init(1024);
+    std::atomic<int>  ready{0};
+    std::atomic<long> sum{0};
+    const long each = n/np;
+    std::vector<std::thread> T;
+    for(int i=0;i<np;++i)
+        T.emplace_back([&,i]() {              // consumer
+            pin(np+i);
+            ready.fetch_add(1); while(ready.load()<2*np);
+            void *p; long s=0, spins=0;
+            for(long k=0;k<each;++k) {
+                while(!q.pop(&p)) relax(spins);
+                s += (long)p;
+            }
+            sum.fetch_add(s);
+        });
+    const auto t0 = std::chrono::steady_clock::now();
+    for(int i=0;i<np;++i)
+        T.emplace_back([&,i]() {              // producer
+            pin(i);
+            ready.fetch_add(1); while(ready.load()<2*np);
+            long spins=0;
+            for(long k=1;k<=each;++k)
+                while(!q.push((void*)k)) relax(spins);
+        });
+    for(auto &t: T) t.join();
+    const double s = seconds_since(t0);
+    if (sum.load() != np*(each*(each+1)/2)) error("mpmc, wrong result\n");
+    return np*each/s/1e6;
+}
+
+static void bench_mpmc() {
+    const long n = quick ? 20000 : 4000000;
+    for(int np=1; np<=(int)std::max<size_t>(1, cpus.size()/2) && np<=4; np*=2)
+        measure("mpmc", std::to_string(np)+"x"+std::to_string(np), "Mops/s", true,
+                [&]() { return mpmc_throughput(np, n); });
+}
+
+/* --------------------------- farm / a2a -------------------------- */
+
+struct Source: ff_node_t<long> {
+    Source(long n):n(n) {}
+    long* svc(long*) {
+        for(long i=1;i<=n;++i) ff_send_out((long*)i);
+        return EOS;
+    }
+    long n;
+};
+struct Worker: ff_node_t<long> {
+    long* svc(long* t) { if (work) ticks_wait(work); return t; }
+};
+struct Sink: ff_node_t<long> {
+    int svc_init() { sum=0; return 0; }
+    long* svc(long* t) { sum += (long)t; return GO_ON; }
+    long sum=0;
+};
+
+static double farm_throughput(size_t nw, long n, bool ordered) {
+    Source S(n); Sink K;
+    std::vector<ff_node*> W;
+    for(size_t i=0;i<nw;++i) W.push_back(new Worker);
+    ff_farm farm(W, &S, &K);
+    farm.cleanup_workers();
+    if (ordered) farm.set_ordered();
+    const auto t0 = std::chrono::steady_clock::now();
+    if (farm.run_and_wait_end()<0) {
+        error("running farm\n");
+        return 0;
+    }
+    const double s = seconds_since(t0);
+    if (K.sum != n*(n+1)/2) error("farm, wrong result\n");
+    return n/s/1e6;
+}
+
+// the Emitter and the Collector have their own core
+static size_t max_workers() {
+    return quick ? 2 : std::max<size_t>(1, cpus.size() > 2 ? cpus.size()-2 : 1);
+}
+
+static void bench_farm(bool ordered) {
+    const long n = quick ? 5000 : 1000000;
+    const char *name = ordered ? "ofarm" : "farm";
+    for(size_t nw=1; nw<=max_workers(); nw = (nw*2<=max_workers() || nw==max_workers()) ? nw*2 : max_workers())
+        measure(name, "nw="+std::to_string(nw), "Mtasks/s", true,
+                [&]() { return farm_throughput(nw, n, ordered); });
+}
+
+struct Counter: ff_node_t<long> {
+    int svc_init() { sum=0; return 0; }
+    long* svc(long* t) { if (work) ticks_wait(work); sum += (long)t; return GO_ON; }
+    long sum=0;
+};
+
+static double a2a_throughput(size_t nl, size_t nr, long n) {
+    std::vector<ff_node*> L, R;
+    const long each = n/nl;
+    for(size_t i=0;i<nl;++i) L.push_back(new Source(each));
+    for(size_t i=0;i<nr;++i) R.push_back(new Counter);
+    ff_a2a a2a;
+    a2a.add_firstset(L, 0, true);
+    a2a.add_secondset(R, true);
+    const auto t0 = std::chrono::steady_clock::now();
+    if (a2a.run_and_wait_end()<0) {
+        error("running a2a\n");
+        return 0;
+    }
+    const double s = seconds_since(t0);
+    long sum=0;
+    for(auto r: R) sum += ((Counter*)r)->sum;
+    if (sum != (long)nl*(each*(each+1)/2)) error("a2a, wrong result\n");
+    return nl*each/s/1e6;
+}
+
+static void bench_a2a() {
+    const long n = quick ? 5000 : 1000000;
+    const size_t maxn = quick ? 2 : std::max<size_t>(1, cpus.size()/2);
+    for(size_t k=1; k<=maxn; k*=2)
+        measure("a2a", std::to_string(k)+"x"+std::to_string(k), "Mtasks/s", true,
+                [&]() { return a2a_throughput(k, k, n); });
+}
+
+/* ----------------------------- parfor ---------------------------- */
+
+static void bench_parfor() {
+    const long N  = quick ? (1<<14) : (1<<22);
+    const long nw = quick ? 2 : (long)cpus.size();
+    std::vector<double> A(N);
+    ParallelFor pf(nw);
+    // balanced: the same cost for each iteration, unbalanced: the cost
+    // grows with the index
+    auto body = [&](const long i, bool unbalanced) {
+        const long k = unbalanced ? 1 + (i*16)/N : 8;
+        double x = (double)i;
+        for(long j=0;j<k;++j) x = x*0.999 + 1.0;
+        A[i] = x;
+    };
+    for(int u=0;u<2;++u) {
+        const std::string kind = u ? "unbalanced" : "balanced";
+        measure("parfor", kind+" static", "ms", false, [&]() {
+            const auto t0 = std::chrono::steady_clock::now();
+            pf.parallel_for_static(0, N, 1, 0, [&](const long i) { body(i, u); }, nw);
+            return seconds_since(t0)*1e3;
+        });
+        for(long grain: {16L, 256L, 4096L})
+            measure("parfor", kind+" dynamic g="+std::to_string(grain), "ms", false, [&]() {
+                const auto t0 = std::chrono::steady_clock::now();
+                pf.parallel_for(0, N, 1, grain, [&](const long i) { body(i, u); }, nw);
+                return seconds_since(t0)*1e3;
+            });
+        // random and hierarchical stealing among the workers
+        const std::pair<parfor_steal_t, std::string> steal[] = {
+            { PARFOR_STEAL_RANDOM, "random" }, { PARFOR_STEAL_HIERARCHICAL, "hier" } };
+        for(auto &st: steal) {
+            pf.setStealing(st.first);
+            measure("parfor", kind+" dynamic g=16 "+st.second, "ms", false, [&]() {
+                const auto t0 = std::chrono::steady_clock::now();
+                pf.parallel_for(0, N, 1, 16, [&](const long i) { body(i, u); }, nw);
+                return seconds_since(t0)*1e3;
+            });
+        }
+        pf.setStealing(PARFOR_STEAL_DEFAULT);
+    }
+}
+
+/* ----------------------------- algo ------------------------------ */
+
+static void bench_algo() {
+    const long N  = quick ? (1<<16) : (1<<24);
+    const long nw = quick ? 2 : (long)cpus.size();
+    std::vector<long> A(N), B(N), C(2*N);
+    unsigned long seed = 1;
+    for(long i=0;i<N;++i) {
+        seed = seed*6364136223846793005UL + 1442695040888963407UL;
+        A[i] = (long)(seed>>33);
+    }
+    ParallelAlgorithms pa(nw);
+
+    // f runs on a copy of A in B, the copy is not measured
+    auto run = [&](const std::string &param, const std::function<void()> &f) {
+        measure("algo", param, "ms", false, [&]() {
+            std::copy(A.begin(), A.end(), B.begin());
+            const auto t0 = std::chrono::steady_clock::now();
+            f();
+            return seconds_since(t0)*1e3;
+        });
+    };
+    run("sort std",        [&]() { std::sort(B.begin(), B.end()); });
+    run("sort ff",         [&]() { pa.sort(B.begin(), B.end()); });
+    run("stable_sort std", [&]() { std::stable_sort(B.begin(), B.end()); });
+    run("stable_sort ff",  [&]() { pa.stable_sort(B.begin(), B.end()); });
+    auto odd = [](const long x) { return (x&1)!=0; };
+    run("partition std",   [&]() { std::stable_partition(B.begin(), B.end(), odd); });
+    run("partition ff",    [&]() { pa.partition(B.begin(), B.end(), odd); });
+
+    // merge and set_union of the two sorted halves of B
+    std::copy(A.begin(), A.end(), B.begin());
+    std::sort(B.begin(), B.begin()+N/2);
+    std::sort(B.begin()+N/2, B.end());
+    auto twoway = [&](const std::string &param, const std::function<void()> &f) {
+        measure("algo", param, "ms", false, [&]() {
+            const auto t0 = std::chrono::steady_clock::now();
+            f();
+            return seconds_since(t0)*1e3;
+        });
+    };
+    const auto mid = B.begin()+N/2;
+    twoway("merge std",     [&]() { std::merge(B.begin(), mid, mid, B.end(), C.begin()); });
+    twoway("merge ff",      [&]() { pa.merge(B.begin(), mid, mid, B.end(), C.begin()); });
+    twoway("set_union std", [&]() { std::set_union(B.begin(), mid, mid, B.end(), C.begin()); });
+    twoway("set_union ff",  [&]() { pa.set_union(B.begin(), mid, mid, B.end(), C.begin()); });
+
+    auto sq = [](const long x) { return (x&1023)*(x&1023); };
+    volatile long sink = 0;
+    twoway("transform_reduce std", [&]() {
+            long s = 0;
+            for(long i=0;i<N;++i) s += sq(A[i]);
+            sink = s;
+        });
+    twoway("transform_reduce ff", [&]() {
+            sink = pa.transform_reduce(A.begin(), A.end(), 0L, std::plus<long>(), sq);
+        });
+    auto bin = [](const long x) { return x&255; };
+    twoway("histogram std", [&]() {
+            std::vector<long> H(256, 0);
+            for(long i=0;i<N;++i) ++H[bin(A[i])];
+            sink = H[0];
+        });
+    twoway("histogram ff", [&]() { sink = pa.histogram(A.begin(), A.end(), 256, bin)[0]; });
+    (void)sink;
+}
+
+/* ----------------------------- alloc ----------------------------- */
+
+static const size_t objsize = 64;
+
+struct obj { char data[objsize]; };
+
+// malloc/free pairs in the same thread, the last 'window' objects are kept alive
+template<typename M, typename F>
+static double alloc_local(long n, M m, F f) {
+    const size_t window = 64;
+    std::vector<void*> live(window, nullptr);
+    const auto t0 = std::chrono::steady_clock::now();
+    for(long i=0;i<n;++i) {
+        void *&p = live[i % window];
+        if (p) f(p);
+        p = m();
+        ((char*)p)[0] = (char)i;
+    }
+    for(auto p: live) if (p) f(p);
+    return n/seconds_since(t0)/1e6;
+}
+
+// allocated by the producer, freed by the consumer
+template<typename M, typename F>
+static double alloc_cross(long n, M m, F f, const std::function<void()> &cinit=nullptr) {
+    SWSR_Ptr_Buffer q(1024); q.init();
+    std::thread C([&]() {
+        pin(1);
+        if (cinit) cinit();
+        void *p; long spins=0;
+        for(long i=0;i<n;++i) {
+            while(!q.pop(&p)) relax(spins);
+            f(p);
+        }
+    });
+    pin(0);
+    const auto t0 = std::chrono::steady_clock::now();
+    long spins=0;
+    for(long i=0;i<n;++i) {
+        void *p = m();
+        ((char*)p)[0] = (char)i;
+        while(!q.push(p)) relax(spins);
+    }
+    C.join();
+    return n/seconds_since(t0)/1e6;
+}
+
+static void bench_alloc() {
+    const long n = quick ? 20000 : 5000000;
+    const std::string sz = " size="+std::to_string(objsize);
+
+    measure("alloc", "malloc local"+sz, "Mops/s", true, [&]() {
+        return alloc_local(n, []() { return ::malloc(objsize); }, [](void *p) { ::free(p); });
+    });
+    measure("alloc", "malloc cross"+sz, "Mops/s", true, [&]() {
+        return alloc_cross(n, []() { return ::malloc(objsize); }, [](void *p) { ::free(p); });
+    });
+    measure("alloc", "ff_allocator local"+sz, "Mops/s", true, [&]() {
+        ff_allocator A;
+        if (A.init()<0 || A.registerAllocator()<0) { error("ff_allocator init\n"); return 0.0; }
+        return alloc_local(n, [&]() { return A.malloc(objsize); }, [&](void *p) { A.free(p); });
+    });
+    measure("alloc", "ff_allocator cross"+sz, "Mops/s", true, [&]() {
+        ff_allocator A;
+        if (A.init()<0 || A.registerAllocator()<0) { error("ff_allocator init\n"); return 0.0; }
+        return alloc_cross(n, [&]() { return A.malloc(objsize); }, [&](void *p) { A.free(p); },
+                           [&]() { A.register4free(); });
+    });
+    // the slots are reused as soon as they are released
+    measure("alloc", "StaticAllocator local"+sz, "Mops/s", true, [&]() {
+        StaticAllocator A(128, sizeof(obj));
+        if (A.init()<0) { error("StaticAllocator init\n"); return 0.0; }
+        return alloc_local(n, [&]() { obj *o; A.alloc(o); return (void*)o; },
+                           [](void *p) { StaticAllocator::dealloc((obj*)p); });
+    });
+    measure("alloc", "StaticAllocator cross"+sz, "Mops/s", true, [&]() {
+        StaticAllocator A(2048, sizeof(obj));
+        if (A.init()<0) { error("StaticAllocator init\n"); return 0.0; }
+        return alloc_cross(n, [&]() { obj *o; A.alloc(o); return (void*)o; },
+                           [](void *p) { StaticAllocator::dealloc((obj*)p); });
+    });
+}
+
+/* --------------------------- output ----------------------------- */
+
+static int write_csv(const std::string &file) {
+    std::ofstream out(file);
+    if (!out) { error("cannot open %s\n", file.c_str()); return -1; }
+    out << "benchmark,parameter,unit,better,median,min,max\n";
+    out << std::setprecision(6);
+    for(auto &r: results)
+        out << r.bench << "," << r.param << "," << r.unit << "," << (r.higher?"higher":"lower")
+            << "," << r.median << "," << r.min << "," << r.max << "\n";
+    return out ? 0 : -1;
+}
+
+static int write_json(const std::string &file) {
+    std::ofstream out(file);
+    if (!out) { error("cannot open %s\n", file.c_str()); return -1; }
+    out << std::setprecision(6);
+    out << "{\n  \"fastflow\": \"" << FF_VERSION << "\",\n  \"repetitions\": " << reps
+        << ",\n  \"cpus\": [";
+    for(size_t i=0;i<cpus.size();++i) out << (i?",":"") << cpus[i];
+    out << "],\n  \"results\": [\n";
+    for(size_t i=0;i<results.size();++i) {
+        const result &r = results[i];
+        out << "    {\"benchmark\": \"" << r.bench << "\", \"parameter\": \"" << r.param
+            << "\", \"unit\": \"" << r.unit << "\", \"better\": \"" << (r.higher?"higher":"lower")
+            << "\", \"median\": " << r.median << ", \"min\": " << r.min << ", \"max\": " << r.max
+            << "}" << (i+1<results.size() ? "," : "") << "\n";
+    }
+    out << "  ]\n}\n";
+    return out ? 0 : -1;
+}
+
+/*
+ * Compares the medians with the ones in the baseline (CSV). It returns
+ * the number of regressions, -1 if the baseline cannot be read.
+ */
+static int compare(const std::string &file, double tolerance) {
+    std::ifstream in(file);
+    if (!in) { error("cannot open baseline %s\n", file.c_str()); return -1; }
+    std::map<std::string, double> base;
+    std::string line;
+    std::getline(in, line);  // header
+    while(std::getline(in, line)) {
+        std::vector<std::string> f;
+        std::stringstream ss(line);
+        std::string x;
+        while(std::getline(ss, x, ',')) f.push_back(x);
+        if (f.size() < 5) continue;
+        base[f[0]+","+f[1]] = atof(f[4].c_str());
+    }
+    int nreg=0;
+    std::cout << "\ncomparison with " << file << " (tolerance " << std::defaultfloat << tolerance << "%)\n";
+    for(auto &r: results) {
+        auto it = base.find(r.bench+","+r.param);
+        std::cout << std::left << std::setw(8) << r.bench << std::setw(30) << r.param << std::right;
+        if (it == base.end() || it->second == 0) {
+            std::cout << std::setw(12) << "-" << "  not in baseline\n";
+            continue;
+        }
+        const double change = (r.median - it->second)/it->second*100.0;
+        const bool worse = r.higher ? (change < -tolerance) : (change > tolerance);
+        nreg += worse;
+        std::cout << std::setw(12) << std::fixed << std::setprecision(3) << it->second
+                  << std::setw(12) << r.median << std::setw(9) << std::setprecision(1)
+                  << std::showpos << change << "%" << std::noshowpos
+                  << (worse ? "  REGRESSION" : "") << "\n";
+    }
+    return nreg;
+}
+
+/* ---------------------------------------------------------------- */
+
+static void usage(const char *name) {
+    std::cerr << "use: " << name << " [options] [benchmark ...]\n"
+              << "  benchmarks: spsc mpmc farm ofarm a2a parfor algo alloc (default all)\n"
+              << "  -r reps      repetitions of each measure (default " << reps << ")\n"
+              << "  -c cpus      comma separated list of cores (default all)\n"
+              << "  -w ticks     work of each task in farm, ofarm and a2a (default " << work << ")\n"
+              << "  -o file      results in CSV or JSON (.json)\n"
+              << "  -b file      baseline (CSV) to compare with\n"
+              << "  -t percent   tolerance of the comparison (default 10)\n"
+              << "  -q           quick run with small sizes\n";
+}
+
+int main(int argc, char *argv[]) {
+    std::string outfile, basefile;
+    double tolerance = 10.0;
+    std::vector<std::string> which;
+
+    for(int i=1;i<argc;++i) {
+        const std::string a = argv[i];
+        const bool hasarg = (i+1<argc);
+        if      (a=="-q") quick = true;
+        else if (a=="-r" && hasarg) reps = std::max(1, atoi(argv[++i]));
+        else if (a=="-w" && hasarg) work = atol(argv[++i]);
+        else if (a=="-o" && hasarg) outfile = argv[++i];
+        else if (a=="-b" && hasarg) basefile = argv[++i];
+        else if (a=="-t" && hasarg) tolerance = atof(argv[++i]);
+        else if (a=="-c" && hasarg) {
+            std::stringstream ss(argv[++i]);
+            std::string c;
+            while(std::getline(ss, c, ',')) cpus.push_back(atoi(c.c_str()));
+        }
+        else if (a[0]=='-') { usage(argv[0]); return -1; }
+        else which.push_back(a);
+    }
+    if (quick && reps>3) reps = 3;
+    if (cpus.empty())
+        for(ssize_t i=0;i<ff_numCores();++i) cpus.push_back((int)i);
+
+    // the threads of the FastFlow patterns use the same cores
+    std::string mapping;
+    for(size_t i=0;i<cpus.size();++i) mapping += (i?" ":"") + std::to_string(cpus[i]);
+    threadMapper::instance()->setMappingList(mapping.c_str());
+
+    const std::vector<std::pair<std::string, std::function<void()> > > benchs = {
+        { "spsc",   bench_spsc },
+        { "mpmc",   bench_mpmc },
+        { "farm",   []() { bench_farm(false); } },
+        { "ofarm",  []() { bench_farm(true);  } },
+        { "a2a",    bench_a2a },
+        { "parfor", bench_parfor },
+        { "algo",   bench_algo },
+        { "alloc",  bench_alloc },
+    };
+    for(auto &w: which)
+        if (std::none_of(benchs.begin(), benchs.end(), [&](const std::pair<std::string, std::function<void()> > &b) { return b.first == w; })) {
+            usage(argv[0]);
+            return -1;
+        }
+
+    std::cout << "FastFlow " << FF_VERSION << ", " << cpus.size() << " cores, "
+              << reps << " repetitions\n";
+    for(auto &b: benchs)
+        if (which.empty() || std::find(which.begin(), which.end(), b.first) != which.end())
+            b.second();
+
+    if (!outfile.empty()) {
+        const bool json = outfile.size()>5 && outfile.compare(outfile.size()-5, 5, ".json")==0;
+        if ((json ? write_json(outfile) : write_csv(outfile)) < 0) return -1;
+    }
+    if (!basefile.empty()) {
+        const int r = compare(basefile, tolerance);
+        if (r<0) return -1;
+        if (r>0) {
+            std::cout << r << " regression(s)\n";
+            return 1;
+        }
+    }
+    return 0;
+}
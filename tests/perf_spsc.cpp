@@ -0,0 +1,142 @@
+/* -*- Mode: C++; tab-width: 4; c-basic-offset: 4; indent-tabs-mode: nil -*- */
+/* ***************************************************************************
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License version 2 as 
+ *  published by the Free Software Foundation.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ *
+ *  As a special exception, you may use this file as part of a free software
+ *  library without restriction.  Specifically, if other files instantiate
+ *  templates or use macros or inline functions from this file, or you compile
+ *  this file and link it with other files to produce an executable, this
+ *  file does not by itself cause the resulting executable to be covered by
+ *  the GNU General Public License.  This exception does not however
+ *  invalidate any other reasons why the executable file might be covered by
+ *  the GNU General Public License.
+ *
+ ****************************************************************************
+ */
+
+/*
+ * Compares the SPSC buffers available in FastFlow:
+ *
+ *   - SWSR_Ptr_Buffer           (classic per-slot NULL check)
+ *   - SWSR_Ptr_Buffer lookahead (batched lookahead, B-Queue like)
+ *   - Lamport_Buffer
+ *   - uSWSR_Ptr_Buffer          (unbounded, default FFBUFFER)
+ *
+ * on three workloads:
+ *   - near-empty: the producer is slower than the consumer 
+ *   - near-full : the consumer is slower than the producer 
+ *                 (here the unbounded buffer is used as a bounded one)
+ *   - balanced  : no work on both sides
+ *
+ */
+
+#include <iostream>
+#include <iomanip>
+#include <thread>
+#include <atomic>
+#include <string>
+#include <ff/buffer.hpp>
+#include <ff/ubuffer.hpp>
+#include <ff/utils.hpp>
+#include <ff/mapping_utils.hpp>
+
+using namespace ff;
+
+enum workload_t { NEAR_EMPTY, NEAR_FULL, BALANCED };
+static const char* workload_str[] = { "near-empty", "near-full", "balanced" };
+
+static long ntasks    = 500000;
+static long qsize     = 1024;
+static long lookahead = 64;
+static long work      = 200;   // ticks spent by the slow side
+static int  cpu_P=-1, cpu_C=-1;
+
+template<typename Q>
+static double run(Q& q, workload_t w) {
+    std::atomic<int> ready{0};
+    long sum = 0;
+
+    std::thread C([&]() {
+        if (cpu_C != -1) ff_mapThreadToCpu(cpu_C);
+        ready.fetch_add(1); while(ready.load()<2);
+        void *p;
+        for(long i=1;i<=ntasks;++i) {
+            while(!q.pop(&p)) ;
+            sum += (long)p;
+            if (w == NEAR_FULL) ticks_wait(work);
+        }
+    });
+    if (cpu_P != -1) ff_mapThreadToCpu(cpu_P);
+    ready.fetch_add(1); while(ready.load()<2);
+    ffTime(START_TIME);
+    for(long i=1;i<=ntasks;++i) {
+        if (w == NEAR_EMPTY) ticks_wait(work);
+        while(!q.push((void*)i)) ;
+    }
+    C.join();
+    ffTime(STOP_TIME);
+    if (sum != (ntasks*(ntasks+1))/2) {
+        std::cerr << "ERROR: wrong result\n";
+        exit(-1);
+    }
+    return ffTime(GET_TIME);
+}
+
+static void print(const std::string& name, workload_t w, double ms) {
+    std::cout << std::left << std::setw(32) << name << std::setw(12) << workload_str[w]
+              << std::right << std::setw(10) << std::fixed << std::setprecision(2) << ms << " ms "
+              << std::setw(10) << (ntasks/(ms*1000.0)) << " Mops/s\n";
+}
+
+int main(int argc, char* argv[]) {
+    if (argc>1) {
+        if (argc<5) {
+            std::cerr << "use: " << argv[0] << " ntasks qsize lookahead work-ticks [cpu_P cpu_C]\n";
+            return -1;
+        }
+        ntasks    = std::stol(argv[1]);
+        qsize     = std::stol(argv[2]);
+        lookahead = std::stol(argv[3]);
+        work      = std::stol(argv[4]);
+        if (argc == 7) {
+            cpu_P = std::stol(argv[5]);
+            cpu_C = std::stol(argv[6]);
+        }
+    }
+    
+    for(int i=NEAR_EMPTY; i<=BALANCED; ++i) {
+        workload_t w = (workload_t)i;
+        {
+            SWSR_Ptr_Buffer q(qsize); q.init();
+            print("SWSR_Ptr_Buffer", w, run(q, w));
+        }
+        {
+            SWSR_Ptr_Buffer q(qsize); q.init(); q.set_lookahead(lookahead);
+            print("SWSR_Ptr_Buffer(lookahead="+std::to_string(lookahead)+")", w, run(q, w));
+        }
+        {
+            Lamport_Buffer q(qsize); q.init();
+            print("Lamport_Buffer", w, run(q, w));
+        }
+        {
+            uSWSR_Ptr_Buffer q(qsize, w==NEAR_FULL); q.init();
+            print("uSWSR_Ptr_Buffer", w, run(q, w));
+        }
+        {
+            uSWSR_Ptr_Buffer q(qsize, w==NEAR_FULL); q.init(); q.set_lookahead(lookahead);
+            print("uSWSR_Ptr_Buffer(lookahead="+std::to_string(lookahead)+")", w, run(q, w));
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,160 @@
+/* -*- Mode: C++; tab-width: 4; c-basic-offset: 4; indent-tabs-mode: nil -*- */
+/* ***************************************************************************
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License version 2 as
+ *  published by the Free Software Foundation.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ *
+ *  As a special exception, you may use this file as part of a free software
+ *  library without restriction.  Specifically, if other files instantiate
+ *  templates or use macros or inline functions from this file, or you compile
+ *  this file and link it with other files to produce an executable, this
+ *  file does not by itself cause the resulting executable to be covered by
+ *  the GNU General Public License.  This exception does not however
+ *  invalidate any other reasons why the executable file might be covered by
+ *  the GNU General Public License.
+ *
+ ****************************************************************************
+ */
+
+/*
+ * Parallel algorithms (ParallelAlgorithms).
+ *
+ * Each algorithm is checked against the sequential std:: one for several 
+ * sizes (shorter and longer than FF_ALGORITHMS_BLOCK per Worker), with 
+ * random values and with many repeated values. The stability of 
+ * stable_sort and partition is checked with pairs (key, position).
+ */
+
+#include <cstdio>
+#include <vector>
+#include <numeric>
+#include <algorithm>
+#include <ff/ff.hpp>
+#include <ff/algorithms.hpp>
+
+using namespace ff;
+
+struct item {
+    long key=0, pos=0;
+    bool operator==(const item &o) const { return key==o.key && pos==o.pos; }
+};
+static inline bool bykey(const item &a, const item &b) { return a.key < b.key; }
+
+static unsigned long seed = 1;
+static inline long rnd() {
+    seed = seed*6364136223846793005UL + 1442695040888963407UL;
+    return (long)(seed>>33);
+}
+
+#define CHECK(cond, what)                                               \
+    if (!(cond)) { printf("ERROR: %s n=%ld range=%ld\n", what, n, range); return -1; }
+
+int main(int argc, char *argv[]) {
+    int  nw = 4;
+    long N  = 1<<20;
+    if (argc>1) {
+        if (argc<3) {
+            printf("use: %s nworkers N\n", argv[0]);
+            return -1;
+        }
+        nw = atoi(argv[1]);
+        N  = atol(argv[2]);
+    }
+    ParallelAlgorithms pa(nw);
+    const long sizes[] = {0, 1, 1000, FF_ALGORITHMS_BLOCK*nw+7, N};
+    const long ranges[] = {10, 1L<<40};
+    for(long n: sizes)
+        for(long range: ranges) {
+            std::vector<long> A(n), B, C;
+            for(long i=0;i<n;++i) A[i] = rnd() % range;
+
+            B = A; C = A;
+            pa.sort(B.begin(), B.end());
+            std::sort(C.begin(), C.end());
+            CHECK(B == C, "sort");
+            B = A;
+            pa.sort(B.begin(), B.end(), std::greater<long>());
+            std::reverse(C.begin(), C.end());
+            CHECK(B == C, "sort (greater)");
+
+            std::vector<item> I(n), J, K;
+            for(long i=0;i<n;++i) I[i].key = A[i], I[i].pos = i;
+            J = I; K = I;
+            pa.stable_sort(J.begin(), J.end(), bykey);
+            std::stable_sort(K.begin(), K.end(), bykey);
+            CHECK(J == K, "stable_sort");
+
+            J = I; K = I;
+            auto even = [](const item &x) { return x.key%2==0; };
+            auto pj = pa.partition(J.begin(), J.end(), even);
+            auto pk = std::stable_partition(K.begin(), K.end(), even);
+            CHECK(J == K && (pj-J.begin()) == (pk-K.begin()), "partition");
+
+            B = A; C = A;
+            std::sort(B.begin(), B.end()); std::sort(C.begin(), C.end());
+            auto ub = pa.unique(B.begin(), B.end());
+            auto uc = std::unique(C.begin(), C.end());
+            CHECK((ub-B.begin()) == (uc-C.begin()) && std::equal(B.begin(), ub, C.begin()), "unique");
+
+            const long s1 = pa.transform_reduce(A.begin(), A.end(), 3L, std::plus<long>(),
+                                                [](const long x) { return x%1000; });
+            long s2 = 3;
+            for(long i=0;i<n;++i) s2 += A[i]%1000;
+            CHECK(s1 == s2, "transform_reduce");
+
+            std::vector<long> H = pa.histogram(A.begin(), A.end(), 7,
+                                               [](const long x) { return x%8; });  // bin 7 not counted
+            std::vector<long> H2(7, 0);
+            for(long i=0;i<n;++i) if (A[i]%8 < 7) ++H2[A[i]%8];
+            CHECK(H == H2, "histogram");
+
+            // two sorted ranges of different size
+            std::vector<long> X(A.begin(), A.begin()+n/3), Y(A.begin()+n/3, A.end());
+            std::sort(X.begin(), X.end()); std::sort(Y.begin(), Y.end());
+            std::vector<long> O(n+1), P(n+1);
+            auto oe = pa.merge(X.begin(), X.end(), Y.begin(), Y.end(), O.begin());
+            auto pe = std::merge(X.begin(), X.end(), Y.begin(), Y.end(), P.begin());
+            CHECK(O == P && (oe-O.begin()) == (pe-P.begin()), "merge");
+
+            // stable merge: equal keys of the first range come first
+            std::vector<item> XI(X.size()), YI(Y.size()), OI(n), PI(n);
+            for(size_t i=0;i<X.size();++i) XI[i].key = X[i], XI[i].pos = 0;
+            for(size_t i=0;i<Y.size();++i) YI[i].key = Y[i], YI[i].pos = 1;
+            pa.merge(XI.begin(), XI.end(), YI.begin(), YI.end(), OI.begin(), bykey);
+            std::merge(XI.begin(), XI.end(), YI.begin(), YI.end(), PI.begin(), bykey);
+            CHECK(OI == PI, "merge (stability)");
+
+#define CHECK_SET(op)                                                   \
+            {                                                           \
+                std::fill(O.begin(), O.end(), -1);                      \
+                std::fill(P.begin(), P.end(), -1);                      \
+                oe = pa.op(X.begin(), X.end(), Y.begin(), Y.end(), O.begin()); \
+                pe = std::op(X.begin(), X.end(), Y.begin(), Y.end(), P.begin()); \
+                CHECK(O == P && (oe-O.begin()) == (pe-P.begin()), #op);  \
+            }
+            CHECK_SET(set_union);
+            CHECK_SET(set_intersection);
+            CHECK_SET(set_difference);
+            CHECK_SET(set_symmetric_difference);
+        }
+
+    // the same object is used also for the parallel_for loops
+    std::vector<double> V(N);
+    pa.parallel_for(0, N, [&](const long i) { V[i] = (double)((i*7919)%N); });
+    ffTime(START_TIME);
+    pa.sort(V.begin(), V.end());
+    ffTime(STOP_TIME);
+    printf("parallel sort of %ld doubles: %g (ms)\n", N, ffTime(GET_TIME));
+    if (!std::is_sorted(V.begin(), V.end())) { printf("ERROR: sort of doubles\n"); return -1; }
+    printf("DONE\n");
+    return 0;
+}
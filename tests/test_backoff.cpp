@@ -0,0 +1,151 @@
+/* -*- Mode: C++; tab-width: 4; c-basic-offset: 4; indent-tabs-mode: nil -*- */
+/* ***************************************************************************
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License version 2 as 
+ *  published by the Free Software Foundation.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ *
+ *  As a special exception, you may use this file as part of a free software
+ *  library without restriction.  Specifically, if other files instantiate
+ *  templates or use macros or inline functions from this file, or you compile
+ *  this file and link it with other files to produce an executable, this
+ *  file does not by itself cause the resulting executable to be covered by
+ *  the GNU General Public License.  This exception does not however
+ *  invalidate any other reasons why the executable file might be covered by
+ *  the GNU General Public License.
+ *
+ ****************************************************************************
+ */
+
+/*
+ * Per-node and per-farm backoff policies.
+ *
+ *   pipe( Source, farm(Worker x nw), Stage, Sink )
+ *
+ * Source: the default policy
+ * farm  : exponential backoff (emitter, collector and workers)
+ * Stage : a user-defined policy counting its calls
+ * Sink  : adaptive policy on the input channel, yield on the output one
+ *
+ * The Source pauses every now and then, so that all the other stages 
+ * have to wait on their input channel.
+ */
+
+#include <iostream>
+#include <ff/ff.hpp>
+
+using namespace ff;
+
+struct counting_backoff: ff_backoff {
+    counting_backoff(std::atomic<long>& cnt):cnt(cnt) {}
+    ff_backoff* clone() const { return new counting_backoff(cnt); }
+    const char* name() const { return "counting"; }
+protected:
+    void backoff(unsigned long nticks, ticks) {
+        ++cnt;
+        ticks_wait(nticks);
+    }
+    std::atomic<long>& cnt;
+};
+
+struct Source: ff_node_t<long> {
+    Source(long ntasks):ntasks(ntasks) {}
+    long* svc(long*) {
+        for(long i=1;i<=ntasks;++i) {
+            ff_send_out((long*)i);
+            if ((i % 1000) == 0) usleep(5000);
+        }
+        return EOS;
+    }
+    long ntasks;
+};
+
+struct Worker: ff_node_t<long> {
+    long* svc(long* in) { return in; }
+};
+
+struct Sink: ff_node_t<long> {
+    long* svc(long* in) {
+        sum += (long)in;
+        ++cnt;
+        return GO_ON;
+    }
+    long sum=0, cnt=0;
+};
+
+int main(int argc, char* argv[]) {
+    long nw     = 3;
+    long ntasks = 10000;
+    if (argc>1) {
+        if (argc!=3) {
+            std::cerr << "use: " << argv[0] << " nworkers ntasks\n";
+            return -1;
+        }
+        nw     = atol(argv[1]);
+        ntasks = atol(argv[2]);
+    }
+
+    std::atomic<long> stagecnt(0);
+
+    Source source(ntasks);
+    Worker stage;
+    Sink   sink;
+    ff_Farm<long> farm([nw]() {
+            std::vector<std::unique_ptr<ff_node> > W;
+            for(long i=0;i<nw;++i) W.push_back(make_unique<Worker>());
+            return W;
+        } ());
+    farm.set_backoff(ff_backoff_exp(64, 4096));
+    stage.set_backoff(counting_backoff(stagecnt));
+    sink.set_backoff_in(ff_backoff_adaptive());
+    sink.set_backoff_out(ff_backoff_yield());
+
+    ff_Pipe<> pipe(source, farm, stage, sink);
+    if (pipe.run_and_wait_end()<0) {
+        error("running pipe\n");
+        return -1;
+    }
+    if (sink.cnt != ntasks || sink.sum != ntasks*(ntasks+1)/2) {
+        std::cerr << "wrong result " << sink.cnt << " " << sink.sum << "\n";
+        return -1;
+    }
+
+#if !defined(BLOCKING_MODE)
+    // in blocking mode the nodes wait on the condition variables, the policies
+    // are used only by the nonblocking run-time
+    const ff_backoff* b = sink.get_backoff_in();
+    std::cout << "sink  : " << b->name() << " waits= " << b->get_nwaits()
+              << " phases= " << b->get_nphases() << " ticks= " << b->get_waitticks() << "\n";
+    if (b->get_nwaits() == 0 || b->get_waitticks() == 0 || b->get_nphases() == 0) {
+        std::cerr << "no waiting recorded on the sink input channel\n";
+        return -1;
+    }
+    b = stage.get_backoff_in();
+    std::cout << "stage : " << b->name() << " waits= " << b->get_nwaits() 
+              << " ticks= " << b->get_waitticks() << "\n";
+    if (stagecnt == 0 || (size_t)stagecnt.load() != b->get_nwaits()) {
+        std::cerr << "the stage policy has not been used\n";
+        return -1;
+    }
+#endif
+    if (std::string(source.get_backoff_out() ? "set" : "unset") != 
+#if defined(SPINPARK_MODE)
+        "set"
+#else
+        "unset"
+#endif
+        ) {
+        std::cerr << "the source policy has been changed\n";
+        return -1;
+    }
+    std::cout << "DONE\n";
+    return 0;
+}
@@ -0,0 +1,154 @@
+/* -*- Mode: C++; tab-width: 4; c-basic-offset: 4; indent-tabs-mode: nil -*- */
+/* ***************************************************************************
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License version 2 as 
+ *  published by the Free Software Foundation.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ *
+ *  As a special exception, you may use this file as part of a free software
+ *  library without restriction.  Specifically, if other files instantiate
+ *  templates or use macros or inline functions from this file, or you compile
+ *  this file and link it with other files to produce an executable, this
+ *  file does not by itself cause the resulting executable to be covered by
+ *  the GNU General Public License.  This exception does not however
+ *  invalidate any other reasons why the executable file might be covered by
+ *  the GNU General Public License.
+ *
+ ****************************************************************************
+ */
+
+/*
+ * Batched sends and batched receives.
+ *
+ *   pipe( Source, farm(Worker x nw, Collector) )
+ *
+ * The Source sends tasks in batches using ff_send_out_batch, the workers
+ * and the collector pop batches of tasks from their input channels.
+ * In the second test the farm's channels also use the lookahead.
+ * In the last two tests the channels are bounded and the batches are
+ * larger than the channel capacity.
+ *
+ */
+#include <iostream>
+#include <ff/ff.hpp>
+
+using namespace ff;
+
+struct Source: ff_node_t<long> {
+    Source(long ntasks, size_t bsize):ntasks(ntasks), bsize(bsize) {}
+    long* svc(long*) {
+        std::vector<void*> V(bsize);
+        long i=1;
+        while(i<=ntasks) {
+            size_t n=0;
+            for(; n<bsize && i<=ntasks; ++n, ++i) V[n] = (void*)i;
+            ff_send_out_batch(V.data(), n);
+        }
+        return EOS;
+    }
+    long ntasks;
+    size_t bsize;
+};
+
+struct Worker: ff_node_t<long> {
+    long* svc(long* in) { return in; }
+};
+
+struct Collector: ff_node_t<long> {
+    Collector(long ntasks):ntasks(ntasks) {}
+    long* svc(long* in) {
+        sum += (long)in;
+        ++cnt;
+        return GO_ON;
+    }
+    void svc_end() {
+        if (cnt != ntasks || sum != (ntasks*(ntasks+1))/2) {
+            std::cerr << "Wrong result: received " << cnt << " tasks, sum= " << sum << "\n";
+            exit(-1);
+        }
+    }
+    long ntasks, cnt=0, sum=0;
+};
+
+int main(int argc, char* argv[]) {
+    long   ntasks = 100000;
+    size_t bsize  = 32;
+    size_t nw     = 3;
+    if (argc>1) {
+        if (argc!=4) {
+            std::cerr << "use: " << argv[0] << " ntasks batch-size nworkers\n";
+            return -1;
+        }
+        ntasks = std::stol(argv[1]);
+        bsize  = std::stol(argv[2]);
+        nw     = std::stol(argv[3]);
+    }
+    
+    {   // the Source is the Emitter of the farm
+        std::vector<std::unique_ptr<ff_node> > W;
+        for(size_t i=0;i<nw;++i) W.push_back(make_unique<Worker>());
+        Source    S(ntasks, bsize);
+        Collector C(ntasks);
+        ff_Farm<long> farm(std::move(W), S, C);
+        farm.set_input_batch(bsize);
+        if (farm.run_and_wait_end()<0) {
+            error("running farm\n");
+            return -1;
+        }
+    }
+    {   // the Source is a stage of the pipeline
+        std::vector<std::unique_ptr<ff_node> > W;
+        for(size_t i=0;i<nw;++i) W.push_back(make_unique<Worker>());
+        Source    S(ntasks, bsize);
+        Collector C(ntasks);
+        ff_Farm<long> farm(std::move(W));
+        farm.add_collector(C);
+        farm.set_input_batch(bsize);
+        farm.set_input_lookahead(16);
+        ff_Pipe<> pipe(S, farm);
+        if (pipe.run_and_wait_end()<0) {
+            error("running pipe\n");
+            return -1;
+        }
+    }
+    // with bounded channels the threads wait much more often, less tasks
+    ntasks = ntasks/50 + 1;
+    {   // bounded input channels of the workers, the Source is the Emitter
+        std::vector<std::unique_ptr<ff_node> > W;
+        for(size_t i=0;i<nw;++i) W.push_back(make_unique<Worker>());
+        Source    S(ntasks, 5*bsize);
+        Collector C(ntasks);
+        ff_Farm<long> farm(std::move(W), S, C);
+        farm.setInputQueueLength(bsize, true);
+        farm.setOutputQueueLength(bsize, true);
+        if (farm.run_and_wait_end()<0) {
+            error("running bounded farm\n");
+            return -1;
+        }
+    }
+    {   // bounded channel between the Source and the farm
+        std::vector<std::unique_ptr<ff_node> > W;
+        for(size_t i=0;i<nw;++i) W.push_back(make_unique<Worker>());
+        Source    S(ntasks, 5*bsize);
+        Collector C(ntasks);
+        ff_Farm<long> farm(std::move(W));
+        farm.add_collector(C);
+        ff_Pipe<> pipe(S, farm);
+        pipe.setXNodeInputQueueLength(bsize, true);
+        pipe.setXNodeOutputQueueLength(bsize, true);
+        if (pipe.run_and_wait_end()<0) {
+            error("running bounded pipe\n");
+            return -1;
+        }
+    }
+    std::cout << "Done\n";
+    return 0;
+}
@@ -0,0 +1,110 @@
+/* -*- Mode: C++; tab-width: 4; c-basic-offset: 4; indent-tabs-mode: nil -*- */
+/* ***************************************************************************
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License version 2 as
+ *  published by the Free Software Foundation.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ *
+ *  As a special exception, you may use this file as part of a free software
+ *  library without restriction.  Specifically, if other files instantiate
+ *  templates or use macros or inline functions from this file, or you compile
+ *  this file and link it with other files to produce an executable, this
+ *  file does not by itself cause the resulting executable to be covered by
+ *  the GNU General Public License.  This exception does not however
+ *  invalidate any other reasons why the executable file might be covered by
+ *  the GNU General Public License.
+ *
+ ****************************************************************************
+ */
+
+/*
+ * Iterative broadcast and all-gather.
+ *
+ *           ----------------------------------
+ *          |                                  |
+ *          v      | --> Worker -->|           |
+ *        Emitter->|      ...      |--> Collector
+ *                 | --> Worker -->|
+ *
+ * At each iteration the Emitter broadcasts the iteration number to all the
+ * workers, the Collector gathers one result from each worker (all_gather),
+ * checks them and sends the iteration number back to the Emitter.
+ */
+
+#include <iostream>
+#include <ff/ff.hpp>
+
+using namespace ff;
+
+struct Emitter: ff_monode_t<long> {
+    Emitter(long niter):niter(niter) {}
+    long* svc(long* t) {
+        long i = (long)t;
+        if (t == nullptr) i = 0;   // first call, no input
+        else if (i != iter) {
+            error("Emitter, wrong iteration %ld (expected %ld)\n", i, iter);
+            return EOS;
+        }
+        if (++iter > niter) return EOS;
+        broadcast_task((long*)iter);
+        return GO_ON;
+    }
+    long niter, iter=0;
+};
+
+struct Worker: ff_node_t<long> {
+    long* svc(long* t) { return t; }
+};
+
+struct Collector: ff_minode_t<long> {
+    long* svc(long* t) {
+        std::vector<long*> V;
+        all_gather(t, V);
+        for(size_t i=0;i<V.size();++i)
+            if (V[i] != t) {
+                error("Collector, wrong value from worker %ld\n", i);
+                ++errors;
+            }
+        ++niter;
+        return t;
+    }
+    long niter=0, errors=0;
+};
+
+int main(int argc, char* argv[]) {
+    int  nworkers = 16;
+    long niter    = 50;
+    if (argc>1) {
+        if (argc<3) {
+            std::cerr << "use: " << argv[0] << " nworkers niter\n";
+            return -1;
+        }
+        nworkers = atoi(argv[1]);
+        niter    = atol(argv[2]);
+    }
+    Emitter   E(niter);
+    Collector C;
+    std::vector<ff_node*> W;
+    for(int i=0;i<nworkers;++i) W.push_back(new Worker);
+    ff_farm farm(W, &E, &C);
+    farm.cleanup_workers();
+    farm.wrap_around();
+    if (farm.run_and_wait_end()<0) {
+        error("running farm\n");
+        return -1;
+    }
+    if (C.errors || C.niter != niter) {
+        std::cerr << "ERROR: " << C.niter << " iterations, " << C.errors << " errors\n";
+        return -1;
+    }
+    std::cout << "DONE\n";
+    return 0;
+}
@@ -0,0 +1,149 @@
+/* -*- Mode: C++; tab-width: 4; c-basic-offset: 4; indent-tabs-mode: nil -*- */
+/* ***************************************************************************
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License version 2 as 
+ *  published by the Free Software Foundation.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ *
+ *  As a special exception, you may use this file as part of a free software
+ *  library without restriction.  Specifically, if other files instantiate
+ *  templates or use macros or inline functions from this file, or you compile
+ *  this file and link it with other files to produce an executable, this
+ *  file does not by itself cause the resulting executable to be covered by
+ *  the GNU General Public License.  This exception does not however
+ *  invalidate any other reasons why the executable file might be covered by
+ *  the GNU General Public License.
+ *
+ ****************************************************************************
+ */
+
+/*
+ * Typed channels carrying small values instead of pointers to heap allocated tasks.
+ *
+ *   pipe( Source, farm(Worker x nw, Collector), Sink )
+ *
+ * Source   : ff_node_t<char, by_value<point_t> >
+ * Worker   : ff_node_t<by_value<point_t>, by_value<double> >
+ * Collector: ff_node_t<by_value<double> >
+ * Sink     : ff_node_t<by_value<double>, char>
+ *
+ * Then a pipeline and a farm where a by_value channel has a consumer that
+ * is not a by_value node: they must fail to start.
+ *
+ */
+
+#include <iostream>
+#include <ff/ff.hpp>
+
+using namespace ff;
+
+struct point_t {
+    long   id;
+    double x, y;
+};
+
+struct Source: ff_node_t<char, by_value<point_t> > {
+    Source(long ntasks):ntasks(ntasks) {}
+    point_t* svc(char*) {
+        point_t p;
+        for(long i=1;i<=ntasks;++i) {
+            p.id = i; p.x = i; p.y = 2*i;
+            ff_send_out(&p);   // the value is copied, p can be reused
+        }
+        return EOS;
+    }
+    long ntasks;
+};
+
+struct Worker: ff_node_t<by_value<point_t>, by_value<double> > {
+    double* svc(point_t* p) {
+        r = p->x + p->y;
+        return &r;            // the value is copied
+    }
+    double r;
+};
+
+struct Collector: ff_node_t<by_value<double> > {
+    double* svc(double* in) { return in; }  // forwarding the input value
+};
+
+struct Sink: ff_node_t<by_value<double>, char> {
+    Sink(long ntasks):ntasks(ntasks) {}
+    char* svc(double* in) {
+        sum += *in;
+        ++cnt;
+        return GO_ON;
+    }
+    void svc_end() {
+        // sum of 3*i for i in [1..ntasks]
+        if (cnt != ntasks || sum != 3.0*(ntasks*(ntasks+1))/2) {
+            std::cerr << "Wrong result: received " << cnt << " tasks, sum= " << sum << "\n";
+            exit(-1);
+        }
+    }
+    long ntasks, cnt=0;
+    double sum=0.0;
+};
+
+// it does not give the slots back to the Source's pool
+struct PtrSink: ff_node_t<point_t, char> {
+    char* svc(point_t*) { return GO_ON; }
+};
+
+int main(int argc, char* argv[]) {
+    long   ntasks = 5000;
+    size_t nw     = 3;
+    if (argc>1) {
+        if (argc!=3) {
+            std::cerr << "use: " << argv[0] << " ntasks nworkers\n";
+            return -1;
+        }
+        ntasks = std::stol(argv[1]);
+        nw     = std::stol(argv[2]);
+    }
+    
+    Source    S(ntasks);
+    S.set_value_pool_size(64);  // at most 64 tasks in flight produced by the Source
+    Sink      K(ntasks);
+    Collector C;
+    std::vector<std::unique_ptr<ff_node> > W;
+    for(size_t i=0;i<nw;++i) W.push_back(make_unique<Worker>());
+    ff_Farm<by_value<point_t>, by_value<double> > farm(std::move(W));
+    farm.add_collector(C);
+
+    ff_Pipe<> pipe(S, farm, K);
+    if (pipe.run_and_wait_end()<0) {
+        error("running pipe\n");
+        return -1;
+    }
+    {
+        Source  S(ntasks);
+        PtrSink P;
+        ff_Pipe<> pipe(S, P);
+        if (pipe.run_and_wait_end()==0) {
+            error("the pipe with a wrong by_value consumer has been run\n");
+            return -1;
+        }
+    }
+    {
+        Source S(ntasks);
+        std::vector<std::unique_ptr<ff_node> > W;
+        for(size_t i=0;i<nw;++i) W.push_back(make_unique<PtrSink>());
+        ff_Farm<point_t> farm(std::move(W), S);
+        farm.remove_collector();
+        if (farm.run_and_wait_end()==0) {
+            error("the farm with wrong by_value workers has been run\n");
+            return -1;
+        }
+    }
+    std::cout << "Done\n";
+    return 0;
+}
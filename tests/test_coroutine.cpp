@@ -0,0 +1,154 @@
+/* -*- Mode: C++; tab-width: 4; c-basic-offset: 4; indent-tabs-mode: nil -*- */
+/* ***************************************************************************
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License version 2 as
+ *  published by the Free Software Foundation.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ *
+ *  As a special exception, you may use this file as part of a free software
+ *  library without restriction.  Specifically, if other files instantiate
+ *  templates or use macros or inline functions from this file, or you compile
+ *  this file and link it with other files to produce an executable, this
+ *  file does not by itself cause the resulting executable to be covered by
+ *  the GNU General Public License.  This exception does not however
+ *  invalidate any other reasons why the executable file might be covered by
+ *  the GNU General Public License.
+ *
+ ****************************************************************************
+ */
+
+/*
+ * Stream nodes written as C++20 coroutines (ff_node_co).
+ *
+ *   ff_Pipe(Source, Split, Batch, Sink)
+ *
+ * Source generates the numbers 1..ntasks, Split sends out k copies of
+ * each input divided by k, Batch sums groups of n inputs and sends out
+ * the last (partial) group when the stream ends. The same pipeline with
+ * many Split stages is then run on a few executor threads.
+ *
+ * It requires -std=c++20.
+ */
+
+#include <iostream>
+#include <ff/ff.hpp>
+#include <ff/coroutine.hpp>
+
+using namespace ff;
+
+struct Source: ff_node_co<long> {
+    Source(long ntasks):ntasks(ntasks) {}
+    coroutine body() {
+        for(long i=1;i<=ntasks;++i) co_yield new long(i);
+    }
+    long ntasks;
+};
+struct Split: ff_node_co<long> {
+    Split(long k):k(k) {}
+    coroutine body() {
+        while(long *t = co_await in()) {
+            for(long i=0;i<k;++i) co_yield new long(*t);
+            delete t;
+        }
+    }
+    long k;
+};
+struct Merge: ff_node_co<long> {
+    Merge(long k):k(k) {}
+    coroutine body() {
+        while(long *t = co_await in()) {
+            for(long i=1;i<k;++i) {
+                long *s = co_await in();
+                if (!s) { error("Merge: partial group\n"); co_return; }
+                delete s;
+            }
+            co_yield t;
+        }
+    }
+    long k;
+};
+struct Batch: ff_node_co<long> {
+    Batch(long n):n(n) {}
+    coroutine body() {
+        long sum = 0, cnt = 0;
+        while(long *t = co_await in()) {
+            sum += *t;
+            delete t;
+            if (++cnt == n) { co_yield new long(sum); sum = cnt = 0; }
+        }
+        if (cnt) co_yield new long(sum);
+    }
+    long n;
+};
+struct Sink: ff_node_t<long> {
+    long* svc(long* t) { sum += *t; ++cnt; delete t; return GO_ON; }
+    long sum=0, cnt=0;
+};
+
+int main(int argc, char* argv[]) {
+    long ntasks = 10000;
+    long k      = 3;
+    long batch  = 7;
+    int  nsplit = 100;
+    if (argc>1) {
+        if (argc<5) {
+            std::cerr << "use: " << argv[0] << " ntasks k batch nsplit\n";
+            return -1;
+        }
+        ntasks = atol(argv[1]);
+        k      = atol(argv[2]);
+        batch  = atol(argv[3]);
+        nsplit = atoi(argv[4]);
+    }
+    const long expected = ntasks*(ntasks+1)/2;
+    {
+        Source S(ntasks); Split P(k); Merge M(k); Batch B(batch); Sink K;
+        ff_Pipe<> pipe(S, P, M, B, K);
+        for(int i=0;i<2;++i) {  // the bodies start again at each run
+            K.sum = K.cnt = 0;
+            if (pipe.run_then_freeze()<0 || pipe.wait_freezing()<0) {
+                error("running pipeline\n");
+                return -1;
+            }
+            if (K.sum != expected || K.cnt != (ntasks+batch-1)/batch) {
+                std::cerr << "ERROR: wrong result " << K.sum << " (" << K.cnt << " batches)\n";
+                return -1;
+            }
+        }
+        if (pipe.wait()<0) return -1;
+    }
+    ff_executor *E = ff_executor::instance();
+    if (E->start(2)<0) return -1;
+    {
+        Source S(ntasks); Batch B(1); Sink K;
+        ff_pipeline pipe(false, 16, 16, true); // small bounded channels
+        pipe.add_stage(&S);
+        for(int i=0;i<nsplit;++i) {
+            pipe.add_stage(new Split(k), true);
+            pipe.add_stage(new Merge(k), true);
+        }
+        pipe.add_stage(&B);
+        pipe.add_stage(&K);
+        if (pipe.run_and_wait_end()<0) {
+            error("running pipeline\n");
+            return -1;
+        }
+        if (K.sum != expected || K.cnt != ntasks) {
+            std::cerr << "ERROR: wrong result " << K.sum << "\n";
+            return -1;
+        }
+        std::cout << "pipeline: " << 2*nsplit+3 << " coroutine nodes on "
+                  << E->get_nthreads() << " executors\n";
+    }
+    E->stop();
+    std::cout << "DONE\n";
+    return 0;
+}
@@ -0,0 +1,137 @@
+/* -*- Mode: C++; tab-width: 4; c-basic-offset: 4; indent-tabs-mode: nil -*- */
+/* ***************************************************************************
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License version 2 as
+ *  published by the Free Software Foundation.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ *
+ *  As a special exception, you may use this file as part of a free software
+ *  library without restriction.  Specifically, if other files instantiate
+ *  templates or use macros or inline functions from this file, or you compile
+ *  this file and link it with other files to produce an executable, this
+ *  file does not by itself cause the resulting executable to be covered by
+ *  the GNU General Public License.  This exception does not however
+ *  invalidate any other reasons why the executable file might be covered by
+ *  the GNU General Public License.
+ *
+ ****************************************************************************
+ */
+
+/*
+ * Elastic farm.
+ *
+ *                  | --> Worker -->|
+ *                  |               |
+ *        Emitter-->| --> Worker -->| --> Collector
+ *                  |      ...      |
+ *                  | --> Worker -->|
+ *
+ * The Emitter first sends few tasks slowly, then many tasks at full speed
+ * (on-demand scheduling).
+ * The number of active workers has to decrease in the first phase and to
+ * increase in the second one, within the bounds of the controller.
+ * The farm is run twice, no task has to be lost.
+ */
+
+#include <iostream>
+#include <chrono>
+#include <thread>
+#include <ff/ff.hpp>
+
+using namespace ff;
+
+static void busy(long us) {
+    auto t = std::chrono::steady_clock::now() + std::chrono::microseconds(us);
+    while(std::chrono::steady_clock::now() < t);
+}
+
+struct Emitter: ff_node_t<long> {
+    Emitter(long nslow, long nfast):nslow(nslow),nfast(nfast) {}
+    long* svc(long*) {
+        long k=1;
+        for(long i=0;i<nslow;++i,++k) {
+            std::this_thread::sleep_for(std::chrono::microseconds(500));
+            ff_send_out((long*)k);
+        }
+        for(long i=0;i<nfast;++i,++k) ff_send_out((long*)k);
+        return EOS;
+    }
+    long nslow, nfast;
+};
+
+struct Worker: ff_node_t<long> {
+    long* svc(long* t) {
+        busy(1000);
+        return t;
+    }
+};
+
+struct Collector: ff_node_t<long> {
+    int svc_init() { sum=0; cnt=0; return 0; }
+    long* svc(long* t) {
+        sum += (long)t; ++cnt;
+        return GO_ON;
+    }
+    long sum=0, cnt=0;
+};
+
+int main(int argc, char* argv[]) {
+    int  nworkers = 6;
+    long nslow    = 200;
+    long nfast    = 300;
+    if (argc>1) {
+        if (argc<4) {
+            std::cerr << "use: " << argv[0] << " nworkers nslow nfast\n";
+            return -1;
+        }
+        nworkers = atoi(argv[1]);
+        nslow    = atol(argv[2]);
+        nfast    = atol(argv[3]);
+    }
+    const long ntasks   = nslow+nfast;
+    const long expected = ntasks*(ntasks+1)/2;
+    const size_t minw = 2;
+
+    Emitter   E(nslow, nfast);
+    Collector C;
+    std::vector<ff_node*> W;
+    for(int i=0;i<nworkers;++i) W.push_back(new Worker);
+    ff_farm farm(W, &E, &C);
+    farm.cleanup_workers();
+    farm.set_scheduling_ondemand(16);
+    farm.set_elastic(ff_elastic(minw, nworkers, 0.75, 5));
+
+    for(int k=0;k<2;++k) {
+        if (farm.run_then_freeze()<0 || farm.wait_freezing()<0) {
+            error("running farm\n");
+            return -1;
+        }
+        if (C.cnt != ntasks || C.sum != expected) {
+            std::cerr << "ERROR: received " << C.cnt << " tasks\n";
+            return -1;
+        }
+        const ff_elastic* e = farm.get_elastic();
+        std::cout << "run " << k << ": grow= " << e->get_ngrow()
+                  << " shrink= " << e->get_nshrink() << "\n";
+        if (e->get_nactive() < minw || e->get_nactive() > (size_t)nworkers) {
+            std::cerr << "ERROR: " << e->get_nactive() << " active workers\n";
+            return -1;
+        }
+    }
+    const ff_elastic* e = farm.get_elastic();
+    if (e->get_nshrink()==0 || e->get_ngrow()==0) {
+        std::cerr << "ERROR: the number of workers has not changed\n";
+        return -1;
+    }
+    farm.wait();
+    std::cout << "DONE\n";
+    return 0;
+}
@@ -0,0 +1,136 @@
+/* -*- Mode: C++; tab-width: 4; c-basic-offset: 4; indent-tabs-mode: nil -*- */
+/* ***************************************************************************
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License version 2 as
+ *  published by the Free Software Foundation.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ *
+ *  As a special exception, you may use this file as part of a free software
+ *  library without restriction.  Specifically, if other files instantiate
+ *  templates or use macros or inline functions from this file, or you compile
+ *  this file and link it with other files to produce an executable, this
+ *  file does not by itself cause the resulting executable to be covered by
+ *  the GNU General Public License.  This exception does not however
+ *  invalidate any other reasons why the executable file might be covered by
+ *  the GNU General Public License.
+ *
+ ****************************************************************************
+ */
+
+/*
+ * M:N execution of the nodes on a few executor threads.
+ *
+ *   pipe(Source, Stage x nstages, farm(Worker x nw, Collector), Sink)
+ *
+ * The graph has many more nodes than executor threads. The pipeline is
+ * run twice with freezing (the frozen nodes do not use any executor) and
+ * then a2a(Source x 4, Sink x 4) is run until the end.
+ */
+
+#include <iostream>
+#include <ff/ff.hpp>
+
+using namespace ff;
+
+struct Source: ff_node_t<long> {
+    Source(long ntasks):ntasks(ntasks) {}
+    long* svc(long*) {
+        for(long i=1;i<=ntasks;++i) ff_send_out((long*)i);
+        return EOS;
+    }
+    long ntasks;
+};
+struct Stage: ff_node_t<long> {
+    long* svc(long* t) { return t; }
+};
+struct Worker: ff_node_t<long> {
+    long* svc(long* t) { ticks_wait(100); return t; }
+};
+struct Collector: ff_node_t<long> {
+    long* svc(long* t) { return t; }
+};
+struct Sink: ff_node_t<long> {
+    int  svc_init() { sum=0; return 0; }
+    long* svc(long* t) { sum += (long)t; return GO_ON; }
+    void svc_end()  { ++nend; }
+    long sum=0, nend=0;
+};
+
+int main(int argc, char* argv[]) {
+    int  nexecutors = 2;
+    int  nstages    = 50;
+    int  nworkers   = 16;
+    long ntasks     = 5000;
+    if (argc>1) {
+        if (argc<5) {
+            std::cerr << "use: " << argv[0] << " nexecutors nstages nworkers ntasks\n";
+            return -1;
+        }
+        nexecutors = atoi(argv[1]);
+        nstages    = atoi(argv[2]);
+        nworkers   = atoi(argv[3]);
+        ntasks     = atol(argv[4]);
+    }
+    const long expected = ntasks*(ntasks+1)/2;
+    ff_executor *E = ff_executor::instance();
+    if (E->start(nexecutors)<0) return -1;
+    {
+        Source S(ntasks); Collector C; Sink K;
+        std::vector<ff_node*> W;
+        for(int i=0;i<nworkers;++i) W.push_back(new Worker);
+        ff_farm farm(W, nullptr, &C);
+        farm.cleanup_workers();
+        ff_pipeline pipe(false, 16, 16, true); // small bounded channels
+        pipe.add_stage(&S);
+        for(int i=0;i<nstages;++i) pipe.add_stage(new Stage, true);
+        pipe.add_stage(&farm);
+        pipe.add_stage(&K);
+        for(int i=0;i<2;++i) {
+            if (pipe.run_then_freeze()<0 || pipe.wait_freezing()<0) {
+                error("running pipeline\n");
+                return -1;
+            }
+            if (K.sum != expected || K.nend != i+1) {
+                std::cerr << "ERROR: wrong result " << K.sum << "\n";
+                return -1;
+            }
+        }
+        if (pipe.wait()<0) return -1;
+        std::cout << "pipeline: " << nstages+nworkers+5 << " nodes on "
+                  << E->get_nthreads() << " executors\n";
+    }
+    {
+        std::vector<ff_node*> L, R;
+        for(int i=0;i<4;++i) L.push_back(new Source(ntasks));
+        for(int i=0;i<4;++i) R.push_back(new Sink);
+        ff_a2a a2a;
+        a2a.add_firstset(L, 0, true);
+        a2a.add_secondset(R, true);
+        if (a2a.run_and_wait_end()<0) {
+            error("running a2a\n");
+            return -1;
+        }
+        long sum=0;
+        for(auto r: R) sum += ((Sink*)r)->sum;
+        if (sum != 4*expected) {
+            std::cerr << "ERROR: wrong a2a result " << sum << "\n";
+            return -1;
+        }
+    }
+    if (E->get_nfibers() != 0 || E->get_nyields() == 0) {
+        std::cerr << "ERROR: " << E->get_nfibers() << " fibers alive, "
+                  << E->get_nyields() << " yields\n";
+        return -1;
+    }
+    E->stop();
+    std::cout << "DONE\n";
+    return 0;
+}
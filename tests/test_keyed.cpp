@@ -0,0 +1,241 @@
+/* -*- Mode: C++; tab-width: 4; c-basic-offset: 4; indent-tabs-mode: nil -*- */
+/* ***************************************************************************
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License version 2 as 
+ *  published by the Free Software Foundation.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ *
+ *  As a special exception, you may use this file as part of a free software
+ *  library without restriction.  Specifically, if other files instantiate
+ *  templates or use macros or inline functions from this file, or you compile
+ *  this file and link it with other files to produce an executable, this
+ *  file does not by itself cause the resulting executable to be covered by
+ *  the GNU General Public License.  This exception does not however
+ *  invalidate any other reasons why the executable file might be covered by
+ *  the GNU General Public License.
+ *
+ ****************************************************************************
+ */
+
+/*
+ * Keyed scheduling.
+ *
+ *   farm(Emitter, Counter x nw)            keys are partitioned among workers
+ *   farm(Counter x nw) as accelerator      consistent hashing, thawed with 
+ *                                          fewer workers
+ *   farm(Emitter, Counter x nw)            skewed keys, hot key rebalancing
+ *   a2a(Emitter x 2, Counter x nw)         keyed all-to-all
+ *   farm(Emitter, Counter x nw)            the Emitter sends out the EOS
+ *                                          (and then it ends or goes out)
+ *
+ * Each worker counts the tasks of its keys in a private table; the test 
+ * checks that each key is seen by the expected number of workers.
+ */
+
+#include <iostream>
+#include <atomic>
+#include <map>
+#include <ff/ff.hpp>
+
+using namespace ff;
+
+const long NKEYS = 64;
+
+struct Task {
+    Task(long key, long value):key(key),value(value) {}
+    long key;
+    long value;
+};
+
+// which workers have seen a key (bitmask)
+static std::atomic<unsigned long> seenby[NKEYS];
+static std::atomic<long> total;
+static void reset() {
+    for(long k=0;k<NKEYS;++k) seenby[k]=0;
+    total=0;
+}
+static long nowners(long k) { return __builtin_popcountl(seenby[k].load()); }
+
+struct Emitter: ff_node_t<Task> {
+    Emitter(long ntasks, bool skewed=false, bool sendeos=false, bool goout=true):
+        ntasks(ntasks),skewed(skewed),sendeos(sendeos),goout(goout) {}
+    Task* svc(Task*) {
+        for(long i=0;i<ntasks;++i) {
+            long key = (skewed && (i%2==0)) ? 0 : (i*7)%NKEYS;
+            ff_send_out(new Task(key, i));
+        }
+        if (sendeos) {  // the tags do not reach the key function
+            ff_send_out(EOS);
+            if (goout) return GO_OUT;
+        }
+        return EOS;
+    }
+    long ntasks;
+    bool skewed;
+    bool sendeos;
+    bool goout;
+};
+
+struct Counter: ff_node_t<Task> {
+    Counter(int id):id(id) {}
+    Task* svc(Task* t) {
+        ++table[t->key];                     // private state, no locking
+        seenby[t->key] |= (1UL << id);
+        total += t->value;
+        delete t;
+        return GO_ON;
+    }
+    int id;
+    std::map<long, long> table;
+};
+
+static bool check(long ntasks, long maxowners) {
+    if (total != ntasks*(ntasks-1)/2) {
+        std::cerr << "wrong total " << total << "\n";
+        return false;
+    }
+    for(long k=0;k<NKEYS;++k) 
+        if (nowners(k) > maxowners) {
+            std::cerr << "key " << k << " computed by " << nowners(k) << " workers\n";
+            return false;
+        }
+    return true;
+}
+
+int main(int argc, char* argv[]) {
+    long ntasks = 100000;
+    int  nw     = 4;
+    if (argc>1) {
+        if (argc!=3) {
+            std::cerr << "use: " << argv[0] << " ntasks nworkers\n";
+            return -1;
+        }
+        ntasks = std::stol(argv[1]);
+        nw     = std::stol(argv[2]);
+    }
+    auto key = [](Task* t) { return t->key; };
+    {
+        reset();
+        Emitter E(ntasks);
+        std::vector<std::unique_ptr<ff_node> > W;
+        for(int i=0;i<nw;++i) W.push_back(make_unique<Counter>(i));
+        ff_Farm<Task> farm(std::move(W), E);
+        farm.remove_collector();
+        farm.set_scheduling_bykey<Task>(key);
+        if (farm.run_and_wait_end()<0) {
+            error("running farm\n");
+            return -1;
+        }
+        if (!check(ntasks, 1)) return -1;
+    }
+    {
+        // consistent hashing: with one worker less only its keys move
+        reset();
+        std::vector<std::unique_ptr<ff_node> > W;
+        for(int i=0;i<nw;++i) W.push_back(make_unique<Counter>(i));
+        ff_Farm<Task> farm(std::move(W), true);
+        farm.remove_collector();
+        farm.set_scheduling_bykey<Task>(key, true);
+        unsigned long before[NKEYS];
+        for(int run=0;run<2;++run) {
+            const int n = (run==0) ? nw : nw-1;
+            if (farm.run_then_freeze(n)<0) {
+                error("running farm\n");
+                return -1;
+            }
+            for(long i=0;i<ntasks;++i) farm.offload(new Task((i*7)%NKEYS, i));
+            farm.offload(farm.EOS);
+            if (farm.wait_freezing()<0) {
+                error("waiting farm\n");
+                return -1;
+            }
+            if (!check(ntasks, 1)) return -1;
+            if (run==0) {
+                for(long k=0;k<NKEYS;++k) before[k] = seenby[k];
+            } else {
+                for(long k=0;k<NKEYS;++k) 
+                    if (before[k] != (1UL<<(nw-1)) && seenby[k] != before[k]) {
+                        std::cerr << "key " << k << " moved\n";
+                        return -1;
+                    }
+            }
+            reset();
+        }
+        farm.wait();
+    }
+    {
+        // half of the tasks have key 0
+        reset();
+        Emitter E(ntasks, true);
+        std::vector<std::unique_ptr<ff_node> > W;
+        for(int i=0;i<nw;++i) W.push_back(make_unique<Counter>(i));
+        ff_Farm<Task> farm(std::move(W), E);
+        farm.remove_collector();
+        farm.set_scheduling_bykey<Task>(key, false, true);
+        if (farm.run_and_wait_end()<0) {
+            error("running farm\n");
+            return -1;
+        }
+        if (!check(ntasks, 2)) return -1;
+        if (nw>1 && (nowners(0) != 2 || farm.get_keyrouter()->get_nrebalanced()==0)) {
+            std::cerr << "hot key not rebalanced\n";
+            return -1;
+        }
+        std::cout << "hot key tasks rebalanced " << farm.get_keyrouter()->get_nrebalanced() << "\n";
+    }
+    {
+        reset();
+        std::vector<ff_node*> L, R;
+        for(int i=0;i<2;++i) L.push_back(new Emitter(ntasks/2));
+        for(int i=0;i<nw;++i) R.push_back(new Counter(i));
+        ff_a2a a2a;
+        a2a.add_firstset(L, 0, true);
+        a2a.add_secondset(R, true);
+        a2a.set_scheduling_bykey<Task>(key);
+        if (a2a.run_and_wait_end()<0) {
+            error("running a2a\n");
+            return -1;
+        }
+        const long n = ntasks/2;
+        if (total != 2*(n*(n-1)/2)) {
+            std::cerr << "wrong total (a2a) " << total << "\n";
+            return -1;
+        }
+        for(long k=0;k<NKEYS;++k) 
+            if (nowners(k) > 1) {
+                std::cerr << "key " << k << " computed by " << nowners(k) << " workers (a2a)\n";
+                return -1;
+            }
+    }
+    for(int goout=1;goout>=0;--goout) {
+        reset();
+        Emitter E(ntasks, false, true, goout);
+        std::vector<std::unique_ptr<ff_node> > W;
+        for(int i=0;i<nw;++i) W.push_back(make_unique<Counter>(i));
+        ff_Farm<Task> farm(std::move(W), E);
+        farm.remove_collector();
+        farm.set_scheduling_bykey<Task>(key);
+        if (farm.run_and_wait_end()<0) {
+            error("running farm (EOS)\n");
+            return -1;
+        }
+        if (!check(ntasks, 1)) return -1;
+        // each worker has got exactly one EOS
+        const svector<ff_node*> &w = farm.getWorkers();
+        for(size_t i=0;i<w.size();++i)
+            if (!w[i]->get_in_buffer()->empty()) {
+                std::cerr << "worker " << i << " has got more than one EOS\n";
+                return -1;
+            }
+    }
+    std::cout << "Done\n";
+    return 0;
+}
@@ -0,0 +1,168 @@
+/* -*- Mode: C++; tab-width: 4; c-basic-offset: 4; indent-tabs-mode: nil -*- */
+/* ***************************************************************************
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License version 2 as
+ *  published by the Free Software Foundation.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ *
+ *  As a special exception, you may use this file as part of a free software
+ *  library without restriction.  Specifically, if other files instantiate
+ *  templates or use macros or inline functions from this file, or you compile
+ *  this file and link it with other files to produce an executable, this
+ *  file does not by itself cause the resulting executable to be covered by
+ *  the GNU General Public License.  This exception does not however
+ *  invalidate any other reasons why the executable file might be covered by
+ *  the GNU General Public License.
+ *
+ ****************************************************************************
+ */
+
+/*
+ * Sampled latency tracing.
+ *
+ *   pipe(Source, Stage, farm(Worker x nw, Collector), Sink)
+ *   farm(Emitter, Worker x nw)                              no Collector
+ *
+ * One task out of 16 is traced, each sampled task has to reach the end
+ * of the stream (or be dropped because the table is full).
+ */
+
+#include <iostream>
+#include <chrono>
+#include <ff/ff.hpp>
+
+using namespace ff;
+
+static void busy(long us) {
+    auto t = std::chrono::steady_clock::now() + std::chrono::microseconds(us);
+    while(std::chrono::steady_clock::now() < t);
+}
+
+struct Source: ff_node_t<long> {
+    Source(long ntasks):ntasks(ntasks) {}
+    long* svc(long*) {
+        for(long i=1;i<=ntasks;++i) ff_send_out((long*)i);
+        return EOS;
+    }
+    long ntasks;
+};
+struct Stage: ff_node_t<long> {
+    long* svc(long* t) { busy(2); return t; }
+};
+struct Worker: ff_node_t<long> {
+    long* svc(long* t) { busy(10); return t; }
+};
+struct Collector: ff_node_t<long> {
+    long* svc(long* t) { return t; }
+};
+struct Sink: ff_node_t<long> {
+    long* svc(long* t) { sum += (long)t; return GO_ON; }
+    long sum=0;
+};
+
+static bool check(const ff_latency_tracer *T, const char *stage, long nsamples) {
+    const ff_histogram &E = T->end2end();
+    if (E.get_count() + T->dropped() != (uint64_t)nsamples) {
+        std::cerr << "ERROR: " << E.get_count() << " samples, " << T->dropped() 
+                  << " dropped, expected " << nsamples << "\n";
+        return false;
+    }
+    const ff_histogram *S = T->stage(stage);
+    if (!S || S->get_count() == 0) {
+        std::cerr << "ERROR: no samples in stage " << stage << "\n";
+        return false;
+    }
+    if (!(E.percentile(0.5) <= E.percentile(0.99) && E.percentile(0.99) <= E.percentile(0.999) &&
+          E.percentile(0.999) <= E.get_max() && E.get_min() <= E.percentile(0.5))) {
+        std::cerr << "ERROR: wrong percentiles\n";
+        return false;
+    }
+    // a stage cannot take more than the whole stream
+    if (S->get_mean() > E.get_max()) {
+        std::cerr << "ERROR: stage " << stage << " slower than end-to-end\n";
+        return false;
+    }
+    return true;
+}
+
+int main(int argc, char* argv[]) {
+    int  nworkers = 4;
+    long ntasks   = 8000;
+    if (argc>1) {
+        if (argc<3) {
+            std::cerr << "use: " << argv[0] << " nworkers ntasks\n";
+            return -1;
+        }
+        nworkers = atoi(argv[1]);
+        ntasks   = atol(argv[2]);
+    }
+    const size_t sample = 16;
+
+    {   // relative error of the histogram
+        ff_histogram H;
+        for(uint64_t v=1;v<=100000;++v) H.record(v*10);
+        const double p50 = (double)H.percentile(0.5), p99 = (double)H.percentile(0.99);
+        if (p50 < 500000*0.97 || p50 > 500000*1.03 || p99 < 990000*0.97 || p99 > 990000*1.03 ||
+            H.get_min()!=10 || H.get_max()!=1000000) {
+            std::cerr << "ERROR: histogram p50=" << p50 << " p99=" << p99 << "\n";
+            return -1;
+        }
+    }
+    {
+        Source S(ntasks); Stage A; Collector C; Sink K;
+        std::vector<ff_node*> W;
+        for(int i=0;i<nworkers;++i) W.push_back(new Worker);
+        ff_farm farm(W, nullptr, &C);
+        farm.cleanup_workers();
+        ff_pipeline pipe;
+        pipe.add_stage(&S);
+        pipe.add_stage(&A);
+        pipe.add_stage(&farm);
+        pipe.add_stage(&K);
+        pipe.set_latency_tracing(sample);
+        if (pipe.run_and_wait_end()<0) {
+            error("running pipeline\n");
+            return -1;
+        }
+        if (K.sum != ntasks*(ntasks+1)/2) {
+            std::cerr << "ERROR: wrong result\n";
+            return -1;
+        }
+        const ff_latency_tracer *T = pipe.get_latency_tracer();
+        T->print(std::cout);
+        if (!check(T, "2.workers", ntasks/sample) || !T->stage("2.collector") || !T->stage("3"))
+            return -1;
+        // the tracer is in use by the stages, it cannot be replaced
+        pipe.set_latency_tracing(sample);
+        if (pipe.get_latency_tracer() != T) {
+            std::cerr << "ERROR: the tracer has been replaced after the run\n";
+            return -1;
+        }
+    }
+    {
+        Source E(ntasks);
+        std::vector<ff_node*> W;
+        for(int i=0;i<nworkers;++i) W.push_back(new Worker);
+        ff_farm farm(W, &E);
+        farm.cleanup_workers();
+        farm.remove_collector();
+        farm.set_latency_tracing(sample);
+        if (farm.run_and_wait_end()<0) {
+            error("running farm\n");
+            return -1;
+        }
+        const ff_latency_tracer *T = farm.get_latency_tracer();
+        T->print(std::cout);
+        if (!check(T, "workers", ntasks/sample)) return -1;
+    }
+    std::cout << "DONE\n";
+    return 0;
+}
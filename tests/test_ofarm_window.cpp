@@ -0,0 +1,123 @@
+/* -*- Mode: C++; tab-width: 4; c-basic-offset: 4; indent-tabs-mode: nil -*- */
+/* ***************************************************************************
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License version 2 as
+ *  published by the Free Software Foundation.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ *
+ *  As a special exception, you may use this file as part of a free software
+ *  library without restriction.  Specifically, if other files instantiate
+ *  templates or use macros or inline functions from this file, or you compile
+ *  this file and link it with other files to produce an executable, this
+ *  file does not by itself cause the resulting executable to be covered by
+ *  the GNU General Public License.  This exception does not however
+ *  invalidate any other reasons why the executable file might be covered by
+ *  the GNU General Public License.
+ *
+ ****************************************************************************
+ */
+
+/*          |<------- ordered farm (small window) ------->|
+ *
+ *                  | --> Worker (slow) -->|
+ *                  |                      |
+ * Start -->DefEmi->| --> Worker ------->  | -> DefCol --> Stop
+ *                  |                      |
+ *                  | --> Worker ------->  |
+ *
+ * The ordered farm is created with a very small reorder window and
+ * worker 0 is much slower than the others. The Emitter has to wait for the
+ * collector when the window is full, the tasks must be received in order.
+ * The pipeline is run twice to check that the sequence numbers continue
+ * across the runs.
+ */
+
+#include <iostream>
+#include <ff/ff.hpp>
+
+using namespace ff;
+
+struct Start: ff_node_t<long> {
+    Start(long streamlen):streamlen(streamlen) {}
+    long* svc(long*) {
+        for(long j=1;j<=streamlen;++j) ff_send_out((long*)j);
+        return EOS;
+    }
+    long streamlen;
+};
+
+struct Worker: ff_node_t<long> {
+    long* svc(long* task) {
+        if (get_my_id() == 0) usleep(500);
+        return task;
+    }
+};
+
+struct Stop: ff_node_t<long> {
+    Stop():expected(1),error(false) {}
+    int svc_init() { expected = 1; return 0; }
+    long* svc(long* t) {
+        if ((long)t != expected) {
+            printf("ERROR: task received out of order, received %ld expected %ld\n", (long)t, expected);
+            error = true;
+        }
+        ++expected;
+        return GO_ON;
+    }
+    long expected;
+    bool error;
+};
+
+int main(int argc, char * argv[]) {
+    int nworkers = 3;
+    long streamlen = 200;
+    if (argc>1) {
+        if (argc<3) {
+            std::cerr << "use: " << argv[0] << " nworkers streamlen\n";
+            return -1;
+        }
+        nworkers=atoi(argv[1]);
+        streamlen=atol(argv[2]);
+    }
+    if (nworkers<=0 || streamlen<=0) {
+        std::cerr << "Wrong parameters values\n";
+        return -1;
+    }
+
+    Start start(streamlen);
+    Stop  stop;
+    std::vector<ff_node*> W;
+    for(int i=0;i<nworkers;++i) W.push_back(new Worker);
+
+    ff_farm farm(W);
+    farm.cleanup_workers();
+    farm.set_scheduling_ondemand();
+    farm.set_ordered(2);
+
+    ff_Pipe<> pipe(start, farm, stop);
+    for(int k=0;k<2;++k) {
+        if (pipe.run_then_freeze()<0) {
+            error("running pipe\n");
+            return -1;
+        }
+        if (pipe.wait_freezing()<0) {
+            error("waiting pipe\n");
+            return -1;
+        }
+        if (stop.error || stop.expected != streamlen+1) {
+            std::cerr << "ERROR: wrong result, received " << stop.expected-1 << " tasks\n";
+            return -1;
+        }
+    }
+    pipe.wait();
+    std::cerr << "DONE\n";
+    return 0;
+}
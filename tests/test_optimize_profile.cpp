@@ -0,0 +1,132 @@
+/* -*- Mode: C++; tab-width: 4; c-basic-offset: 4; indent-tabs-mode: nil -*- */
+/* ***************************************************************************
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License version 2 as
+ *  published by the Free Software Foundation.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ *
+ *  As a special exception, you may use this file as part of a free software
+ *  library without restriction.  Specifically, if other files instantiate
+ *  templates or use macros or inline functions from this file, or you compile
+ *  this file and link it with other files to produce an executable, this
+ *  file does not by itself cause the resulting executable to be covered by
+ *  the GNU General Public License.  This exception does not however
+ *  invalidate any other reasons why the executable file might be covered by
+ *  the GNU General Public License.
+ *
+ ****************************************************************************
+ */
+
+/*
+ * Profile-guided fusion and fission of a pipeline.
+ *
+ *   Source -> Inc -> Inc -> Heavy -> Inc -> Sink
+ *
+ * The pipeline is run once with the profiler attached, the plan has to
+ * fuse some of the cheap stages and to replicate the Heavy stage. The
+ * pipeline built from the plan has to compute the same result.
+ */
+
+#include <iostream>
+#include <chrono>
+#include <ff/ff.hpp>
+#include <ff/optimize.hpp>
+
+using namespace ff;
+
+static void busy(long us) {
+    auto t = std::chrono::steady_clock::now() + std::chrono::microseconds(us);
+    while(std::chrono::steady_clock::now() < t);
+}
+
+struct Source: ff_node_t<long> {
+    Source(long ntasks):ntasks(ntasks) {}
+    long* svc(long*) {
+        for(long i=1;i<=ntasks;++i) ff_send_out((long*)i);
+        return EOS;
+    }
+    long ntasks;
+};
+struct Inc: ff_node_t<long> {
+    long* svc(long* t) { return (long*)((long)t+1); }
+};
+struct Heavy: ff_node_t<long> {
+    long* svc(long* t) { busy(100); return t; }
+};
+struct Sink: ff_node_t<long> {
+    Sink(long &sum):sum(sum) {}
+    long* svc(long* t) { sum += (long)t; return GO_ON; }
+    long &sum;
+};
+
+int main(int argc, char* argv[]) {
+    long ntasks = 2000;
+    if (argc>1) ntasks = atol(argv[1]);
+    const long expected = ntasks*(ntasks+1)/2 + 3*ntasks;
+
+    long sum = 0;
+    auto make_stage = [&](size_t i) -> ff_node* {
+        switch(i) {
+        case 0: return new Source(ntasks);
+        case 3: return new Heavy;
+        case 5: return new Sink(sum);
+        default: return new Inc;
+        }
+    };
+
+    std::vector<ff_stage_group> plan;
+    {
+        ff_pipeline pipe;
+        for(size_t i=0;i<6;++i) pipe.add_stage(make_stage(i), true);
+        ff_pipeline_profiler prof;
+        prof.attach(pipe);
+        if (pipe.run_and_wait_end()<0) {
+            error("running pipeline\n");
+            return -1;
+        }
+        if (sum != expected) {
+            std::cerr << "ERROR: wrong result " << sum << "\n";
+            return -1;
+        }
+        const std::vector<ff_stage_profile> P = prof.profile();
+        if (!P[0].opaque || P[3].opaque || P[3].tasks != (size_t)ntasks) {
+            std::cerr << "ERROR: wrong profile\n";
+            return -1;
+        }
+        OptProfile opt;
+        opt.max_threads = 8;
+        opt.replicable  = {false, true, true, true, true, false};
+        opt.verbose_level = 1;
+        plan = prof.plan(opt);
+    }
+    bool replicated=false;
+    for(auto &g: plan) 
+        if (g.first<=3 && 3<=g.last) replicated = (g.nworkers>1);
+    if (plan.size() >= 6 || !replicated) {
+        std::cerr << "ERROR: " << plan.size() << " groups, the heavy stage is "
+                  << (replicated ? "" : "not ") << "replicated\n";
+        return -1;
+    }
+
+    sum = 0;
+    ff_pipeline *pipe = build_pipeline(plan, make_stage);
+    if (!pipe || pipe->run_and_wait_end()<0) {
+        error("running optimized pipeline\n");
+        return -1;
+    }
+    delete pipe;
+    if (sum != expected) {
+        std::cerr << "ERROR: wrong result " << sum << " from the optimized pipeline\n";
+        return -1;
+    }
+    std::cout << "DONE\n";
+    return 0;
+}
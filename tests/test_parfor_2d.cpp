@@ -0,0 +1,123 @@
+/* -*- Mode: C++; tab-width: 4; c-basic-offset: 4; indent-tabs-mode: nil -*- */
+/* ***************************************************************************
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License version 2 as
+ *  published by the Free Software Foundation.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ *
+ *  As a special exception, you may use this file as part of a free software
+ *  library without restriction.  Specifically, if other files instantiate
+ *  templates or use macros or inline functions from this file, or you compile
+ *  this file and link it with other files to produce an executable, this
+ *  file does not by itself cause the resulting executable to be covered by
+ *  the GNU General Public License.  This exception does not however
+ *  invalidate any other reasons why the executable file might be covered by
+ *  the GNU General Public License.
+ *
+ ****************************************************************************
+ */
+
+/*
+ * Collapsed 2D/3D loops scheduled in tiles (parallel_for_2d/3d and 
+ * parallel_reduce_2d/3d).
+ *
+ * Each loop is checked (every iteration is executed exactly once) with
+ * given and automatic tile shapes. Then the transpose of a NxN matrix is
+ * timed distributing the rows (parallel_for) and the tiles (parallel_for_2d).
+ */
+
+#include <cstdio>
+#include <vector>
+#include <ff/ff.hpp>
+#include <ff/parallel_for.hpp>
+
+using namespace ff;
+
+int main(int argc, char *argv[]) {
+    int  nw = 4;
+    long N  = 2048;
+    if (argc>1) {
+        if (argc<3) {
+            printf("use: %s nworkers N\n", argv[0]);
+            return -1;
+        }
+        nw = atoi(argv[1]);
+        N  = atol(argv[2]);
+    }
+    const long R=123, C=457, D=29;
+    std::vector<long> V(R*C*D);
+    ParallelForReduce<long> pfr(nw);
+    ParallelFor pf(nw);
+
+    const long tiles[][3] = { {0,0,0}, {1,1,1}, {16,64,8}, {R,C,D}, {7,1000,3} };
+    for(auto &t: tiles) {
+        std::fill(V.begin(), V.end(), 0);
+        pf.parallel_for_2d(3, R, 5, C, [&](const long i, const long j) { V[i*C+j]++; }, t[0], t[1]);
+        for(long i=0;i<R;++i)
+            for(long j=0;j<C;++j)
+                if (V[i*C+j] != (i>=3 && j>=5)) {
+                    printf("ERROR: 2D iteration (%ld,%ld) executed %ld times\n", i, j, V[i*C+j]);
+                    return -1;
+                }
+        std::fill(V.begin(), V.end(), 0);
+        pfr.parallel_for_3d(0, R, 0, C, 1, D, [&](const long i, const long j, const long k) { 
+                V[(i*C+j)*D+k]++; 
+            }, t[0], t[1], t[2]);
+        for(long i=0;i<R*C*D;++i)
+            if (V[i] != (i%D != 0)) {
+                printf("ERROR: 3D iteration %ld executed %ld times\n", i, V[i]);
+                return -1;
+            }
+        long sum = 0, expected = 0;
+        for(long i=0;i<R;++i) for(long j=0;j<C;++j) expected += i*j;
+        pfr.parallel_reduce_2d(sum, 0L, 0, R, 0, C, 
+                               [](const long i, const long j, long &s) { s += i*j; },
+                               [](long &s, const long e) { s += e; }, t[0], t[1]);
+        if (sum != expected) {
+            printf("ERROR: 2D reduce %ld != %ld\n", sum, expected);
+            return -1;
+        }
+        sum = 0, expected = 0;
+        for(long i=0;i<R;++i) for(long j=0;j<C;++j) for(long k=0;k<D;++k) expected += i+j*k;
+        pfr.parallel_reduce_3d(sum, 0L, 0, R, 0, C, 0, D,
+                               [](const long i, const long j, const long k, long &s) { s += i+j*k; },
+                               [](long &s, const long e) { s += e; }, t[0], t[1], t[2]);
+        if (sum != expected) {
+            printf("ERROR: 3D reduce %ld != %ld\n", sum, expected);
+            return -1;
+        }
+    }
+    // empty iteration spaces
+    pf.parallel_for_2d(0, 0, 0, 10, [&](const long, const long) { printf("ERROR\n"); abort(); });
+    pf.parallel_for_3d(0, 10, 5, 5, 0, 10, [&](const long, const long, const long) { printf("ERROR\n"); abort(); });
+
+    std::vector<double> A(N*N), B(N*N);
+    for(long i=0;i<N*N;++i) A[i] = (double)i;
+    ffTime(START_TIME);
+    pf.parallel_for(0, N, 1, 1, [&](const long i) { 
+            for(long j=0;j<N;++j) B[j*N+i] = A[i*N+j]; 
+        }, nw);
+    ffTime(STOP_TIME);
+    printf("transpose, rows : %g (ms)\n", ffTime(GET_TIME));
+    std::fill(B.begin(), B.end(), 0.0);
+    ffTime(START_TIME);
+    pf.parallel_for_2d(0, N, 0, N, [&](const long i, const long j) { B[j*N+i] = A[i*N+j]; }, 64, 64, nw);
+    ffTime(STOP_TIME);
+    printf("transpose, tiles: %g (ms)\n", ffTime(GET_TIME));
+    for(long i=0;i<N;++i)
+        for(long j=0;j<N;++j)
+            if (B[j*N+i] != A[i*N+j]) {
+                printf("ERROR: wrong transpose\n");
+                return -1;
+            }
+    printf("DONE\n");
+    return 0;
+}
@@ -0,0 +1,131 @@
+/* -*- Mode: C++; tab-width: 4; c-basic-offset: 4; indent-tabs-mode: nil -*- */
+/* ***************************************************************************
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License version 2 as
+ *  published by the Free Software Foundation.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ *
+ *  As a special exception, you may use this file as part of a free software
+ *  library without restriction.  Specifically, if other files instantiate
+ *  templates or use macros or inline functions from this file, or you compile
+ *  this file and link it with other files to produce an executable, this
+ *  file does not by itself cause the resulting executable to be covered by
+ *  the GNU General Public License.  This exception does not however
+ *  invalidate any other reasons why the executable file might be covered by
+ *  the GNU General Public License.
+ *
+ ****************************************************************************
+ */
+
+/*
+ * Hot loops of the ParallelFor/ParallelForReduce (parallel_for_hot).
+ *
+ * Many short loops are run in the hot loop mode, with static and dynamic
+ * scheduling, different steps and number of workers, and checked (every 
+ * iteration is executed exactly once). The hot loops are interleaved with 
+ * the other parallel_for methods and threadPause, both with blocking and 
+ * with spinning Workers. Then the time needed to start and join a short 
+ * loop is measured with parallel_for and parallel_for_hot.
+ */
+
+#include <cstdio>
+#include <vector>
+#include <ff/ff.hpp>
+#include <ff/parallel_for.hpp>
+
+using namespace ff;
+
+static bool check(const std::vector<long> &V, long first, long last, long step, long times) {
+    for(long i=0;i<(long)V.size();++i) {
+        const long expected = (i>=first && i<last && (i-first)%step==0) ? times : 0;
+        if (V[i] != expected) {
+            printf("ERROR: iteration %ld executed %ld times instead of %ld\n", i, V[i], expected);
+            return false;
+        }
+    }
+    return true;
+}
+
+int main(int argc, char *argv[]) {
+    int  nw = 4;
+    long N  = 10000;
+    long L  = 200;
+    if (argc>1) {
+        if (argc<4) {
+            printf("use: %s nworkers N nloops\n", argv[0]);
+            return -1;
+        }
+        nw = atoi(argv[1]);
+        N  = atol(argv[2]);
+        L  = atol(argv[3]);
+    }
+    std::vector<long> V(N+5);
+    for(int spin=0;spin<2;++spin) {
+        ParallelFor             pf(nw, spin);
+        ParallelForReduce<long> pfr(nw, spin);
+        const long steps[]  = {1, 3};
+        const long grains[] = {0, 1, 64};
+        for(long step: steps)
+            for(long grain: grains) 
+                for(long w: {(long)nw, 2L, 1L}) {
+                    std::fill(V.begin(), V.end(), 0);
+                    for(long k=0;k<L;++k)
+                        pf.parallel_for_hot(1, N, step, grain, [&](const long i) { V[i]++; }, w);
+                    if (!check(V, 1, N, step, L)) return -1;
+
+                    // a short loop, less iterations than workers
+                    std::fill(V.begin(), V.end(), 0);
+                    for(long k=0;k<L;++k)
+                        pfr.parallel_for_hot(0, 3, step, grain, [&](const long i) { V[i]++; }, w);
+                    if (!check(V, 0, 3, step, L)) return -1;
+
+                    // the hot loop mode ends and starts again
+                    std::fill(V.begin(), V.end(), 0);
+                    pf.parallel_for(0, N, step, grain, [&](const long i) { V[i]++; });
+                    pf.parallel_for_hot(0, N, step, grain, [&](const long i) { V[i]++; });
+                    pf.parallel_for_static(0, N, step, grain, [&](const long i) { V[i]++; });
+                    if (!check(V, 0, N, step, 3)) return -1;
+
+                    long sum = 0, expected = 0;
+                    for(long i=0;i<N;i+=step) expected += i;
+                    pfr.parallel_for_hot(0, N, 1, grain, [&](const long i) { V[i] = 0; });
+                    pfr.parallel_reduce(sum, 0L, 0, N, step, grain,
+                                        [](const long i, long &s) { s += i; },
+                                        [](long &s, const long e) { s += e; });
+                    if (sum != expected) {
+                        printf("ERROR: reduce %ld != %ld\n", sum, expected);
+                        return -1;
+                    }
+                }
+        if (spin) pf.threadPause(), pfr.threadPause();
+        pf.parallel_for_hot(0, N, 1, 0, [&](const long i) { V[i] = i; });
+        pf.stopHotLoops();
+    }
+
+    // launch and join of a loop of nw iterations
+    ParallelFor pf(nw, true);
+    std::vector<double> A(nw);
+    const long nloops = 20*L;
+    ffTime(START_TIME);
+    for(long k=0;k<nloops;++k)
+        pf.parallel_for(0, nw, 1, 0, [&](const long i) { A[i] += 1.0; }, nw);
+    ffTime(STOP_TIME);
+    printf("parallel_for    : %8.2f (us) per loop\n", 1000.0*ffTime(GET_TIME)/nloops);
+    ffTime(START_TIME);
+    for(long k=0;k<nloops;++k)
+        pf.parallel_for_hot(0, nw, 1, 0, [&](const long i) { A[i] += 1.0; }, nw);
+    ffTime(STOP_TIME);
+    printf("parallel_for_hot: %8.2f (us) per loop\n", 1000.0*ffTime(GET_TIME)/nloops);
+    for(long i=0;i<nw;++i) 
+        if (A[i] != 2.0*nloops) { printf("ERROR: wrong result\n"); return -1; }
+    printf("DONE\n");
+    return 0;
+}
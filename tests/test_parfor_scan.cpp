@@ -0,0 +1,125 @@
+/* -*- Mode: C++; tab-width: 4; c-basic-offset: 4; indent-tabs-mode: nil -*- */
+/* ***************************************************************************
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License version 2 as
+ *  published by the Free Software Foundation.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ *
+ *  As a special exception, you may use this file as part of a free software
+ *  library without restriction.  Specifically, if other files instantiate
+ *  templates or use macros or inline functions from this file, or you compile
+ *  this file and link it with other files to produce an executable, this
+ *  file does not by itself cause the resulting executable to be covered by
+ *  the GNU General Public License.  This exception does not however
+ *  invalidate any other reasons why the executable file might be covered by
+ *  the GNU General Public License.
+ *
+ ****************************************************************************
+ */
+
+/*
+ * Parallel prefix scan (ParallelForScan).
+ *
+ * Inclusive and exclusive scans are checked against the sequential ones
+ * for several sizes, in place and with a non commutative operation 
+ * (composition of affine functions). Then the scan is used for stream
+ * compaction and a large array is scanned and timed.
+ */
+
+#include <cstdio>
+#include <vector>
+#include <ff/ff.hpp>
+#include <ff/parallel_for.hpp>
+
+using namespace ff;
+
+// the affine function x -> a*x+b, composition is associative but not commutative
+struct affine {
+    unsigned long a=1, b=0;
+    bool operator==(const affine &o) const { return a==o.a && b==o.b; }
+};
+static inline affine compose(const affine &f, const affine &g) {  // first f then g
+    affine r; r.a = f.a*g.a; r.b = f.b*g.a + g.b; return r;
+}
+
+int main(int argc, char *argv[]) {
+    int  nw = 4;
+    long N  = 1<<24;
+    if (argc>1) {
+        if (argc<3) {
+            printf("use: %s nworkers N\n", argv[0]);
+            return -1;
+        }
+        nw = atoi(argv[1]);
+        N  = atol(argv[2]);
+    }
+    for(int spin=0;spin<2;++spin) {
+        ParallelForScan<long>   pfs(nw, spin);
+        ParallelForScan<affine> pfa(nw, spin);
+        const long sizes[] = {0, 1, 2, 1000, 4096*nw-1, 4096*nw+3, 100003};
+        for(long n: sizes) {
+            std::vector<long> A(n), B(n), S(n);
+            for(long i=0;i<n;++i) A[i] = (i*7919)%101 - 50;
+            auto plus = [](const long a, const long b) { return a+b; };
+            long total = pfs.inclusive_scan(A.data(), B.data(), n, 0L, plus);
+            long s = 0;
+            for(long i=0;i<n;++i) { s += A[i]; S[i] = s; }
+            if (B != S || total != s) { printf("ERROR: inclusive scan n=%ld\n", n); return -1; }
+
+            B = A;
+            total = pfs.exclusive_scan(B.data(), B.data(), n, 0L, plus);  // in place
+            s = 0;
+            for(long i=0;i<n;++i) { S[i] = s; s += A[i]; }
+            if (B != S || total != s) { printf("ERROR: exclusive scan n=%ld\n", n); return -1; }
+
+            std::vector<affine> F(n), G(n);
+            for(long i=0;i<n;++i) F[i].a = 2*(i%13)+1, F[i].b = i;
+            pfa.inclusive_scan(F.data(), G.data(), n, affine(), compose);
+            affine f;
+            for(long i=0;i<n;++i) {
+                f = compose(f, F[i]);
+                if (!(G[i] == f)) { printf("ERROR: affine scan n=%ld i=%ld\n", n, i); return -1; }
+            }
+        }
+        // stream compaction: the even values of A are copied in B
+        {
+            const long n = 200000;
+            std::vector<long> A(n), B(n, -1);
+            for(long i=0;i<n;++i) A[i] = (i*31)%1000;
+            const long m = pfs.parallel_scan(0, n, 0L,
+                               [&](const long i) { return long(A[i]%2==0); },
+                               [](const long a, const long b) { return a+b; },
+                               [&](const long i, const long pos) { if (A[i]%2==0) B[pos] = A[i]; });
+            long k = 0;
+            for(long i=0;i<n;++i) 
+                if (A[i]%2==0 && B[k++] != A[i]) { printf("ERROR: compaction\n"); return -1; }
+            if (k != m) { printf("ERROR: compaction count %ld != %ld\n", m, k); return -1; }
+        }
+        if (spin) pfs.threadPause(), pfa.threadPause();
+    }
+
+    ParallelForScan<double> pfs(nw);
+    std::vector<double> A(N), B(N);
+    for(long i=0;i<N;++i) A[i] = 1.0;
+    ffTime(START_TIME);
+    double s = 0.0;
+    for(long i=0;i<N;++i) { s += A[i]; B[i] = s; }
+    ffTime(STOP_TIME);
+    printf("sequential scan: %g (ms)\n", ffTime(GET_TIME));
+    ffTime(START_TIME);
+    pfs.inclusive_scan(A.data(), B.data(), N, 0.0, [](const double a, const double b) { return a+b; });
+    ffTime(STOP_TIME);
+    printf("parallel   scan: %g (ms) %.2f GB/s\n", ffTime(GET_TIME), 
+           3.0*N*sizeof(double)/ffTime(GET_TIME)/1e6);
+    if (B[N-1] != (double)N) { printf("ERROR: wrong result\n"); return -1; }
+    printf("DONE\n");
+    return 0;
+}
@@ -0,0 +1,116 @@
+/* -*- Mode: C++; tab-width: 4; c-basic-offset: 4; indent-tabs-mode: nil -*- */
+/* ***************************************************************************
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License version 2 as
+ *  published by the Free Software Foundation.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ *
+ *  As a special exception, you may use this file as part of a free software
+ *  library without restriction.  Specifically, if other files instantiate
+ *  templates or use macros or inline functions from this file, or you compile
+ *  this file and link it with other files to produce an executable, this
+ *  file does not by itself cause the resulting executable to be covered by
+ *  the GNU General Public License.  This exception does not however
+ *  invalidate any other reasons why the executable file might be covered by
+ *  the GNU General Public License.
+ *
+ ****************************************************************************
+ */
+
+/*
+ * Guided and adaptive scheduling of the ParallelFor/ParallelForReduce
+ * iterations. 
+ *
+ * Each loop is checked (every iteration is executed exactly once) with
+ * the default dynamic, the guided and the adaptive scheduling, both with
+ * blocking and with spinning Workers. Then an unbalanced loop (the cost
+ * of the iteration i decreases as 1/i, as in test_parfor_unbalanced) is
+ * timed with the three policies and grain 1.
+ */
+
+#include <cmath>
+#include <cstdio>
+#include <vector>
+#include <ff/ff.hpp>
+#include <ff/parallel_for.hpp>
+
+using namespace ff;
+
+static const parfor_schedule_t policies[] = { PARFOR_SCHED_DEFAULT, PARFOR_SCHED_GUIDED, PARFOR_SCHED_ADAPTIVE };
+static const char *names[] = { "default", "guided", "adaptive" };
+
+static bool check(const std::vector<long> &V, long first, long last, long step) {
+    for(long i=0;i<(long)V.size();++i) {
+        const long expected = (i>=first && i<last && (i-first)%step==0) ? 1 : 0;
+        if (V[i] != expected) {
+            printf("ERROR: iteration %ld executed %ld times\n", i, V[i]);
+            return false;
+        }
+    }
+    return true;
+}
+
+int main(int argc, char *argv[]) {
+    int  nw = 4;
+    long N  = 100000;
+    long M  = 2000;
+    if (argc>1) {
+        if (argc<4) {
+            printf("use: %s nworkers N M\n", argv[0]);
+            return -1;
+        }
+        nw = atoi(argv[1]);
+        N  = atol(argv[2]);
+        M  = atol(argv[3]);
+    }
+    std::vector<long> V(N+5);
+    for(int spin=0;spin<2;++spin) {
+        ParallelFor       pf(nw, spin);
+        ParallelForReduce<long> pfr(nw, spin);
+        for(int p=0;p<3;++p) {
+            const long steps[] = {1, 3};
+            const long grains[] = {1, 7};
+            for(long step: steps)
+                for(long grain: grains) {
+                    std::fill(V.begin(), V.end(), 0);
+                    pf.parallel_for(2, N, step, grain, policies[p], [&](const long i) { V[i]++; });
+                    if (!check(V, 2, N, step)) return -1;
+
+                    std::fill(V.begin(), V.end(), 0);
+                    pfr.parallel_for(1, N+1, step, grain, policies[p], [&](const long i) { V[i]++; }, 3);
+                    if (!check(V, 1, N+1, step)) return -1;
+
+                    long sum = 0, expected = 0;
+                    for(long i=0;i<N;i+=step) expected += i;
+                    pfr.parallel_reduce(sum, 0L, 0, N, step, grain, policies[p],
+                                        [](const long i, long &s) { s += i; },
+                                        [](long &s, const long e) { s += e; });
+                    if (sum != expected) {
+                        printf("ERROR: %s reduce %ld != %ld\n", names[p], sum, expected);
+                        return -1;
+                    }
+                }
+        }
+        if (spin) pf.threadPause();
+    }
+
+    ParallelFor pf(nw);
+    std::vector<long> W(M+1);
+    for(long i=1;i<=M;++i) W[i] = (long)std::ceil(float(M)*powf(float(i),-1.1));
+    for(int p=0;p<3;++p) {
+        ffTime(START_TIME);
+        pf.parallel_for(1, M+1, 1, 1, policies[p], [&](const long i) { ticks_wait(1000*W[i]); }, nw);
+        ffTime(STOP_TIME);
+        printf("unbalanced loop, %-8s scheduling: %g (ms)\n", names[p], ffTime(GET_TIME));
+    }
+    printf("DONE\n");
+    return 0;
+}
@@ -0,0 +1,156 @@
+/* -*- Mode: C++; tab-width: 4; c-basic-offset: 4; indent-tabs-mode: nil -*- */
+/* ***************************************************************************
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License version 2 as
+ *  published by the Free Software Foundation.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ *
+ *  As a special exception, you may use this file as part of a free software
+ *  library without restriction.  Specifically, if other files instantiate
+ *  templates or use macros or inline functions from this file, or you compile
+ *  this file and link it with other files to produce an executable, this
+ *  file does not by itself cause the resulting executable to be covered by
+ *  the GNU General Public License.  This exception does not however
+ *  invalidate any other reasons why the executable file might be covered by
+ *  the GNU General Public License.
+ *
+ ****************************************************************************
+ */
+
+/*
+ * Stealing policies of the ParallelFor/ParallelForReduce Workers 
+ * (setStealing).
+ *
+ * Unbalanced loops (the first iterations are the most expensive ones, so 
+ * that the Workers steal) are checked (every iteration is executed exactly
+ * once) with the default, random and hierarchical stealing, different steps
+ * and grains, with the default and the guided scheduling, both with 
+ * blocking and with spinning Workers. Then many Workers run loops of
+ * irregular iterations so that the ranges are stolen back and forth, the
+ * iterations are counted atomically. Finally a loop of fine grain iterations
+ * is timed with the three policies.
+ */
+
+#include <cstdio>
+#include <vector>
+#include <atomic>
+#include <ff/ff.hpp>
+#include <ff/parallel_for.hpp>
+
+using namespace ff;
+
+static const parfor_steal_t policies[] = { PARFOR_STEAL_DEFAULT, PARFOR_STEAL_RANDOM, PARFOR_STEAL_HIERARCHICAL };
+static const char *names[] = { "default", "random", "hierarchical" };
+
+static bool check(const std::vector<long> &V, long first, long last, long step) {
+    for(long i=0;i<(long)V.size();++i) {
+        const long expected = (i>=first && i<last && (i-first)%step==0) ? 1 : 0;
+        if (V[i] != expected) {
+            printf("ERROR: iteration %ld executed %ld times\n", i, V[i]);
+            return false;
+        }
+    }
+    return true;
+}
+
+int main(int argc, char *argv[]) {
+    int  nw = 4;
+    long N  = 50000;
+    long M  = 1000000;
+    if (argc>1) {
+        if (argc<4) {
+            printf("use: %s nworkers N M\n", argv[0]);
+            return -1;
+        }
+        nw = atoi(argv[1]);
+        N  = atol(argv[2]);
+        M  = atol(argv[3]);
+    }
+    std::vector<long> V(N+5);
+    // the cost of the iterations decreases with the index
+    auto work = [N](const long i) { ticks_wait(i < N/8 ? 200 : 10); };
+    for(int spin=0;spin<2;++spin) {
+        ParallelFor       pf(nw, spin);
+        ParallelForReduce<long> pfr(nw, spin);
+        pf.disableScheduler(true);
+        for(int p=0;p<3;++p) {
+            pf.setStealing(policies[p]);
+            pfr.setStealing(policies[p]);
+            const long steps[] = {1, 3, 8};
+            const long grains[] = {1, 5, 64};
+            for(long step: steps)
+                for(long grain: grains) {
+                    std::fill(V.begin(), V.end(), 0);
+                    pf.parallel_for(2, N, step, grain, [&](const long i) { work(i); V[i]++; });
+                    if (!check(V, 2, N, step)) return -1;
+
+                    std::fill(V.begin(), V.end(), 0);
+                    pf.parallel_for(1, N+1, step, grain, PARFOR_SCHED_GUIDED,
+                                    [&](const long i) { work(i); V[i]++; }, 3);
+                    if (!check(V, 1, N+1, step)) return -1;
+
+                    long sum = 0, expected = 0;
+                    for(long i=0;i<N;i+=step) expected += i;
+                    pfr.parallel_reduce(sum, 0L, 0, N, step, grain,
+                                        [&](const long i, long &s) { work(i); s += i; },
+                                        [](long &s, const long e) { s += e; });
+                    if (sum != expected) {
+                        printf("ERROR: %s reduce %ld != %ld\n", names[p], sum, expected);
+                        return -1;
+                    }
+                }
+        }
+        if (spin) pf.threadPause(), pfr.threadPause();
+    }
+
+    {
+        // many thieves, the cost of the iterations is irregular
+        const int  nws = 4*nw;
+        const long Ns  = N/10;
+        std::vector<std::atomic<int>> C(Ns+5);
+        auto irregular = [](const long i) { ticks_wait(((i*7919)%13==0) ? 300 : 5); };
+        ParallelFor pf(nws, true);
+        pf.disableScheduler(true);
+        for(int p=0;p<3;++p) {
+            pf.setStealing(policies[p]);
+            const long steps[] = {1, 3};
+            for(long step: steps)
+                for(int r=0;r<10;++r) {
+                    for(auto &c: C) c.store(0, std::memory_order_relaxed);
+                    pf.parallel_for(0, Ns, step, 1+r%3, [&](const long i) { 
+                            irregular(i); C[i].fetch_add(1, std::memory_order_relaxed); 
+                        });
+                    for(long i=0;i<(long)C.size();++i) {
+                        const int expected = (i<Ns && i%step==0) ? 1 : 0;
+                        if (C[i].load() != expected) {
+                            printf("ERROR: %s stealing, %d workers, iteration %ld executed %d times\n", 
+                                   names[p], nws, i, C[i].load());
+                            return -1;
+                        }
+                    }
+                }
+        }
+        pf.threadPause();
+    }
+
+    ParallelFor pf(nw);
+    pf.disableScheduler(true);
+    std::vector<double> A(M);
+    for(int p=0;p<3;++p) {
+        pf.setStealing(policies[p]);
+        ffTime(START_TIME);
+        pf.parallel_for(0, M, 1, 16, [&](const long i) { A[i] = i*0.5; }, nw);
+        ffTime(STOP_TIME);
+        printf("fine grain loop, %-12s stealing: %g (ms)\n", names[p], ffTime(GET_TIME));
+    }
+    printf("DONE\n");
+    return 0;
+}
@@ -0,0 +1,129 @@
+/* -*- Mode: C++; tab-width: 4; c-basic-offset: 4; indent-tabs-mode: nil -*- */
+/* ***************************************************************************
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License version 2 as 
+ *  published by the Free Software Foundation.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ *
+ *  As a special exception, you may use this file as part of a free software
+ *  library without restriction.  Specifically, if other files instantiate
+ *  templates or use macros or inline functions from this file, or you compile
+ *  this file and link it with other files to produce an executable, this
+ *  file does not by itself cause the resulting executable to be covered by
+ *  the GNU General Public License.  This exception does not however
+ *  invalidate any other reasons why the executable file might be covered by
+ *  the GNU General Public License.
+ *
+ ****************************************************************************
+ */
+
+/*
+ * NUMA and huge pages placement of the channels.
+ *
+ *   pipe( Source, farm(Worker x nw, Collector), Sink )
+ *
+ * The farm's channels are bound to the NUMA node of their consumer and 
+ * allocated on huge pages, the Sink's input channel is bound to node 0.
+ * Small channels are used so that the unbounded queues allocate (and reuse)
+ * many internal buffers.
+ *
+ */
+
+#include <iostream>
+#include <cstdint>
+#include <ff/ff.hpp>
+
+using namespace ff;
+
+struct Source: ff_node_t<long> {
+    Source(long ntasks):ntasks(ntasks) {}
+    long* svc(long*) {
+        for(long i=1;i<=ntasks;++i) ff_send_out((long*)i);
+        return EOS;
+    }
+    long ntasks;
+};
+
+struct Worker: ff_node_t<long> {
+    long* svc(long* in) { return in; }
+};
+
+struct Sink: ff_node_t<long> {
+    long* svc(long* in) {
+        sum += (long)in;
+        ++cnt;
+        return GO_ON;
+    }
+    long sum=0, cnt=0;
+};
+
+int main(int argc, char* argv[]) {
+    long ntasks = 200000;
+    int  nw     = 3;
+    if (argc>1) {
+        if (argc!=3) {
+            std::cerr << "use: " << argv[0] << " ntasks nworkers\n";
+            return -1;
+        }
+        ntasks = std::stol(argv[1]);
+        nw     = std::stol(argv[2]);
+    }
+
+    // the memory primitives
+    {
+        const size_t sz = 3*4096+10;
+        char *p = (char*)getPlacedMemory(sz, 0, true);
+        if (!p) { std::cerr << "getPlacedMemory failed\n"; return -1; }
+#if defined(__linux__)
+        if (((uintptr_t)p % FF_HUGEPAGE_SIZE) != 0) {
+            std::cerr << "huge pages buffer not aligned\n";
+            return -1;
+        }
+#endif
+        for(size_t i=0;i<sz;++i) p[i]=(char)i;
+        freePlacedMemory(p, sz, true);
+    }
+    // an unbounded channel growing over several placed buffers
+    {
+        uSWSR_Ptr_Buffer b(64);
+        b.set_placement(FF_NUMA_CONSUMER, true);
+        if (!b.init()) { std::cerr << "init failed\n"; return -1; }
+        b.set_placement(0);
+        for(long i=1;i<=1000;++i) b.push((void*)i);
+        void *d;
+        for(long i=1;i<=1000;++i) 
+            if (!b.pop(&d) || (long)d != i) { std::cerr << "wrong channel content\n"; return -1; }
+        if (b.pop(&d)) { std::cerr << "channel not empty\n"; return -1; }
+    }
+
+    Source source(ntasks);
+    Sink   sink;
+    std::vector<std::unique_ptr<ff_node> > W;
+    for(int i=0;i<nw;++i) W.push_back(make_unique<Worker>());
+    ff_Farm<long> farm(std::move(W));
+    farm.set_input_placement(FF_NUMA_CONSUMER, true);
+    sink.set_input_placement(0);
+
+    ff_Pipe<> pipe(source, farm, sink);
+    pipe.setXNodeInputQueueLength(128, false);
+    pipe.setXNodeOutputQueueLength(128, false);
+    if (pipe.run_and_wait_end()<0) {
+        error("running pipe\n");
+        return -1;
+    }
+    if (sink.cnt != ntasks || sink.sum != ntasks*(ntasks+1)/2) {
+        std::cerr << "wrong result " << sink.cnt << " " << sink.sum << "\n";
+        return -1;
+    }
+    std::cout << "channels placed, current NUMA node " << ff_getMyNumaNode() << "\n";
+    std::cout << "Done\n";
+    return 0;
+}
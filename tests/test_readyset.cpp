@@ -0,0 +1,138 @@
+/* -*- Mode: C++; tab-width: 4; c-basic-offset: 4; indent-tabs-mode: nil -*- */
+/* ***************************************************************************
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License version 2 as
+ *  published by the Free Software Foundation.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ *
+ *  As a special exception, you may use this file as part of a free software
+ *  library without restriction.  Specifically, if other files instantiate
+ *  templates or use macros or inline functions from this file, or you compile
+ *  this file and link it with other files to produce an executable, this
+ *  file does not by itself cause the resulting executable to be covered by
+ *  the GNU General Public License.  This exception does not however
+ *  invalidate any other reasons why the executable file might be covered by
+ *  the GNU General Public License.
+ *
+ ****************************************************************************
+ */
+
+/*
+ * Ready notification of the input channels of a gatherer.
+ *
+ *   farm(Emitter, Worker x nw, Collector)    nw > 64, run twice
+ *   a2a(Source x nl, Sink)                   Sink is a multi-input node
+ *
+ * In both cases the gatherer looks only at the channels marked as ready
+ * by their producers. The test checks that no task is lost.
+ */
+
+#define FF_READYSET
+#include <iostream>
+#include <ff/ff.hpp>
+
+using namespace ff;
+
+struct Emitter: ff_node_t<long> {
+    Emitter(long ntasks):ntasks(ntasks) {}
+    long* svc(long*) {
+        for(long i=1;i<=ntasks;++i) ff_send_out((long*)i);
+        return EOS;
+    }
+    long ntasks;
+};
+
+struct Worker: ff_node_t<long> {
+    long* svc(long* t) { return t; }
+};
+
+struct Collector: ff_node_t<long> {
+    int svc_init() { sum=0; cnt=0; return 0; }
+    long* svc(long* t) {
+        sum += (long)t; ++cnt;
+        return GO_ON;
+    }
+    long sum=0, cnt=0;
+};
+
+struct Source: ff_monode_t<long> {
+    Source(long ntasks):ntasks(ntasks) {}
+    long* svc(long*) {
+        for(long i=1;i<=ntasks;++i) ff_send_out((long*)i);
+        return EOS;
+    }
+    long ntasks;
+};
+
+struct Sink: ff_minode_t<long> {
+    long* svc(long* t) {
+        sum += (long)t; ++cnt;
+        return GO_ON;
+    }
+    long sum=0, cnt=0;
+};
+
+int main(int argc, char* argv[]) {
+    int  nworkers = 70;
+    long ntasks   = 10000;
+    if (argc>1) {
+        if (argc<3) {
+            std::cerr << "use: " << argv[0] << " nworkers ntasks\n";
+            return -1;
+        }
+        nworkers = atoi(argv[1]);
+        ntasks   = atol(argv[2]);
+    }
+    const long expected = ntasks*(ntasks+1)/2;
+
+    {
+        Emitter   E(ntasks);
+        Collector C;
+        std::vector<ff_node*> W;
+        for(int i=0;i<nworkers;++i) W.push_back(new Worker);
+        ff_farm farm(W, &E, &C);
+        farm.cleanup_workers();
+        farm.set_ready_notification();
+        for(int k=0;k<2;++k) {
+            if (farm.run_then_freeze()<0 || farm.wait_freezing()<0) {
+                error("running farm\n");
+                return -1;
+            }
+            if (C.cnt != ntasks || C.sum != expected) {
+                std::cerr << "ERROR: farm, received " << C.cnt << " tasks\n";
+                return -1;
+            }
+        }
+        farm.wait();
+    }
+    {
+        const int nl = 8;
+        std::vector<ff_node*> L;
+        for(int i=0;i<nl;++i) L.push_back(new Source(ntasks/nl));
+        Sink S;
+        S.set_ready_notification();
+        std::vector<ff_node*> R(1, &S);
+        ff_a2a a2a;
+        a2a.add_firstset(L, 0, true);
+        a2a.add_secondset(R);
+        if (a2a.run_and_wait_end()<0) {
+            error("running a2a\n");
+            return -1;
+        }
+        const long n = ntasks/nl;
+        if (S.cnt != nl*n || S.sum != nl*(n*(n+1)/2)) {
+            std::cerr << "ERROR: a2a, received " << S.cnt << " tasks\n";
+            return -1;
+        }
+    }
+    std::cout << "DONE\n";
+    return 0;
+}
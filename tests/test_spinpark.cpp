@@ -0,0 +1,162 @@
+/* -*- Mode: C++; tab-width: 4; c-basic-offset: 4; indent-tabs-mode: nil -*- */
+/* ***************************************************************************
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License version 2 as 
+ *  published by the Free Software Foundation.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ *
+ *  As a special exception, you may use this file as part of a free software
+ *  library without restriction.  Specifically, if other files instantiate
+ *  templates or use macros or inline functions from this file, or you compile
+ *  this file and link it with other files to produce an executable, this
+ *  file does not by itself cause the resulting executable to be covered by
+ *  the GNU General Public License.  This exception does not however
+ *  invalidate any other reasons why the executable file might be covered by
+ *  the GNU General Public License.
+ *
+ ****************************************************************************
+ */
+
+/*
+ * Spin-then-park run-time (SPINPARK_MODE).
+ *
+ *   pipe( Source, farm(Worker x nw, Collector), Sink )
+ *
+ * The Source produces bursts of tasks separated by idle periods. During the
+ * idle periods the other threads are expected to park instead of spinning,
+ * so the CPU time of the process has to stay well below the elapsed time.
+ * The same farm is then used as an accelerator.
+ *
+ */
+
+#define SPINPARK_MODE
+#include <iostream>
+#include <sys/time.h>
+#include <sys/resource.h>
+#include <ff/ff.hpp>
+
+using namespace ff;
+
+static double cputime() {
+    struct rusage r;
+    getrusage(RUSAGE_SELF, &r);
+    return (r.ru_utime.tv_sec + r.ru_stime.tv_sec)*1000.0 +
+        (r.ru_utime.tv_usec + r.ru_stime.tv_usec)/1000.0;
+}
+
+struct Source: ff_node_t<long> {
+    Source(long nbursts, long burst, long idle_ms):
+        nbursts(nbursts),burst(burst),idle_ms(idle_ms) {}
+    long* svc(long*) {
+        long k=1;
+        for(long i=0;i<nbursts;++i) {
+            for(long j=0;j<burst;++j, ++k) ff_send_out((long*)k);
+            usleep(idle_ms*1000);
+        }
+        return EOS;
+    }
+    long nbursts, burst, idle_ms;
+};
+
+struct Worker: ff_node_t<long> {
+    long* svc(long* in) { return in; }
+};
+
+struct Sink: ff_node_t<long> {
+    long* svc(long* in) {
+        sum += (long)in;
+        ++cnt;
+        return GO_ON;
+    }
+    long sum=0, cnt=0;
+};
+
+int main(int argc, char* argv[]) {
+    long nw      = 3;
+    long nbursts = 5;
+    long burst   = 1000;
+    long idle_ms = 100;
+    if (argc>1) {
+        if (argc!=5) {
+            std::cerr << "use: " << argv[0] << " nworkers nbursts burst idle_ms\n";
+            return -1;
+        }
+        nw      = atol(argv[1]);
+        nbursts = atol(argv[2]);
+        burst   = atol(argv[3]);
+        idle_ms = atol(argv[4]);
+    }
+    const long ntasks = nbursts*burst;
+    const long expected = ntasks*(ntasks+1)/2;
+
+    {
+        Source source(nbursts, burst, idle_ms);
+        Sink   sink;
+        ff_Farm<long> farm([nw]() {
+                std::vector<std::unique_ptr<ff_node> > W;
+                for(long i=0;i<nw;++i) W.push_back(make_unique<Worker>());
+                return W;
+            } ());
+        ff_Pipe<> pipe(source, farm, sink);
+
+        ffTime(START_TIME);
+        const double c0 = cputime();
+        if (pipe.run_and_wait_end()<0) {
+            error("running pipe\n");
+            return -1;
+        }
+        const double cpu  = cputime() - c0;
+        ffTime(STOP_TIME);
+        const double wall = ffTime(GET_TIME);
+        std::cout << "pipe: elapsed " << wall << " (ms), cpu " << cpu << " (ms)\n";
+        if (sink.cnt != ntasks || sink.sum != expected) {
+            std::cerr << "pipe: wrong result " << sink.cnt << " " << sink.sum << "\n";
+            return -1;
+        }
+        // the threads (nw+4) spend most of the time waiting for the Source
+        if (cpu > wall) {
+            std::cerr << "pipe: threads do not park while idle\n";
+            return -1;
+        }
+    }
+    {
+        // accelerator, the main thread parks in load_result
+        ff_Farm<long> farm([nw]() {
+                std::vector<std::unique_ptr<ff_node> > W;
+                for(long i=0;i<nw;++i) W.push_back(make_unique<Worker>());
+                return W;
+            } (), true);
+        if (farm.run_then_freeze()<0) {
+            error("running farm\n");
+            return -1;
+        }
+        long sum=0;
+        for(long i=1;i<=burst;++i) {
+            farm.offload((void*)i);
+            long* r;
+            if (!farm.load_result(r)) {
+                std::cerr << "farm: unexpected EOS\n";
+                return -1;
+            }
+            sum += (long)r;
+        }
+        farm.offload((void *)FF_EOS);
+        long* r;
+        while(farm.load_result(r)) sum += (long)r;
+        farm.wait();
+        if (sum != burst*(burst+1)/2) {
+            std::cerr << "farm: wrong result " << sum << "\n";
+            return -1;
+        }
+    }
+    std::cout << "DONE\n";
+    return 0;
+}
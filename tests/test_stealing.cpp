@@ -0,0 +1,182 @@
+/* -*- Mode: C++; tab-width: 4; c-basic-offset: 4; indent-tabs-mode: nil -*- */
+/* ***************************************************************************
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License version 2 as 
+ *  published by the Free Software Foundation.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ *
+ *  As a special exception, you may use this file as part of a free software
+ *  library without restriction.  Specifically, if other files instantiate
+ *  templates or use macros or inline functions from this file, or you compile
+ *  this file and link it with other files to produce an executable, this
+ *  file does not by itself cause the resulting executable to be covered by
+ *  the GNU General Public License.  This exception does not however
+ *  invalidate any other reasons why the executable file might be covered by
+ *  the GNU General Public License.
+ *
+ ****************************************************************************
+ */
+
+/*
+ * Work-stealing scheduling of the farm.
+ *
+ *   farm(Emitter, Worker x nw, Collector)
+ *
+ * Tasks have irregular costs (one task out of 16 is much longer).
+ * In the second run the workers split the tasks recursively by pushing the
+ * sub-tasks in their own deque (ff_send_out_local), only the leaves are
+ * sent to the Collector. The farm is then used as an accelerator.
+ *
+ */
+
+#include <iostream>
+#include <ff/ff.hpp>
+
+using namespace ff;
+
+static inline void work(long n) {
+    volatile long x=0;
+    for(long i=0;i<n*100;++i) x += i;
+}
+
+struct Emitter: ff_node_t<long> {
+    Emitter(long ntasks):ntasks(ntasks) {}
+    long* svc(long*) {
+        for(long i=1;i<=ntasks;++i) ff_send_out((long*)i);
+        return EOS;
+    }
+    long ntasks;
+};
+
+struct Worker: ff_node_t<long> {
+    Worker(bool split):split(split) {}
+    // the task is computed here if the deque is full
+    void spawn(long t) {
+        if (ff_send_out_local((void*)t)) return;
+        long *r = svc((long*)t);
+        if (r != GO_ON) ff_send_out(r);
+    }
+    long* svc(long* in) {
+        long t = (long)in;
+        if (!split) {
+            if (t%16==0) usleep(2000); else work(100);
+            return in;
+        }
+        // t encodes the size of the sub-problem in the high bits
+        long size = t >> 20;
+        if (size>1) {
+            long base = t & ((1<<20)-1);
+            spawn(((size/2)<<20) | base);
+            spawn(((size-size/2)<<20) | base);
+            return GO_ON;
+        }
+        work(100);
+        return in;
+    }
+    bool split;
+};
+
+struct Collector: ff_node_t<long> {
+    long* svc(long* in) {
+        sum += (long)in & ((1<<20)-1);
+        ++cnt;
+        return GO_ON;
+    }
+    long sum=0, cnt=0;
+};
+
+int main(int argc, char* argv[]) {
+    long ntasks = 1000;
+    int  nw     = 4;
+    if (argc>1) {
+        if (argc!=3) {
+            std::cerr << "use: " << argv[0] << " ntasks nworkers\n";
+            return -1;
+        }
+        ntasks = std::stol(argv[1]);
+        nw     = std::stol(argv[2]);
+    }
+    {
+        Emitter   E(ntasks);
+        Collector C;
+        std::vector<std::unique_ptr<ff_node> > W;
+        for(int i=0;i<nw;++i) W.push_back(make_unique<Worker>(false));
+        ff_Farm<long> farm(std::move(W), E, C);
+        farm.set_scheduling_stealing();
+        if (farm.run_and_wait_end()<0) {
+            error("running farm\n");
+            return -1;
+        }
+        if (C.cnt != ntasks || C.sum != ntasks*(ntasks+1)/2) {
+            std::cerr << "wrong result " << C.cnt << " " << C.sum << "\n";
+            return -1;
+        }
+        std::cout << "irregular tasks, steals: " << farm.get_nsteals() << "\n";
+    }
+    {
+        // each task is split in 16 leaves
+        struct Source: ff_node_t<long> {
+            Source(long ntasks):ntasks(ntasks) {}
+            long* svc(long*) {
+                for(long i=1;i<=ntasks;++i) ff_send_out((long*)((16L<<20)|i));
+                return EOS;
+            }
+            long ntasks;
+        } E(ntasks/16);
+        Collector C;
+        std::vector<std::unique_ptr<ff_node> > W;
+        for(int i=0;i<nw;++i) W.push_back(make_unique<Worker>(true));
+        ff_Farm<long> farm(std::move(W), E, C);
+        farm.set_scheduling_stealing(2, 64);
+        if (farm.run_and_wait_end()<0) {
+            error("running farm\n");
+            return -1;
+        }
+        const long n = ntasks/16;
+        if (C.cnt != 16*n || C.sum != 16*(n*(n+1)/2)) {
+            std::cerr << "wrong result (split) " << C.cnt << " " << C.sum << "\n";
+            return -1;
+        }
+        std::cout << "recursive split, steals: " << farm.get_nsteals() << "\n";
+    }
+    {
+        // accelerator
+        std::vector<std::unique_ptr<ff_node> > W;
+        for(int i=0;i<nw;++i) W.push_back(make_unique<Worker>(false));
+        ff_Farm<long> farm(std::move(W), true);
+        farm.set_scheduling_stealing();
+        if (farm.run_then_freeze()<0) {
+            error("running farm\n");
+            return -1;
+        }
+        for(int k=0;k<2;++k) {
+            for(long i=1;i<=ntasks;++i) farm.offload((void*)i);
+            farm.offload((void *)FF_EOS);
+            long *r, sum=0, cnt=0;
+            while(farm.load_result(r)) { sum += (long)r; ++cnt; }
+            if (farm.wait_freezing()<0) {
+                error("waiting farm\n");
+                return -1;
+            }
+            if (cnt != ntasks || sum != ntasks*(ntasks+1)/2) {
+                std::cerr << "wrong result (accelerator) " << cnt << " " << sum << "\n";
+                return -1;
+            }
+            if (k==0 && farm.run_then_freeze()<0) {
+                error("running farm\n");
+                return -1;
+            }
+        }
+        farm.wait();
+    }
+    std::cout << "Done\n";
+    return 0;
+}
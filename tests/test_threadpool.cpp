@@ -0,0 +1,154 @@
+/* -*- Mode: C++; tab-width: 4; c-basic-offset: 4; indent-tabs-mode: nil -*- */
+/* ***************************************************************************
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License version 2 as
+ *  published by the Free Software Foundation.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ *
+ *  As a special exception, you may use this file as part of a free software
+ *  library without restriction.  Specifically, if other files instantiate
+ *  templates or use macros or inline functions from this file, or you compile
+ *  this file and link it with other files to produce an executable, this
+ *  file does not by itself cause the resulting executable to be covered by
+ *  the GNU General Public License.  This exception does not however
+ *  invalidate any other reasons why the executable file might be covered by
+ *  the GNU General Public License.
+ *
+ ****************************************************************************
+ */
+
+/*
+ * Process-wide thread pool.
+ *
+ *   pipe(Source, farm(Worker x nw, Collector), Sink)
+ *
+ * Many short-lived pipelines are built and run one after the other, the
+ * pool has to create the OS threads only for the first one. The same is
+ * done with the pool disabled to compare the time.
+ */
+
+#include <iostream>
+#include <chrono>
+#include <ff/ff.hpp>
+
+using namespace ff;
+
+struct Source: ff_node_t<long> {
+    Source(long ntasks):ntasks(ntasks) {}
+    long* svc(long*) {
+        for(long i=1;i<=ntasks;++i) ff_send_out((long*)i);
+        return EOS;
+    }
+    long ntasks;
+};
+struct Worker: ff_node_t<long> {
+    long* svc(long* t) { return t; }
+};
+struct Collector: ff_node_t<long> {
+    long* svc(long* t) { return t; }
+};
+struct Sink: ff_node_t<long> {
+    long* svc(long* t) { sum += (long)t; return GO_ON; }
+    long sum=0;
+};
+
+// builds and runs niter pipelines, it returns the time in ms (-1 on error)
+static double run(int niter, int nworkers, long ntasks) {
+    auto t0 = std::chrono::steady_clock::now();
+    for(int k=0;k<niter;++k) {
+        Source S(ntasks); Collector C; Sink K;
+        std::vector<ff_node*> W;
+        for(int i=0;i<nworkers;++i) W.push_back(new Worker);
+        ff_farm farm(W, nullptr, &C);
+        farm.cleanup_workers();
+        ff_pipeline pipe;
+        pipe.add_stage(&S);
+        pipe.add_stage(&farm);
+        pipe.add_stage(&K);
+        if (pipe.run_and_wait_end()<0) {
+            error("running pipeline\n");
+            return -1;
+        }
+        if (K.sum != ntasks*(ntasks+1)/2) {
+            std::cerr << "ERROR: wrong result\n";
+            return -1;
+        }
+    }
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now()-t0).count();
+}
+
+int main(int argc, char* argv[]) {
+    int  nworkers = 3;
+    int  niter    = 50;
+    long ntasks   = 100;
+    if (argc>1) {
+        if (argc<4) {
+            std::cerr << "use: " << argv[0] << " nworkers niter ntasks\n";
+            return -1;
+        }
+        nworkers = atoi(argv[1]);
+        niter    = atoi(argv[2]);
+        ntasks   = atol(argv[3]);
+    }
+    // source, emitter, workers, collector and sink
+    const size_t nthreads = nworkers + 4;
+    ff_threadpool *pool = ff_threadpool::instance();
+
+    pool->enable(false);
+    const double tnopool = run(niter, nworkers, ntasks);
+    if (tnopool<0) return -1;
+    if (pool->created() != 0) {
+        std::cerr << "ERROR: threads created by the disabled pool\n";
+        return -1;
+    }
+    pool->enable();
+    const double tpool = run(niter, nworkers, ntasks);
+    if (tpool<0) return -1;
+    if (pool->created() != nthreads || pool->size() != nthreads || pool->idle() != nthreads) {
+        std::cerr << "ERROR: " << pool->created() << " threads created, "
+                  << pool->size() << " in the pool, " << pool->idle() << " idle, expected "
+                  << nthreads << "\n";
+        return -1;
+    }
+    std::cout << niter << " pipelines: " << tnopool << " ms without the pool, "
+              << tpool << " ms with the pool\n";
+
+    {   // a node frozen and thawed keeps its thread
+        Source S(ntasks); Sink K;
+        ff_pipeline pipe;
+        pipe.add_stage(&S);
+        pipe.add_stage(&K);
+        for(int i=0;i<3;++i) {
+            K.sum = 0;
+            if (pipe.run_then_freeze()<0 || pipe.wait_freezing()<0 || K.sum != ntasks*(ntasks+1)/2) {
+                std::cerr << "ERROR: running the pipeline with freezing\n";
+                return -1;
+            }
+        }
+        if (pipe.wait()<0) return -1;
+        if (pool->created() != nthreads || pool->idle() != nthreads) {
+            std::cerr << "ERROR: threads not given back to the pool\n";
+            return -1;
+        }
+    }
+    pool->set_max_idle(2);
+    if (pool->size() != 2) {
+        std::cerr << "ERROR: " << pool->size() << " threads after set_max_idle(2)\n";
+        return -1;
+    }
+    pool->shrink();
+    if (pool->size() != 0) {
+        std::cerr << "ERROR: the pool has not been emptied\n";
+        return -1;
+    }
+    std::cout << "DONE\n";
+    return 0;
+}
@@ -0,0 +1,189 @@
+/* -*- Mode: C++; tab-width: 4; c-basic-offset: 4; indent-tabs-mode: nil -*- */
+/* ***************************************************************************
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License version 2 as
+ *  published by the Free Software Foundation.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ *
+ *  As a special exception, you may use this file as part of a free software
+ *  library without restriction.  Specifically, if other files instantiate
+ *  templates or use macros or inline functions from this file, or you compile
+ *  this file and link it with other files to produce an executable, this
+ *  file does not by itself cause the resulting executable to be covered by
+ *  the GNU General Public License.  This exception does not however
+ *  invalidate any other reasons why the executable file might be covered by
+ *  the GNU General Public License.
+ *
+ ****************************************************************************
+ */
+
+/*
+ * Run-time timeline of the threads exported as a Chrome trace.
+ *
+ *   pipe(Source, farm(Worker x nw, Collector), Sink)
+ *
+ * The pipeline is run with the timeline disabled (no event recorded),
+ * then enabled, then frozen and thawed. The trace file has to contain
+ * one track for each thread and one svc event for each task served by
+ * the workers. Finally a thread changes its name (as the threads of the 
+ * pool do), its events have to be labelled with the right name.
+ */
+
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <ff/ff.hpp>
+
+using namespace ff;
+
+struct Source: ff_node_t<long> {
+    Source(long ntasks):ntasks(ntasks) {}
+    long* svc(long*) {
+        for(long i=1;i<=ntasks;++i) ff_send_out((long*)i);
+        return EOS;
+    }
+    long ntasks;
+};
+struct Worker: ff_node_t<long> {
+    long* svc(long* t) { usleep(5); return t; }
+};
+struct Collector: ff_node_t<long> {
+    long* svc(long* t) { return t; }
+};
+struct Sink: ff_node_t<long> {
+    int svc_init() { sum=0; return 0; }
+    long* svc(long* t) { sum += (long)t; return GO_ON; }
+    long sum=0;
+};
+
+static size_t count(const std::string &s, const std::string &what) {
+    size_t n=0;
+    for(size_t p=s.find(what); p!=std::string::npos; p=s.find(what, p+what.size())) ++n;
+    return n;
+}
+
+int main(int argc, char* argv[]) {
+    int  nworkers = 3;
+    long ntasks   = 2000;
+    if (argc>1) {
+        if (argc<3) {
+            std::cerr << "use: " << argv[0] << " nworkers ntasks\n";
+            return -1;
+        }
+        nworkers = atoi(argv[1]);
+        ntasks   = atol(argv[2]);
+    }
+    const long expected = ntasks*(ntasks+1)/2;
+
+    Source S(ntasks); Collector C; Sink K;
+    std::vector<ff_node*> W;
+    for(int i=0;i<nworkers;++i) W.push_back(new Worker);
+    ff_farm farm(W, nullptr, &C);
+    farm.cleanup_workers();
+    ff_pipeline pipe;
+    pipe.add_stage(&S);
+    pipe.add_stage(&farm);
+    pipe.add_stage(&K);
+
+    // disabled
+    if (pipe.run_then_freeze()<0 || pipe.wait_freezing()<0) {
+        error("running pipeline\n");
+        return -1;
+    }
+    if (K.sum != expected || ff_timeline::nthreads() != 0) {
+        std::cerr << "ERROR: events recorded with the timeline disabled\n";
+        return -1;
+    }
+    // enabled, two runs so that the threads are frozen in between
+    ff_timeline::start();
+    for(int i=0;i<2;++i) {
+        if (pipe.run_then_freeze()<0 || pipe.wait_freezing()<0) {
+            error("running pipeline\n");
+            return -1;
+        }
+        if (K.sum != expected) {
+            std::cerr << "ERROR: wrong result\n";
+            return -1;
+        }
+    }
+    ff_timeline::stop();
+    pipe.wait();
+
+    const std::string file = "/tmp/test_timeline.json";
+    if (ff_timeline::dump(file)<0) return -1;
+    std::ifstream in(file);
+    std::stringstream ss; ss << in.rdbuf();
+    const std::string trace = ss.str();
+    std::remove(file.c_str());
+
+    // source, emitter, workers, collector and sink
+    const size_t nthreads = ff_timeline::nthreads();
+    if (nthreads != (size_t)nworkers + 4 || count(trace, "\"thread_name\"") != nthreads) {
+        std::cerr << "ERROR: " << nthreads << " threads in the timeline\n";
+        return -1;
+    }
+    if (count(trace, "\"name\":\"emitter ") != 1 || count(trace, "\"name\":\"collector ") != 1 ||
+        count(trace, "\"name\":\"node ") != (size_t)nworkers+2) {
+        std::cerr << "ERROR: wrong thread names\n";
+        return -1;
+    }
+    // every task is served twice by a worker, the collector and the sink
+    // (the emitter has no filter)
+    const size_t nsvc = count(trace, "\"name\":\"svc\"");
+    if (nsvc < (size_t)(2*3*ntasks)) {
+        std::cerr << "ERROR: " << nsvc << " svc events\n";
+        return -1;
+    }
+    if (count(trace, "\"name\":\"frozen\"") == 0 || count(trace, "\"name\":\"EOS\"") == 0) {
+        std::cerr << "ERROR: missing frozen/EOS events\n";
+        return -1;
+    }
+    if (trace.find("{\"displayTimeUnit\"") != 0 || trace.find("]}") == std::string::npos) {
+        std::cerr << "ERROR: malformed trace\n";
+        return -1;
+    }
+    ff_timeline::clear();
+    if (ff_timeline::nthreads() != 0) {
+        std::cerr << "ERROR: timeline not cleared\n";
+        return -1;
+    }
+    // one thread runs the node A, then B, then A again
+    ff_timeline::start();
+    std::thread t([]() {
+            const char *seq[] = { "node A", "node B", "node A" };
+            for(const char *name: seq) {
+                ff_timeline::set_thread_name(name);
+                ff_timeline::instant(ff_timeline::EOS);
+            }
+        });
+    t.join();
+    ff_timeline::stop();
+    if (ff_timeline::dump(file)<0) return -1;
+    {
+        std::ifstream in(file);
+        std::stringstream ss; ss << in.rdbuf();
+        const std::string trace = ss.str();
+        std::remove(file.c_str());
+        // two tracks, the one of A (2 EOS events) is written before the one of B (1 EOS)
+        const size_t a = trace.find("\"name\":\"node A\""), b = trace.find("\"name\":\"node B\"");
+        if (ff_timeline::nthreads() != 2 || a == std::string::npos || b == std::string::npos || b < a ||
+            count(trace.substr(a, b-a), "\"name\":\"EOS\"") != 2 ||
+            count(trace.substr(b), "\"name\":\"EOS\"") != 1) {
+            std::cerr << "ERROR: events of a renamed thread\n";
+            return -1;
+        }
+    }
+    ff_timeline::clear();
+    std::cout << "DONE (" << nthreads << " threads, " << nsvc << " svc events)\n";
+    return 0;
+}